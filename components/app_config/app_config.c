@@ -5,26 +5,268 @@
 #include "lwip/ip_addr.h"
 #include <string.h>
 #include "tcp_client.h"  
+#include "config_storage.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "sdkconfig.h"
+#include "metrics.h"
+#include "task_layout.h"
 
 static const char *TAG = "APP_CONFIG";
-AppConfig globalConfig;  // Define global config object
 
-//Triggers on config load/save. Starts or stops TCP task based on mode.
-void handle_config_change(void) {
-    stop_tcp_client_service();
-    ESP_LOGE(TAG, "Stopping tcp-service");
-    vTaskDelay(pdMS_TO_TICKS(1500));  // delay before restarting
-    if (globalConfig.tcpEnabled) {
-        ESP_LOGE(TAG, "Start tcp-service as regular");
-        start_tcp_client_service(TCP_MODE_REGULAR);
-    } else if (globalConfig.companionMode) {
-        ESP_LOGE(TAG, "Start tcp-service as companion");
-        start_tcp_client_service(TCP_MODE_COMPANION);
+//*************** Published config (double-buffered seqlock) *****************************//
+//
+// The live config is published as immutable versions. The writer updates the two copies one
+// after the other and bumps config_seq around each copy; readers pick the copy that is not being
+// written (config_seq & 1) and retry only if a whole publish raced with their copy.
+// Writers (httpd save, boot load) are serialized by publish_lock.
+//
+// Readers and the writer touch the copies only through relaxed atomic loads and stores, so a
+// racing read is a retry rather than a data race (and ThreadSanitizer agrees). On the target
+// these compile to plain loads and stores.
+
+static AppConfig config_copies[2];
+static volatile uint32_t config_seq = 0;
+static SemaphoreHandle_t publish_lock = NULL;
+
+// Word-wise when both sides are aligned, byte-wise otherwise (fields inside packed structs)
+static void copy_relaxed(void *dst, const void *src, size_t size) {
+    if ((((uintptr_t)dst | (uintptr_t)src | size) & 3) == 0) {
+        uint32_t *d = dst;
+        const uint32_t *s = src;
+        for (size_t i = 0; i < size / 4; i++) {
+            __atomic_store_n(&d[i], __atomic_load_n(&s[i], __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+        }
+    } else {
+        uint8_t *d = dst;
+        const uint8_t *s = src;
+        for (size_t i = 0; i < size; i++) {
+            __atomic_store_n(&d[i], __atomic_load_n(&s[i], __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+        }
+    }
+}
+
+uint32_t config_snapshot(AppConfig *out) {
+    uint32_t seq;
+    do {
+        seq = __atomic_load_n(&config_seq, __ATOMIC_ACQUIRE);
+        copy_relaxed(out, &config_copies[seq & 1], sizeof(AppConfig));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&config_seq, __ATOMIC_RELAXED) != seq);
+    return seq >> 1;
+}
+
+#define COPY_FIELD(field) copy_relaxed(&out->field, &src->field, sizeof(out->field))
+
+uint32_t config_snapshot_sinks(SinkConfig *out) {
+    uint32_t seq;
+    do {
+        seq = __atomic_load_n(&config_seq, __ATOMIC_ACQUIRE);
+        const AppConfig *src = &config_copies[seq & 1];
+        COPY_FIELD(companionMode);
+        COPY_FIELD(serialEnabled);
+        COPY_FIELD(tcpEnabled);
+        COPY_FIELD(httpEnabled);
+        COPY_FIELD(companionIp);
+        COPY_FIELD(companionPort);
+        COPY_FIELD(tcpPort);
+        COPY_FIELD(tcpIp);
+        COPY_FIELD(tcpUser);
+        COPY_FIELD(tcpPassword);
+        COPY_FIELD(httpUser);
+        COPY_FIELD(httpPassword);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&config_seq, __ATOMIC_RELAXED) != seq);
+    return seq >> 1;
+}
+
+uint32_t config_version(void) {
+    return __atomic_load_n(&config_seq, __ATOMIC_ACQUIRE) >> 1;
+}
+
+//*************** Deferred commits *****************************//
+//
+// save_config() only marks the config dirty and arms commit_timer, the flash write happens
+// CONFIG_APP_CONFIG_COMMIT_DELAY_MS after the first save of a burst. A shutdown handler flushes
+// whatever is still pending on esp_restart(). Power loss before the flush loses only the pending
+// change: the storage writes the other slot, so the previous record stays valid.
+//
+// The timer only wakes commit_task: an NVS write can erase a sector and block for tens of
+// milliseconds, which would hold up the settle timers and GPO patterns on the esp_timer task.
+
+static esp_timer_handle_t commit_timer = NULL;
+static TaskHandle_t commit_task = NULL;
+static SemaphoreHandle_t commit_lock = NULL;
+static volatile bool commit_pending = false;
+
+// Writes the live config now if a save is pending
+esp_err_t config_flush(void) {
+    if (!commit_lock) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(commit_lock, portMAX_DELAY);
+    if (!__atomic_exchange_n(&commit_pending, false, __ATOMIC_ACQ_REL)) {
+        xSemaphoreGive(commit_lock);
+        return ESP_OK;
+    }
+
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    esp_err_t err = config_storage_save(&cfg);
+    if (err != ESP_OK) {
+        __atomic_store_n(&commit_pending, true, __ATOMIC_RELEASE);  // retried on the next save or on restart
+    }
+    xSemaphoreGive(commit_lock);
+
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Configuration saved successfully.");
+    } else {
+        ESP_LOGE(TAG, "Failed to save config: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+static void commit_timer_cb(void *arg) {
+    xTaskNotifyGive(commit_task);
+}
+
+static void config_commit_task(void *arg) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        config_flush();
+    }
+}
+
+static void flush_on_shutdown(void) {
+    config_flush();
+}
+
+// Publishes cfg as the new live config. Caller holds publish_lock.
+static void publish_config(const AppConfig *cfg) {
+    __atomic_fetch_add(&config_seq, 1, __ATOMIC_RELEASE);    // odd: readers use copy 1
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    copy_relaxed(&config_copies[0], cfg, sizeof(AppConfig));
+    __atomic_fetch_add(&config_seq, 1, __ATOMIC_RELEASE);    // even: readers use copy 0
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    copy_relaxed(&config_copies[1], cfg, sizeof(AppConfig));
+}
+
+#define MAX_RELOAD_HOOKS 8
+#define FIELD_CHANGED(field) (memcmp(&before->field, &after->field, sizeof(before->field)) != 0)
+
+typedef struct {
+    uint32_t mask;
+    ConfigReloadHook hook;
+} ReloadHookEntry;
+
+static ReloadHookEntry reload_hooks[MAX_RELOAD_HOOKS];
+static int reload_hook_count = 0;
+
+// Registers a hook that runs whenever a config change touches any bit in mask
+esp_err_t register_config_reload_hook(uint32_t mask, ConfigReloadHook hook) {
+    if (reload_hook_count >= MAX_RELOAD_HOOKS) return ESP_ERR_NO_MEM;
+    reload_hooks[reload_hook_count].mask = mask;
+    reload_hooks[reload_hook_count].hook = hook;
+    reload_hook_count++;
+    return ESP_OK;
+}
+
+// Returns ConfigChange bits for every field group that differs between the two configs
+uint32_t config_diff(const AppConfig *before, const AppConfig *after) {
+    uint32_t changed = 0;
+
+    if (FIELD_CHANGED(deviceIp) || FIELD_CHANGED(gateway) || FIELD_CHANGED(subnetMask) ||
+        FIELD_CHANGED(backupIp) || FIELD_CHANGED(backupGateway) || FIELD_CHANGED(backupSubnetMask))
+        changed |= CONFIG_CHANGED_NETWORK;
+    if (FIELD_CHANGED(companionMode) || FIELD_CHANGED(companionIp) || FIELD_CHANGED(companionPort))
+        changed |= CONFIG_CHANGED_COMPANION;
+    if (FIELD_CHANGED(tcpEnabled) || FIELD_CHANGED(tcpIp) || FIELD_CHANGED(tcpPort))
+        changed |= CONFIG_CHANGED_TCP;
+    if (FIELD_CHANGED(tcpSecure) || FIELD_CHANGED(tcpUser) || FIELD_CHANGED(tcpPassword))
+        changed |= CONFIG_CHANGED_TCP_AUTH;
+    if (FIELD_CHANGED(httpEnabled) || FIELD_CHANGED(httpUrl) || FIELD_CHANGED(httpSecure) ||
+        FIELD_CHANGED(httpUser) || FIELD_CHANGED(httpPassword))
+        changed |= CONFIG_CHANGED_HTTP;
+    if (FIELD_CHANGED(serialEnabled))
+        changed |= CONFIG_CHANGED_SERIAL;
+    if (FIELD_CHANGED(adminPassword))
+        changed |= CONFIG_CHANGED_ADMIN;
+    if (FIELD_CHANGED(gpi) || FIELD_CHANGED(gpo) || FIELD_CHANGED(expander))
+        changed |= CONFIG_CHANGED_PINS;
+    if (FIELD_CHANGED(syslogEnabled) || FIELD_CHANGED(syslogIp) || FIELD_CHANGED(syslogPort))
+        changed |= CONFIG_CHANGED_SYSLOG;
+    if (FIELD_CHANGED(web))
+        changed |= CONFIG_CHANGED_WEB;
+    if (FIELD_CHANGED(ethRxMode))
+        changed |= CONFIG_CHANGED_ETH_RX;
+
+    return changed;
+}
+
+// Runs only the reloads the changed field groups need, against cfg (the config just published).
+// The TCP client serves both regular TCP and Companion mode, so it is restarted only when one
+// of those changed.
+void handle_config_change(uint32_t changed, const AppConfig *cfg) {
+    if (changed & (CONFIG_CHANGED_TCP | CONFIG_CHANGED_COMPANION)) {
+        if (tcp_client_is_running()) {
+            stop_tcp_client_service();
+            ESP_LOGE(TAG, "Stopping tcp-service");
+            vTaskDelay(pdMS_TO_TICKS(1500));  // delay before restarting
+        }
+        if (cfg->tcpEnabled) {
+            ESP_LOGE(TAG, "Start tcp-service as regular");
+            start_tcp_client_service(TCP_MODE_REGULAR);
+        } else if (cfg->companionMode) {
+            ESP_LOGE(TAG, "Start tcp-service as companion");
+            start_tcp_client_service(TCP_MODE_COMPANION);
+        }
+    }
+
+    for (int i = 0; i < reload_hook_count; i++) {
+        if (reload_hooks[i].mask & changed) {
+            reload_hooks[i].hook(changed, cfg);
+        }
+    }
+}
+
+// Publishes new_config as the live config. Unchanged configs are not written to flash,
+// changed ones are persisted and only the affected subsystems are reloaded.
+// Runs on the httpd stack: the diff reads the published copy in place, which only writers
+// holding publish_lock modify, and the hooks get new_config instead of taking snapshots.
+esp_err_t apply_config(const AppConfig *new_config) {
+    xSemaphoreTake(publish_lock, portMAX_DELAY);
+    uint32_t changed = config_diff(&config_copies[1], new_config);
+    if (changed == 0) {
+        xSemaphoreGive(publish_lock);
+        ESP_LOGI(TAG, "Configuration unchanged, nothing to save.");
+        return ESP_OK;
     }
+    publish_config(new_config);
+    xSemaphoreGive(publish_lock);
+
+    esp_err_t err = save_config();
+    ESP_LOGI(TAG, "Configuration changed (mask 0x%02lx)", (unsigned long)changed);
+    handle_config_change(changed, new_config);
+    return err;
 }
 
 // Init the NVS storage that holds device config
 esp_err_t init_config() {
+    publish_lock = xSemaphoreCreateMutex();
+    commit_lock = xSemaphoreCreateMutex();
+    if (!publish_lock || !commit_lock) return ESP_ERR_NO_MEM;
+
+    if (task_layout_create(TASK_CONFIG_COMMIT, config_commit_task, NULL, &commit_task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    const esp_timer_create_args_t commit_timer_args = {
+        .callback = commit_timer_cb,
+        .name = "config_commit",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&commit_timer_args, &commit_timer));
+    ESP_ERROR_CHECK(esp_register_shutdown_handler(flush_on_shutdown));
+
     esp_err_t err = nvs_flash_init();
 
     // If NVS storage needs to be reflashed (duo size change for example) - we erase and re-init it.
@@ -45,90 +287,157 @@ esp_err_t init_config() {
     return ESP_OK;
 }
 
-//Load the config data from NVS to in-memory globalConfig
+//Load the config data from NVS and publish it as the live config
 esp_err_t load_config(void) {
-    nvs_handle_t nvs_handle; // This will hold the config data from NVS
+    // Start from defaults so fields missing from an older stored format, or a failed read,
+    // never leave the live config uninitialized.
+    AppConfig loaded;
+    config_factory_defaults(&loaded);
 
-    esp_err_t err = nvs_open("storage", NVS_READWRITE, &nvs_handle);  //Open NVS in READWRITE mode and copy it to nvs_handle
+    esp_err_t err = config_storage_load(&loaded); // Newest valid slot, migrated to the current format
 
-    // On Err
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to open NVS namespace 'storage': %s", esp_err_to_name(err));
-        return err;
+    // If no data - publish default values.
+    if (err == ESP_ERR_NOT_FOUND) {
+        ESP_LOGW(TAG, "No config found in NVS, applying defaults...");
+        set_default_config();   //Publish defaults, schedules one write
+        return ESP_OK;
     }
 
-    size_t size = sizeof(AppConfig); // Get size of AppConfig struct
-
-    err = nvs_get_blob(nvs_handle, "app_config", &globalConfig, &size); // Load blob from NVS into globalConfig ("app_config" is the key in namespace "storage")
-
-    // If no data - load to globalConfig default values.
-    if (err == ESP_ERR_NVS_NOT_FOUND) {
-        ESP_LOGW(TAG, "No config found in NVS, applying defaults...");
-        set_default_config();   //Use globalConfig
-        save_config();          //Save default config to NVS
-    } else if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to read config: %s", esp_err_to_name(err)); // Some error
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read config: %s, using defaults", esp_err_to_name(err)); // Some error
     } else {
         ESP_LOGI(TAG, "Configuration loaded successfully."); // OK
     }
 
-    nvs_close(nvs_handle); // Stop reading NVS and close the api
+    xSemaphoreTake(publish_lock, portMAX_DELAY);
+    publish_config(&loaded);
+    xSemaphoreGive(publish_lock);
     return ESP_OK;
 }
 
-//Saves current globalConfig to NVS.
+//Schedules the current live config to be written to NVS. Saves within the commit window
+//are merged into one write.
 esp_err_t save_config(void) {
-    
-    nvs_handle_t nvs_handle;
-    
-    esp_err_t err = nvs_open("storage", NVS_READWRITE, &nvs_handle);
-    
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to open NVS storage for writing: %s", esp_err_to_name(err));
-        return err;
-    }
+    bool was_pending = __atomic_exchange_n(&commit_pending, true, __ATOMIC_ACQ_REL);
 
-    err = nvs_set_blob(nvs_handle, "app_config", &globalConfig, sizeof(AppConfig));
-    if (err == ESP_OK) {
-        err = nvs_commit(nvs_handle); // Commit save
-        if (err == ESP_OK) {
-            ESP_LOGI(TAG, "Configuration saved successfully.");
-        } else {
-            ESP_LOGE(TAG, "Failed to commit config: %s", esp_err_to_name(err));
-        }
-    } else {
-        ESP_LOGE(TAG, "Failed to set config blob: %s", esp_err_to_name(err));
+    if (CONFIG_APP_CONFIG_COMMIT_DELAY_MS == 0 || !commit_timer) {
+        return config_flush();
+    }
+    if (was_pending && esp_timer_is_active(commit_timer)) {
+        metrics_inc(METRIC_CONFIG_SAVES_COALESCED);
+        return ESP_OK;
     }
 
-    nvs_close(nvs_handle);
-    handle_config_change(); // Once app configuration changed - call change handler func.
+    esp_err_t err = esp_timer_start_once(commit_timer, CONFIG_APP_CONFIG_COMMIT_DELAY_MS * 1000ULL);
+    if (err == ESP_ERR_INVALID_STATE) {
+        err = ESP_OK;  // armed concurrently, the running timer picks this save up
+    }
     return err;
 }
 
-//Set default values to globalConfig, save in to NVS, save triggers change handler func.
-void set_default_config(void) {
-    globalConfig.deviceIp = ipaddr_addr("10.168.0.177");
-    globalConfig.gateway = ipaddr_addr("10.168.0.1");
-    globalConfig.subnetMask = ipaddr_addr("255.255.255.0");
+// Factory defaults
+void config_factory_defaults(AppConfig *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->deviceIp = ipaddr_addr("10.168.0.177");
+    cfg->gateway = ipaddr_addr("10.168.0.1");
+    cfg->subnetMask = ipaddr_addr("255.255.255.0");
+    cfg->backupIp = ipaddr_addr("0.0.0.0");
+    cfg->backupGateway = ipaddr_addr("0.0.0.0");
+    cfg->backupSubnetMask = ipaddr_addr("255.255.255.0");
 
-    globalConfig.companionIp = ipaddr_addr("0.0.0.0");
-    globalConfig.companionPort = 9567;
-    globalConfig.companionMode = 0;
+    cfg->companionIp = ipaddr_addr("0.0.0.0");
+    cfg->companionPort = 9567;
+    cfg->companionMode = 0;
     
-    globalConfig.tcpEnabled = 0;
-    globalConfig.tcpIp = ipaddr_addr("0.0.0.0");
-    globalConfig.tcpPort = 0;
-    globalConfig.tcpSecure = 0;
-    memset(globalConfig.tcpUser, 0, sizeof(globalConfig.tcpUser));
-    memset(globalConfig.tcpPassword, 0, sizeof(globalConfig.tcpPassword));
-    globalConfig.httpEnabled = 0;
-    memset(globalConfig.httpUrl, 0, sizeof(globalConfig.httpUrl));
-    globalConfig.httpSecure = 0;
-    memset(globalConfig.httpUser, 0, sizeof(globalConfig.httpUser));
-    memset(globalConfig.httpPassword, 0, sizeof(globalConfig.httpPassword));
-    globalConfig.serialEnabled = 0;
-    strncpy(globalConfig.adminPassword, "admin", sizeof(globalConfig.adminPassword));
-    globalConfig.configFlag = 0xAA;
+    cfg->tcpEnabled = 0;
+    cfg->tcpIp = ipaddr_addr("0.0.0.0");
+    cfg->tcpPort = 0;
+    cfg->tcpSecure = 0;
+    memset(cfg->tcpUser, 0, sizeof(cfg->tcpUser));
+    memset(cfg->tcpPassword, 0, sizeof(cfg->tcpPassword));
+    cfg->httpEnabled = 0;
+    memset(cfg->httpUrl, 0, sizeof(cfg->httpUrl));
+    cfg->httpSecure = 0;
+    memset(cfg->httpUser, 0, sizeof(cfg->httpUser));
+    memset(cfg->httpPassword, 0, sizeof(cfg->httpPassword));
+    cfg->serialEnabled = 0;
+    cfg->syslogEnabled = 0;
+    cfg->syslogIp = ipaddr_addr("0.0.0.0");
+    cfg->syslogPort = 514;
+    strncpy(cfg->adminPassword, "admin", sizeof(cfg->adminPassword));
+    cfg->configFlag = 0xAA;
+
+    // Board wiring, GPOs avoid the strapping pins 2, 5 and 12
+    static const uint8_t gpi_pins[GPI_PIN_COUNT] = {32, 33, 25, 26, 27, 14, 12, 13};
+    static const uint8_t gpo_pins[GPO_PIN_COUNT] = {16, 17, 21, 22, 4};
+    for (int i = 0; i < GPI_PIN_COUNT; i++) {
+        cfg->gpi[i].gpio = gpi_pins[i];
+        cfg->gpi[i].enabled = 1;
+        cfg->gpi[i].invert = 0;
+        cfg->gpi[i].pull = PIN_PULL_UP;
+        cfg->gpi[i].edges = PIN_EDGES_BOTH;
+        cfg->gpi[i].debounceUs = 50000;
+        cfg->gpi[i].mode = GPI_MODE_LEVEL;
+        cfg->gpi[i].reportMs = 1000;
+        cfg->gpi[i].reportThreshold = 0;
+        cfg->gpi[i].eventBurst = 20;
+        cfg->gpi[i].eventsPerMin = 600;
+    }
+    for (int i = 0; i < GPO_PIN_COUNT; i++) {
+        cfg->gpo[i].gpio = gpo_pins[i];
+        cfg->gpo[i].enabled = 1;
+        cfg->gpo[i].invert = 0;
+        memset(cfg->gpo[i].rule, 0, sizeof(cfg->gpo[i].rule));
+    }
+    for (int i = 0; i < GPIO_EXPANDER_COUNT; i++) {
+        cfg->expander[i].enabled = 0;
+        cfg->expander[i].address = 0x20 + i;
+        cfg->expander[i].intGpio = GPIO_EXPANDER_NO_INT;
+        cfg->expander[i].inputMask = 0xFFFF;
+        cfg->expander[i].invertMask = 0;
+        cfg->expander[i].pullUpMask = 0xFFFF;
+        cfg->expander[i].debounceUs = 50000;
+        cfg->expander[i].edges = PIN_EDGES_BOTH;
+        cfg->expander[i].eventBurst = 20;
+        cfg->expander[i].eventsPerMin = 600;
+    }
+
+    const TaskLayout *httpd = task_layout_get(TASK_HTTPD);
+    cfg->web.maxOpenSockets = CONFIG_WEB_SERVER_MAX_OPEN_SOCKETS;
+    cfg->web.backlogConn = CONFIG_WEB_SERVER_BACKLOG_CONN;
+#if CONFIG_WEB_SERVER_LRU_PURGE
+    cfg->web.lruPurge = 1;
+#endif
+#if CONFIG_WEB_SERVER_KEEP_ALIVE
+    cfg->web.keepAlive = 1;
+    cfg->web.keepAliveIdleS = CONFIG_WEB_SERVER_KEEP_ALIVE_IDLE_S;
+    cfg->web.keepAliveIntervalS = CONFIG_WEB_SERVER_KEEP_ALIVE_INTERVAL_S;
+    cfg->web.keepAliveCount = CONFIG_WEB_SERVER_KEEP_ALIVE_COUNT;
+#else
+    cfg->web.keepAliveIdleS = 5;    // used once keep-alive is switched on at runtime
+    cfg->web.keepAliveIntervalS = 5;
+    cfg->web.keepAliveCount = 3;
+#endif
+    cfg->web.taskPriority = httpd->priority;
+    cfg->web.taskCore = httpd->core == tskNO_AFFINITY ? WEB_TASK_CORE_ANY : httpd->core;
+    cfg->web.recvTimeoutS = CONFIG_WEB_SERVER_RECV_TIMEOUT_S;
+    cfg->web.sendTimeoutS = CONFIG_WEB_SERVER_SEND_TIMEOUT_S;
+
+#if CONFIG_ETH_RX_ADAPTIVE_POLL
+    cfg->ethRxMode = ETH_RX_MODE_ADAPTIVE;
+#else
+    cfg->ethRxMode = ETH_RX_MODE_DRIVER;
+#endif
+}
+
+//Publish default values as the live config and save them to NVS.
+void set_default_config(void) {
+    AppConfig defaults;
+    config_factory_defaults(&defaults);
+
+    xSemaphoreTake(publish_lock, portMAX_DELAY);
+    publish_config(&defaults);
+    xSemaphoreGive(publish_lock);
 
     ESP_LOGI(TAG, "Default configuration applied.");
     save_config();
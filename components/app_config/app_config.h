@@ -1,12 +1,102 @@
 #pragma once
 
 #include "esp_err.h"
+#include <stdint.h>
+
+#define GPI_PIN_COUNT 8
+#define GPO_PIN_COUNT 5
+#define GPIO_EXPANDER_COUNT 4
+#define GPIO_EXPANDER_PINS 16
+#define GPIO_EXPANDER_NO_INT 0xFF  // intGpio of an expander that is polled
+// Native GPIs come first, then 16 per expander slot: GPI09-GPI24 on expander 1, ... GPI57-GPI72
+#define GPI_TOTAL_COUNT (GPI_PIN_COUNT + GPIO_EXPANDER_COUNT * GPIO_EXPANDER_PINS)
+
+typedef enum {
+    PIN_PULL_UP,
+    PIN_PULL_DOWN,
+    PIN_PULL_NONE
+} PinPull;
+
+typedef enum {
+    GPI_MODE_LEVEL,     // debounced level changes, one event per change
+    GPI_MODE_COUNTER    // hardware pulse counter, periodic aggregated reports
+} GpiMode;
+
+typedef enum {
+    PIN_EDGES_BOTH,
+    PIN_EDGES_RISING,   // only report the logical level going high (after inversion)
+    PIN_EDGES_FALLING
+} PinEdges;
+
+// Stored as one TLV record per pin, fields may only be appended
+typedef struct __attribute__((packed)) {
+    uint32_t debounceUs;    // level must hold this long before it is reported, 0 reports every edge
+    uint8_t gpio;
+    uint8_t enabled;
+    uint8_t invert;         // active-low: report the inverted pin level
+    uint8_t pull;           // PinPull
+    uint8_t edges;          // PinEdges, in counter mode the edges that are counted
+    uint8_t mode;           // GpiMode
+    uint16_t reportMs;      // counter mode: report at least this often, 0 = threshold only
+    uint32_t reportThreshold; // counter mode: report once this many edges came in, 0 = interval only
+    uint8_t eventBurst;     // token bucket size for events sent to sinks, 0 = no limit
+    uint16_t eventsPerMin;  // token refill rate
+} GpiPinConfig;
+
+typedef struct __attribute__((packed)) {
+    uint8_t gpio;
+    uint8_t enabled;
+    uint8_t invert;         // drive the inverted level
+    char rule[40];          // local GPI interlock, see gpio_rules.h; empty = network controlled
+} GpoPinConfig;
+
+// MCP23017 input expander on the I2C bus. Mask bit n is GPA0-GPA7 for n = 0-7, GPB0-GPB7 for 8-15.
+// Stored as one TLV record per expander, fields may only be appended.
+typedef struct __attribute__((packed)) {
+    uint8_t enabled;
+    uint8_t address;        // 7-bit I2C address, 0x20-0x27
+    uint8_t intGpio;        // GPIO wired to INTA (mirrored, open drain), GPIO_EXPANDER_NO_INT = polled
+    uint16_t inputMask;     // inputs that are reported
+    uint16_t invertMask;    // active-low inputs
+    uint16_t pullUpMask;    // internal 100k pull-ups, the chip has no pull-downs
+    uint32_t debounceUs;    // for every input, like GpiPinConfig.debounceUs
+    uint8_t edges;          // PinEdges
+    uint8_t eventBurst;
+    uint16_t eventsPerMin;
+} ExpanderConfig;
+
+// How frames are picked up from W5500 modules without an INT line, see eth_setup/eth_rx.h
+typedef enum {
+    ETH_RX_MODE_DRIVER,     // the driver's fixed poll period only
+    ETH_RX_MODE_ADAPTIVE    // extra polls, fast while frames arrive and backing off when idle
+} EthRxMode;
+
+#define WEB_TASK_CORE_ANY 2  // WebServerConfig.taskCore: no affinity
+
+// HTTP server tuning, see web_server/README.md. Factory values come from menuconfig (GPIO Box Web
+// Server) and the task layout. Stored as one TLV record, fields may only be appended.
+typedef struct __attribute__((packed)) {
+    uint8_t maxOpenSockets;
+    uint8_t backlogConn;
+    uint8_t lruPurge;           // close the least recently used client instead of refusing a new one
+    uint8_t keepAlive;          // TCP keep-alive on client sockets
+    uint16_t keepAliveIdleS;
+    uint16_t keepAliveIntervalS;
+    uint8_t keepAliveCount;
+    uint8_t taskPriority;       // httpd task
+    uint8_t taskCore;           // 0, 1 or WEB_TASK_CORE_ANY
+    uint8_t recvTimeoutS;
+    uint8_t sendTimeoutS;
+} WebServerConfig;
 
 // Configuration structure
 typedef struct {
     uint32_t deviceIp;
     uint32_t gateway;
     uint32_t subnetMask;
+    uint32_t backupIp;          // second Ethernet port, 0.0.0.0 leaves it down
+    uint32_t backupGateway;
+    uint32_t backupSubnetMask;
     uint32_t companionIp;
     uint16_t companionPort;
     uint8_t  companionMode;
@@ -24,14 +114,68 @@ typedef struct {
     uint8_t serialEnabled;
     char adminPassword[32];
     uint8_t configFlag;
+    GpiPinConfig gpi[GPI_PIN_COUNT];
+    GpoPinConfig gpo[GPO_PIN_COUNT];
+    ExpanderConfig expander[GPIO_EXPANDER_COUNT];
+    uint8_t syslogEnabled;      // stream log lines to a syslog collector over UDP
+    uint32_t syslogIp;
+    uint16_t syslogPort;
+    WebServerConfig web;
+    uint8_t ethRxMode;          // EthRxMode
 } AppConfig;
 
-// Global Config Instance
-extern AppConfig globalConfig;
+// Groups of fields, used to tell which subsystems a config change affects
+typedef enum {
+    CONFIG_CHANGED_NETWORK   = 1 << 0,  // deviceIp, gateway, subnetMask, backup port addresses
+    CONFIG_CHANGED_COMPANION = 1 << 1,  // companionMode, companionIp, companionPort
+    CONFIG_CHANGED_TCP       = 1 << 2,  // tcpEnabled, tcpIp, tcpPort
+    CONFIG_CHANGED_TCP_AUTH  = 1 << 3,  // tcpSecure, tcpUser, tcpPassword (read per message, no reconnect)
+    CONFIG_CHANGED_HTTP      = 1 << 4,  // httpEnabled, httpUrl, httpSecure, httpUser, httpPassword
+    CONFIG_CHANGED_SERIAL    = 1 << 5,  // serialEnabled
+    CONFIG_CHANGED_ADMIN     = 1 << 6,  // adminPassword
+    CONFIG_CHANGED_PINS      = 1 << 7,  // gpi, gpo pin maps, GPO rules and input expanders
+    CONFIG_CHANGED_SYSLOG    = 1 << 8,  // syslogEnabled, syslogIp, syslogPort
+    CONFIG_CHANGED_WEB       = 1 << 9,  // web (HTTP server sockets, timeouts and task placement)
+    CONFIG_CHANGED_ETH_RX    = 1 << 10, // ethRxMode
+    CONFIG_CHANGED_ALL       = 0x7FF
+} ConfigChange;
+
+// The fields the event sinks read for every message, see config_snapshot_sinks()
+typedef struct {
+    uint8_t companionMode;
+    uint8_t serialEnabled;
+    uint8_t tcpEnabled;
+    uint8_t httpEnabled;
+    uint32_t companionIp;
+    uint16_t companionPort;
+    uint16_t tcpPort;
+    uint32_t tcpIp;
+    char tcpUser[32];
+    char tcpPassword[32];
+    char httpUser[32];
+    char httpPassword[32];
+} SinkConfig;
+
+// Reload hook, called with the ConfigChange bits that actually changed and the config that was
+// just published. cfg is only valid during the call.
+typedef void (*ConfigReloadHook)(uint32_t changed, const AppConfig *cfg);
 
 // Function Declarations
 esp_err_t init_config(void);
 esp_err_t load_config(void);
-esp_err_t save_config(void);
+esp_err_t save_config(void);    // deferred, see CONFIG_APP_CONFIG_COMMIT_DELAY_MS
+esp_err_t config_flush(void);   // writes a pending save now
 void set_default_config(void);
-void handle_config_change(void);
\ No newline at end of file
+void config_factory_defaults(AppConfig *cfg);   // fills cfg, publishes nothing
+void handle_config_change(uint32_t changed, const AppConfig *cfg);
+
+// Copies a consistent view of the live config into out and returns its version.
+// Lock-free: safe from any task, never blocks on a writer.
+uint32_t config_snapshot(AppConfig *out);
+// Same for only the sink fields, for the event path where a whole AppConfig is too much stack
+uint32_t config_snapshot_sinks(SinkConfig *out);
+uint32_t config_version(void);
+
+uint32_t config_diff(const AppConfig *before, const AppConfig *after);
+esp_err_t apply_config(const AppConfig *new_config);
+esp_err_t register_config_reload_hook(uint32_t mask, ConfigReloadHook hook);
\ No newline at end of file
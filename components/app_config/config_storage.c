@@ -0,0 +1,396 @@
+#include "config_storage.h"
+#include "nvs.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "metrics.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "CONFIG_STORAGE";
+
+#define NVS_NAMESPACE   "storage"
+#define LEGACY_KEY      "app_config"                 // v1 raw struct
+#define CONFIG_MAGIC    0x46434247                   // "GBCF"
+#define CONFIG_BLOB_MAX 1024
+
+static const char *const slot_keys[2] = { "cfg_a", "cfg_b" };
+
+// Blob layout: header followed by `length` bytes of TLV records (tag, len, value)
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;
+    uint32_t sequence;   // incremented on every write, the higher valid slot wins
+    uint32_t crc;        // CRC32 of the TLV payload
+} ConfigBlobHeader;
+
+typedef enum {
+    TLV_INT,     // little-endian integer, len must equal the field size
+    TLV_STRING,  // bytes without terminator, len < field size
+    TLV_RECORD   // packed struct, a shorter record keeps the defaults of the missing tail fields
+} TlvType;
+
+typedef struct {
+    uint8_t tag;
+    TlvType type;
+    size_t offset;
+    size_t size;
+} TlvField;
+
+#define TLV(tag, type, member) { tag, type, offsetof(AppConfig, member), sizeof(((AppConfig *)0)->member) }
+
+// Tags are part of the on-flash format: never reuse or renumber them, only append.
+static const TlvField tlv_fields[] = {
+    TLV(1,  TLV_INT,    deviceIp),
+    TLV(2,  TLV_INT,    gateway),
+    TLV(3,  TLV_INT,    subnetMask),
+    TLV(4,  TLV_INT,    companionIp),
+    TLV(5,  TLV_INT,    companionPort),
+    TLV(6,  TLV_INT,    companionMode),
+    TLV(7,  TLV_INT,    tcpEnabled),
+    TLV(8,  TLV_INT,    tcpIp),
+    TLV(9,  TLV_INT,    tcpPort),
+    TLV(10, TLV_INT,    tcpSecure),
+    TLV(11, TLV_STRING, tcpUser),
+    TLV(12, TLV_STRING, tcpPassword),
+    TLV(13, TLV_INT,    httpEnabled),
+    TLV(14, TLV_STRING, httpUrl),
+    TLV(15, TLV_INT,    httpSecure),
+    TLV(16, TLV_STRING, httpUser),
+    TLV(17, TLV_STRING, httpPassword),
+    TLV(18, TLV_INT,    serialEnabled),
+    TLV(19, TLV_STRING, adminPassword),
+    TLV(20, TLV_INT,    configFlag),
+    TLV(21, TLV_INT,    backupIp),
+    TLV(22, TLV_INT,    backupGateway),
+    TLV(23, TLV_INT,    backupSubnetMask),
+    TLV(24, TLV_RECORD, gpi[0]),
+    TLV(25, TLV_RECORD, gpi[1]),
+    TLV(26, TLV_RECORD, gpi[2]),
+    TLV(27, TLV_RECORD, gpi[3]),
+    TLV(28, TLV_RECORD, gpi[4]),
+    TLV(29, TLV_RECORD, gpi[5]),
+    TLV(30, TLV_RECORD, gpi[6]),
+    TLV(31, TLV_RECORD, gpi[7]),
+    TLV(32, TLV_RECORD, gpo[0]),
+    TLV(33, TLV_RECORD, gpo[1]),
+    TLV(34, TLV_RECORD, gpo[2]),
+    TLV(35, TLV_RECORD, gpo[3]),
+    TLV(36, TLV_RECORD, gpo[4]),
+    TLV(37, TLV_RECORD, expander[0]),
+    TLV(38, TLV_RECORD, expander[1]),
+    TLV(39, TLV_RECORD, expander[2]),
+    TLV(40, TLV_RECORD, expander[3]),
+    TLV(41, TLV_INT,    syslogEnabled),
+    TLV(42, TLV_INT,    syslogIp),
+    TLV(43, TLV_INT,    syslogPort),
+    TLV(44, TLV_RECORD, web),
+    TLV(45, TLV_INT,    ethRxMode),
+};
+
+#define TLV_FIELD_COUNT (sizeof(tlv_fields) / sizeof(tlv_fields[0]))
+
+// Frozen copy of the v1 AppConfig layout (256 bytes). Do not edit.
+typedef struct {
+    uint32_t deviceIp;
+    uint32_t gateway;
+    uint32_t subnetMask;
+    uint32_t companionIp;
+    uint16_t companionPort;
+    uint8_t  companionMode;
+    uint8_t tcpEnabled;
+    uint32_t tcpIp;
+    uint16_t tcpPort;
+    uint8_t tcpSecure;
+    char tcpUser[32];
+    char tcpPassword[32];
+    uint8_t httpEnabled;
+    char httpUrl[64];
+    uint8_t httpSecure;
+    char httpUser[32];
+    char httpPassword[32];
+    uint8_t serialEnabled;
+    char adminPassword[32];
+    uint8_t configFlag;
+} LegacyAppConfigV1;
+
+_Static_assert(sizeof(LegacyAppConfigV1) == 256, "v1 layout must not change");
+
+static uint32_t last_sequence = 0;
+static int last_slot = -1;
+static uint32_t last_crc = 0;       // payload CRC/length of last_slot, to skip identical rewrites
+static uint16_t last_length = 0;
+
+//*************** Migrations *****************************//
+
+// Forward migrations, indexed by the version they upgrade from. Each one fixes up field
+// semantics after decoding; new fields need none because missing tags keep their defaults.
+typedef void (*ConfigMigration)(AppConfig *cfg);
+
+static const ConfigMigration migrations[CONFIG_FORMAT_VERSION] = {
+    [0] = NULL,
+    [1] = NULL,  // v1 -> v2: same fields, only the container changed (see decode_legacy_v1)
+};
+
+static void run_migrations(AppConfig *cfg, uint16_t from_version) {
+    for (uint16_t v = from_version; v < CONFIG_FORMAT_VERSION; v++) {
+        if (migrations[v]) migrations[v](cfg);
+        ESP_LOGW(TAG, "Migrated config v%d -> v%d", v, v + 1);
+    }
+}
+
+static void copy_string(char *dst, size_t dst_size, const char *src, size_t src_size) {
+    size_t len = strnlen(src, src_size);
+    if (len >= dst_size) len = dst_size - 1;
+    memset(dst, 0, dst_size);
+    memcpy(dst, src, len);
+}
+
+static void decode_legacy_v1(const LegacyAppConfigV1 *old, AppConfig *cfg) {
+    cfg->deviceIp = old->deviceIp;
+    cfg->gateway = old->gateway;
+    cfg->subnetMask = old->subnetMask;
+    cfg->companionIp = old->companionIp;
+    cfg->companionPort = old->companionPort;
+    cfg->companionMode = old->companionMode;
+    cfg->tcpEnabled = old->tcpEnabled;
+    cfg->tcpIp = old->tcpIp;
+    cfg->tcpPort = old->tcpPort;
+    cfg->tcpSecure = old->tcpSecure;
+    copy_string(cfg->tcpUser, sizeof(cfg->tcpUser), old->tcpUser, sizeof(old->tcpUser));
+    copy_string(cfg->tcpPassword, sizeof(cfg->tcpPassword), old->tcpPassword, sizeof(old->tcpPassword));
+    cfg->httpEnabled = old->httpEnabled;
+    copy_string(cfg->httpUrl, sizeof(cfg->httpUrl), old->httpUrl, sizeof(old->httpUrl));
+    cfg->httpSecure = old->httpSecure;
+    copy_string(cfg->httpUser, sizeof(cfg->httpUser), old->httpUser, sizeof(old->httpUser));
+    copy_string(cfg->httpPassword, sizeof(cfg->httpPassword), old->httpPassword, sizeof(old->httpPassword));
+    cfg->serialEnabled = old->serialEnabled;
+    copy_string(cfg->adminPassword, sizeof(cfg->adminPassword), old->adminPassword, sizeof(old->adminPassword));
+    cfg->configFlag = old->configFlag;
+}
+
+//*************** TLV encode / decode *****************************//
+
+static size_t encode_tlv(const AppConfig *cfg, uint8_t *out, size_t out_size) {
+    size_t pos = 0;
+    for (size_t i = 0; i < TLV_FIELD_COUNT; i++) {
+        const TlvField *f = &tlv_fields[i];
+        const uint8_t *src = (const uint8_t *)cfg + f->offset;
+        size_t len = (f->type == TLV_STRING) ? strnlen((const char *)src, f->size - 1) : f->size;
+
+        if (pos + 2 + len > out_size) return 0;
+        out[pos++] = f->tag;
+        out[pos++] = (uint8_t)len;
+        memcpy(out + pos, src, len);
+        pos += len;
+    }
+    return pos;
+}
+
+static const TlvField *find_tlv_field(uint8_t tag) {
+    for (size_t i = 0; i < TLV_FIELD_COUNT; i++) {
+        if (tlv_fields[i].tag == tag) return &tlv_fields[i];
+    }
+    return NULL;
+}
+
+static bool decode_tlv(const uint8_t *data, size_t len, AppConfig *cfg) {
+    size_t pos = 0;
+    while (pos < len) {
+        if (pos + 2 > len) return false;
+        uint8_t tag = data[pos];
+        uint8_t vlen = data[pos + 1];
+        pos += 2;
+        if (pos + vlen > len) return false;
+
+        const TlvField *f = find_tlv_field(tag);
+        uint8_t *dst = (uint8_t *)cfg + (f ? f->offset : 0);
+        if (!f) {
+            // Unknown tag from a newer firmware, skip it
+        } else if (f->type == TLV_INT && vlen == f->size) {
+            memcpy(dst, data + pos, vlen);
+        } else if (f->type == TLV_STRING && vlen < f->size) {
+            memset(dst, 0, f->size);
+            memcpy(dst, data + pos, vlen);
+        } else if (f->type == TLV_RECORD) {
+            // Older records are a prefix, newer ones only appended fields we don't know
+            memcpy(dst, data + pos, vlen < f->size ? vlen : f->size);
+        } else {
+            ESP_LOGW(TAG, "Ignoring tag %d with unexpected length %d", tag, vlen);
+        }
+        pos += vlen;
+    }
+    return true;
+}
+
+//*************** Slots *****************************//
+
+// Reads and validates one slot. Returns true and fills header/payload on success.
+static bool read_slot(nvs_handle_t nvs, int slot, ConfigBlobHeader *hdr, uint8_t *blob) {
+    size_t size = CONFIG_BLOB_MAX;
+    if (nvs_get_blob(nvs, slot_keys[slot], blob, &size) != ESP_OK) return false;
+    if (size < sizeof(ConfigBlobHeader)) return false;
+
+    memcpy(hdr, blob, sizeof(*hdr));
+    if (hdr->magic != CONFIG_MAGIC || hdr->length != size - sizeof(*hdr)) {
+        ESP_LOGW(TAG, "Slot %s has invalid header", slot_keys[slot]);
+        return false;
+    }
+    if (esp_rom_crc32_le(0, blob + sizeof(*hdr), hdr->length) != hdr->crc) {
+        ESP_LOGW(TAG, "Slot %s failed CRC check", slot_keys[slot]);
+        return false;
+    }
+    if (hdr->version > CONFIG_FORMAT_VERSION) {
+        // Written by newer firmware after a downgrade: TLV keeps it readable, tags we know still apply
+        ESP_LOGW(TAG, "Slot %s has newer format v%d", slot_keys[slot], hdr->version);
+    }
+    return true;
+}
+
+// Compares a slot's stored payload with payload, byte for byte
+static bool slot_matches(nvs_handle_t nvs, int slot, const uint8_t *payload, size_t len) {
+    uint8_t *stored = malloc(CONFIG_BLOB_MAX);
+    if (!stored) return false;
+
+    ConfigBlobHeader hdr;
+    bool match = read_slot(nvs, slot, &hdr, stored) && hdr.length == len &&
+                 memcmp(stored + sizeof(hdr), payload, len) == 0;
+    free(stored);
+    return match;
+}
+
+static esp_err_t load_legacy(nvs_handle_t nvs, AppConfig *cfg) {
+    LegacyAppConfigV1 legacy;
+    size_t size = sizeof(legacy);
+    esp_err_t err = nvs_get_blob(nvs, LEGACY_KEY, &legacy, &size);
+    if (err == ESP_ERR_NVS_NOT_FOUND) return ESP_ERR_NOT_FOUND;
+    if (err != ESP_OK || size != sizeof(legacy)) {
+        ESP_LOGE(TAG, "Legacy config unreadable (%s, %d bytes)", esp_err_to_name(err), (int)size);
+        return ESP_ERR_NOT_FOUND;
+    }
+    decode_legacy_v1(&legacy, cfg);
+    run_migrations(cfg, 1);
+    return ESP_OK;
+}
+
+esp_err_t config_storage_load(AppConfig *cfg) {
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS namespace '%s': %s", NVS_NAMESPACE, esp_err_to_name(err));
+        return err;
+    }
+
+    uint8_t *blob = malloc(CONFIG_BLOB_MAX);
+    if (!blob) {
+        nvs_close(nvs);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Pick the valid slot with the highest sequence. A write interrupted by power loss
+    // leaves the other slot intact, so we fall back to the previous config.
+    ConfigBlobHeader hdr[2];
+    bool valid[2];
+    for (int i = 0; i < 2; i++) {
+        valid[i] = read_slot(nvs, i, &hdr[i], blob);
+    }
+    int best = -1;
+    if (valid[0] && valid[1]) {
+        best = (int32_t)(hdr[1].sequence - hdr[0].sequence) > 0 ? 1 : 0;
+    } else if (valid[0] || valid[1]) {
+        best = valid[0] ? 0 : 1;
+    }
+
+    if (best >= 0) {
+        read_slot(nvs, best, &hdr[best], blob);  // blob holds the last slot read, reload the winner
+        if (!decode_tlv(blob + sizeof(ConfigBlobHeader), hdr[best].length, cfg)) {
+            ESP_LOGW(TAG, "Truncated TLV record in slot %s", slot_keys[best]);
+        }
+        last_slot = best;
+        last_sequence = hdr[best].sequence;
+        last_crc = hdr[best].crc;
+        last_length = hdr[best].length;
+        err = ESP_OK;
+
+        // Fast path: current version needs nothing else
+        if (hdr[best].version < CONFIG_FORMAT_VERSION) {
+            run_migrations(cfg, hdr[best].version);
+            err = config_storage_save(cfg);
+        }
+    } else {
+        err = load_legacy(nvs, cfg);
+        if (err == ESP_OK) {
+            // Write the new format first, drop the legacy blob only once that succeeded
+            if (config_storage_save(cfg) == ESP_OK) {
+                nvs_erase_key(nvs, LEGACY_KEY);
+                nvs_commit(nvs);
+            }
+        }
+    }
+
+    free(blob);
+    nvs_close(nvs);
+    return err;
+}
+
+esp_err_t config_storage_save(const AppConfig *cfg) {
+    uint8_t *blob = malloc(CONFIG_BLOB_MAX);
+    if (!blob) return ESP_ERR_NO_MEM;
+
+    size_t payload = encode_tlv(cfg, blob + sizeof(ConfigBlobHeader), CONFIG_BLOB_MAX - sizeof(ConfigBlobHeader));
+    if (payload == 0) {
+        free(blob);
+        ESP_LOGE(TAG, "Config does not fit in %d bytes", CONFIG_BLOB_MAX);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    ConfigBlobHeader hdr = {
+        .magic = CONFIG_MAGIC,
+        .version = CONFIG_FORMAT_VERSION,
+        .length = (uint16_t)payload,
+        .sequence = last_sequence + 1,
+        .crc = esp_rom_crc32_le(0, blob + sizeof(ConfigBlobHeader), payload),
+    };
+    memcpy(blob, &hdr, sizeof(hdr));
+
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        free(blob);
+        ESP_LOGE(TAG, "Failed to open NVS storage for writing: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    // Identical to the current slot: reading costs no erase cycles, writing does
+    if (last_slot >= 0 && hdr.crc == last_crc && hdr.length == last_length &&
+        slot_matches(nvs, last_slot, blob + sizeof(hdr), payload)) {
+        nvs_close(nvs);
+        free(blob);
+        metrics_inc(METRIC_CONFIG_SAVES_UNCHANGED);
+        ESP_LOGI(TAG, "Config unchanged on flash, commit skipped");
+        return ESP_OK;
+    }
+
+    // Never overwrite the slot holding the current config
+    int slot = (last_slot == 0) ? 1 : 0;
+    err = nvs_set_blob(nvs, slot_keys[slot], blob, sizeof(hdr) + payload);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    free(blob);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write config slot %s: %s", slot_keys[slot], esp_err_to_name(err));
+        return err;
+    }
+
+    last_slot = slot;
+    last_sequence = hdr.sequence;
+    last_crc = hdr.crc;
+    last_length = hdr.length;
+    metrics_inc(METRIC_CONFIG_FLASH_COMMITS);
+    return ESP_OK;
+}
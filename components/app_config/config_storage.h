@@ -0,0 +1,18 @@
+#pragma once
+
+#include "esp_err.h"
+#include "app_config.h"
+
+// On-flash config format version written by this firmware.
+//   v1 - raw AppConfig struct under NVS key "app_config" (firmware <= v1.00)
+//   v2 - CRC-protected TLV records, two alternating slots
+#define CONFIG_FORMAT_VERSION 2
+
+// Loads the newest valid config into cfg. Fields missing from the stored record keep the
+// values cfg already holds, so callers pre-fill it with defaults.
+// Returns ESP_ERR_NOT_FOUND when nothing valid is stored.
+esp_err_t config_storage_load(AppConfig *cfg);
+
+// Writes cfg in the current format to the older of the two slots. Skips the write (and returns
+// ESP_OK) when the newest slot already holds exactly this config. Not thread safe, callers serialize.
+esp_err_t config_storage_save(const AppConfig *cfg);
@@ -0,0 +1,105 @@
+#include "boot_timeline.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdio.h>
+
+static const char *TAG = "BOOT";
+
+typedef struct {
+    int64_t startUs;
+    int64_t endUs;
+    esp_err_t result;
+} BootStageRecord;
+
+static const char *const stage_names[BOOT_STAGE_COUNT] = {
+    [BOOT_STAGE_CONFIG]     = "config",
+    [BOOT_STAGE_JOURNAL]    = "journal",
+    [BOOT_STAGE_GPIO]       = "gpio",
+    [BOOT_STAGE_ETHERNET]   = "ethernet",
+    [BOOT_STAGE_SPIFFS]     = "spiffs",
+    [BOOT_STAGE_WEB_SERVER] = "web_server",
+    [BOOT_STAGE_LINK]       = "link",
+    [BOOT_STAGE_SINKS]      = "sinks",
+};
+
+static BootStageRecord stages[BOOT_STAGE_COUNT];
+static EventGroupHandle_t boot_events = NULL;
+static portMUX_TYPE stage_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void boot_timeline_init(void) {
+    boot_events = xEventGroupCreate();
+}
+
+void boot_stage_begin(BootStage stage) {
+    portENTER_CRITICAL(&stage_lock);
+    if (stages[stage].startUs == 0) {
+        stages[stage].startUs = esp_timer_get_time();
+    }
+    portEXIT_CRITICAL(&stage_lock);
+}
+
+void boot_stage_end(BootStage stage, esp_err_t result) {
+    int64_t now = esp_timer_get_time();
+    bool first = false;
+
+    portENTER_CRITICAL(&stage_lock);
+    if (stages[stage].endUs == 0) {
+        if (stages[stage].startUs == 0) stages[stage].startUs = now;
+        stages[stage].endUs = now;
+        stages[stage].result = result;
+        first = true;
+    }
+    portEXIT_CRITICAL(&stage_lock);
+
+    if (!first) return;
+    ESP_LOGI(TAG, "%s ready at %lld ms (%s)", stage_names[stage], now / 1000, esp_err_to_name(result));
+    xEventGroupSetBits(boot_events, BOOT_BIT(stage));
+}
+
+esp_err_t boot_run(BootStage stage, esp_err_t (*fn)(void)) {
+    boot_stage_begin(stage);
+    esp_err_t err = fn();
+    boot_stage_end(stage, err);
+    return err;
+}
+
+EventBits_t boot_wait(EventBits_t bits, TickType_t timeout) {
+    return xEventGroupWaitBits(boot_events, bits, pdFALSE, pdTRUE, timeout);
+}
+
+void boot_timeline_log(void) {
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+        const BootStageRecord *s = &stages[i];
+        if (s->endUs == 0) {
+            ESP_LOGI(TAG, "%-10s  not finished", stage_names[i]);
+            continue;
+        }
+        ESP_LOGI(TAG, "%-10s  %6lld -> %6lld ms  (%lld ms)", stage_names[i],
+                 s->startUs / 1000, s->endUs / 1000, (s->endUs - s->startUs) / 1000);
+    }
+}
+
+size_t boot_timeline_json(char *buf, size_t size) {
+    BootStageRecord snap[BOOT_STAGE_COUNT];
+    portENTER_CRITICAL(&stage_lock);
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++) snap[i] = stages[i];
+    portEXIT_CRITICAL(&stage_lock);
+
+    size_t len = 0;
+#define APPEND(...) do { \
+        int n = snprintf(buf + len, len < size ? size - len : 0, __VA_ARGS__); \
+        if (n > 0) len += n; \
+    } while (0)
+
+    APPEND("{\"stages\":[");
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+        const BootStageRecord *s = &snap[i];
+        const char *state = s->endUs ? (s->result == ESP_OK ? "done" : "failed") : (s->startUs ? "running" : "pending");
+        APPEND("%s{\"stage\":\"%s\",\"state\":\"%s\",\"startUs\":%lld,\"endUs\":%lld}",
+               i ? "," : "", stage_names[i], state, s->startUs, s->endUs);
+    }
+    APPEND("]}");
+#undef APPEND
+
+    return len < size ? len : (size ? size - 1 : 0);
+}
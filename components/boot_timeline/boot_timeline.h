@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+// Boot stages in dependency order. Each stage sets its bit in the boot event group when it ends,
+// dependent stages wait on those bits instead of polling.
+//
+//   CONFIG ─┬─ JOURNAL ── GPIO                  inputs live
+//           └─ ETHERNET ─┬─ WEB_SERVER          also waits for SPIFFS
+//                        └─ LINK ── SINKS       on IP_EVENT_ETH_GOT_IP
+//   SPIFFS runs alongside ETHERNET
+typedef enum {
+    BOOT_STAGE_CONFIG,      // NVS init, config load, config consumers
+    BOOT_STAGE_JOURNAL,     // event journal mount and recovery
+    BOOT_STAGE_GPIO,        // GPI sampling and GPO outputs
+    BOOT_STAGE_ETHERNET,    // W5500 driver and netif
+    BOOT_STAGE_SPIFFS,      // web assets
+    BOOT_STAGE_WEB_SERVER,
+    BOOT_STAGE_LINK,        // from driver start until the interface has its IP
+    BOOT_STAGE_SINKS,       // TCP / Companion client started
+
+    BOOT_STAGE_COUNT
+} BootStage;
+
+#define BOOT_BIT(stage) ((EventBits_t)1 << (stage))
+#define BOOT_ALL_BITS   (BOOT_BIT(BOOT_STAGE_COUNT) - 1)
+
+void boot_timeline_init(void);
+
+// Stage timestamps come from esp_timer_get_time(), i.e. microseconds since boot.
+// Ending a stage twice keeps the first result, so event handlers may call it on every event.
+void boot_stage_begin(BootStage stage);
+void boot_stage_end(BootStage stage, esp_err_t result);
+
+// Runs fn as a stage and returns its result
+esp_err_t boot_run(BootStage stage, esp_err_t (*fn)(void));
+
+// Waits until all bits are set, returns the bits set at return time
+EventBits_t boot_wait(EventBits_t bits, TickType_t timeout);
+
+void boot_timeline_log(void);
+
+// Writes the timeline as a JSON object, returns the length (truncated output if size is too small)
+size_t boot_timeline_json(char *buf, size_t size);
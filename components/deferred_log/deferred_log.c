@@ -0,0 +1,112 @@
+#include "deferred_log.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "metrics.h"
+#include "task_layout.h"
+
+#if CONFIG_DEFERRED_LOG_ENABLE
+
+#define RING_SIZE CONFIG_DEFERRED_LOG_RING_SIZE
+#define RING_MASK (RING_SIZE - 1)
+#define LINE_MAX_LEN 160
+
+_Static_assert((RING_SIZE & RING_MASK) == 0, "DEFERRED_LOG_RING_SIZE must be a power of two");
+
+// A writer claims an index with one atomic add, so writers never wait for each other or for the
+// printer. seq works like a seqlock: 0 while the record is being filled, index + 1 once it is
+// complete, which also tells the printer which lap of the ring the record belongs to.
+typedef struct {
+    volatile uint32_t seq;
+    const DlogSite *site;
+    int64_t timeUs;
+    uint32_t args[DLOG_MAX_ARGS];
+} DlogRecord;
+
+static DlogRecord ring[RING_SIZE];
+static volatile uint32_t ring_head;     // next index to claim
+static uint32_t ring_tail;              // next index to print, dlog_task only
+
+void IRAM_ATTR dlog_write(const DlogSite *site, ...) {
+    uint32_t index = __atomic_fetch_add(&ring_head, 1, __ATOMIC_RELAXED);
+    DlogRecord *rec = &ring[index & RING_MASK];
+
+    __atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    rec->site = site;
+    rec->timeUs = esp_timer_get_time();
+    va_list ap;
+    va_start(ap, site);
+    for (int i = 0; i < site->argc; i++) rec->args[i] = va_arg(ap, uint32_t);
+    va_end(ap);
+    __atomic_store_n(&rec->seq, index + 1, __ATOMIC_RELEASE);
+}
+
+// Copies the record at ring_tail. Returns false when there is none yet, or when its writer is
+// still busy; records the writers lapped are skipped and counted as dropped.
+static bool read_record(DlogRecord *out) {
+    while (1) {
+        uint32_t head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+        if (head - ring_tail > RING_SIZE) {
+            metrics_add(METRIC_LOG_DROPPED, head - ring_tail - RING_SIZE);
+            ring_tail = head - RING_SIZE;
+        }
+        if (ring_tail == head) return false;
+
+        DlogRecord *rec = &ring[ring_tail & RING_MASK];
+        uint32_t seq = __atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE);
+        if (seq != ring_tail + 1) {
+            if (seq == 0 || (int32_t)(seq - 1 - ring_tail) < 0) return false;  // claimed, not written yet
+            metrics_inc(METRIC_LOG_DROPPED);  // a later lap took the slot
+            ring_tail++;
+            continue;
+        }
+
+        *out = *rec;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&rec->seq, __ATOMIC_RELAXED) != seq) {
+            metrics_inc(METRIC_LOG_DROPPED);  // overwritten while it was copied
+            ring_tail++;
+            continue;
+        }
+        ring_tail++;
+        return true;
+    }
+}
+
+static void print_record(const DlogRecord *rec) {
+    static const char letters[] = "NEWIDV";
+    const DlogSite *site = rec->site;
+    char line[LINE_MAX_LEN];
+
+    // Every argument is a 32-bit word, which is also how integers and pointers are passed on
+    // this target, so the format can be replayed with all slots filled
+    snprintf(line, sizeof(line), site->format, rec->args[0], rec->args[1], rec->args[2], rec->args[3]);
+    esp_log_write(site->level, site->tag, "%c (%lu) %s: %s\n", letters[site->level],
+                  (unsigned long)(rec->timeUs / 1000), site->tag, line);
+}
+
+static void dlog_task(void *arg) {
+    DlogRecord rec;
+    while (1) {
+        while (read_record(&rec)) print_record(&rec);
+        metrics_set(METRIC_LOG_DEFERRED, __atomic_load_n(&ring_head, __ATOMIC_RELAXED));
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_DEFERRED_LOG_FLUSH_MS));
+    }
+}
+
+esp_err_t dlog_init(void) {
+    if (task_layout_create(TASK_LOG, dlog_task, NULL, NULL) != pdPASS) return ESP_ERR_NO_MEM;
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t dlog_init(void) {
+    return ESP_OK;  // DLOG calls go straight to ESP_LOG
+}
+
+#endif
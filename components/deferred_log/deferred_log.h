@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+// Deferred logging for the event path. DLOGI(TAG, fmt, ...) doesn't format anything: it stores a
+// pointer to a static call site (level, tag and format, i.e. the format ID), the time and up to
+// DLOG_MAX_ARGS raw arguments in a lock-free RAM ring. dlog_task prints the records later at the
+// lowest priority, stamped with the time of the call.
+//
+// The tag and format must be string literals. Arguments must be 32-bit integers or pointers to
+// strings that outlive the record (literals such as state ? "HIGH" : "LOW"), so no %f, %lld or
+// stack buffers; those stay with ESP_LOG. Safe from ISRs and from both cores.
+
+#define DLOG_MAX_ARGS 4
+
+typedef struct {
+    const char *tag;
+    const char *format;
+    esp_log_level_t level;
+    uint8_t argc;
+} DlogSite;
+
+// Starts the printer task. Records written before that are kept and printed once it runs.
+esp_err_t dlog_init(void);
+
+// Use the DLOG macros instead, they build the site and count the arguments
+void dlog_write(const DlogSite *site, ...);
+
+// Never called, lets the compiler check the format against the arguments
+static inline void __attribute__((format(printf, 1, 2))) dlog_check_format(const char *format, ...) {
+}
+
+#define DLOG_NARGS(...) DLOG_NARGS_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define DLOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, n, ...) n
+
+#if CONFIG_DEFERRED_LOG_ENABLE
+#define DLOG_LEVEL(level, tag, format, ...) do {                                                  \
+        if ((level) <= CONFIG_DEFERRED_LOG_MAX_LEVEL) {                                       \
+            _Static_assert(DLOG_NARGS(__VA_ARGS__) <= DLOG_MAX_ARGS, "too many DLOG arguments"); \
+            static const DlogSite dlog_site = { tag, format, level, DLOG_NARGS(__VA_ARGS__) };  \
+            if (0) dlog_check_format(format, ##__VA_ARGS__);                                  \
+            dlog_write(&dlog_site, ##__VA_ARGS__);                                            \
+        }                                                                                     \
+    } while (0)
+#else
+#define DLOG_LEVEL(level, tag, format, ...) do {                                                  \
+        if ((level) <= CONFIG_DEFERRED_LOG_MAX_LEVEL) ESP_LOG_LEVEL_LOCAL(level, tag, format, ##__VA_ARGS__); \
+    } while (0)
+#endif
+
+#define DLOGE(tag, format, ...) DLOG_LEVEL(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define DLOGW(tag, format, ...) DLOG_LEVEL(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define DLOGI(tag, format, ...) DLOG_LEVEL(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define DLOGD(tag, format, ...) DLOG_LEVEL(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
@@ -0,0 +1,180 @@
+#include "eth_rx.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "metrics.h"
+#include "net_state.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "ETH_RX";
+
+// Rough SPI cost per operation for the busy-time estimate: a W5500 register access is a 3-byte
+// header plus data. A poll reads the interrupt registers, a frame adds the RX size/pointer
+// handling and the 2-byte length prefix on top of the payload.
+#define SPI_BYTES_PER_POLL   8
+#define SPI_BYTES_PER_FRAME  24
+
+// Ports without an INT line, the ones the driver only checks on its poll timer
+#if CONFIG_EXAMPLE_USE_SPI_ETHERNET
+static const uint32_t driver_poll_ms[NET_STATE_MAX_PORTS] = {
+    CONFIG_EXAMPLE_ETH_SPI_INT0_GPIO < 0 ? CONFIG_EXAMPLE_ETH_SPI_POLLING0_MS : 0,
+#if CONFIG_EXAMPLE_SPI_ETHERNETS_NUM > 1
+    CONFIG_EXAMPLE_ETH_SPI_INT1_GPIO < 0 ? CONFIG_EXAMPLE_ETH_SPI_POLLING1_MS : 0,
+#endif
+};
+#else
+static const uint32_t driver_poll_ms[NET_STATE_MAX_PORTS] = { 0 };
+#endif
+
+// A port with link must deliver a frame (ARP, the sinks' own traffic) well within this, or its
+// RX task can't be identified and adaptive polling gives up on it
+#define RX_TASK_LEARN_TIMEOUT_US (CONFIG_ETH_RX_LEARN_TIMEOUT_S * 1000000LL)
+
+typedef struct {
+    int port;
+    esp_netif_t *netif;
+    TaskHandle_t rx_task;            // the driver's RX task, learned from the first frame
+    volatile int64_t last_frame_us;
+#if CONFIG_EXAMPLE_USE_W5500
+    esp_timer_handle_t poll_timer;
+    uint32_t poll_interval_us;
+    int64_t up_since_us;             // while the RX task is still unknown, 0 = port down
+    bool no_rx_task;                 // never identified, left to the driver's polling
+#endif
+} RxPort;
+
+static RxPort rx_ports[NET_STATE_MAX_PORTS];
+
+static inline void add_spi_bytes(uint32_t bytes) {
+    metrics_add(METRIC_ETH_SPI_BUSY_US, bytes * 8 / CONFIG_EXAMPLE_ETH_SPI_CLOCK_MHZ);
+}
+
+// Replaces the netif glue input path, runs in the driver's RX task. Both W5500 RX tasks carry
+// the same name, so each port's task is identified here rather than looked up by name.
+static esp_err_t rx_tap(esp_eth_handle_t eth, uint8_t *buffer, uint32_t length, void *priv) {
+    RxPort *rx = priv;
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    if (rx->rx_task != self) {
+        if (rx->rx_task) ESP_LOGE(TAG, "Port %d: frames now come from another task, polling that one", rx->port);
+        rx->rx_task = self;
+    }
+    metrics_inc(METRIC_ETH_RX_FRAMES);
+    metrics_add(METRIC_ETH_RX_BYTES, length);
+    add_spi_bytes(length + SPI_BYTES_PER_FRAME);
+    rx->last_frame_us = esp_timer_get_time();
+    return esp_netif_receive(rx->netif, buffer, length, NULL);
+}
+
+esp_err_t eth_rx_tap_port(int port, esp_eth_handle_t eth, esp_netif_t *netif) {
+    if (port < 0 || port >= NET_STATE_MAX_PORTS) return ESP_ERR_INVALID_ARG;
+    rx_ports[port].port = port;
+    rx_ports[port].netif = netif;
+    return esp_eth_update_input_path(eth, rx_tap, &rx_ports[port]);
+}
+
+#if CONFIG_EXAMPLE_USE_W5500
+static volatile uint8_t rx_mode = ETH_RX_MODE_DRIVER;
+
+static void stop_polling(RxPort *rx) {
+    esp_timer_stop(rx->poll_timer);
+    if (rx->port == 0) metrics_set(METRIC_ETH_RX_POLL_INTERVAL_US, driver_poll_ms[0] * 1000);
+}
+
+// Nothing to notify until a frame named the port's RX task. That needs link, so only time with
+// the port up counts against the timeout; past it the port is left to the driver, loudly.
+static bool rx_task_known(RxPort *rx) {
+    if (rx->rx_task) return true;
+    if (!net_state_port_up(rx->port)) {
+        rx->up_since_us = 0;
+        return false;
+    }
+    int64_t now = esp_timer_get_time();
+    if (!rx->up_since_us) rx->up_since_us = now;
+    if (now - rx->up_since_us > RX_TASK_LEARN_TIMEOUT_US) {
+        ESP_LOGE(TAG, "Port %d: no frame in %d s with link up, W5500 RX task unknown. Adaptive polling is off "
+                 "for this port, frames wait for the driver's %lu ms polling", rx->port,
+                 (int)(RX_TASK_LEARN_TIMEOUT_US / 1000000), (unsigned long)driver_poll_ms[rx->port]);
+        rx->no_rx_task = true;
+        stop_polling(rx);
+    }
+    return false;
+}
+
+// The W5500 RX task checks the chip whenever it is notified, which is all the driver's own
+// poll timer does. Extra notifications just mean extra checks.
+static void poll_tick(void *arg) {
+    RxPort *rx = arg;
+    if (!rx_task_known(rx)) return;
+    xTaskNotifyGive(rx->rx_task);
+    metrics_inc(METRIC_ETH_RX_POLLS);
+    add_spi_bytes(SPI_BYTES_PER_POLL);
+
+    // Fast while frames keep coming, then back off by doubling so a lull is not penalized at once
+    int64_t idle_us = esp_timer_get_time() - rx->last_frame_us;
+    uint32_t next = rx->poll_interval_us;
+    if (idle_us < (int64_t)CONFIG_ETH_RX_IDLE_AFTER_MS * 1000) {
+        next = CONFIG_ETH_RX_POLL_FAST_US;
+    } else if (rx->poll_interval_us < CONFIG_ETH_RX_POLL_IDLE_US) {
+        next = rx->poll_interval_us * 2;
+        if (next > CONFIG_ETH_RX_POLL_IDLE_US) next = CONFIG_ETH_RX_POLL_IDLE_US;
+    }
+
+    if (next != rx->poll_interval_us && rx_mode == ETH_RX_MODE_ADAPTIVE) {
+        rx->poll_interval_us = next;
+        if (rx->port == 0) metrics_set(METRIC_ETH_RX_POLL_INTERVAL_US, next);  // the gauge follows the primary
+        esp_timer_restart(rx->poll_timer, next);
+    }
+}
+
+esp_err_t eth_rx_set_mode(EthRxMode mode) {
+    if (mode != ETH_RX_MODE_DRIVER && mode != ETH_RX_MODE_ADAPTIVE) return ESP_ERR_INVALID_ARG;
+    rx_mode = mode;
+    for (int port = 0; port < NET_STATE_MAX_PORTS; port++) {
+        RxPort *rx = &rx_ports[port];
+        if (!rx->poll_timer) continue;  // absent or INT wired
+        stop_polling(rx);
+        if (mode != ETH_RX_MODE_ADAPTIVE || rx->no_rx_task) continue;
+
+        rx->poll_interval_us = CONFIG_ETH_RX_POLL_IDLE_US;
+        if (port == 0) metrics_set(METRIC_ETH_RX_POLL_INTERVAL_US, rx->poll_interval_us);
+        esp_timer_start_periodic(rx->poll_timer, rx->poll_interval_us);
+    }
+    ESP_LOGI(TAG, "RX mode: %s", mode == ETH_RX_MODE_ADAPTIVE ? "adaptive polling" : "driver polling");
+    return ESP_OK;
+}
+
+static void on_eth_rx_config_change(uint32_t changed, const AppConfig *cfg) {
+    eth_rx_set_mode(cfg->ethRxMode);
+}
+
+esp_err_t eth_rx_start(void) {
+    for (int port = 0; port < NET_STATE_MAX_PORTS; port++) {
+        RxPort *rx = &rx_ports[port];
+        if (!rx->netif || !driver_poll_ms[port] || rx->poll_timer) continue;  // absent, INT wired or created
+
+        const esp_timer_create_args_t args = {
+            .callback = poll_tick,
+            .arg = rx,
+            .name = "eth_rx_poll",
+        };
+        esp_err_t err = esp_timer_create(&args, &rx->poll_timer);
+        if (err != ESP_OK) return err;
+    }
+
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    metrics_set(METRIC_ETH_RX_POLL_INTERVAL_US, driver_poll_ms[0] * 1000);
+    eth_rx_set_mode(cfg.ethRxMode);
+    return register_config_reload_hook(CONFIG_CHANGED_ETH_RX, on_eth_rx_config_change);
+}
+#else
+esp_err_t eth_rx_set_mode(EthRxMode mode) {
+    return mode == ETH_RX_MODE_DRIVER ? ESP_OK : ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t eth_rx_start(void) {
+    metrics_set(METRIC_ETH_RX_POLL_INTERVAL_US, driver_poll_ms[0] * 1000);  // fixed driver polling, 0 if interrupt driven
+    return ESP_OK;
+}
+#endif
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "app_config.h"
+#include "esp_err.h"
+#include "esp_eth_driver.h"
+#include "esp_netif.h"
+
+// Taps the RX path of one port (frame/byte counters, SPI load estimate) and hands frames on to
+// the netif. Call after esp_netif_attach, which installs the default path this replaces.
+esp_err_t eth_rx_tap_port(int port, esp_eth_handle_t eth, esp_netif_t *netif);
+
+// Sets up polling for every tapped W5500 port without an INT line, in the mode AppConfig.ethRxMode
+// selects, and follows later changes of it. Call after esp_eth_start.
+esp_err_t eth_rx_start(void);
+
+// Adaptive polling needs each port's RX task, which is learned from the port's first frame. A port
+// that shows none within ETH_RX_LEARN_TIMEOUT_S of link up is logged as an error and left to the driver's polling.
+esp_err_t eth_rx_set_mode(EthRxMode mode);
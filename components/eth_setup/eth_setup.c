@@ -6,11 +6,66 @@
 #include "esp_netif.h"
 #include "esp_event.h"
 #include "app_config.h"  
+#include "net_state.h"
+#include "eth_rx.h"
 
 
 static const char *TAG = "ETH_SETUP";
-static esp_netif_t *eth_netif = NULL;
-static esp_eth_handle_t eth_handle = NULL;
+
+// Port 0 is the primary W5500, port 1 the optional backup (CONFIG_EXAMPLE_SPI_ETHERNETS_NUM = 2)
+static esp_netif_t *eth_netifs[NET_STATE_MAX_PORTS] = {NULL};
+static esp_eth_handle_t eth_handles_used[NET_STATE_MAX_PORTS] = {NULL};
+static bool eth_started[NET_STATE_MAX_PORTS] = {false};
+static uint8_t eth_port_count = 0;
+
+static void port_ip_info(const AppConfig *cfg, int port, esp_netif_ip_info_t *ip_info) {
+    if (port == 0) {
+        ip_info->ip.addr = cfg->deviceIp;
+        ip_info->gw.addr = cfg->gateway;
+        ip_info->netmask.addr = cfg->subnetMask;
+    } else {
+        ip_info->ip.addr = cfg->backupIp;
+        ip_info->gw.addr = cfg->backupGateway;
+        ip_info->netmask.addr = cfg->backupSubnetMask;
+    }
+}
+
+// Applies the static IP and starts or stops the port. The backup port only runs with an IP configured.
+static esp_err_t apply_port_config(const AppConfig *cfg, int port) {
+    esp_netif_ip_info_t ip_info;
+    port_ip_info(cfg, port, &ip_info);
+    bool enabled = port == 0 || ip_info.ip.addr != 0;
+
+    if (!enabled) {
+        if (eth_started[port]) {
+            esp_eth_stop(eth_handles_used[port]);  // posts ETHERNET_EVENT_STOP, net_state fails back
+            eth_started[port] = false;
+            ESP_LOGI(TAG, "Ethernet port %d stopped (no IP configured)", port);
+        }
+        return ESP_OK;
+    }
+
+    esp_netif_dhcp_status_t dhcp_status;
+    if (esp_netif_dhcpc_get_status(eth_netifs[port], &dhcp_status) == ESP_OK &&
+        dhcp_status == ESP_NETIF_DHCP_STARTED) {
+        esp_netif_dhcpc_stop(eth_netifs[port]);  // stop only if active
+    }
+    ESP_ERROR_CHECK(esp_netif_set_ip_info(eth_netifs[port], &ip_info));
+
+    if (!eth_started[port]) {
+        ESP_ERROR_CHECK(esp_eth_start(eth_handles_used[port]));
+        eth_started[port] = true;
+    }
+    ESP_LOGI(TAG, "Ethernet port %d configured with IP: " IPSTR, port, IP2STR(&ip_info.ip));
+    return ESP_OK;
+}
+
+// Config reload hook - re-applies static IP when network fields changed
+static void on_network_config_change(uint32_t changed, const AppConfig *cfg) {
+    for (int port = 0; port < eth_port_count; port++) {
+        apply_port_config(cfg, port);
+    }
+}
 
 esp_err_t init_ethernet_static(void)
 {
@@ -18,49 +73,56 @@ esp_err_t init_ethernet_static(void)
     esp_eth_handle_t *eth_handles = NULL;
 
     ESP_ERROR_CHECK(example_eth_init(&eth_handles, &eth_port_cnt));
-    eth_handle = eth_handles[0];  // Store the first handle
+    eth_port_count = eth_port_cnt < NET_STATE_MAX_PORTS ? eth_port_cnt : NET_STATE_MAX_PORTS;
+    if (eth_port_count < CONFIG_EXAMPLE_SPI_ETHERNETS_NUM) {
+        ESP_LOGW(TAG, "Running on %d of %d Ethernet ports, no failover", eth_port_count, CONFIG_EXAMPLE_SPI_ETHERNETS_NUM);
+    }
 
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
+    ESP_ERROR_CHECK(net_state_init());  // before esp_eth_start, so the first link-up is seen
 
-    esp_netif_config_t cfg = ESP_NETIF_DEFAULT_ETH();
-    eth_netif = esp_netif_new(&cfg);  // Store netif
+    for (int port = 0; port < eth_port_count; port++) {
+        eth_handles_used[port] = eth_handles[port];
 
-    esp_eth_netif_glue_handle_t eth_netif_glue = esp_eth_new_netif_glue(eth_handle);
-    ESP_ERROR_CHECK(esp_netif_attach(eth_netif, eth_netif_glue));
+        if (port == 0) {
+            esp_netif_config_t cfg = ESP_NETIF_DEFAULT_ETH();
+            eth_netifs[port] = esp_netif_new(&cfg);
+        } else {
+            // Lower route priority: lwIP keeps routing through the primary whenever its link is up
+            esp_netif_inherent_config_t base = ESP_NETIF_INHERENT_DEFAULT_ETH();
+            base.if_key = "ETH_BACKUP";
+            base.if_desc = "eth backup";
+            base.route_prio -= 5;
+            esp_netif_config_t cfg = { .base = &base, .stack = ESP_NETIF_NETSTACK_DEFAULT_ETH };
+            eth_netifs[port] = esp_netif_new(&cfg);
+        }
 
-    esp_netif_ip_info_t ip_info = {
-        .ip.addr = globalConfig.deviceIp,
-        .gw.addr = globalConfig.gateway,
-        .netmask.addr = globalConfig.subnetMask
-    };
+        esp_eth_netif_glue_handle_t eth_netif_glue = esp_eth_new_netif_glue(eth_handles_used[port]);
+        ESP_ERROR_CHECK(esp_netif_attach(eth_netifs[port], eth_netif_glue));
+        ESP_ERROR_CHECK(eth_rx_tap_port(port, eth_handles_used[port], eth_netifs[port]));
+        ESP_ERROR_CHECK(net_state_add_port(port, eth_handles_used[port], eth_netifs[port]));
+    }
 
-    ESP_ERROR_CHECK(esp_netif_dhcpc_stop(eth_netif));
-    ESP_ERROR_CHECK(esp_netif_set_ip_info(eth_netif, &ip_info));
-    ESP_ERROR_CHECK(esp_eth_start(eth_handle));
-    ESP_LOGI(TAG, "Ethernet configured with IP: " IPSTR, IP2STR(&ip_info.ip));
+    AppConfig app_cfg;
+    config_snapshot(&app_cfg);
+    for (int port = 0; port < eth_port_count; port++) {
+        ESP_ERROR_CHECK(apply_port_config(&app_cfg, port));
+    }
+    eth_rx_start();
+    register_config_reload_hook(CONFIG_CHANGED_NETWORK, on_network_config_change);
     
     return ESP_OK;
 }
 
 esp_err_t reapply_eth_config(void)
 {
-    if (!eth_netif) return ESP_ERR_INVALID_STATE;
+    if (!eth_port_count) return ESP_ERR_INVALID_STATE;
 
-    esp_netif_dhcp_status_t dhcp_status;
-    if (esp_netif_dhcpc_get_status(eth_netif, &dhcp_status) == ESP_OK &&
-        dhcp_status == ESP_NETIF_DHCP_STARTED) {
-        esp_netif_dhcpc_stop(eth_netif);  // stop only if active
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    for (int port = 0; port < eth_port_count; port++) {
+        apply_port_config(&cfg, port);
     }
-
-    esp_netif_ip_info_t ip_info = {
-        .ip.addr = globalConfig.deviceIp,
-        .gw.addr = globalConfig.gateway,
-        .netmask.addr = globalConfig.subnetMask
-    };
-
-    ESP_ERROR_CHECK(esp_netif_set_ip_info(eth_netif, &ip_info));
-
-    ESP_LOGI(TAG, "Ethernet IP updated to: " IPSTR, IP2STR(&ip_info.ip));
     return ESP_OK;
-}
\ No newline at end of file
+}
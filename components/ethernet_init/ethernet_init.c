@@ -180,6 +180,10 @@ static esp_eth_handle_t eth_init_spi(spi_eth_module_config_t *spi_eth_module_con
     // Init common MAC and PHY configs to default
     eth_mac_config_t mac_config = ETH_MAC_DEFAULT_CONFIG();
     eth_phy_config_t phy_config = ETH_PHY_DEFAULT_CONFIG();
+#if CONFIG_TASK_LAYOUT_SPLIT
+    // Keep the driver's RX task off the input core, boot_net runs this on the network core
+    mac_config.flags |= ETH_MAC_FLAG_PIN_TO_CORE;
+#endif
 
     // Update PHY config based on board specific configuration
     phy_config.phy_addr = spi_eth_module_config->phy_addr;
@@ -288,6 +292,11 @@ esp_err_t example_eth_init(esp_eth_handle_t *eth_handles_out[], uint8_t *eth_cnt
 #endif
     for (int i = 0; i < CONFIG_EXAMPLE_SPI_ETHERNETS_NUM; i++) {
         eth_handles[eth_cnt] = eth_init_spi(&spi_eth_module_config[i], NULL, NULL);
+        if (!eth_handles[eth_cnt] && i > 0) {
+            // Boards without the optional backup module run on the first one alone
+            ESP_LOGW(TAG, "SPI Ethernet module #%d not found, continuing without it", i + 1);
+            continue;
+        }
         ESP_GOTO_ON_FALSE(eth_handles[eth_cnt], ESP_FAIL, err, TAG, "SPI Ethernet init failed");
         eth_cnt++;
     }
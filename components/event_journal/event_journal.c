@@ -0,0 +1,656 @@
+#include "event_journal.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include "metrics.h"
+#include "task_layout.h"
+#include <stddef.h>
+#include <string.h>
+
+static const char *TAG = "EVENT_JOURNAL";
+
+//*************** On-flash layout *****************************//
+//
+// The partition is a ring of 4 KB pages (one flash sector each). A page starts with a header,
+// followed by fixed-size records written append-only. Records are only ever programmed into
+// erased (0xFF) space, so a page is erased once per trip around the ring.
+//
+// Delivery cursors are not stored separately: a sink's progress is an ACK record holding the last
+// seq it received. Every new page starts with a checkpoint ACK per sink, so erasing the oldest page
+// never loses a cursor. After a power cut the newest valid page is the write head, the first erased
+// slot in it is the write position, and records with a bad CRC (torn writes) are skipped.
+
+#define JOURNAL_PARTITION_SUBTYPE 0x40        // custom data subtype, see partitions.csv
+#define JOURNAL_PAGE_SIZE   4096
+#define JOURNAL_PAGE_MAGIC  0x4C4E524A        // "JRNL"
+
+#define REC_EVENT   0x01
+#define REC_ACK     0x02
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t pageSeq;       // increments every time a page is (re)opened, the highest is the head
+    uint16_t boot;
+    uint16_t reserved;
+    uint32_t reserved2;
+    uint32_t crc;
+} JournalPageHeader;
+
+typedef struct __attribute__((packed)) {
+    uint8_t type;           // REC_*
+    uint8_t sinks;          // event: sinks that missed it; ack: the sink index
+    uint8_t gpi;
+    uint8_t level;
+    uint32_t seq;           // event seq, or for acks the last seq the sink received
+    uint32_t uptimeMs;
+    uint16_t boot;
+    uint16_t reserved;
+    uint32_t crc;           // over all preceding bytes
+} JournalRecord;
+
+_Static_assert(sizeof(JournalPageHeader) == 20, "page header layout is part of the on-flash format");
+_Static_assert(sizeof(JournalRecord) == 20, "record layout is part of the on-flash format");
+
+#define RECORDS_PER_PAGE ((JOURNAL_PAGE_SIZE - sizeof(JournalPageHeader)) / sizeof(JournalRecord))
+
+typedef struct {
+    uint16_t page;
+    uint16_t slot;
+} JournalPos;
+
+//*************** State *****************************//
+//
+// Flash belongs to journal_task: only it takes journal_lock (besides the shutdown flush), and
+// holds it across erases and writes. The event path (gpio_task, HTTP post tasks) only touches
+// the RAM side under batch_lock, a spinlock held for a few stores: it batches the record and
+// wakes journal_task, or drops the record when the batch is full. It never waits for flash.
+
+#define BATCH_CAPACITY (2 * CONFIG_EVENT_JOURNAL_BATCH_RECORDS)  // room for a batch while the last one is written
+
+// journal_task notification bits
+#define NOTIFY_FLUSH  (1u << 0)     // flush timer expired or a batch filled up
+#define NOTIFY_REPLAY (1u << 1)     // a sink may be reachable again
+
+static const esp_partition_t *partition = NULL;
+static SemaphoreHandle_t journal_lock = NULL;
+static portMUX_TYPE batch_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t replay_task = NULL;
+static esp_timer_handle_t flush_timer = NULL;
+static uint16_t boot_id;                // set by mount, read-only afterwards
+static JournalDeliver deliverers[JOURNAL_SINK_COUNT];
+
+// Guarded by journal_lock
+static uint16_t page_count;
+static uint16_t tail_page;              // oldest valid page
+static JournalPos head;                 // next free slot on flash
+static uint32_t head_page_seq;
+static JournalPos cursor[JOURNAL_SINK_COUNT];    // next record to look at when replaying
+static JournalRecord flushing[BATCH_CAPACITY];   // taken from the batch, not on flash yet
+static size_t flushing_len = 0;
+
+// Guarded by batch_lock
+static uint32_t last_seq;
+static uint32_t ack_seq[JOURNAL_SINK_COUNT];
+static uint32_t pending[JOURNAL_SINK_COUNT];     // undelivered events per sink, flash + RAM
+static JournalRecord batch[BATCH_CAPACITY];
+static size_t batch_len = 0;
+
+static const MetricId pending_metric[JOURNAL_SINK_COUNT] = {
+    [JOURNAL_SINK_TCP]  = METRIC_JOURNAL_PENDING_TCP,
+    [JOURNAL_SINK_HTTP] = METRIC_JOURNAL_PENDING_HTTP,
+};
+
+//*************** Flash helpers *****************************//
+
+static size_t page_offset(uint16_t page) {
+    return (size_t)page * JOURNAL_PAGE_SIZE;
+}
+
+static size_t record_offset(JournalPos pos) {
+    return page_offset(pos.page) + sizeof(JournalPageHeader) + (size_t)pos.slot * sizeof(JournalRecord);
+}
+
+static uint32_t record_crc(const JournalRecord *rec) {
+    return esp_rom_crc32_le(0, (const uint8_t *)rec, offsetof(JournalRecord, crc));
+}
+
+static bool is_erased(const void *data, size_t len) {
+    const uint8_t *p = data;
+    for (size_t i = 0; i < len; i++) {
+        if (p[i] != 0xFF) return false;
+    }
+    return true;
+}
+
+static bool read_page_header(uint16_t page, JournalPageHeader *hdr) {
+    if (esp_partition_read(partition, page_offset(page), hdr, sizeof(*hdr)) != ESP_OK) return false;
+    return hdr->magic == JOURNAL_PAGE_MAGIC &&
+           hdr->crc == esp_rom_crc32_le(0, (const uint8_t *)hdr, offsetof(JournalPageHeader, crc));
+}
+
+typedef enum {
+    SLOT_ERASED,
+    SLOT_VALID,
+    SLOT_TORN
+} SlotState;
+
+static SlotState read_record(JournalPos pos, JournalRecord *rec) {
+    if (esp_partition_read(partition, record_offset(pos), rec, sizeof(*rec)) != ESP_OK) return SLOT_TORN;
+    if (is_erased(rec, sizeof(*rec))) return SLOT_ERASED;
+    return rec->crc == record_crc(rec) ? SLOT_VALID : SLOT_TORN;
+}
+
+static uint16_t next_page(uint16_t page) {
+    return (page + 1) % page_count;
+}
+
+// Caller holds batch_lock, or runs before journal_task starts
+static void publish_pending(void) {
+    for (int s = 0; s < JOURNAL_SINK_COUNT; s++) {
+        metrics_set(pending_metric[s], pending[s]);
+    }
+}
+
+//*************** Write path *****************************//
+
+// Counts undelivered events on a page that is about to be overwritten
+static void drop_page(uint16_t page) {
+    JournalRecord rec;
+    for (uint16_t slot = 0; slot < RECORDS_PER_PAGE; slot++) {
+        JournalPos pos = { page, slot };
+        SlotState state = read_record(pos, &rec);
+        if (state == SLOT_ERASED) break;
+        if (state != SLOT_VALID || rec.type != REC_EVENT) continue;
+
+        portENTER_CRITICAL(&batch_lock);
+        for (int s = 0; s < JOURNAL_SINK_COUNT; s++) {
+            if ((rec.sinks & JOURNAL_SINK_BIT(s)) && rec.seq > ack_seq[s] && pending[s] > 0) {
+                pending[s]--;
+                metrics_inc(METRIC_JOURNAL_OVERWRITTEN);
+            }
+        }
+        publish_pending();
+        portEXIT_CRITICAL(&batch_lock);
+    }
+}
+
+static void fill_ack(JournalRecord *rec, int sink, uint32_t seq) {
+    memset(rec, 0xFF, sizeof(*rec));
+    rec->type = REC_ACK;
+    rec->sinks = (uint8_t)sink;
+    rec->seq = seq;
+    rec->uptimeMs = (uint32_t)(esp_timer_get_time() / 1000);
+    rec->boot = boot_id;
+    rec->crc = record_crc(rec);
+}
+
+// Erases the page after the head and makes it the new head, writing a cursor checkpoint first
+static esp_err_t open_next_page(void) {
+    uint16_t page = next_page(head.page);
+
+    if (page == tail_page) {
+        // Ring full: the oldest page is overwritten
+        drop_page(page);
+        tail_page = next_page(page);
+        for (int s = 0; s < JOURNAL_SINK_COUNT; s++) {
+            if (cursor[s].page == page) {
+                cursor[s] = (JournalPos){ tail_page, 0 };
+            }
+        }
+    }
+
+    esp_err_t err = esp_partition_erase_range(partition, page_offset(page), JOURNAL_PAGE_SIZE);
+    if (err != ESP_OK) return err;
+    metrics_inc(METRIC_JOURNAL_PAGE_ERASES);
+
+    JournalPageHeader hdr = {
+        .magic = JOURNAL_PAGE_MAGIC,
+        .pageSeq = head_page_seq + 1,
+        .boot = boot_id,
+        .reserved = 0xFFFF,
+        .reserved2 = 0xFFFFFFFF,
+    };
+    hdr.crc = esp_rom_crc32_le(0, (const uint8_t *)&hdr, offsetof(JournalPageHeader, crc));
+    err = esp_partition_write(partition, page_offset(page), &hdr, sizeof(hdr));
+    if (err != ESP_OK) return err;
+
+    head = (JournalPos){ page, 0 };
+    head_page_seq = hdr.pageSeq;
+
+    uint32_t seqs[JOURNAL_SINK_COUNT];
+    portENTER_CRITICAL(&batch_lock);
+    memcpy(seqs, ack_seq, sizeof(seqs));
+    portEXIT_CRITICAL(&batch_lock);
+
+    JournalRecord acks[JOURNAL_SINK_COUNT];
+    for (int s = 0; s < JOURNAL_SINK_COUNT; s++) {
+        fill_ack(&acks[s], s, seqs[s]);
+    }
+    err = esp_partition_write(partition, record_offset(head), acks, sizeof(acks));
+    if (err == ESP_OK) head.slot = JOURNAL_SINK_COUNT;
+    return err;
+}
+
+// Takes the batch and writes it to flash behind anything a failed write left over, one write
+// per page touched. Only journal_task and the shutdown flush get here.
+static esp_err_t flush_batch_locked(void) {
+    portENTER_CRITICAL(&batch_lock);
+    size_t take = batch_len;
+    if (take > BATCH_CAPACITY - flushing_len) take = BATCH_CAPACITY - flushing_len;
+    memcpy(&flushing[flushing_len], batch, take * sizeof(JournalRecord));
+    memmove(batch, &batch[take], (batch_len - take) * sizeof(JournalRecord));
+    batch_len -= take;
+    portEXIT_CRITICAL(&batch_lock);
+    flushing_len += take;
+
+    size_t done = 0;
+    while (done < flushing_len) {
+        if (head.slot >= RECORDS_PER_PAGE) {
+            esp_err_t err = open_next_page();
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to open journal page: %s", esp_err_to_name(err));
+                memmove(flushing, &flushing[done], (flushing_len - done) * sizeof(JournalRecord));
+                flushing_len -= done;
+                return err;
+            }
+        }
+
+        size_t room = RECORDS_PER_PAGE - head.slot;
+        size_t count = flushing_len - done;
+        if (count > room) count = room;
+
+        esp_err_t err = esp_partition_write(partition, record_offset(head), &flushing[done], count * sizeof(JournalRecord));
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Journal write failed: %s", esp_err_to_name(err));
+            head.slot += count;  // slots may be partly programmed, never write them again
+            memmove(flushing, &flushing[done], (flushing_len - done) * sizeof(JournalRecord));
+            flushing_len -= done;
+            return err;
+        }
+        head.slot += count;
+        done += count;
+    }
+    flushing_len = 0;
+    return ESP_OK;
+}
+
+static void request_flush(void) {
+    if (replay_task) xTaskNotify(replay_task, NOTIFY_FLUSH, eSetBits);
+}
+
+// After a record was batched (batch length len, 0 if it was dropped): a full batch is written
+// right away, the first record of one arms the flush timer
+static void batch_added(size_t len) {
+    if (len == CONFIG_EVENT_JOURNAL_BATCH_RECORDS) {
+        esp_timer_stop(flush_timer);
+        request_flush();
+    } else if (len == 1) {
+        esp_timer_start_once(flush_timer, CONFIG_EVENT_JOURNAL_FLUSH_MS * 1000ULL);  // INVALID_STATE if armed
+    }
+}
+
+// Caller holds batch_lock. Returns the new batch length, 0 when the record was dropped because
+// journal_task has not written the previous batches yet.
+static size_t append_event_locked(uint8_t sinks, uint8_t gpi, uint8_t level) {
+    if (batch_len == BATCH_CAPACITY) {
+        metrics_inc(METRIC_JOURNAL_DROPPED);
+        return 0;
+    }
+    JournalRecord *rec = &batch[batch_len++];
+    memset(rec, 0xFF, sizeof(*rec));
+    rec->type = REC_EVENT;
+    rec->sinks = sinks;
+    rec->gpi = gpi;
+    rec->level = level;
+    rec->seq = ++last_seq;
+    rec->uptimeMs = (uint32_t)(esp_timer_get_time() / 1000);
+    rec->boot = boot_id;
+    rec->crc = record_crc(rec);
+
+    for (int s = 0; s < JOURNAL_SINK_COUNT; s++) {
+        if (sinks & JOURNAL_SINK_BIT(s)) pending[s]++;
+    }
+    metrics_inc(METRIC_JOURNAL_APPENDED);
+    publish_pending();
+    return batch_len;
+}
+
+// Marks seq as delivered for sink. Consecutive acks for the same sink share one batched record.
+// journal_task only: a full batch is written first. Should the event path fill it again
+// meanwhile, the ack stays in RAM until the next ack or page checkpoint, and a power cut before
+// then only means the event is delivered again.
+static void ack_locked(int sink, uint32_t seq) {
+    if (__atomic_load_n(&batch_len, __ATOMIC_RELAXED) == BATCH_CAPACITY) flush_batch_locked();
+
+    size_t len = 0;
+    portENTER_CRITICAL(&batch_lock);
+    ack_seq[sink] = seq;
+    if (pending[sink] > 0) pending[sink]--;
+    publish_pending();
+    if (batch_len > 0 && batch[batch_len - 1].type == REC_ACK && batch[batch_len - 1].sinks == sink) {
+        fill_ack(&batch[batch_len - 1], sink, seq);
+    } else if (batch_len < BATCH_CAPACITY) {
+        fill_ack(&batch[batch_len++], sink, seq);
+        len = batch_len;
+    }
+    portEXIT_CRITICAL(&batch_lock);
+    batch_added(len);
+}
+
+// Runs on the esp_timer task, which must not block on flash
+static void flush_timer_cb(void *arg) {
+    request_flush();
+}
+
+static void flush_on_shutdown(void) {
+    event_journal_flush();
+}
+
+//*************** Mount / recovery *****************************//
+
+static void format_journal(void) {
+    ESP_LOGW(TAG, "No valid journal found, formatting %d pages", page_count);
+    head = (JournalPos){ page_count - 1, RECORDS_PER_PAGE };
+    tail_page = head.page;  // keeps open_next_page() from treating page 0 as a full ring
+    head_page_seq = 0;
+    open_next_page();       // opens page 0
+    tail_page = 0;
+    for (int s = 0; s < JOURNAL_SINK_COUNT; s++) {
+        cursor[s] = head;
+    }
+}
+
+// Walks every record from tail to head in write order. Stops at the head's first erased slot.
+typedef void (*RecordVisitor)(JournalPos pos, const JournalRecord *rec);
+
+static void scan_records(RecordVisitor visit) {
+    uint16_t page = tail_page;
+    while (1) {
+        JournalPageHeader hdr;
+        if (read_page_header(page, &hdr)) {
+            for (uint16_t slot = 0; slot < RECORDS_PER_PAGE; slot++) {
+                JournalPos pos = { page, slot };
+                JournalRecord rec;
+                SlotState state = read_record(pos, &rec);
+                if (state == SLOT_ERASED) break;
+                if (state == SLOT_VALID) visit(pos, &rec);
+            }
+        }
+        if (page == head.page) break;
+        page = next_page(page);
+    }
+}
+
+static void collect_acks(JournalPos pos, const JournalRecord *rec) {
+    if (rec->boot >= boot_id) boot_id = rec->boot + 1;
+    if (rec->seq > last_seq && rec->type == REC_EVENT) last_seq = rec->seq;
+    if (rec->type == REC_ACK && rec->sinks < JOURNAL_SINK_COUNT && rec->seq > ack_seq[rec->sinks]) {
+        ack_seq[rec->sinks] = rec->seq;
+    }
+}
+
+static void collect_pending(JournalPos pos, const JournalRecord *rec) {
+    if (rec->type != REC_EVENT) return;
+    for (int s = 0; s < JOURNAL_SINK_COUNT; s++) {
+        if ((rec->sinks & JOURNAL_SINK_BIT(s)) && rec->seq > ack_seq[s]) {
+            if (pending[s]++ == 0) cursor[s] = pos;
+        }
+    }
+}
+
+static void mount_journal(void) {
+    bool found = false;
+    uint32_t newest = 0, oldest = 0;
+
+    for (uint16_t page = 0; page < page_count; page++) {
+        JournalPageHeader hdr;
+        if (!read_page_header(page, &hdr)) continue;
+        if (hdr.boot >= boot_id) boot_id = hdr.boot + 1;
+        if (!found || (int32_t)(hdr.pageSeq - newest) > 0) {
+            newest = hdr.pageSeq;
+            head.page = page;
+        }
+        if (!found || (int32_t)(hdr.pageSeq - oldest) < 0) {
+            oldest = hdr.pageSeq;
+            tail_page = page;
+        }
+        found = true;
+    }
+    if (boot_id == 0) boot_id = 1;
+
+    if (!found) {
+        format_journal();
+        return;
+    }
+    head_page_seq = newest;
+
+    // Write position: first erased slot of the head page. A torn record is stepped over.
+    head.slot = RECORDS_PER_PAGE;
+    for (uint16_t slot = 0; slot < RECORDS_PER_PAGE; slot++) {
+        JournalRecord rec;
+        if (read_record((JournalPos){ head.page, slot }, &rec) == SLOT_ERASED) {
+            head.slot = slot;
+            break;
+        }
+    }
+
+    scan_records(collect_acks);
+    for (int s = 0; s < JOURNAL_SINK_COUNT; s++) {
+        cursor[s] = head;
+    }
+    scan_records(collect_pending);
+    publish_pending();
+
+    ESP_LOGI(TAG, "Journal mounted: %d pages, head %d/%d, last seq %lu, pending tcp %lu http %lu",
+             page_count, head.page, head.slot, (unsigned long)last_seq,
+             (unsigned long)pending[JOURNAL_SINK_TCP], (unsigned long)pending[JOURNAL_SINK_HTTP]);
+}
+
+//*************** Catch-up *****************************//
+
+// Moves the sink's cursor to its next undelivered event and returns it, without consuming it.
+// Returns false when the sink is caught up.
+static bool peek_pending_locked(int sink, JournalPos *at, JournalRecord *out) {
+    while (__atomic_load_n(&pending[sink], __ATOMIC_RELAXED) > 0) {
+        JournalPos *pos = &cursor[sink];
+
+        if (pos->page == head.page && pos->slot >= head.slot) {
+            if (flushing_len > 0 || __atomic_load_n(&batch_len, __ATOMIC_RELAXED) > 0) {
+                if (flush_batch_locked() == ESP_OK) continue;  // batch is on flash now, keep reading
+                return false;
+            }
+            // Nothing left to read: resync the count (events lost to torn writes) so the sink is
+            // not held in catch-up forever. Unless an event was batched since the check above.
+            portENTER_CRITICAL(&batch_lock);
+            if (batch_len == 0) {
+                pending[sink] = 0;
+                publish_pending();
+            }
+            portEXIT_CRITICAL(&batch_lock);
+            return false;
+        }
+        if (pos->slot >= RECORDS_PER_PAGE) {
+            *pos = (JournalPos){ next_page(pos->page), 0 };
+            continue;
+        }
+
+        JournalRecord rec;
+        SlotState state = read_record(*pos, &rec);
+        if (state == SLOT_ERASED) {
+            pos->slot = RECORDS_PER_PAGE;   // rest of an older page was never written
+            continue;
+        }
+        if (state == SLOT_VALID && rec.type == REC_EVENT &&
+            (rec.sinks & JOURNAL_SINK_BIT(sink)) && rec.seq > ack_seq[sink]) {
+            *at = *pos;
+            *out = rec;
+            return true;
+        }
+        pos->slot++;
+    }
+    return false;
+}
+
+static bool is_expired(const JournalRecord *rec) {
+    if (rec->boot != boot_id) {
+        // Age across a reboot is unknown without a wall clock
+#if CONFIG_EVENT_JOURNAL_REPLAY_AFTER_REBOOT
+        return false;
+#else
+        return true;
+#endif
+    }
+    if (CONFIG_EVENT_JOURNAL_RETENTION_S == 0) return false;
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    return now_ms - rec->uptimeMs > CONFIG_EVENT_JOURNAL_RETENTION_S * 1000UL;
+}
+
+// Catch-up rate limit. Batches that fill up meanwhile are still written on time.
+static void replay_pause(TickType_t ticks) {
+    TickType_t start = xTaskGetTickCount();
+    TickType_t waited;
+    while ((waited = xTaskGetTickCount() - start) < ticks) {
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, NOTIFY_FLUSH, &bits, ticks - waited);
+        if (bits & NOTIFY_FLUSH) event_journal_flush();
+    }
+}
+
+static void replay_sink(int sink) {
+    while (1) {
+        JournalPos at;
+        JournalRecord rec;
+
+        xSemaphoreTake(journal_lock, portMAX_DELAY);
+        bool found = peek_pending_locked(sink, &at, &rec);
+        xSemaphoreGive(journal_lock);
+        if (!found) return;
+
+        bool expired = is_expired(&rec);
+        if (!expired) {
+            JournalEvent ev = {
+                .seq = rec.seq,
+                .uptimeMs = rec.uptimeMs,
+                .boot = rec.boot,
+                .gpi = rec.gpi,
+                .level = rec.level,
+            };
+            if (deliverers[sink](&ev) != ESP_OK) return;  // still down, retry later
+        }
+
+        xSemaphoreTake(journal_lock, portMAX_DELAY);
+        if (cursor[sink].page == at.page && cursor[sink].slot == at.slot) {
+            cursor[sink].slot++;
+        }
+        ack_locked(sink, rec.seq);
+        xSemaphoreGive(journal_lock);
+
+        metrics_inc(expired ? METRIC_JOURNAL_EXPIRED : METRIC_JOURNAL_REPLAYED);
+        if (!expired) {
+            replay_pause(pdMS_TO_TICKS(1000 / CONFIG_EVENT_JOURNAL_REPLAY_RATE));
+        }
+    }
+}
+
+static void journal_task(void *arg) {
+    while (1) {
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, pdMS_TO_TICKS(CONFIG_EVENT_JOURNAL_RETRY_MS));
+        if (bits & NOTIFY_FLUSH) event_journal_flush();
+        for (int s = 0; s < JOURNAL_SINK_COUNT; s++) {
+            if (deliverers[s] && __atomic_load_n(&pending[s], __ATOMIC_RELAXED) > 0) {
+                replay_sink(s);
+            }
+        }
+    }
+}
+
+//*************** Public API *****************************//
+
+esp_err_t event_journal_init(void) {
+#if !CONFIG_EVENT_JOURNAL_ENABLE
+    ESP_LOGI(TAG, "Event journal disabled");
+    return ESP_OK;
+#else
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, JOURNAL_PARTITION_SUBTYPE, "journal");
+    if (!partition) {
+        ESP_LOGW(TAG, "No journal partition, events to offline sinks will be dropped");
+        return ESP_OK;
+    }
+    page_count = partition->size / JOURNAL_PAGE_SIZE;
+    if (page_count < 2) {
+        ESP_LOGE(TAG, "Journal partition needs at least 2 pages");
+        partition = NULL;
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    journal_lock = xSemaphoreCreateMutex();
+    if (!journal_lock) {
+        partition = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    const esp_timer_create_args_t flush_timer_args = {
+        .callback = flush_timer_cb,
+        .name = "journal_flush",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&flush_timer_args, &flush_timer));
+
+    mount_journal();
+    ESP_ERROR_CHECK(esp_register_shutdown_handler(flush_on_shutdown));
+
+    if (task_layout_create(TASK_JOURNAL, journal_task, NULL, &replay_task) != pdPASS) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+#endif
+}
+
+void event_journal_register_sink(JournalSink sink, JournalDeliver deliver) {
+    if (sink < JOURNAL_SINK_COUNT) deliverers[sink] = deliver;
+}
+
+uint8_t event_journal_defer(uint8_t sinks, uint8_t gpi, uint8_t level) {
+    if (!partition) return 0;
+
+    size_t len = 0;
+    portENTER_CRITICAL(&batch_lock);
+    uint8_t behind = 0;
+    for (int s = 0; s < JOURNAL_SINK_COUNT; s++) {
+        if ((sinks & JOURNAL_SINK_BIT(s)) && pending[s] > 0) behind |= JOURNAL_SINK_BIT(s);
+    }
+    if (behind) len = append_event_locked(behind, gpi, level);
+    portEXIT_CRITICAL(&batch_lock);
+    batch_added(len);
+    return behind;
+}
+
+esp_err_t event_journal_append(uint8_t sinks, uint8_t gpi, uint8_t level) {
+    if (!partition) return ESP_ERR_NOT_FOUND;
+    if (sinks == 0) return ESP_OK;
+
+    portENTER_CRITICAL(&batch_lock);
+    size_t len = append_event_locked(sinks, gpi, level);
+    portEXIT_CRITICAL(&batch_lock);
+    batch_added(len);
+    return len ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+void event_journal_kick(void) {
+    if (replay_task) xTaskNotify(replay_task, NOTIFY_REPLAY, eSetBits);
+}
+
+esp_err_t event_journal_flush(void) {
+    if (!partition) return ESP_OK;
+
+    xSemaphoreTake(journal_lock, portMAX_DELAY);
+    esp_err_t err = flush_batch_locked();
+    xSemaphoreGive(journal_lock);
+    return err;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Sinks that can fall behind and catch up from the journal. Used as bit positions in sink masks.
+typedef enum {
+    JOURNAL_SINK_TCP,       // regular TCP or Companion, both share the TCP client socket
+    JOURNAL_SINK_HTTP,
+
+    JOURNAL_SINK_COUNT
+} JournalSink;
+
+#define JOURNAL_SINK_BIT(sink) ((uint8_t)(1u << (sink)))
+
+// One GPI event as stored in the journal
+typedef struct {
+    uint32_t seq;           // journal order, strictly increasing
+    uint32_t uptimeMs;      // when it was journaled, relative to the boot it was recorded in
+    uint16_t boot;          // journal boot counter, differs for events from before a reboot
+    uint8_t gpi;            // GPI index, 0-based
+    uint8_t level;
+} JournalEvent;
+
+// Delivers one replayed event synchronously. Any error stops the catch-up of that sink until
+// the next kick or retry, the event stays in the journal.
+typedef esp_err_t (*JournalDeliver)(const JournalEvent *ev);
+
+// Mounts the "journal" partition, recovers the write position and per-sink cursors after
+// a power cut and starts the catch-up task. Without the partition (or with the journal disabled
+// in menuconfig) all calls below are no-ops and events are sent live only.
+esp_err_t event_journal_init(void);
+void event_journal_register_sink(JournalSink sink, JournalDeliver deliver);
+
+// Journals the event for every sink in sinks that still has a backlog, so live events never
+// overtake replayed ones. Returns the sinks it was journaled for; send live to the others.
+// Neither this nor event_journal_append waits for flash: records are batched in RAM for the
+// journal task, and dropped (METRIC_JOURNAL_DROPPED) if it has fallen two batches behind.
+uint8_t event_journal_defer(uint8_t sinks, uint8_t gpi, uint8_t level);
+
+// Journals an event that sinks failed to deliver live. ESP_ERR_NO_MEM when it was dropped.
+esp_err_t event_journal_append(uint8_t sinks, uint8_t gpi, uint8_t level);
+
+// Wakes the catch-up task, e.g. right after a sink reconnected
+void event_journal_kick(void);
+
+// Writes batched records to flash now, from the calling task (shutdown, tests)
+esp_err_t event_journal_flush(void);
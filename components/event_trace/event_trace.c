@@ -0,0 +1,123 @@
+#include "event_trace.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include "esp_attr.h"
+
+#define TRACE_PID 1
+#define SINK_TID_BASE 100   // input tracks are tid 1..72 (GPI number)
+
+static const char *const stage_names[TRACE_STAGE_COUNT] = {
+    [TRACE_ISR]      = "isr",
+    [TRACE_DEQUEUE]  = "dequeue",
+    [TRACE_STABLE]   = "stable",
+    [TRACE_BUILT]    = "built",
+    [TRACE_ENQUEUED] = "enqueued",
+    [TRACE_SENT]     = "sent",
+};
+
+static const char *const sink_names[TRACE_SINK_COUNT] = {
+    [TRACE_SINK_NONE]      = "",
+    [TRACE_SINK_COMPANION] = "companion",
+    [TRACE_SINK_TCP]       = "tcp",
+    [TRACE_SINK_HTTP]      = "http",
+    [TRACE_SINK_SERIAL]    = "serial",
+};
+
+#if CONFIG_EVENT_TRACE_ENABLE
+
+#define RING_SIZE CONFIG_EVENT_TRACE_RING_SIZE
+#define RING_MASK (RING_SIZE - 1)
+
+_Static_assert((RING_SIZE & RING_MASK) == 0, "EVENT_TRACE_RING_SIZE must be a power of two");
+
+// seq is 0 while a writer fills the record and index + 1 once it is complete, like the
+// deferred log ring. Readers copy a record and keep it only if seq didn't change meanwhile.
+typedef struct {
+    volatile uint32_t seq;
+    uint32_t eventId;
+    int64_t atUs;
+    uint8_t stage;
+    uint8_t gpi;
+    uint8_t sink;
+} TraceRecord;
+
+static TraceRecord ring[RING_SIZE];
+static volatile uint32_t ring_head;
+
+void IRAM_ATTR event_trace_at(TraceStage stage, uint8_t gpi, TraceSink sink, int64_t eventUs, int64_t atUs) {
+    uint32_t index = __atomic_fetch_add(&ring_head, 1, __ATOMIC_RELAXED);
+    TraceRecord *rec = &ring[index & RING_MASK];
+
+    __atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    rec->eventId = (uint32_t)eventUs;
+    rec->atUs = atUs;
+    rec->stage = stage;
+    rec->gpi = gpi;
+    rec->sink = sink;
+    __atomic_store_n(&rec->seq, index + 1, __ATOMIC_RELEASE);
+}
+
+static bool copy_record(uint32_t index, TraceRecord *out) {
+    const TraceRecord *rec = &ring[index & RING_MASK];
+    uint32_t seq = __atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE);
+    if (seq != index + 1) return false;  // being written, or already overwritten
+    *out = *rec;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&rec->seq, __ATOMIC_RELAXED) == seq;
+}
+
+#endif
+
+// Every element after the process name starts with the separator
+static void emit_thread_name(EventTraceWriter writer, void *ctx, int tid, const char *name) {
+    char line[128];
+    int len = snprintf(line, sizeof(line),
+                       ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                       TRACE_PID, tid, name);
+    writer(line, len, ctx);
+}
+
+void event_trace_render(EventTraceWriter writer, void *ctx) {
+    static const char head[] = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    static const char tail[] = "\n]}\n";
+    char line[256];
+
+    writer(head, sizeof(head) - 1, ctx);
+    int len = snprintf(line, sizeof(line),
+                       "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"GPIO Box\"}}", TRACE_PID);
+    writer(line, len, ctx);
+    for (int s = TRACE_SINK_COMPANION; s < TRACE_SINK_COUNT; s++) {
+        char name[24];
+        snprintf(name, sizeof(name), "sink %s", sink_names[s]);
+        emit_thread_name(writer, ctx, SINK_TID_BASE + s, name);
+    }
+
+#if CONFIG_EVENT_TRACE_ENABLE
+    uint8_t named[256 / 8] = {0};
+    uint32_t end = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+    uint32_t start = end > RING_SIZE ? end - RING_SIZE : 0;
+
+    for (uint32_t i = start; i != end; i++) {
+        TraceRecord rec;
+        if (!copy_record(i, &rec) || rec.stage >= TRACE_STAGE_COUNT || rec.sink >= TRACE_SINK_COUNT) continue;
+
+        int tid = rec.sink == TRACE_SINK_NONE ? rec.gpi + 1 : SINK_TID_BASE + rec.sink;
+        if (rec.sink == TRACE_SINK_NONE && !(named[rec.gpi / 8] & (1u << (rec.gpi % 8)))) {
+            char name[8];
+            snprintf(name, sizeof(name), "GPI%02d", rec.gpi + 1);
+            emit_thread_name(writer, ctx, tid, name);
+            named[rec.gpi / 8] |= 1u << (rec.gpi % 8);
+        }
+
+        len = snprintf(line, sizeof(line),
+                       ",\n{\"name\":\"%s\",\"cat\":\"gpi\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld,\"pid\":%d,\"tid\":%d,"
+                       "\"args\":{\"event\":\"%08lx\",\"gpi\":%d,\"sink\":\"%s\"}}",
+                       stage_names[rec.stage], (long long)rec.atUs, TRACE_PID, tid,
+                       (unsigned long)rec.eventId, rec.gpi + 1, sink_names[rec.sink]);
+        writer(line, len, ctx);
+    }
+#endif
+
+    writer(tail, sizeof(tail) - 1, ctx);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+// Stage-by-stage trace of GPI events, to tell whether a late event waited in debounce, the queue,
+// message building, a blocked send() or the network. Every trace point is one record in a
+// lock-free RAM ring, safe from ISRs and both cores.
+//
+// The event ID is the ISR time of the edge that opened the event's debounce window: the edgeUs
+// that already travels with every event for the latency histograms, so all stages of one event
+// share it without extra bookkeeping. Bounces get the ID of their own edge.
+
+typedef enum {
+    TRACE_ISR,          // edge seen by the GPIO ISR, or the expander INT line
+    TRACE_DEQUEUE,      // edge picked up by gpio_task
+    TRACE_STABLE,       // debounce settled on a new level
+    TRACE_BUILT,        // message built for a sink
+    TRACE_ENQUEUED,     // handed to the sink: send() called, HTTP post task created
+    TRACE_SENT,         // send() returned, HTTP post answered, serial line written
+
+    TRACE_STAGE_COUNT
+} TraceStage;
+
+typedef enum {
+    TRACE_SINK_NONE,    // input stages
+    TRACE_SINK_COMPANION,
+    TRACE_SINK_TCP,
+    TRACE_SINK_HTTP,
+    TRACE_SINK_SERIAL,
+
+    TRACE_SINK_COUNT
+} TraceSink;
+
+#if CONFIG_EVENT_TRACE_ENABLE
+// atUs: when the stage happened, for stages whose time was taken earlier (ISR edges)
+void event_trace_at(TraceStage stage, uint8_t gpi, TraceSink sink, int64_t eventUs, int64_t atUs);
+#else
+static inline void event_trace_at(TraceStage stage, uint8_t gpi, TraceSink sink, int64_t eventUs, int64_t atUs) {
+}
+#endif
+
+static inline void event_trace(TraceStage stage, uint8_t gpi, TraceSink sink, int64_t eventUs) {
+#if CONFIG_EVENT_TRACE_ENABLE
+    event_trace_at(stage, gpi, sink, eventUs, esp_timer_get_time());
+#endif
+}
+
+// Writes the ring as Chrome trace JSON ({"traceEvents":[...]}, open in ui.perfetto.dev or
+// chrome://tracing), oldest first. Inputs and sinks get one track each; every point carries its
+// event ID in args.
+typedef void (*EventTraceWriter)(const char *data, size_t len, void *ctx);
+void event_trace_render(EventTraceWriter writer, void *ctx);
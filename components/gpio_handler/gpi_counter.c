@@ -0,0 +1,85 @@
+#include "gpi_counter.h"
+#include "driver/gpio.h"
+#include "esp_log.h"
+#include <string.h>
+
+#define TAG "GPI_COUNTER"
+
+// The unit accumulates past its 16-bit range on the high limit watch point, so the count
+// read back is a plain 32-bit value that wraps only after 2^31 edges
+#define PCNT_HIGH_LIMIT 32767
+#define PCNT_LOW_LIMIT -1               // counts only go up, the driver needs a negative limit
+#define PCNT_MAX_GLITCH_NS 12000        // filter width limit on the ESP32 (1023 APB cycles)
+
+esp_err_t gpi_counter_start(GpiCounter *counter, const GpiPinConfig *cfg) {
+    memset(counter, 0, sizeof(*counter));
+
+    pcnt_unit_config_t unit_config = {
+        .low_limit = PCNT_LOW_LIMIT,
+        .high_limit = PCNT_HIGH_LIMIT,
+        .flags.accum_count = 1,
+    };
+    esp_err_t err = pcnt_new_unit(&unit_config, &counter->unit);
+    if (err != ESP_OK) return err;
+
+    if (cfg->debounceUs > 0) {
+        uint32_t glitchNs = cfg->debounceUs > PCNT_MAX_GLITCH_NS / 1000 ? PCNT_MAX_GLITCH_NS : cfg->debounceUs * 1000;
+        pcnt_glitch_filter_config_t filter_config = { .max_glitch_ns = glitchNs };
+        err = pcnt_unit_set_glitch_filter(counter->unit, &filter_config);
+    }
+
+    pcnt_chan_config_t chan_config = {
+        .edge_gpio_num = cfg->gpio,
+        .level_gpio_num = -1,
+        .flags.invert_edge_input = cfg->invert,
+    };
+    if (err == ESP_OK) err = pcnt_new_channel(counter->unit, &chan_config, &counter->channel);
+
+    if (err == ESP_OK) {
+        pcnt_channel_edge_action_t rising = cfg->edges == PIN_EDGES_FALLING ? PCNT_CHANNEL_EDGE_ACTION_HOLD
+                                                                           : PCNT_CHANNEL_EDGE_ACTION_INCREASE;
+        pcnt_channel_edge_action_t falling = cfg->edges == PIN_EDGES_RISING ? PCNT_CHANNEL_EDGE_ACTION_HOLD
+                                                                           : PCNT_CHANNEL_EDGE_ACTION_INCREASE;
+        err = pcnt_channel_set_edge_action(counter->channel, rising, falling);
+    }
+    if (err == ESP_OK) {
+        err = pcnt_channel_set_level_action(counter->channel, PCNT_CHANNEL_LEVEL_ACTION_KEEP,
+                                            PCNT_CHANNEL_LEVEL_ACTION_KEEP);
+    }
+    // The channel routes the pin with its own pull setting, apply the configured one afterwards
+    if (err == ESP_OK) {
+        err = gpio_set_pull_mode(cfg->gpio, cfg->pull == PIN_PULL_UP ? GPIO_PULLUP_ONLY :
+                                            cfg->pull == PIN_PULL_DOWN ? GPIO_PULLDOWN_ONLY : GPIO_FLOATING);
+    }
+    if (err == ESP_OK) err = pcnt_unit_add_watch_point(counter->unit, PCNT_HIGH_LIMIT);
+    if (err == ESP_OK) err = pcnt_unit_enable(counter->unit);
+    if (err == ESP_OK) err = pcnt_unit_clear_count(counter->unit);
+    if (err == ESP_OK) err = pcnt_unit_start(counter->unit);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "PCNT setup on GPIO %d failed: %s", cfg->gpio, esp_err_to_name(err));
+        gpi_counter_stop(counter);
+    }
+    return err;
+}
+
+void gpi_counter_stop(GpiCounter *counter) {
+    if (!counter->unit) return;
+    // Each step fails harmlessly when setup didn't get that far
+    pcnt_unit_stop(counter->unit);
+    pcnt_unit_disable(counter->unit);
+    pcnt_unit_remove_watch_point(counter->unit, PCNT_HIGH_LIMIT);
+    if (counter->channel) pcnt_del_channel(counter->channel);
+    pcnt_del_unit(counter->unit);
+    counter->unit = NULL;
+    counter->channel = NULL;
+}
+
+uint64_t gpi_counter_read(GpiCounter *counter) {
+    int raw = 0;
+    if (counter->unit && pcnt_unit_get_count(counter->unit, &raw) == ESP_OK) {
+        counter->total += (uint32_t)raw - counter->lastRaw;
+        counter->lastRaw = (uint32_t)raw;
+    }
+    return counter->total;
+}
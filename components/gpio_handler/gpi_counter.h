@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/pulse_cnt.h"
+#include "app_config.h"
+
+// One PCNT unit counting the edges of a GPI in counter mode. The hardware counts with no CPU
+// involvement at all; software only reads the total when a report is due.
+typedef struct {
+    pcnt_unit_handle_t unit;
+    pcnt_channel_handle_t channel;
+    uint32_t lastRaw;   // unit count at the last read, wraps
+    uint64_t total;     // edges since start
+} GpiCounter;
+
+// Counts the edges selected by cfg->edges (after inversion) on cfg->gpio. debounceUs becomes the
+// PCNT glitch filter, which the hardware caps at about 12 us.
+esp_err_t gpi_counter_start(GpiCounter *counter, const GpiPinConfig *cfg);
+void gpi_counter_stop(GpiCounter *counter);
+
+// Edges counted since gpi_counter_start
+uint64_t gpi_counter_read(GpiCounter *counter);
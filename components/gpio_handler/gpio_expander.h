@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include "app_config.h"
+
+// A 16-input expander: an MCP23017 on the I2C bus, or an in-memory mock in builds with simulated
+// inputs (the mock has no ESP-IDF dependencies and also builds on a host). Debounce, events and
+// sync state are handled by gpio_handler exactly like for native pins; a backend only reads levels.
+#if CONFIG_GPIO_EXPANDER_I2C || CONFIG_GPIO_HANDLER_SIM_INPUTS
+#define GPIO_EXPANDER_SUPPORTED 1
+#else
+#define GPIO_EXPANDER_SUPPORTED 0
+#endif
+
+typedef struct {
+    int slot;       // expander slot, 0-based
+    void *dev;      // backend handle
+} GpioExpander;
+
+// Configures every pin as input with cfg's pull-ups and interrupt-on-change for cfg->inputMask.
+// ESP_ERR_NOT_SUPPORTED when the firmware was built without expander support.
+esp_err_t gpio_expander_start(GpioExpander *exp, int slot, const ExpanderConfig *cfg);
+void gpio_expander_stop(GpioExpander *exp);
+
+// Reads all 16 inputs in one bus transaction (bit n = GPA0-GPB7), which also clears the
+// expander's interrupt
+esp_err_t gpio_expander_read(GpioExpander *exp, uint16_t *levels);
+
+#if CONFIG_GPIO_HANDLER_SIM_INPUTS
+// Mock backend: sets the level the next read of input pin (0-15) on slot returns
+void gpio_expander_mock_set(int slot, int pin, int level);
+#endif
@@ -0,0 +1,34 @@
+#include "gpio_expander.h"
+
+#if CONFIG_GPIO_HANDLER_SIM_INPUTS
+
+// Idle high, like pulled-up inputs
+static volatile uint16_t mock_levels[GPIO_EXPANDER_COUNT] = { 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF };
+
+esp_err_t gpio_expander_start(GpioExpander *exp, int slot, const ExpanderConfig *cfg) {
+    if (slot < 0 || slot >= GPIO_EXPANDER_COUNT) return ESP_ERR_INVALID_ARG;
+    exp->slot = slot;
+    exp->dev = (void *)&mock_levels[slot];
+    return ESP_OK;
+}
+
+void gpio_expander_stop(GpioExpander *exp) {
+    exp->dev = NULL;
+}
+
+esp_err_t gpio_expander_read(GpioExpander *exp, uint16_t *levels) {
+    if (!exp->dev) return ESP_ERR_INVALID_STATE;
+    *levels = mock_levels[exp->slot];
+    return ESP_OK;
+}
+
+void gpio_expander_mock_set(int slot, int pin, int level) {
+    if (slot < 0 || slot >= GPIO_EXPANDER_COUNT || pin < 0 || pin >= GPIO_EXPANDER_PINS) return;
+    if (level) {
+        __atomic_fetch_or(&mock_levels[slot], (uint16_t)(1u << pin), __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_and(&mock_levels[slot], (uint16_t)~(1u << pin), __ATOMIC_RELAXED);
+    }
+}
+
+#endif
@@ -1,4 +1,7 @@
 #include "gpio_handler.h"
+#include "gpio_rules.h"
+#include "gpi_counter.h"
+#include "gpio_expander.h"
 #include "esp_log.h"
 #include "driver/gpio.h"
 #include "app_config.h"
@@ -9,177 +12,1412 @@
 #include "esp_attr.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "esp_timer.h"  // Needed for esp_timer_get_time()
+#include "metrics.h"
+#include "event_journal.h"
+#include <stdlib.h>
+#include "esp_rom_sys.h"
+#include "task_layout.h"
+#include "deferred_log.h"
+#include "event_trace.h"
 
 #define TAG "GPIO_HANDLER"
-#define DEBOUNCE_DELAY_MS 50
-
-static int last_stable_state[8] = {0};
-static int last_debounce_state[8] = {0};
-static int64_t last_debounce_time[8] = {0};
-static bool gpo_states[5] = {0};  //stores last known GPO states, serves sync requests
+#define GPI_QUEUE_LEN 32
+#define GPI_WAKE -1     // queue item that only wakes gpio_task (settle timer, expander INT, reconfigure)
+#define POLL_US 10000   // how often counter reports and event storms are checked
+#define STORM_QUIET_US (CONFIG_GPIO_HANDLER_STORM_QUIET_MS * 1000LL)
 
+static bool gpo_states[GPO_PIN_COUNT] = {0};  //stores last known GPO states, serves sync requests
 
 static QueueHandle_t gpio_evt_queue = NULL;
 
+// Queued by the ISR; edgeUs is where edge-to-send latency starts
+typedef struct {
+    int index;
+    int64_t edgeUs;
+} GpiEdge;
+
+// Debounce state of one GPI, native or on an expander. Everything but edgeCount is owned by gpio_task.
+typedef struct {
+    GpiPinConfig cfg;               // config the pin currently runs with
+    esp_timer_handle_t settleTimer; // restarted on every edge, fires once the level held debounceUs
+    volatile uint32_t edgeCount;    // bumped by the ISR, also counts edges whose queue item was dropped
+    uint32_t armedCount;            // edgeCount when settleTimer was last armed
+    int64_t windowStartUs;          // first edge of the current bounce window, 0 while settled
+    int stableRaw;                  // last settled pin level, before inversion
+    GpiCounter counter;             // counter mode only
+    uint64_t reportedTotal;         // counter total sent in the last report
+    int64_t lastReportUs;
+
+    // Event storm suppression, level mode only
+    uint32_t tokensMilli;           // event tokens x1000, refilled at eventsPerMin
+    int64_t refillUs;
+    int reportedLevel;              // last level sent to sinks, -1 before the first
+    bool storming;                  // events are coalesced until the pin is quiet again
+    int64_t stormStartUs;
+    int64_t lastSuppressedUs;
+    int pendingLevel;               // newest coalesced level
+    int64_t pendingEdgeUs;
+    volatile uint32_t suppressed;   // events suppressed since boot, served to sync requests
+    volatile bool quarantined;      // interrupt off after a sustained storm
+    int64_t quarantineEndUs;
+} GpiPin;
+
 static void gpio_task(void *arg);
+static void on_gpi_edge(int index, int64_t edgeUs);
+static void set_gpo_level(int index, bool state);
+static void cancel_gpo_pattern(int index);
+static void gpo_pattern_cb(void *arg);
+static esp_err_t replay_tcp_event(const JournalEvent *ev);
+static esp_err_t replay_http_event(const JournalEvent *ev);
+
+// Pin maps come from the config (AppConfig.gpi/gpo/expander) and are re-applied by gpio_task on change
+static GpiPin gpi_pins[GPI_TOTAL_COUNT];    // native pins, then GPIO_EXPANDER_PINS per expander slot
+static GpoPinConfig gpo_pins[GPO_PIN_COUNT];
+static GpioRule gpo_rules[GPO_PIN_COUNT];       // compiled from gpo_pins[].rule
+static SemaphoreHandle_t gpo_lock = NULL;       // gpo_pins, gpo_rules vs trigger_gpo from the TCP task
+static uint8_t rule_inputs = 0;                 // logical GPI levels the rules last saw, bit n = GPI n+1
+
+// gpo_states, gpo_patterns and the GPO level writes. A spinlock, since pattern callbacks run on
+// the esp_timer task and must not wait for gpo_lock, which is held across I2C on a remap.
+static portMUX_TYPE gpo_level_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Pulse or blink running on a GPO, guarded by gpo_level_lock
+typedef struct {
+    esp_timer_handle_t timer;
+    bool active;
+    bool on;                // level driven right now
+    uint8_t gpio;           // pin and polarity at start, the pattern is cancelled before a remap
+    uint8_t invert;
+    uint32_t onUs;
+    uint32_t offUs;
+    uint32_t remaining;     // on phases left including the current one, 0 = until cancelled
+    int64_t nextUs;         // absolute time of the next transition
+} GpoPattern;
+
+static GpoPattern gpo_patterns[GPO_PIN_COUNT];
+
+#define SETTLE_WORDS ((GPI_TOTAL_COUNT + 31) / 32)
+static volatile uint32_t settle_pending[SETTLE_WORDS];   // GPI bits whose settle timer fired
+static volatile bool reconfig_pending = false;
+static esp_timer_handle_t poll_timer = NULL;    // runs while any GPI counts, storms or is quarantined
+static volatile bool poll_due = false;
+
+// Stores last known GPI states, after inversion
+static bool gpi_states[GPI_TOTAL_COUNT] = {0};
 
-// GPIO allocations
-static const gpio_num_t gpi_pins[8] = {
-    GPIO_NUM_32, GPIO_NUM_33, GPIO_NUM_25, GPIO_NUM_26,
-    GPIO_NUM_27, GPIO_NUM_14, GPIO_NUM_12, GPIO_NUM_13
-};
+// One expander slot, owned by gpio_task except irqUs (written by its INT ISR)
+typedef struct {
+    ExpanderConfig cfg;     // config the slot currently runs with
+    GpioExpander dev;
+    uint16_t levels;        // last read, bit n = GPA0-GPB7, before inversion
+    volatile int64_t irqUs; // first INT edge since the last read
+} Expander;
 
-// GPO reduced to 5 safe pins (excluding GPIO 2, 5, 12)
-static const gpio_num_t gpo_pins[5] = {GPIO_NUM_16, GPIO_NUM_17, GPIO_NUM_21, GPIO_NUM_22, GPIO_NUM_4};
+static Expander expanders[GPIO_EXPANDER_COUNT];
+static volatile uint32_t expander_pending = 0;      // slots whose INT fired
+static volatile uint8_t gpi_count = GPI_PIN_COUNT;  // native pins plus every slot up to the last enabled one
 
-// Stores last known GPI states
-static bool gpi_states[8] = {0};
+static inline int expander_slot(int index) {
+    return (index - GPI_PIN_COUNT) / GPIO_EXPANDER_PINS;
+}
+
+static inline int expander_pin(int index) {
+    return (index - GPI_PIN_COUNT) % GPIO_EXPANDER_PINS;
+}
+
+// Expander inputs read from the last batch read, every change on them triggers a new one
+static inline int read_expander_gpi(int index) {
+    return (expanders[expander_slot(index)].levels >> expander_pin(index)) & 1;
+}
+
+#if CONFIG_GPIO_HANDLER_SIM_INPUTS
+// Simulated pin levels, written by the trace player, idle high like the pulled-up inputs
+static volatile uint8_t sim_levels[GPI_PIN_COUNT] = {1, 1, 1, 1, 1, 1, 1, 1};
+static volatile bool sim_playing = false;
+
+static inline int read_gpi(int index) {
+    return index < GPI_PIN_COUNT ? sim_levels[index] : read_expander_gpi(index);
+}
+#else
+static inline int read_gpi(int index) {
+    return index < GPI_PIN_COUNT ? gpio_get_level(gpi_pins[index].cfg.gpio) : read_expander_gpi(index);
+}
+#endif
 
 // ISR handler for GPI pin change -triggered by esp each time the pin state changed 
 static void IRAM_ATTR gpio_isr_handler(void* arg) {
     int index = (int) arg;
-    xQueueSendFromISR(gpio_evt_queue, &index, NULL);
+    GpiEdge edge = { .index = index, .edgeUs = esp_timer_get_time() };
+    gpi_pins[index].edgeCount++;
+    metrics_inc(METRIC_GPI_EDGES);
+    event_trace_at(TRACE_ISR, index, TRACE_SINK_NONE, edge.edgeUs, edge.edgeUs);
+    if (xQueueSendFromISR(gpio_evt_queue, &edge, NULL) != pdTRUE) {
+        metrics_inc(METRIC_GPI_QUEUE_OVERFLOWS);
+    }
+}
+
+// A full queue already wakes gpio_task, so a dropped wake item loses nothing
+static void wake_gpio_task(void) {
+    GpiEdge wake = { .index = GPI_WAKE, .edgeUs = 0 };
+    xQueueSend(gpio_evt_queue, &wake, 0);
+}
+
+// Marks an expander for a read by gpio_task, the caller wakes it
+static inline void IRAM_ATTR mark_expander_pending(int slot) {
+    uint32_t bit = 1u << slot;
+    if (!(__atomic_load_n(&expander_pending, __ATOMIC_ACQUIRE) & bit)) {
+        expanders[slot].irqUs = esp_timer_get_time();  // first INT since the last read
+    }
+    __atomic_fetch_or(&expander_pending, bit, __ATOMIC_RELEASE);
+}
+
+// The INT line falls on the first input change since the last read and stays low until then
+static void IRAM_ATTR expander_isr_handler(void* arg) {
+    mark_expander_pending((int) arg);
+    GpiEdge wake = { .index = GPI_WAKE, .edgeUs = 0 };
+    xQueueSendFromISR(gpio_evt_queue, &wake, NULL);
+}
+
+static void settle_timer_cb(void *arg) {
+    int index = (int) arg;
+    __atomic_fetch_or(&settle_pending[index / 32], 1u << (index % 32), __ATOMIC_RELEASE);
+    wake_gpio_task();
+}
+
+static void poll_timer_cb(void *arg) {
+    __atomic_store_n(&poll_due, true, __ATOMIC_RELEASE);
+    wake_gpio_task();
+}
+
+static void on_pins_changed(uint32_t changed, const AppConfig *cfg) {
+    __atomic_store_n(&reconfig_pending, true, __ATOMIC_RELEASE);
+    wake_gpio_task();
+}
+
+//*************** Pin map *****************************//
+
+static void release_gpi(int index) {
+    GpiPin *pin = &gpi_pins[index];
+    if (pin->settleTimer) esp_timer_stop(pin->settleTimer);
+    pin->windowStartUs = 0;
+    pin->storming = false;
+    pin->quarantined = false;
+    if (!pin->cfg.enabled) return;
+#if !CONFIG_GPIO_HANDLER_SIM_INPUTS
+    if (index >= GPI_PIN_COUNT) {
+        // expander input, the slot owns the hardware. Its cfg.gpio is 0, which must not be reset:
+        // GPIO0 is a strapping pin
+    } else if (pin->cfg.mode == GPI_MODE_COUNTER) {
+        gpi_counter_stop(&pin->counter);
+        gpio_reset_pin(pin->cfg.gpio);
+    } else {
+        gpio_isr_handler_remove(pin->cfg.gpio);
+        gpio_reset_pin(pin->cfg.gpio);
+    }
+#endif
+    pin->cfg.enabled = 0;
+}
+
+// Counter pins get no GPIO interrupt, the PCNT unit counts every edge on its own
+static void setup_gpi_counter(int index, const GpiPinConfig *cfg) {
+    GpiPin *pin = &gpi_pins[index];
+    gpi_states[index] = false;
+#if CONFIG_GPIO_HANDLER_SIM_INPUTS
+    ESP_LOGW(TAG, "GPI%02d: counter mode is not simulated, pin disabled", index + 1);
+    pin->cfg.enabled = 0;
+#else
+    if (gpi_counter_start(&pin->counter, cfg) != ESP_OK) {
+        ESP_LOGE(TAG, "GPI%02d: no pulse counter for GPIO %d", index + 1, cfg->gpio);
+        gpio_reset_pin(cfg->gpio);
+        pin->cfg.enabled = 0;
+        return;
+    }
+    pin->reportedTotal = 0;
+    pin->lastReportUs = esp_timer_get_time();
+    ESP_LOGI(TAG, "GPI%02d on GPIO %d, counter, report every %u ms / %lu edges", index + 1, cfg->gpio,
+             cfg->reportMs, (unsigned long)cfg->reportThreshold);
+#endif
+}
+
+// Native level-mode pins only: input with pull and an edge interrupt
+static esp_err_t attach_gpi_interrupt(int index, const GpiPinConfig *cfg) {
+#if !CONFIG_GPIO_HANDLER_SIM_INPUTS
+    gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << cfg->gpio,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = cfg->pull == PIN_PULL_UP ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE,
+        .pull_down_en = cfg->pull == PIN_PULL_DOWN ? GPIO_PULLDOWN_ENABLE : GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_ANYEDGE
+    };
+    esp_err_t err = gpio_config(&io_conf);
+    if (err == ESP_OK) {
+        err = gpio_isr_handler_add(cfg->gpio, gpio_isr_handler, (void*) index);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "GPI%02d: GPIO %d unusable: %s", index + 1, cfg->gpio, esp_err_to_name(err));
+        gpio_reset_pin(cfg->gpio);
+        return err;
+    }
+#endif
+    return ESP_OK;
+}
+
+static void setup_gpi(int index, const GpiPinConfig *cfg) {
+    GpiPin *pin = &gpi_pins[index];
+    pin->cfg = *cfg;
+    pin->armedCount = pin->edgeCount;
+    gpi_states[index] = false;
+    if (!cfg->enabled) {
+        if (index < GPI_PIN_COUNT) ESP_LOGI(TAG, "GPI%02d disabled", index + 1);
+        return;
+    }
+    if (!pin->settleTimer) {
+        // Created on first use, most expander inputs never need one
+        const esp_timer_create_args_t settle_args = {
+            .callback = settle_timer_cb,
+            .arg = (void*) index,
+            .name = "gpi_settle",
+        };
+        if (esp_timer_create(&settle_args, &pin->settleTimer) != ESP_OK) {
+            ESP_LOGE(TAG, "GPI%02d: no settle timer", index + 1);
+            pin->cfg.enabled = 0;
+            return;
+        }
+    }
+    if (cfg->mode == GPI_MODE_COUNTER) {
+        setup_gpi_counter(index, cfg);
+        return;
+    }
+    // Disabled pins get no interrupt at all, expander inputs share their slot's INT line
+    if (index < GPI_PIN_COUNT && attach_gpi_interrupt(index, cfg) != ESP_OK) {
+        pin->cfg.enabled = 0;
+        return;
+    }
+
+    pin->stableRaw = read_gpi(index);
+    gpi_states[index] = pin->stableRaw ^ cfg->invert;
+    pin->reportedLevel = gpi_states[index];
+    pin->tokensMilli = cfg->eventBurst * 1000u;
+    pin->refillUs = esp_timer_get_time();
+    if (index < GPI_PIN_COUNT) {
+        ESP_LOGI(TAG, "GPI%02d on GPIO %d, debounce %lu us%s", index + 1, cfg->gpio,
+                 (unsigned long)cfg->debounceUs, cfg->invert ? ", active low" : "");
+    }
+}
+
+// Caller holds gpo_lock
+static void release_gpo(int index) {
+    cancel_gpo_pattern(index);
+    if (!gpo_pins[index].enabled) return;
+    gpio_reset_pin(gpo_pins[index].gpio);
+    gpo_pins[index].enabled = 0;
+}
+
+// Caller holds gpo_lock. The logical GPO state survives a remap.
+static void setup_gpo(int index, const GpoPinConfig *cfg) {
+    char rule[sizeof(cfg->rule) + 1];
+    snprintf(rule, sizeof(rule), "%.*s", (int)sizeof(cfg->rule), cfg->rule);
+
+    gpo_pins[index] = *cfg;
+    if (gpio_rule_compile(rule, &gpo_rules[index], NULL, 0) != ESP_OK) {
+        ESP_LOGE(TAG, "GPO%02d: rule \"%s\" ignored", index + 1, rule);  // checked on save, only old data gets here
+    }
+    if (!cfg->enabled) {
+        ESP_LOGI(TAG, "GPO%02d disabled", index + 1);
+        return;
+    }
+
+    gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << cfg->gpio,
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE
+    };
+    esp_err_t err = gpio_config(&io_conf);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "GPO%02d: GPIO %d unusable: %s", index + 1, cfg->gpio, esp_err_to_name(err));
+        gpo_pins[index].enabled = 0;
+        return;
+    }
+    set_gpo_level(index, gpo_states[index]);
+    ESP_LOGI(TAG, "GPO%02d on GPIO %d%s%s%s", index + 1, cfg->gpio, cfg->invert ? ", active low" : "",
+             rule[0] ? ", rule: " : "", rule);
+}
+
+// Expander inputs behave like native level-mode pins with the slot's shared settings
+static void expander_pin_config(const ExpanderConfig *x, int pin, GpiPinConfig *out) {
+    memset(out, 0, sizeof(*out));
+    out->enabled = x->enabled && ((x->inputMask >> pin) & 1);
+    out->invert = (x->invertMask >> pin) & 1;
+    out->pull = ((x->pullUpMask >> pin) & 1) ? PIN_PULL_UP : PIN_PULL_NONE;
+    out->edges = x->edges;
+    out->mode = GPI_MODE_LEVEL;
+    out->debounceUs = x->debounceUs;
+    out->eventBurst = x->eventBurst;
+    out->eventsPerMin = x->eventsPerMin;
+}
+
+static esp_err_t attach_expander_interrupt(int slot, const ExpanderConfig *cfg) {
+#if !CONFIG_GPIO_HANDLER_SIM_INPUTS
+    if (cfg->intGpio == GPIO_EXPANDER_NO_INT) return ESP_OK;
+    gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << cfg->intGpio,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,  // INT is open drain
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE
+    };
+    esp_err_t err = gpio_config(&io_conf);
+    if (err == ESP_OK) err = gpio_isr_handler_add(cfg->intGpio, expander_isr_handler, (void*) slot);
+    if (err != ESP_OK) gpio_reset_pin(cfg->intGpio);
+    return err;
+#else
+    return ESP_OK;  // sim_edge raises the interrupt
+#endif
+}
+
+static void stop_expander(int slot) {
+    Expander *x = &expanders[slot];
+    for (int p = 0; p < GPIO_EXPANDER_PINS; p++) release_gpi(GPI_PIN_COUNT + slot * GPIO_EXPANDER_PINS + p);
+    if (!x->cfg.enabled) return;
+#if !CONFIG_GPIO_HANDLER_SIM_INPUTS
+    if (x->cfg.intGpio != GPIO_EXPANDER_NO_INT) {
+        gpio_isr_handler_remove(x->cfg.intGpio);
+        gpio_reset_pin(x->cfg.intGpio);
+    }
+#endif
+    gpio_expander_stop(&x->dev);
+    __atomic_fetch_and(&expander_pending, ~(1u << slot), __ATOMIC_RELAXED);
+    x->cfg.enabled = 0;
+}
+
+static void start_expander(int slot, const ExpanderConfig *cfg) {
+    Expander *x = &expanders[slot];
+    int first = GPI_PIN_COUNT + slot * GPIO_EXPANDER_PINS;
+    x->cfg = *cfg;
+    x->levels = 0;
+    if (cfg->enabled) {
+        esp_err_t err = gpio_expander_start(&x->dev, slot, cfg);
+        if (err == ESP_OK) err = gpio_expander_read(&x->dev, &x->levels);  // also releases a stale INT
+        if (err == ESP_OK) err = attach_expander_interrupt(slot, cfg);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Expander %d at 0x%02x unusable: %s", slot + 1, cfg->address, esp_err_to_name(err));
+            gpio_expander_stop(&x->dev);
+            x->cfg.enabled = 0;
+        } else {
+            ESP_LOGI(TAG, "Expander %d at 0x%02x: GPI%02d-GPI%02d, %s", slot + 1, cfg->address, first + 1,
+                     first + GPIO_EXPANDER_PINS, cfg->intGpio == GPIO_EXPANDER_NO_INT ? "polled" : "interrupt driven");
+        }
+    }
+    for (int p = 0; p < GPIO_EXPANDER_PINS; p++) {
+        GpiPinConfig pinCfg;
+        expander_pin_config(&x->cfg, p, &pinCfg);
+        setup_gpi(first + p, &pinCfg);
+    }
+}
+
+// Reads all inputs of an expander and feeds every change into debounce like a native edge.
+// edgeUs: when the change was first signalled.
+static void read_expander(int slot, int64_t edgeUs) {
+    Expander *x = &expanders[slot];
+    if (!x->cfg.enabled) return;
+
+    uint16_t levels;
+    if (gpio_expander_read(&x->dev, &levels) != ESP_OK) {
+        metrics_inc(METRIC_EXPANDER_READ_ERRORS);  // an INT line left low is retried by poll_expanders
+        return;
+    }
+    metrics_inc(METRIC_EXPANDER_READS);
+
+    uint16_t changed = (levels ^ x->levels) & x->cfg.inputMask;
+    x->levels = levels;
+    for (int p = 0; changed; p++, changed >>= 1) {
+        if (!(changed & 1)) continue;
+        int index = GPI_PIN_COUNT + slot * GPIO_EXPANDER_PINS + p;
+        gpi_pins[index].edgeCount++;
+        metrics_inc(METRIC_GPI_EDGES);
+        event_trace_at(TRACE_ISR, index, TRACE_SINK_NONE, edgeUs, edgeUs);  // when INT fell, or the poll tick
+        on_gpi_edge(index, edgeUs);
+    }
+}
+
+// Polled expanders are read every tick. An INT line still low means a read was missed (I2C
+// error, or a change between the read and the interrupt re-arming), so that slot is read too.
+static void poll_expanders(void) {
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < GPIO_EXPANDER_COUNT; i++) {
+        const ExpanderConfig *cfg = &expanders[i].cfg;
+        if (!cfg->enabled) continue;
+        bool due = cfg->intGpio == GPIO_EXPANDER_NO_INT;
+#if !CONFIG_GPIO_HANDLER_SIM_INPUTS
+        if (!due) due = gpio_get_level(cfg->intGpio) == 0;
+#endif
+        if (due) read_expander(i, now);
+    }
+}
+
+// Drives every rule-controlled GPO for the input change prev -> now. Runs in gpio_task right
+// after debounce, before any sink is served, so local interlocks never wait for the network.
+// edgeUs is the edge that caused the change, 0 when there was none (remap, quarantine end).
+static void run_gpo_rules(uint8_t prev, uint8_t now, int64_t edgeUs) {
+    xSemaphoreTake(gpo_lock, portMAX_DELAY);
+    for (int i = 0; i < GPO_PIN_COUNT; i++) {
+        if (!gpo_pins[i].enabled || gpo_rules[i].kind == GPIO_RULE_NONE) continue;
+        bool state = gpio_rule_eval(&gpo_rules[i], prev, now, gpo_states[i]);
+        if (state == gpo_states[i]) continue;
+        set_gpo_level(i, state);
+        metrics_inc(METRIC_GPO_RULE_CHANGES);
+        if (edgeUs) metrics_observe(HIST_EDGE_TO_OUTPUT_US, (uint32_t)(esp_timer_get_time() - edgeUs));
+        DLOGI(TAG, "Rule set GPO-%d to %s", i + 1, state ? "HIGH" : "LOW");
+    }
+    xSemaphoreGive(gpo_lock);
+}
+
+static uint8_t gpi_state_mask(void) {
+    uint8_t mask = 0;
+    for (int i = 0; i < GPI_PIN_COUNT; i++) {
+        if (gpi_states[i]) mask |= 1u << i;
+    }
+    return mask;
+}
+
+// The poll timer only runs while there is something to poll
+static void update_poll_timer(void) {
+    bool needed = false;
+    uint32_t quarantined = 0;
+    for (int i = 0; i < GPIO_EXPANDER_COUNT; i++) {
+        if (expanders[i].cfg.enabled) needed = true;  // polled, or INT lines checked for a missed read
+    }
+    for (int i = 0; i < GPI_TOTAL_COUNT; i++) {
+        const GpiPin *pin = &gpi_pins[i];
+        if (!pin->cfg.enabled) continue;
+        if (pin->cfg.mode == GPI_MODE_COUNTER || pin->storming || pin->quarantined) needed = true;
+        if (pin->quarantined) quarantined++;
+    }
+    metrics_set(METRIC_GPI_QUARANTINED, quarantined);
+
+    if (needed && !esp_timer_is_active(poll_timer)) {
+        esp_timer_start_periodic(poll_timer, POLL_US);
+    } else if (!needed) {
+        esp_timer_stop(poll_timer);
+    }
+}
+
+// Applies the configured pin maps, touching only pins whose settings changed. Everything changed
+// is released before anything is set up, so pins can trade places in a single save.
+static void apply_pin_map(void) {
+    AppConfig cfg;
+    config_snapshot(&cfg);
+
+    bool gpiChanged[GPI_PIN_COUNT];
+    bool gpoChanged[GPO_PIN_COUNT];
+    bool expanderChanged[GPIO_EXPANDER_COUNT];
+
+    xSemaphoreTake(gpo_lock, portMAX_DELAY);
+    for (int i = 0; i < GPI_PIN_COUNT; i++) {
+        gpiChanged[i] = memcmp(&gpi_pins[i].cfg, &cfg.gpi[i], sizeof(GpiPinConfig)) != 0;
+        if (gpiChanged[i]) release_gpi(i);
+    }
+    for (int i = 0; i < GPO_PIN_COUNT; i++) {
+        gpoChanged[i] = memcmp(&gpo_pins[i], &cfg.gpo[i], sizeof(GpoPinConfig)) != 0;
+        if (gpoChanged[i]) release_gpo(i);
+    }
+    for (int i = 0; i < GPIO_EXPANDER_COUNT; i++) {
+        expanderChanged[i] = memcmp(&expanders[i].cfg, &cfg.expander[i], sizeof(ExpanderConfig)) != 0;
+        if (expanderChanged[i]) stop_expander(i);
+    }
+    for (int i = 0; i < GPI_PIN_COUNT; i++) {
+        if (gpiChanged[i]) setup_gpi(i, &cfg.gpi[i]);
+    }
+    for (int i = 0; i < GPO_PIN_COUNT; i++) {
+        if (gpoChanged[i]) setup_gpo(i, &cfg.gpo[i]);
+    }
+    for (int i = 0; i < GPIO_EXPANDER_COUNT; i++) {
+        if (expanderChanged[i]) start_expander(i, &cfg.expander[i]);
+    }
+    xSemaphoreGive(gpo_lock);
+
+    uint8_t count = GPI_PIN_COUNT;
+    for (int i = 0; i < GPIO_EXPANDER_COUNT; i++) {
+        if (expanders[i].cfg.enabled) count = GPI_PIN_COUNT + (i + 1) * GPIO_EXPANDER_PINS;
+    }
+    gpi_count = count;
+
+    // Level rules take effect right away, toggles and latches wait for their next trigger
+    rule_inputs = gpi_state_mask();
+    run_gpo_rules(rule_inputs, rule_inputs, 0);
+
+    update_poll_timer();
+}
+
+// Pins the board can't give away: the Ethernet SPI bus, the expander I2C bus and, on the ESP32, the module flash
+static uint64_t reserved_pin_mask(void) {
+    uint64_t mask = 0;
+#if CONFIG_EXAMPLE_USE_SPI_ETHERNET
+    mask |= 1ULL << CONFIG_EXAMPLE_ETH_SPI_SCLK_GPIO;
+    mask |= 1ULL << CONFIG_EXAMPLE_ETH_SPI_MOSI_GPIO;
+    mask |= 1ULL << CONFIG_EXAMPLE_ETH_SPI_MISO_GPIO;
+    mask |= 1ULL << CONFIG_EXAMPLE_ETH_SPI_CS0_GPIO;
+#if CONFIG_EXAMPLE_ETH_SPI_INT0_GPIO >= 0
+    mask |= 1ULL << CONFIG_EXAMPLE_ETH_SPI_INT0_GPIO;
+#endif
+#if CONFIG_EXAMPLE_ETH_SPI_PHY_RST0_GPIO >= 0
+    mask |= 1ULL << CONFIG_EXAMPLE_ETH_SPI_PHY_RST0_GPIO;
+#endif
+#if CONFIG_EXAMPLE_SPI_ETHERNETS_NUM > 1
+    mask |= 1ULL << CONFIG_EXAMPLE_ETH_SPI_CS1_GPIO;
+#if CONFIG_EXAMPLE_ETH_SPI_INT1_GPIO >= 0
+    mask |= 1ULL << CONFIG_EXAMPLE_ETH_SPI_INT1_GPIO;
+#endif
+#if CONFIG_EXAMPLE_ETH_SPI_PHY_RST1_GPIO >= 0
+    mask |= 1ULL << CONFIG_EXAMPLE_ETH_SPI_PHY_RST1_GPIO;
+#endif
+#endif
+#endif
+#if CONFIG_GPIO_EXPANDER_I2C
+    mask |= 1ULL << CONFIG_GPIO_EXPANDER_I2C_SDA;
+    mask |= 1ULL << CONFIG_GPIO_EXPANDER_I2C_SCL;
+#endif
+#if CONFIG_IDF_TARGET_ESP32
+    mask |= 0x3FULL << 6;  // GPIO 6-11
+#endif
+    return mask;
+}
+
+esp_err_t gpio_check_pin_map(const AppConfig *cfg, char *reason, size_t reasonSize) {
+    uint64_t reserved = reserved_pin_mask();
+    uint64_t used = 0;
+
+    for (int i = 0; i < GPI_PIN_COUNT + GPO_PIN_COUNT; i++) {
+        bool isGpi = i < GPI_PIN_COUNT;
+        int slot = isGpi ? i + 1 : i - GPI_PIN_COUNT + 1;
+        const char *kind = isGpi ? "GPI" : "GPO";
+        uint8_t enabled = isGpi ? cfg->gpi[i].enabled : cfg->gpo[i - GPI_PIN_COUNT].enabled;
+        int gpio = isGpi ? cfg->gpi[i].gpio : cfg->gpo[i - GPI_PIN_COUNT].gpio;
+        if (!enabled) continue;
+
+        if (gpio >= GPIO_NUM_MAX || (isGpi ? !GPIO_IS_VALID_GPIO(gpio) : !GPIO_IS_VALID_OUTPUT_GPIO(gpio))) {
+            snprintf(reason, reasonSize, "%s%02d: GPIO %d can't be used as %s", kind, slot, gpio,
+                     isGpi ? "input" : "output");
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (reserved & (1ULL << gpio)) {
+            snprintf(reason, reasonSize, "%s%02d: GPIO %d is reserved", kind, slot, gpio);
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (used & (1ULL << gpio)) {
+            snprintf(reason, reasonSize, "%s%02d: GPIO %d is already assigned", kind, slot, gpio);
+            return ESP_ERR_INVALID_ARG;
+        }
+        used |= 1ULL << gpio;
+
+        if (isGpi && cfg->gpi[i].mode == GPI_MODE_COUNTER && cfg->gpi[i].reportThreshold == 0 &&
+            cfg->gpi[i].reportMs < POLL_US / 1000) {
+            snprintf(reason, reasonSize, "GPI%02d: counter needs a report interval of at least %d ms or a threshold",
+                     slot, POLL_US / 1000);
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (isGpi && cfg->gpi[i].eventBurst > 0 && cfg->gpi[i].eventsPerMin == 0) {
+            snprintf(reason, reasonSize, "GPI%02d: event rate limit needs a refill rate", slot);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    uint8_t addresses = 0;
+    for (int i = 0; i < GPIO_EXPANDER_COUNT; i++) {
+        const ExpanderConfig *x = &cfg->expander[i];
+        if (!x->enabled) continue;
+        if (!GPIO_EXPANDER_SUPPORTED) {
+            snprintf(reason, reasonSize, "Expander %d: firmware built without expander support", i + 1);
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        if (x->address < 0x20 || x->address > 0x27) {
+            snprintf(reason, reasonSize, "Expander %d: I2C address must be 0x20-0x27", i + 1);
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (addresses & (1u << (x->address & 7))) {
+            snprintf(reason, reasonSize, "Expander %d: I2C address 0x%02x is already used", i + 1, x->address);
+            return ESP_ERR_INVALID_ARG;
+        }
+        addresses |= 1u << (x->address & 7);
+        if (x->eventBurst > 0 && x->eventsPerMin == 0) {
+            snprintf(reason, reasonSize, "Expander %d: event rate limit needs a refill rate", i + 1);
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        int gpio = x->intGpio;
+        if (gpio == GPIO_EXPANDER_NO_INT) continue;
+        if (gpio >= GPIO_NUM_MAX || !GPIO_IS_VALID_GPIO(gpio)) {
+            snprintf(reason, reasonSize, "Expander %d: GPIO %d can't be used as INT input", i + 1, gpio);
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (reserved & (1ULL << gpio)) {
+            snprintf(reason, reasonSize, "Expander %d: INT GPIO %d is reserved", i + 1, gpio);
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (used & (1ULL << gpio)) {
+            snprintf(reason, reasonSize, "Expander %d: INT GPIO %d is already assigned", i + 1, gpio);
+            return ESP_ERR_INVALID_ARG;
+        }
+        used |= 1ULL << gpio;
+    }
+
+    for (int i = 0; i < GPO_PIN_COUNT; i++) {
+        char rule[sizeof(cfg->gpo[i].rule) + 1];
+        char error[48];
+        GpioRule compiled;
+        snprintf(rule, sizeof(rule), "%.*s", (int)sizeof(cfg->gpo[i].rule), cfg->gpo[i].rule);
+        if (gpio_rule_compile(rule, &compiled, error, sizeof(error)) != ESP_OK) {
+            snprintf(reason, reasonSize, "GPO%02d rule: %s", i + 1, error);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    return ESP_OK;
 }
 
 esp_err_t init_gpio_pins(void) {
     ESP_LOGI(TAG, "Initializing GPIO pins...");
     
-    gpio_evt_queue = xQueueCreate(10, sizeof(int));
-    xTaskCreate(gpio_task, "gpio_task", 4096, NULL, 10, NULL);
-    
+    event_journal_register_sink(JOURNAL_SINK_TCP, replay_tcp_event);
+    event_journal_register_sink(JOURNAL_SINK_HTTP, replay_http_event);
+
+    gpio_evt_queue = xQueueCreate(GPI_QUEUE_LEN, sizeof(GpiEdge));
+    gpo_lock = xSemaphoreCreateMutex();
+    if (!gpio_evt_queue || !gpo_lock) return ESP_ERR_NO_MEM;
+
+    for (int i = 0; i < GPO_PIN_COUNT; i++) {
+        const esp_timer_create_args_t pattern_args = {
+            .callback = gpo_pattern_cb,
+            .arg = (void*) i,
+            .name = "gpo_pattern",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&pattern_args, &gpo_patterns[i].timer));
+    }
+    const esp_timer_create_args_t poll_args = {
+        .callback = poll_timer_cb,
+        .name = "gpi_poll",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&poll_args, &poll_timer));
+
     // Enable ISR service
     gpio_install_isr_service(0);
     
-    // Configure GPI pins
-    for (int i = 0; i < 8; i++) {
-        gpio_config_t io_conf = {
-            .pin_bit_mask = 1ULL << gpi_pins[i],
-            .mode = GPIO_MODE_INPUT,
-            .pull_up_en = GPIO_PULLUP_ENABLE,
-            .pull_down_en = GPIO_PULLDOWN_DISABLE,
-            .intr_type = GPIO_INTR_ANYEDGE
-        };
-        ESP_ERROR_CHECK(gpio_config(&io_conf));
-        gpio_isr_handler_add(gpi_pins[i], gpio_isr_handler, (void*) i);
-        gpi_states[i] = gpio_get_level(gpi_pins[i]);
-    }
-
-    // Configure GPO pins
-    for (int i = 0; i < 5; i++) {
-        gpio_config_t io_conf = {
-            .pin_bit_mask = 1ULL << gpo_pins[i],
-            .mode = GPIO_MODE_OUTPUT,
-            .pull_up_en = GPIO_PULLUP_DISABLE,
-            .pull_down_en = GPIO_PULLDOWN_DISABLE,
-            .intr_type = GPIO_INTR_DISABLE
-        };
-        ESP_ERROR_CHECK(gpio_config(&io_conf));
-        gpio_set_level(gpo_pins[i], 0);
-    }
+#if CONFIG_GPIO_HANDLER_SIM_INPUTS
+    ESP_LOGW(TAG, "GPI inputs are simulated, pins are not read");
+#endif
+    apply_pin_map();
+    register_config_reload_hook(CONFIG_CHANGED_PINS, on_pins_changed);
 
+    task_layout_create(TASK_GPIO, gpio_task, NULL, NULL);
     return ESP_OK;
 }
 
+static inline void observe_edge_to_send(HistogramId hist, int64_t edgeUs) {
+    metrics_observe(hist, (uint32_t)(esp_timer_get_time() - edgeUs));
+}
+
+// Sends live unless the TCP sink is still catching up from the journal, misses get journaled
+static void send_tcp_event(int index, int level, const char *msg, TraceSink sink, HistogramId hist, int64_t edgeUs) {
+    if (event_journal_defer(JOURNAL_SINK_BIT(JOURNAL_SINK_TCP), index, level)) return;
+    event_trace(TRACE_ENQUEUED, index, sink, edgeUs);
+    if (tcp_client_send(msg) != ESP_OK) {
+        event_journal_append(JOURNAL_SINK_BIT(JOURNAL_SINK_TCP), index, level);
+        return;
+    }
+    event_trace(TRACE_SENT, index, sink, edgeUs);
+    observe_edge_to_send(hist, edgeUs);
+}
+
+static void dispatch_gpi_event(int index, int level, int64_t edgeUs);
+
 void handle_gpio_input_change(gpio_num_t gpio, int level) {
+    // Determine GPI index for name (e.g., "GPI01")
+    for (int i = 0; i < GPI_PIN_COUNT; i++) {
+        if (gpi_pins[i].cfg.enabled && gpi_pins[i].cfg.gpio == gpio) {
+            dispatch_gpi_event(i, level, esp_timer_get_time());
+            return;
+        }
+    }
+    ESP_LOGW(TAG, "Unknown GPI pin triggered");
+}
+
+// edgeUs: when the edge that started this debounce window hit the ISR
+static void dispatch_gpi_event(int index, int level, int64_t edgeUs) {
     char msg[256];
     const char* state = level ? "HIGH" : "LOW";
 
-    // Determine GPI index for name (e.g., "GPI01")
-    int index = -1;
-    for (int i = 0; i < 8; i++) {
-        if (gpio == gpi_pins[i]) {
-            index = i;
-            break;
+    char event_name[8];
+    snprintf(event_name, sizeof(event_name), "GPI%02d", index + 1);  // e.g., GPI01
+    DLOGI(TAG, "Trigger:GPI%02d %s", index + 1, state);
+    metrics_inc(METRIC_GPI_EVENTS);
+
+    SinkConfig cfg;
+    config_snapshot_sinks(&cfg);  // one consistent view for all sinks of this event
+
+    if (cfg.companionMode) {
+        construct_message(event_name, state, "", "", msg, sizeof(msg));
+        event_trace(TRACE_BUILT, index, TRACE_SINK_COMPANION, edgeUs);
+        send_tcp_event(index, level, msg, TRACE_SINK_COMPANION, HIST_EDGE_TO_SEND_COMPANION_US, edgeUs);
+        return;
+    }
+
+    if (cfg.serialEnabled) {
+        construct_message(event_name, state, "", "", msg, sizeof(msg));
+        event_trace(TRACE_BUILT, index, TRACE_SINK_SERIAL, edgeUs);
+        event_trace(TRACE_ENQUEUED, index, TRACE_SINK_SERIAL, edgeUs);
+        if (printf("%s", msg) < 0) {
+            metrics_inc(METRIC_SINK_SERIAL_FAILED);
+        } else {
+            event_trace(TRACE_SENT, index, TRACE_SINK_SERIAL, edgeUs);
+            metrics_inc(METRIC_SINK_SERIAL_SENT);
+            observe_edge_to_send(HIST_EDGE_TO_SEND_SERIAL_US, edgeUs);
         }
     }
 
-    if (index == -1) {
-        ESP_LOGW(TAG, "Unknown GPI pin triggered");
-        return;
+    if (cfg.tcpEnabled) {
+        construct_message(event_name, state, cfg.tcpUser, cfg.tcpPassword, msg, sizeof(msg));
+        event_trace(TRACE_BUILT, index, TRACE_SINK_TCP, edgeUs);
+        send_tcp_event(index, level, msg, TRACE_SINK_TCP, HIST_EDGE_TO_SEND_TCP_US, edgeUs);
     }
 
+    if (cfg.httpEnabled) {
+        construct_message(event_name, state, cfg.httpUser, cfg.httpPassword, msg, sizeof(msg));
+        event_trace(TRACE_BUILT, index, TRACE_SINK_HTTP, edgeUs);
+        if (!event_journal_defer(JOURNAL_SINK_BIT(JOURNAL_SINK_HTTP), index, level)) {
+            send_http_event(msg, index, level, edgeUs);
+        }
+    }
+}
+
+//*************** Journal catch-up *****************************//
+// Replayed events are rebuilt with the credentials configured now, not the ones at edge time.
+
+static esp_err_t replay_tcp_event(const JournalEvent *ev) {
+    char msg[256];
     char event_name[8];
-    snprintf(event_name, sizeof(event_name), "GPI%02d", index + 1);  // e.g., GPI01
-    ESP_LOGI(TAG, "Trigger:%s",event_name);
-    if (globalConfig.companionMode) {
+    SinkConfig cfg;
+    config_snapshot_sinks(&cfg);
+    if (!cfg.companionMode && !cfg.tcpEnabled) return ESP_ERR_INVALID_STATE;
+
+    snprintf(event_name, sizeof(event_name), "GPI%02d", ev->gpi + 1);
+    const char *state = ev->level ? "HIGH" : "LOW";
+    if (cfg.companionMode) {
         construct_message(event_name, state, "", "", msg, sizeof(msg));
+    } else {
+        construct_message(event_name, state, cfg.tcpUser, cfg.tcpPassword, msg, sizeof(msg));
+    }
+    return tcp_client_send(msg);
+}
+
+static esp_err_t replay_http_event(const JournalEvent *ev) {
+    char msg[256];
+    char event_name[8];
+    SinkConfig cfg;
+    config_snapshot_sinks(&cfg);
+    if (cfg.companionMode || !cfg.httpEnabled) return ESP_ERR_INVALID_STATE;
+
+    snprintf(event_name, sizeof(event_name), "GPI%02d", ev->gpi + 1);
+    construct_message(event_name, ev->level ? "HIGH" : "LOW", cfg.httpUser, cfg.httpPassword, msg, sizeof(msg));
+    return send_http_post_sync(msg);
+}
+
+//*************** Unjournaled messages *****************************//
+
+// Builds one message with the given sink credentials, NULL if it doesn't fit
+typedef char *(*BuildMessage)(const void *ctx, const char *user, const char *password, char *buf, size_t size);
+
+// Sends to every enabled sink without journaling, for messages that summarize state
+static void send_unjournaled(BuildMessage build, const void *ctx) {
+    char msg[256];
+    SinkConfig cfg;
+    config_snapshot_sinks(&cfg);
+
+    if (cfg.companionMode) {
+        if (build(ctx, "", "", msg, sizeof(msg))) tcp_client_send(msg);
+        return;
+    }
+
+    if (cfg.serialEnabled && build(ctx, "", "", msg, sizeof(msg))) {
+        if (printf("%s", msg) < 0) {
+            metrics_inc(METRIC_SINK_SERIAL_FAILED);
+        } else {
+            metrics_inc(METRIC_SINK_SERIAL_SENT);
+        }
+    }
+    if (cfg.tcpEnabled && build(ctx, cfg.tcpUser, cfg.tcpPassword, msg, sizeof(msg))) {
         tcp_client_send(msg);
+    }
+    if (cfg.httpEnabled && build(ctx, cfg.httpUser, cfg.httpPassword, msg, sizeof(msg))) {
+        send_http_post(msg);
+    }
+}
+
+//*************** Counter mode *****************************//
+//
+// Counter pins are reported as aggregates only: total count, the count since the last report and
+// the rate over that interval. Reports are not journaled, the running total in the next one
+// already covers whatever a lost report counted.
+
+typedef struct {
+    char eventName[8];
+    uint64_t total;
+    uint32_t delta;
+    uint32_t intervalMs;
+    double rate;
+    double frequency;
+} CounterReport;
+
+static char *build_counter_message(const void *ctx, const char *user, const char *password, char *buf, size_t size) {
+    const CounterReport *r = ctx;
+    return construct_counter_message(r->eventName, r->total, r->delta, r->intervalMs, r->rate, r->frequency,
+                                     user, password, buf, size);
+}
+
+static void dispatch_counter_report(int index, uint64_t total, uint32_t delta, int64_t elapsedUs) {
+    CounterReport report = { .total = total, .delta = delta, .intervalMs = (uint32_t)(elapsedUs / 1000) };
+    snprintf(report.eventName, sizeof(report.eventName), "GPI%02d", index + 1);
+    report.rate = elapsedUs > 0 ? delta * 1e6 / elapsedUs : 0;
+    report.frequency = gpi_pins[index].cfg.edges == PIN_EDGES_BOTH ? report.rate / 2 : report.rate;  // two edges per period
+
+    metrics_inc(METRIC_GPI_COUNTER_REPORTS);
+    send_unjournaled(build_counter_message, &report);
+}
+
+static void poll_counters(void) {
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < GPI_PIN_COUNT; i++) {
+        GpiPin *pin = &gpi_pins[i];
+        if (!pin->cfg.enabled || pin->cfg.mode != GPI_MODE_COUNTER) continue;
+
+        uint64_t total = gpi_counter_read(&pin->counter);
+        uint64_t delta = total - pin->reportedTotal;
+        int64_t elapsedUs = now - pin->lastReportUs;
+        bool thresholdHit = pin->cfg.reportThreshold > 0 && delta >= pin->cfg.reportThreshold;
+        bool intervalDue = pin->cfg.reportMs > 0 && elapsedUs >= pin->cfg.reportMs * 1000LL;
+        if (!thresholdHit && !intervalDue) continue;
+
+        pin->reportedTotal = total;
+        pin->lastReportUs = now;
+        dispatch_counter_report(i, total, delta > UINT32_MAX ? UINT32_MAX : (uint32_t)delta, elapsedUs);
+    }
+}
+
+//*************** Event storms *****************************//
+//
+// Every level-mode GPI has a token bucket: eventBurst events at once, refilled at eventsPerMin.
+// A pin that runs dry is storming: its events are counted and coalesced instead of sent, and once
+// it has been quiet for STORM_QUIET_MS the final state goes out as a single event. A storm that
+// outlasts QUARANTINE_AFTER_S turns the pin's interrupt off for QUARANTINE_HOLD_S, so a broken
+// contact can't keep gpio_task and the sinks busy. Rules still see every settled level.
+
+static char *build_pin_status_message(const void *ctx, const char *user, const char *password, char *buf, size_t size) {
+    const char *const *parts = ctx;  // event, pin name
+    return construct_message(parts[0], parts[1], user, password, buf, size);
+}
+
+static void send_pin_status(int index, const char *event) {
+    char name[8];
+    snprintf(name, sizeof(name), "GPI%02d", index + 1);
+    const char *parts[2] = { event, name };
+    send_unjournaled(build_pin_status_message, parts);
+}
+
+static void refill_tokens(GpiPin *pin, int64_t now) {
+    uint32_t capacity = pin->cfg.eventBurst * 1000u;
+    int64_t gained = pin->cfg.eventsPerMin * (now - pin->refillUs) / 60000;  // milli-tokens
+    if (gained <= 0) return;  // keep the fraction for the next refill
+    pin->tokensMilli = gained >= capacity - pin->tokensMilli ? capacity : pin->tokensMilli + (uint32_t)gained;
+    pin->refillUs = now;
+}
+
+static bool edge_reported(const GpiPinConfig *cfg, int level) {
+    return !((cfg->edges == PIN_EDGES_RISING && !level) || (cfg->edges == PIN_EDGES_FALLING && level));
+}
+
+static void report_gpi_event(int index, int level, int64_t edgeUs) {
+    GpiPin *pin = &gpi_pins[index];
+    if (pin->cfg.eventBurst == 0) {
+        pin->reportedLevel = level;
+        dispatch_gpi_event(index, level, edgeUs);
         return;
     }
 
-    if (globalConfig.serialEnabled) {
-        construct_message(event_name, state, "", "", msg, sizeof(msg));
-        printf("%s", msg);
+    int64_t now = esp_timer_get_time();
+    refill_tokens(pin, now);
+    if (!pin->storming && pin->tokensMilli >= 1000) {
+        pin->tokensMilli -= 1000;
+        pin->reportedLevel = level;
+        dispatch_gpi_event(index, level, edgeUs);
+        return;
     }
 
-    if (globalConfig.tcpEnabled) {
-        construct_message(event_name, state, globalConfig.tcpUser, globalConfig.tcpPassword, msg, sizeof(msg));
-        tcp_client_send(msg);
+    if (!pin->storming) {
+        pin->storming = true;
+        pin->stormStartUs = now;
+        ESP_LOGW(TAG, "GPI%02d: event storm, coalescing", index + 1);
+        update_poll_timer();
     }
+    pin->pendingLevel = level;
+    pin->pendingEdgeUs = edgeUs;
+    pin->lastSuppressedUs = now;
+    __atomic_fetch_add(&pin->suppressed, 1, __ATOMIC_RELAXED);
+    metrics_inc(METRIC_GPI_EVENTS_SUPPRESSED);
+}
 
-    if (globalConfig.httpEnabled) {
-        construct_message(event_name, state, globalConfig.httpUser, globalConfig.httpPassword, msg, sizeof(msg));
-        send_http_post(msg);
+static void quarantine_gpi(int index, int64_t now) {
+    GpiPin *pin = &gpi_pins[index];
+#if !CONFIG_GPIO_HANDLER_SIM_INPUTS
+    if (index < GPI_PIN_COUNT) gpio_intr_disable(pin->cfg.gpio);  // expander inputs are muted in software
+#endif
+    esp_timer_stop(pin->settleTimer);
+    pin->windowStartUs = 0;
+    pin->storming = false;
+    pin->quarantined = true;
+    pin->quarantineEndUs = now + CONFIG_GPIO_HANDLER_QUARANTINE_HOLD_S * 1000000LL;
+    ESP_LOGE(TAG, "GPI%02d: storming for %d s, quarantined for %d s", index + 1,
+             CONFIG_GPIO_HANDLER_QUARANTINE_AFTER_S, CONFIG_GPIO_HANDLER_QUARANTINE_HOLD_S);
+    metrics_inc(METRIC_GPI_QUARANTINES);
+    send_pin_status(index, "pin-fault");
+}
+
+// Re-arms the pin and catches up with whatever level it settled on meanwhile
+static void release_quarantine(int index, int64_t now) {
+    GpiPin *pin = &gpi_pins[index];
+    pin->quarantined = false;
+    pin->armedCount = pin->edgeCount;
+    pin->tokensMilli = pin->cfg.eventBurst * 1000u;
+    pin->refillUs = now;
+    ESP_LOGI(TAG, "GPI%02d: quarantine over", index + 1);
+    send_pin_status(index, "pin-ok");
+#if !CONFIG_GPIO_HANDLER_SIM_INPUTS
+    if (index < GPI_PIN_COUNT) gpio_intr_enable(pin->cfg.gpio);  // before the read, a later edge then settles normally
+#endif
+
+    int raw = read_gpi(index);
+    pin->stableRaw = raw;
+    int level = raw ^ pin->cfg.invert;
+    gpi_states[index] = level;
+    if (index < GPI_PIN_COUNT) {  // rules only see GPI1-8
+        uint8_t prev = rule_inputs;
+        rule_inputs = level ? (prev | (1u << index)) : (prev & ~(1u << index));
+        run_gpo_rules(prev, rule_inputs, 0);
+    }
+
+    if (level != pin->reportedLevel && edge_reported(&pin->cfg, level)) {
+        pin->reportedLevel = level;
+        dispatch_gpi_event(index, level, now);
+    }
+}
+
+static void poll_storms(void) {
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < GPI_TOTAL_COUNT; i++) {
+        GpiPin *pin = &gpi_pins[i];
+        if (!pin->cfg.enabled) continue;
+
+        if (pin->quarantined) {
+            if (now >= pin->quarantineEndUs) release_quarantine(i, now);
+            continue;
+        }
+        if (!pin->storming) continue;
+
+#if CONFIG_GPIO_HANDLER_QUARANTINE_AFTER_S > 0
+        if (now - pin->stormStartUs >= CONFIG_GPIO_HANDLER_QUARANTINE_AFTER_S * 1000000LL) {
+            quarantine_gpi(i, now);
+            continue;
+        }
+#endif
+        if (now - pin->lastSuppressedUs < STORM_QUIET_US) continue;
+
+        // Edge-filtered pins report edges, not levels, so their coalesced edge always goes out
+        pin->storming = false;
+        ESP_LOGI(TAG, "GPI%02d: event storm over", i + 1);
+        if (pin->pendingLevel != pin->reportedLevel || pin->cfg.edges != PIN_EDGES_BOTH) {
+            pin->reportedLevel = pin->pendingLevel;
+            dispatch_gpi_event(i, pin->pendingLevel, pin->pendingEdgeUs);
+        }
+    }
+}
+
+//*************** Debounce *****************************//
+//
+// Every edge restarts the pin's settle timer; the level is reported once it held for debounceUs.
+// The latency to report is the debounce time itself instead of a polling period, and pins with
+// debounceUs = 0 report on the edge. Edges are counted in the ISR as well, so a burst that
+// overflows the queue still keeps the window open until the pin is really quiet.
+
+static void settle_gpi(int index) {
+    GpiPin *pin = &gpi_pins[index];
+    if (!pin->cfg.enabled) return;
+
+    if (pin->cfg.debounceUs > 0 && pin->edgeCount != pin->armedCount) {
+        // Edges since the timer was armed whose queue items were dropped, keep waiting
+        pin->armedCount = pin->edgeCount;
+        esp_timer_start_once(pin->settleTimer, pin->cfg.debounceUs);
+        return;
+    }
+
+    int raw = read_gpi(index);
+    int64_t edgeUs = pin->windowStartUs ? pin->windowStartUs : esp_timer_get_time();
+    pin->windowStartUs = 0;
+    if (raw == pin->stableRaw) {
+        metrics_inc(METRIC_GPI_DEBOUNCE_DROPS);  // bounced back to where it was
+        return;
+    }
+
+    pin->stableRaw = raw;
+    int level = raw ^ pin->cfg.invert;
+    gpi_states[index] = level;
+    event_trace(TRACE_STABLE, index, TRACE_SINK_NONE, edgeUs);
+
+    if (index < GPI_PIN_COUNT) {  // rules only see GPI1-8
+        uint8_t prev = rule_inputs;
+        rule_inputs = level ? (prev | (1u << index)) : (prev & ~(1u << index));
+        run_gpo_rules(prev, rule_inputs, edgeUs);
+    }
+
+    // Filtered edges still update the state served to sync requests
+    if (!edge_reported(&pin->cfg, level)) return;
+    report_gpi_event(index, level, edgeUs);
+}
+
+static void on_gpi_edge(int index, int64_t edgeUs) {
+    GpiPin *pin = &gpi_pins[index];
+    if (!pin->cfg.enabled || pin->quarantined) return;  // queued before the pin was released or muted
+    event_trace(TRACE_DEQUEUE, index, TRACE_SINK_NONE, edgeUs);
+
+    if (pin->windowStartUs == 0) pin->windowStartUs = edgeUs;
+    if (pin->cfg.debounceUs == 0) {
+        settle_gpi(index);
+        return;
     }
+
+    pin->armedCount = pin->edgeCount;
+    esp_timer_stop(pin->settleTimer);  // ESP_ERR_INVALID_STATE when it wasn't running
+    esp_timer_start_once(pin->settleTimer, pin->cfg.debounceUs);
 }
 
-// This is the debounce logic
 static void gpio_task(void *arg) {
-    int index;
+    GpiEdge edge;
     while (1) {
-        // Wait for an event to know which pin to check
-        if (xQueueReceive(gpio_evt_queue, &index, portMAX_DELAY)) {
-            while (1) {
-                int level = gpio_get_level(gpi_pins[index]); // Read current level
-                int64_t now = esp_timer_get_time() / 1000;   // Current time in ms
-
-                if (level != last_debounce_state[index]) {
-                    // Level changed: start (or restart) debounce timer
-                    last_debounce_state[index] = level;
-                    last_debounce_time[index] = now;
-                } else {
-                    // Same level as before, check if debounce period has passed
-                    if ((now - last_debounce_time[index]) >= DEBOUNCE_DELAY_MS) {
-                        if (level != last_stable_state[index]) {
-                            last_stable_state[index] = level;
-                            gpi_states[index] = level;
-                            handle_gpio_input_change(gpi_pins[index], level);
-                        }
-                        break; // Exit inner loop once state is stable
-                    }
-                }
-                vTaskDelay(pdMS_TO_TICKS(10)); // Small delay to avoid busy-waiting
+        if (!xQueueReceive(gpio_evt_queue, &edge, portMAX_DELAY)) continue;
+
+        if (__atomic_exchange_n(&reconfig_pending, false, __ATOMIC_ACQ_REL)) {
+            apply_pin_map();
+        }
+        if (edge.index != GPI_WAKE) {
+            on_gpi_edge(edge.index, edge.edgeUs);
+        }
+
+        uint32_t irqs = __atomic_exchange_n(&expander_pending, 0, __ATOMIC_ACQ_REL);
+        for (int i = 0; irqs; i++, irqs >>= 1) {
+            if (irqs & 1) read_expander(i, expanders[i].irqUs);
+        }
+
+        for (int w = 0; w < SETTLE_WORDS; w++) {
+            uint32_t due = __atomic_exchange_n(&settle_pending[w], 0, __ATOMIC_ACQ_REL);
+            for (int b = 0; due; b++, due >>= 1) {
+                if (due & 1) settle_gpi(w * 32 + b);
             }
         }
+
+        if (__atomic_exchange_n(&poll_due, false, __ATOMIC_ACQ_REL)) {
+            poll_counters();
+            poll_expanders();
+            poll_storms();
+            update_poll_timer();
+        }
     }
 }
 
-void trigger_gpo(uint8_t gpo_num, bool state) {
-    if (gpo_num >= 1 && gpo_num <= 5) {
-        int level = state ? 1 : 0;
-        gpo_states[gpo_num - 1] = state;  // Update the state 
-        gpio_set_level(gpo_pins[gpo_num - 1], level);
-        ESP_LOGI(TAG, "Set GPO-%d to %s", gpo_num, state ? "HIGH" : "LOW");
+//*************** GPO commands and patterns *****************************//
+//
+// Pulses and blinks run on one esp_timer per GPO. Every transition is scheduled against the
+// absolute time the pattern started, so widths don't drift with callback latency, and the
+// esp_timer task runs above every network task, so their load doesn't shift the edges either.
+// The callbacks take only gpo_level_lock: gpo_lock can be held across an expander's I2C
+// transfers, and a callback waiting on it would stall every other esp_timer client.
+
+// Takes gpo_lock for a network command on GPO index. Returns false, with the lock released,
+// when the GPO can't take commands.
+static bool lock_gpo_for_command(int index) {
+    xSemaphoreTake(gpo_lock, portMAX_DELAY);
+    if (!gpo_pins[index].enabled) {
+        xSemaphoreGive(gpo_lock);
+        ESP_LOGW(TAG, "GPO-%d is disabled", index + 1);
+        return false;
+    }
+    if (gpo_rules[index].kind != GPIO_RULE_NONE) {
+        xSemaphoreGive(gpo_lock);
+        ESP_LOGW(TAG, "GPO-%d is driven by a local rule, command ignored", index + 1);
+        return false;
+    }
+    return true;
+}
+
+// Caller holds gpo_lock
+static void set_gpo_level(int index, bool state) {
+    portENTER_CRITICAL(&gpo_level_lock);
+    gpo_states[index] = state;  // Update the state 
+    gpio_set_level(gpo_pins[index].gpio, state ^ gpo_pins[index].invert);
+    portEXIT_CRITICAL(&gpo_level_lock);
+}
+
+// Caller holds gpo_lock. A callback that already fired sees the pattern inactive.
+static void cancel_gpo_pattern(int index) {
+    GpoPattern *pattern = &gpo_patterns[index];
+    portENTER_CRITICAL(&gpo_level_lock);
+    bool active = pattern->active;
+    pattern->active = false;
+    portEXIT_CRITICAL(&gpo_level_lock);
+    if (active) esp_timer_stop(pattern->timer);
+}
+
+static void schedule_gpo_pattern(GpoPattern *pattern, int64_t nextUs) {
+    int64_t delay = nextUs - esp_timer_get_time();
+    esp_timer_start_once(pattern->timer, delay > 0 ? delay : 1);
+}
+
+// Runs on the esp_timer task: only gpo_level_lock, never gpo_lock
+static void gpo_pattern_cb(void *arg) {
+    int index = (int) arg;
+    GpoPattern *pattern = &gpo_patterns[index];
+
+    portENTER_CRITICAL(&gpo_level_lock);
+    if (!pattern->active) {  // cancelled after the timer fired
+        portEXIT_CRITICAL(&gpo_level_lock);
+        return;
+    }
+    int64_t nextUs = pattern->nextUs;
+    if (esp_timer_get_time() >= nextUs) {
+        pattern->on = !pattern->on;
+        gpo_states[index] = pattern->on;
+        gpio_set_level(pattern->gpio, pattern->on ^ pattern->invert);
+        if (!pattern->on && pattern->remaining > 0 && --pattern->remaining == 0) {
+            pattern->active = false;
+        } else {
+            pattern->nextUs += pattern->on ? pattern->onUs : pattern->offUs;
+        }
+        nextUs = pattern->active ? pattern->nextUs : 0;
+    }
+    // else: early, armed for a pattern that was replaced meanwhile
+    portEXIT_CRITICAL(&gpo_level_lock);
+
+    if (nextUs) schedule_gpo_pattern(pattern, nextUs);
+}
+
+esp_err_t gpo_start_pattern(uint8_t gpo_num, uint32_t onUs, uint32_t offUs, uint32_t count) {
+    if (gpo_num < 1 || gpo_num > GPO_PIN_COUNT) {
+        ESP_LOGW(TAG, "Invalid GPO number: %d", gpo_num);
+        return ESP_ERR_INVALID_ARG;
+    }
+    bool repeats = count != 1;
+    if (onUs < GPO_PATTERN_MIN_US || onUs > GPO_PATTERN_MAX_US ||
+        (repeats && (offUs < GPO_PATTERN_MIN_US || offUs > GPO_PATTERN_MAX_US))) {
+        ESP_LOGW(TAG, "GPO-%d: pattern timing out of range", gpo_num);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int index = gpo_num - 1;
+    if (!lock_gpo_for_command(index)) return ESP_ERR_INVALID_STATE;
+
+    GpoPattern *pattern = &gpo_patterns[index];
+    cancel_gpo_pattern(index);
+    set_gpo_level(index, true);
+    portENTER_CRITICAL(&gpo_level_lock);
+    pattern->gpio = gpo_pins[index].gpio;
+    pattern->invert = gpo_pins[index].invert;
+    pattern->onUs = onUs;
+    pattern->offUs = offUs;
+    pattern->remaining = count;
+    pattern->active = true;
+    pattern->on = true;
+    pattern->nextUs = esp_timer_get_time() + onUs;
+    portEXIT_CRITICAL(&gpo_level_lock);
+    // A callback of the old pattern may have re-armed the timer since the cancel, replace that
+    while (esp_timer_start_once(pattern->timer, onUs) == ESP_ERR_INVALID_STATE) {
+        esp_timer_stop(pattern->timer);
+    }
+    xSemaphoreGive(gpo_lock);
+
+    if (repeats) {
+        DLOGI(TAG, "Blink GPO-%d %lu/%lu us, %lu times", gpo_num, (unsigned long)onUs,
+              (unsigned long)offUs, (unsigned long)count);
     } else {
+        DLOGI(TAG, "Pulse GPO-%d for %lu us", gpo_num, (unsigned long)onUs);
+    }
+    return ESP_OK;
+}
+
+void trigger_gpo(uint8_t gpo_num, bool state) {
+    if (gpo_num < 1 || gpo_num > GPO_PIN_COUNT) {
         ESP_LOGW(TAG, "Invalid GPO number: %d", gpo_num);
+        return;
+    }
+    if (!lock_gpo_for_command(gpo_num - 1)) return;
+    cancel_gpo_pattern(gpo_num - 1);
+    set_gpo_level(gpo_num - 1, state);
+    xSemaphoreGive(gpo_lock);
+    DLOGI(TAG, "Set GPO-%d to %s", gpo_num, state ? "HIGH" : "LOW");
+}
+
+#if CONFIG_GPIO_HANDLER_SIM_INPUTS
+//*************** Simulated inputs *****************************//
+
+typedef struct {
+    uint32_t delayUs;  // wait before this edge, relative to the previous step
+    uint8_t gpi;       // 0-based
+    uint8_t level;
+} SimStep;
+
+typedef struct {
+    size_t count;
+    SimStep steps[];
+} SimTrace;
+
+// Same path as gpio_isr_handler, so overflow and edge counters behave like real bursts
+static void sim_edge(uint8_t gpi, uint8_t level) {
+    if (gpi >= GPI_PIN_COUNT) {
+        // Expander input: change the mock chip and raise its slot's INT like the real line would
+        int slot = expander_slot(gpi);
+        gpio_expander_mock_set(slot, expander_pin(gpi), level);
+        if (expanders[slot].cfg.enabled) {
+            mark_expander_pending(slot);
+            wake_gpio_task();
+        }
+        return;
+    }
+    sim_levels[gpi] = level;
+    if (!gpi_pins[gpi].cfg.enabled || gpi_pins[gpi].quarantined) return;  // no interrupt on a disabled or muted pin
+    gpi_pins[gpi].edgeCount++;
+    GpiEdge edge = { .index = gpi, .edgeUs = esp_timer_get_time() };
+    metrics_inc(METRIC_GPI_EDGES);
+    event_trace_at(TRACE_ISR, gpi, TRACE_SINK_NONE, edge.edgeUs, edge.edgeUs);
+    if (xQueueSend(gpio_evt_queue, &edge, 0) != pdTRUE) {
+        metrics_inc(METRIC_GPI_QUEUE_OVERFLOWS);
+    }
+}
+
+static void sim_player_task(void *arg) {
+    SimTrace *trace = arg;
+    int64_t due = esp_timer_get_time();
+
+    // Steps are timed against an absolute schedule so delays don't accumulate drift
+    for (size_t i = 0; i < trace->count; i++) {
+        due += trace->steps[i].delayUs;
+        int64_t wait = due - esp_timer_get_time();
+        if (wait >= (int64_t)portTICK_PERIOD_MS * 1000) {
+            vTaskDelay(pdMS_TO_TICKS(wait / 1000));
+            wait = due - esp_timer_get_time();
+        }
+        if (wait > 0) esp_rom_delay_us(wait);  // sub-tick remainder
+        sim_edge(trace->steps[i].gpi, trace->steps[i].level);
+    }
+
+    ESP_LOGI(TAG, "Sim trace done (%d steps)", (int)trace->count);
+    free(trace);
+    sim_playing = false;
+    vTaskDelete(NULL);
+}
+
+// Parses one "<delay_us> <gpi 1-72> <0|1>" line, blank lines and '#' comments are skipped by the caller
+static bool parse_sim_step(const char *line, const char *end, SimStep *out) {
+    uint32_t fields[3] = {0};
+    int field = 0;
+    bool in_number = false;
+
+    for (const char *p = line; p < end; p++) {
+        if (*p >= '0' && *p <= '9') {
+            if (!in_number && field == 3) return false;
+            if (!in_number) field++;
+            in_number = true;
+            if (fields[field - 1] > 99999999) return false;
+            fields[field - 1] = fields[field - 1] * 10 + (*p - '0');
+        } else if (*p == ' ' || *p == '\t' || *p == ',' || *p == '\r') {
+            in_number = false;
+        } else {
+            return false;
+        }
+    }
+    if (field != 3 || fields[1] < 1 || fields[1] > GPI_TOTAL_COUNT || fields[2] > 1) return false;
+
+    out->delayUs = fields[0];
+    out->gpi = fields[1] - 1;
+    out->level = fields[2];
+    return true;
+}
+
+esp_err_t gpio_sim_play(const char *trace, size_t len) {
+    SimTrace *parsed = malloc(sizeof(SimTrace) + CONFIG_GPIO_HANDLER_SIM_MAX_STEPS * sizeof(SimStep));
+    if (!parsed) return ESP_ERR_NO_MEM;
+    parsed->count = 0;
+
+    const char *end = trace + len;
+    for (const char *line = trace; line < end; ) {
+        const char *eol = memchr(line, '\n', end - line);
+        if (!eol) eol = end;
+
+        const char *p = line;
+        while (p < eol && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+        if (p < eol && *p != '#') {
+            if (parsed->count == CONFIG_GPIO_HANDLER_SIM_MAX_STEPS ||
+                !parse_sim_step(p, eol, &parsed->steps[parsed->count])) {
+                ESP_LOGW(TAG, "Sim trace rejected at offset %d", (int)(line - trace));
+                free(parsed);
+                return ESP_ERR_INVALID_ARG;
+            }
+            parsed->count++;
+        }
+        line = eol + 1;
     }
+
+    if (parsed->count == 0) {
+        free(parsed);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    bool expected = false;
+    if (!__atomic_compare_exchange_n(&sim_playing, &expected, true, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        free(parsed);
+        return ESP_ERR_INVALID_STATE;  // one trace at a time
+    }
+
+    ESP_LOGI(TAG, "Playing sim trace (%d steps)", (int)parsed->count);
+    // Above gpio_task, so edges are injected on time even while the pipeline is busy
+    if (task_layout_create(TASK_GPIO_SIM, sim_player_task, parsed, NULL) != pdPASS) {
+        free(parsed);
+        sim_playing = false;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
 }
+#endif
 
 //*************** States and configured pins count getters for sync response *****************************//
 
 bool get_gpi_state(uint8_t index) {
-    return (index < 8) ? gpi_states[index] : false;
+    return (index < GPI_TOTAL_COUNT) ? gpi_states[index] : false;
 }
 
 bool get_gpo_state(uint8_t index) {
-    return (index < 5) ? gpo_states[index] : false;
+    return (index < GPO_PIN_COUNT) ? gpo_states[index] : false;
+}
+
+uint32_t get_gpi_suppressed(uint8_t index) {
+    return (index < GPI_TOTAL_COUNT) ? __atomic_load_n(&gpi_pins[index].suppressed, __ATOMIC_RELAXED) : 0;
+}
+
+bool get_gpi_quarantined(uint8_t index) {
+    return (index < GPI_TOTAL_COUNT) ? gpi_pins[index].quarantined : false;
 }
 
 uint8_t get_gpi_count(void) {
-    return sizeof(gpi_pins) / sizeof(gpi_pins[0]);
+    return gpi_count;
 }
 
 uint8_t get_gpo_count(void) {
-    return sizeof(gpo_pins) / sizeof(gpo_pins[0]);
+    return GPO_PIN_COUNT;
 }
\ No newline at end of file
@@ -2,16 +2,46 @@
 
 #include "esp_err.h"
 #include <stdbool.h>
+#include <stddef.h>
+#include "sdkconfig.h"
 #include "driver/gpio.h"
+#include "app_config.h"
 
+// Sets up the pin maps from the live config. Later pin map changes are applied by the
+// GPIO task without a reboot.
 esp_err_t init_gpio_pins(void);
+
+// Checks the pin maps in cfg before they are saved: every enabled pin must exist (and be
+// output-capable for GPOs), must not be used by Ethernet or flash and must be unique.
+// On failure reason holds a message for the user.
+esp_err_t gpio_check_pin_map(const AppConfig *cfg, char *reason, size_t reasonSize);
+
 void handle_gpio_input_change(gpio_num_t gpio, int level);
+// Sets GPO gpo_num (1-based), cancelling any pulse or blink running on it
 void trigger_gpo(uint8_t gpo_num, bool state);
 
+#define GPO_PATTERN_MIN_US 100
+#define GPO_PATTERN_MAX_US 3600000000UL
+
+// Drives GPO gpo_num HIGH for onUs, then LOW for offUs, count times (0 = until the next command)
+// and leaves it LOW. A single pulse is count 1, offUs is then unused. Replaces a running pattern.
+esp_err_t gpo_start_pattern(uint8_t gpo_num, uint32_t onUs, uint32_t offUs, uint32_t count);
+
+#if CONFIG_GPIO_HANDLER_SIM_INPUTS
+// Plays an edge trace against the simulated inputs in the background. One step per line:
+// "<delay_us> <gpi 1-72> <0|1>", delays are relative to the previous step, '#' starts a comment.
+// ESP_ERR_INVALID_STATE while another trace is still playing.
+esp_err_t gpio_sim_play(const char *trace, size_t len);
+#endif
+
 // GPIO state getters
 bool get_gpi_state(uint8_t index);
 bool get_gpo_state(uint8_t index); 
 
+// Events of GPI index dropped by storm suppression since boot, and whether the pin is quarantined
+uint32_t get_gpi_suppressed(uint8_t index);
+bool get_gpi_quarantined(uint8_t index);
+
 // Number of configured GPI and GPO getters. Those is used to keep the response dynamic , if we decide to change GPO pins from 8 it total to 5
 // Our response will always send only configured pins.
 uint8_t get_gpi_count(void);
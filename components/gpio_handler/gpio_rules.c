@@ -0,0 +1,163 @@
+#include "gpio_rules.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+// The compiler evaluates the expression for all 256 input masks at once: every value is a
+// 256-bit truth table, operators work word by word and the result is the lookup table itself.
+
+typedef struct {
+    uint32_t bits[GPIO_RULE_LUT_WORDS];
+} Table;
+
+typedef struct {
+    const char *pos;
+    const char *error;  // first error, parsing stops there
+    int depth;
+} Parser;
+
+#define MAX_NESTING 16
+
+static Table table_const(bool value) {
+    Table t;
+    memset(t.bits, value ? 0xFF : 0x00, sizeof(t.bits));
+    return t;
+}
+
+// Truth table of a single input: true for every mask with bit gpi set
+static Table table_input(int gpi) {
+    Table t;
+    for (int mask = 0; mask < 256; mask++) {
+        uint32_t bit = 1u << (mask & 31);
+        if (mask & (1 << gpi)) {
+            t.bits[mask >> 5] |= bit;
+        } else {
+            t.bits[mask >> 5] &= ~bit;
+        }
+    }
+    return t;
+}
+
+static void skip_spaces(Parser *p) {
+    while (isspace((unsigned char)*p->pos)) p->pos++;
+}
+
+// Matches a case-insensitive keyword that is not followed by more identifier characters
+static bool match_word(Parser *p, const char *word) {
+    skip_spaces(p);
+    size_t n = strlen(word);
+    if (strncasecmp(p->pos, word, n) != 0 || isalnum((unsigned char)p->pos[n])) return false;
+    p->pos += n;
+    return true;
+}
+
+static bool match_op(Parser *p, char symbol, const char *word) {
+    skip_spaces(p);
+    if (*p->pos == symbol) {
+        p->pos++;
+        return true;
+    }
+    return match_word(p, word);
+}
+
+static Table parse_or(Parser *p);
+
+static Table parse_factor(Parser *p) {
+    if (p->error) return table_const(false);
+    if (++p->depth > MAX_NESTING) {
+        p->error = "nested too deep";
+        return table_const(false);
+    }
+
+    Table t;
+    skip_spaces(p);
+    if (match_op(p, '!', "not")) {
+        t = parse_factor(p);
+        for (int i = 0; i < GPIO_RULE_LUT_WORDS; i++) t.bits[i] = ~t.bits[i];
+    } else if (*p->pos == '(') {
+        p->pos++;
+        t = parse_or(p);
+        skip_spaces(p);
+        if (!p->error && *p->pos++ != ')') p->error = "missing ')'";
+    } else if (strncasecmp(p->pos, "gpi", 3) == 0 && p->pos[3] >= '1' && p->pos[3] <= '8' &&
+               !isalnum((unsigned char)p->pos[4])) {
+        t = table_input(p->pos[3] - '1');
+        p->pos += 4;
+    } else if ((*p->pos == '0' || *p->pos == '1') && !isalnum((unsigned char)p->pos[1])) {
+        t = table_const(*p->pos == '1');
+        p->pos++;
+    } else {
+        p->error = *p->pos ? "expected GPI1-GPI8, 0, 1, NOT or '('" : "unexpected end of rule";
+        t = table_const(false);
+    }
+
+    p->depth--;
+    return t;
+}
+
+static Table parse_and(Parser *p) {
+    Table t = parse_factor(p);
+    while (!p->error && match_op(p, '&', "and")) {
+        Table rhs = parse_factor(p);
+        for (int i = 0; i < GPIO_RULE_LUT_WORDS; i++) t.bits[i] &= rhs.bits[i];
+    }
+    return t;
+}
+
+static Table parse_xor(Parser *p) {
+    Table t = parse_and(p);
+    while (!p->error && match_op(p, '^', "xor")) {
+        Table rhs = parse_and(p);
+        for (int i = 0; i < GPIO_RULE_LUT_WORDS; i++) t.bits[i] ^= rhs.bits[i];
+    }
+    return t;
+}
+
+static Table parse_or(Parser *p) {
+    Table t = parse_xor(p);
+    while (!p->error && match_op(p, '|', "or")) {
+        Table rhs = parse_xor(p);
+        for (int i = 0; i < GPIO_RULE_LUT_WORDS; i++) t.bits[i] |= rhs.bits[i];
+    }
+    return t;
+}
+
+esp_err_t gpio_rule_compile(const char *text, GpioRule *rule, char *error, size_t errorSize) {
+    Parser p = { .pos = text, .error = NULL, .depth = 0 };
+    memset(rule, 0, sizeof(*rule));
+
+    skip_spaces(&p);
+    if (*p.pos == '\0') return ESP_OK;  // no rule
+
+    Table set, reset = table_const(false);
+    GpioRuleKind kind = GPIO_RULE_LEVEL;
+    if (match_word(&p, "toggle")) {
+        kind = GPIO_RULE_TOGGLE;
+    } else if (match_word(&p, "latch")) {
+        kind = GPIO_RULE_LATCH;
+    } else {
+        match_word(&p, "follow");
+    }
+
+    set = parse_or(&p);
+    if (kind == GPIO_RULE_LATCH && !p.error) {
+        if (match_word(&p, "reset")) {
+            reset = parse_or(&p);
+        } else {
+            p.error = "latch needs 'reset <expr>'";
+        }
+    }
+    skip_spaces(&p);
+    if (!p.error && *p.pos != '\0') p.error = "unexpected text";
+
+    if (p.error) {
+        if (error) snprintf(error, errorSize, "%s at offset %d", p.error, (int)(p.pos - text));
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    rule->kind = kind;
+    memcpy(rule->set, set.bits, sizeof(rule->set));
+    memcpy(rule->reset, reset.bits, sizeof(rule->reset));
+    return ESP_OK;
+}
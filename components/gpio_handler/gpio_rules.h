@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// Local GPI -> GPO interlocks. A rule is compiled once, at config time, into lookup tables over
+// the 8-bit mask of logical GPI levels (bit n = GPI n+1), so evaluating it on an input change is
+// a couple of bit tests with no parsing and no network involved.
+//
+// Rule text, case-insensitive:
+//   <expr>                     output follows the expression, e.g. "GPI1 & !GPI4"
+//   follow <expr>              same as above
+//   toggle <expr>              output flips every time the expression becomes true
+//   latch <expr> reset <expr>  set when the first expression becomes true, cleared by the second
+// <expr> is built from GPI1..GPI8, 0, 1, parentheses and the operators NOT/!, AND/&, XOR/^, OR/|
+// (tightest first). An empty rule leaves the GPO to network commands.
+
+#define GPIO_RULE_LUT_WORDS (256 / 32)
+
+typedef enum {
+    GPIO_RULE_NONE,
+    GPIO_RULE_LEVEL,
+    GPIO_RULE_TOGGLE,
+    GPIO_RULE_LATCH
+} GpioRuleKind;
+
+typedef struct {
+    GpioRuleKind kind;
+    uint32_t set[GPIO_RULE_LUT_WORDS];      // LEVEL: output, TOGGLE: trigger, LATCH: set condition
+    uint32_t reset[GPIO_RULE_LUT_WORDS];    // LATCH only
+} GpioRule;
+
+// Compiles text into rule. On failure rule is GPIO_RULE_NONE and error (if given) says why.
+esp_err_t gpio_rule_compile(const char *text, GpioRule *rule, char *error, size_t errorSize);
+
+static inline bool gpio_rule_lut(const uint32_t *lut, uint8_t inputs) {
+    return (lut[inputs >> 5] >> (inputs & 31)) & 1;
+}
+
+// Output level for the input change prev -> now, given the current output. Level rules ignore
+// history; toggles and latches only react to their condition becoming true.
+static inline bool gpio_rule_eval(const GpioRule *rule, uint8_t prev, uint8_t now, bool current) {
+    switch (rule->kind) {
+        case GPIO_RULE_LEVEL:
+            return gpio_rule_lut(rule->set, now);
+        case GPIO_RULE_TOGGLE:
+            return (gpio_rule_lut(rule->set, now) && !gpio_rule_lut(rule->set, prev)) ? !current : current;
+        case GPIO_RULE_LATCH:
+            if (gpio_rule_lut(rule->set, now) && !gpio_rule_lut(rule->set, prev)) return true;
+            if (gpio_rule_lut(rule->reset, now) && !gpio_rule_lut(rule->reset, prev)) return false;
+            return current;
+        default:
+            return current;
+    }
+}
@@ -0,0 +1,114 @@
+#include "gpio_expander.h"
+
+#if !CONFIG_GPIO_HANDLER_SIM_INPUTS  // sim builds use gpio_expander_mock.c
+
+#if CONFIG_GPIO_EXPANDER_I2C
+#include "driver/i2c_master.h"
+#include "esp_log.h"
+
+#define TAG "MCP23017"
+#define I2C_TIMEOUT_MS 10
+
+// Registers with IOCON.BANK = 0, where the A and B registers of a pair are adjacent
+#define REG_IODIRA   0x00
+#define REG_GPINTENA 0x04
+#define REG_GPIOA    0x12
+#define IOCON_MIRROR 0x40   // INTA and INTB both signal every input
+#define IOCON_ODR    0x04   // open-drain INT, pulled up by the ESP32
+
+static i2c_master_bus_handle_t bus = NULL;   // created on first use, expanders are only started by gpio_task
+
+static esp_err_t init_bus(void) {
+    if (bus) return ESP_OK;
+    i2c_master_bus_config_t bus_config = {
+        .i2c_port = -1,  // any free controller
+        .sda_io_num = CONFIG_GPIO_EXPANDER_I2C_SDA,
+        .scl_io_num = CONFIG_GPIO_EXPANDER_I2C_SCL,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7,
+        .flags.enable_internal_pullup = true,  // weak, fit external pull-ups for 400 kHz
+    };
+    esp_err_t err = i2c_new_master_bus(&bus_config, &bus);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "I2C bus on SDA %d / SCL %d: %s", CONFIG_GPIO_EXPANDER_I2C_SDA, CONFIG_GPIO_EXPANDER_I2C_SCL,
+                 esp_err_to_name(err));
+        bus = NULL;
+    }
+    return err;
+}
+
+esp_err_t gpio_expander_start(GpioExpander *exp, int slot, const ExpanderConfig *cfg) {
+    exp->slot = slot;
+    exp->dev = NULL;
+    esp_err_t err = init_bus();
+    if (err != ESP_OK) return err;
+
+    i2c_device_config_t dev_config = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = cfg->address,
+        .scl_speed_hz = CONFIG_GPIO_EXPANDER_I2C_HZ,
+    };
+    i2c_master_dev_handle_t dev;
+    err = i2c_master_bus_add_device(bus, &dev_config, &dev);
+    if (err != ESP_OK) return err;
+
+    // The whole setup is one sequential write from IODIRA: all inputs, no hardware polarity
+    // inversion (done in software like for native pins), interrupt on any change of a reported
+    // input, mirrored open-drain INT, then the pull-ups
+    uint8_t lo = cfg->inputMask & 0xFF, hi = cfg->inputMask >> 8;
+    uint8_t iocon = IOCON_MIRROR | IOCON_ODR;
+    const uint8_t setup[] = {
+        REG_IODIRA,
+        0xFF, 0xFF,                                         // IODIR
+        0x00, 0x00,                                         // IPOL
+        lo, hi,                                             // GPINTEN
+        0x00, 0x00,                                         // DEFVAL
+        0x00, 0x00,                                         // INTCON: compare with previous value
+        iocon, iocon,                                       // IOCON, mapped at both addresses
+        cfg->pullUpMask & 0xFF, cfg->pullUpMask >> 8,       // GPPU
+    };
+    err = i2c_master_transmit(dev, setup, sizeof(setup), I2C_TIMEOUT_MS);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "No MCP23017 at 0x%02x: %s", cfg->address, esp_err_to_name(err));
+        i2c_master_bus_rm_device(dev);
+        return err;
+    }
+    exp->dev = dev;
+    return ESP_OK;
+}
+
+void gpio_expander_stop(GpioExpander *exp) {
+    if (!exp->dev) return;
+    // Leave the chip quiet so it doesn't hold its INT line low once unused
+    const uint8_t disable[] = { REG_GPINTENA, 0x00, 0x00 };
+    i2c_master_transmit(exp->dev, disable, sizeof(disable), I2C_TIMEOUT_MS);
+    i2c_master_bus_rm_device(exp->dev);
+    exp->dev = NULL;
+}
+
+esp_err_t gpio_expander_read(GpioExpander *exp, uint16_t *levels) {
+    if (!exp->dev) return ESP_ERR_INVALID_STATE;
+    const uint8_t reg = REG_GPIOA;
+    uint8_t data[2];
+    esp_err_t err = i2c_master_transmit_receive(exp->dev, &reg, 1, data, sizeof(data), I2C_TIMEOUT_MS);
+    if (err == ESP_OK) *levels = data[0] | (uint16_t)data[1] << 8;
+    return err;
+}
+
+#else
+
+esp_err_t gpio_expander_start(GpioExpander *exp, int slot, const ExpanderConfig *cfg) {
+    exp->slot = slot;
+    exp->dev = NULL;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void gpio_expander_stop(GpioExpander *exp) {
+}
+
+esp_err_t gpio_expander_read(GpioExpander *exp, uint16_t *levels) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif
+#endif
@@ -1,18 +1,28 @@
 #include "http_client.h"
 #include "esp_log.h"
+#include <errno.h>
 #include <string.h>
 #include <stdlib.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <fcntl.h>
 #include <arpa/inet.h>
+#include <net/if.h>
+#include <unistd.h>
 #include "app_config.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "metrics.h"
+#include "event_journal.h"
+#include "net_state.h"
+#include "task_layout.h"
+#include "event_trace.h"
 
 #define TAG "HTTP_CLIENT"
 #define DEFAULT_HTTP_PORT 80
 #define MAX_MSG_SIZE 256
 
-extern AppConfig globalConfig;
 
 typedef struct {
     char host[32];
@@ -20,6 +30,20 @@ typedef struct {
     char route[64];
 } UrlParts;
 
+// Argument of one tcp_post_task, the message follows the struct
+typedef struct {
+    bool journal;       // journal the GPI event if the post fails
+    uint8_t gpi;
+    uint8_t level;
+    int64_t edgeUs;     // GPI edge time for edge-to-send latency, 0 for non-event posts
+    char json[];
+} HttpPostJob;
+
+// httpUrl parsed once per config change instead of once per post
+static UrlParts cached_url;
+static bool cached_url_valid = false;
+static portMUX_TYPE url_lock = portMUX_INITIALIZER_UNLOCKED;
+
 static esp_err_t parse_url(const char *url, UrlParts *parts) {
     const char *start = strstr(url, "://");
     if (!start) return ESP_FAIL;
@@ -55,15 +79,54 @@ static esp_err_t parse_url(const char *url, UrlParts *parts) {
     return ESP_OK;
 }
 
-static void tcp_post_task(void *arg) {
-    
-    char *json_data = (char *)arg;
+// Config reload hook - re-parses httpUrl when HTTP settings changed
+static void on_http_config_change(uint32_t changed, const AppConfig *cfg) {
+    UrlParts parts = {0};
+    bool valid = parse_url(cfg->httpUrl, &parts) == ESP_OK;
+    if (!valid && cfg->httpEnabled) {
+        ESP_LOGE(TAG, "Failed to parse URL: %s", cfg->httpUrl);
+    }
+
+    portENTER_CRITICAL(&url_lock);
+    cached_url = parts;
+    cached_url_valid = valid;
+    portEXIT_CRITICAL(&url_lock);
+}
+
+// Flush the HTTP backlog as soon as the network is back instead of on the next retry tick
+static void on_net_state_change(bool up, int activePort) {
+    if (up) event_journal_kick();
+}
+
+esp_err_t init_http_client(void) {
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    on_http_config_change(CONFIG_CHANGED_HTTP, &cfg);
+    net_state_subscribe(on_net_state_change);
+    return register_config_reload_hook(CONFIG_CHANGED_HTTP, on_http_config_change);
+}
+
+// Connects, sends one POST and closes. Blocks for at most the 100 ms connect window.
+// port pins the socket to one Ethernet port, NET_STATE_NO_PORT lets lwIP route it.
+// The sink sent/failed counters are left to the caller, once per message.
+static esp_err_t http_post_message_via(const char *json_data, int port) {
     UrlParts parts = {0};
 	int sock = -1;  // Initialize here
-    if (parse_url(globalConfig.httpUrl, &parts) != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to parse URL: %s", globalConfig.httpUrl);
+    bool delivered = false;
+    int64_t start_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&url_lock);
+    bool url_valid = cached_url_valid;
+    parts = cached_url;
+    portEXIT_CRITICAL(&url_lock);
+
+    if (!url_valid) {
+        ESP_LOGE(TAG, "No valid HTTP URL configured");
         goto cleanup;
     }
+    if (!net_state_is_up()) {
+        goto cleanup;  // no link, don't wait for the connect timeout
+    }
     char msg[MAX_MSG_SIZE];
     
     int len = snprintf(
@@ -88,6 +151,15 @@ static void tcp_post_task(void *arg) {
 
     fcntl(sock, F_SETFL, O_NONBLOCK);
 
+    if (port != NET_STATE_NO_PORT) {
+        struct ifreq ifr = {0};
+        if (!net_state_port_ifname(port, ifr.ifr_name, sizeof(ifr.ifr_name)) ||
+            setsockopt(sock, SOL_SOCKET, SO_BINDTODEVICE, &ifr, sizeof(ifr)) != 0) {
+            ESP_LOGE(TAG, "Cannot bind to port %d", port);
+            goto cleanup;
+        }
+    }
+
     struct sockaddr_in dest = {0};
     dest.sin_family = AF_INET;
     dest.sin_port = htons(parts.port);
@@ -110,29 +182,108 @@ static void tcp_post_task(void *arg) {
             // Connection established, send data
             if (send(sock, msg, len, 0) < 0) {
                 ESP_LOGE(TAG, "Send failed: %d", errno);
+            } else {
+                delivered = true;
+                metrics_observe(HIST_HTTP_POST_LATENCY_MS, (esp_timer_get_time() - start_us) / 1000);
             }
         }
     } else {
         ESP_LOGW(TAG, "Connection not ready in time");
     }
-	ESP_LOGI(TAG, "Stack high watermark: %d", uxTaskGetStackHighWaterMark(NULL));
     cleanup:
         if (sock >= 0) close(sock);
-        free(json_data);
-        vTaskDelete(NULL);
+        return delivered ? ESP_OK : ESP_FAIL;
 }
 
-esp_err_t send_http_post(const char *json_data) {
-    char *json_copy = strdup(json_data);
-    if (!json_copy) {
+static esp_err_t http_post_message(const char *json_data) {
+    return http_post_message_via(json_data, NET_STATE_NO_PORT);
+}
+
+#if CONFIG_NET_STATE_DUPLICATE_HTTP_EVENTS
+// One post per port that is up, delivered if any of them got through
+static esp_err_t http_post_redundant(const char *json_data) {
+    if (net_state_up_count() < 2) return http_post_message(json_data);
+
+    esp_err_t result = ESP_FAIL;
+    for (int port = 0; port < NET_STATE_MAX_PORTS; port++) {
+        if (net_state_port_up(port) && http_post_message_via(json_data, port) == ESP_OK) {
+            result = ESP_OK;
+        }
+    }
+    return result;
+}
+#endif
+
+static void tcp_post_task(void *arg) {
+    HttpPostJob *job = (HttpPostJob *)arg;
+
+#if CONFIG_NET_STATE_DUPLICATE_HTTP_EVENTS
+    esp_err_t err = job->journal ? http_post_redundant(job->json) : http_post_message(job->json);
+#else
+    esp_err_t err = http_post_message(job->json);
+#endif
+    // One count per event, however many ports carried a copy
+    metrics_inc(err == ESP_OK ? METRIC_SINK_HTTP_SENT : METRIC_SINK_HTTP_FAILED);
+    if (err != ESP_OK) {
+        if (job->journal) {
+            event_journal_append(JOURNAL_SINK_BIT(JOURNAL_SINK_HTTP), job->gpi, job->level);  // replayed later
+        }
+    } else if (job->edgeUs) {
+        event_trace(TRACE_SENT, job->gpi, TRACE_SINK_HTTP, job->edgeUs);
+        metrics_observe(HIST_EDGE_TO_SEND_HTTP_US, (uint32_t)(esp_timer_get_time() - job->edgeUs));
+    }
+	metrics_set_min(METRIC_HTTP_POST_STACK_MIN_FREE, uxTaskGetStackHighWaterMark(NULL));
+    free(job);
+    metrics_add(METRIC_SINK_HTTP_QUEUED, -1);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t queue_http_post(const char *json_data, bool journal, uint8_t gpi, uint8_t level, int64_t edgeUs) {
+    // Paused while the network is down: journal right away instead of spawning a task that can only fail
+    if (!net_state_is_up()) {
+        metrics_inc(METRIC_SINK_HTTP_FAILED);
+        if (journal) event_journal_append(JOURNAL_SINK_BIT(JOURNAL_SINK_HTTP), gpi, level);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    size_t json_len = strlen(json_data);
+    HttpPostJob *job = malloc(sizeof(HttpPostJob) + json_len + 1);
+    if (!job) {
         ESP_LOGE(TAG, "Failed to allocate memory for JSON");
+        metrics_inc(METRIC_SINK_HTTP_FAILED);
         return ESP_ERR_NO_MEM;
     }
+    job->journal = journal;
+    job->gpi = gpi;
+    job->level = level;
+    job->edgeUs = edgeUs;
+    memcpy(job->json, json_data, json_len + 1);
 
-    if (xTaskCreate(tcp_post_task, "tcp_post_task", 2048, json_copy, 5, NULL) != pdPASS) {
-        free(json_copy);
+    metrics_add(METRIC_SINK_HTTP_QUEUED, 1);
+    if (edgeUs) event_trace(TRACE_ENQUEUED, gpi, TRACE_SINK_HTTP, edgeUs);  // before the task can answer
+    // Stack from the task layout (3 KB): the 256 byte request, lwIP's socket calls and ESP_LOG
+    // formatting. gpiobox_http_post_stack_min_free_bytes shows the margin left.
+    if (task_layout_create(TASK_HTTP_POST, tcp_post_task, job, NULL) != pdPASS) {
+        free(job);
         ESP_LOGE(TAG, "Task creation failed");
+        metrics_add(METRIC_SINK_HTTP_QUEUED, -1);
+        metrics_inc(METRIC_SINK_HTTP_FAILED);
+        if (journal) event_journal_append(JOURNAL_SINK_BIT(JOURNAL_SINK_HTTP), gpi, level);
         return ESP_FAIL;
     }
     return ESP_OK;
+}
+
+esp_err_t send_http_post(const char *json_data) {
+    return queue_http_post(json_data, false, 0, 0, 0);
+}
+
+esp_err_t send_http_event(const char *json_data, uint8_t gpi, uint8_t level, int64_t edgeUs) {
+    return queue_http_post(json_data, true, gpi, level, edgeUs);
+}
+
+esp_err_t send_http_post_sync(const char *json_data) {
+    esp_err_t err = http_post_message(json_data);
+    metrics_inc(err == ESP_OK ? METRIC_SINK_HTTP_SENT : METRIC_SINK_HTTP_FAILED);
+    return err;
 }
\ No newline at end of file
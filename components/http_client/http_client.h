@@ -1,5 +1,14 @@
 #pragma once
 
 #include <esp_err.h>
+#include <stdint.h>
 
-esp_err_t send_http_post(const char *json_data);
\ No newline at end of file
+esp_err_t init_http_client(void);
+esp_err_t send_http_post(const char *json_data);
+
+// Like send_http_post, but a failed post journals the GPI event for replay and a delivered one
+// is recorded in the edge-to-send latency histogram (edgeUs from esp_timer_get_time())
+esp_err_t send_http_event(const char *json_data, uint8_t gpi, uint8_t level, int64_t edgeUs);
+
+// Posts from the calling task and reports whether it was delivered (used by journal catch-up)
+esp_err_t send_http_post_sync(const char *json_data);
\ No newline at end of file
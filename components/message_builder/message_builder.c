@@ -1,24 +1,140 @@
 #include <message_builder.h>
-#include "cJSON.h"
 #include "esp_log.h"
+#include <stdio.h>
 #include <string.h>
 
+static void put(JsonWriter *w, const char *s, size_t n) {
+    if (w->overflow) return;
+    if (w->len + n >= w->size) {  // keep room for the terminator
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, s, n);
+    w->len += n;
+}
 
-char* construct_message(const char *event, const char *state, const char *user, const char *password, char *out_buffer, size_t buffer_size) {
-    cJSON *root = cJSON_CreateObject();
-    if (!root) return NULL;
+static void put_char(JsonWriter *w, char c) {
+    put(w, &c, 1);
+}
+
+// Same escaping as cJSON: quote, backslash and control characters, UTF-8 passes through
+static void put_quoted(JsonWriter *w, const char *s) {
+    static const char hex[] = "0123456789abcdef";
+    put_char(w, '"');
+    const char *run = s;
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+        put(w, run, s - run);
+        run = s + 1;
+        switch (c) {
+            case '"':  put(w, "\\\"", 2); break;
+            case '\\': put(w, "\\\\", 2); break;
+            case '\b': put(w, "\\b", 2); break;
+            case '\f': put(w, "\\f", 2); break;
+            case '\n': put(w, "\\n", 2); break;
+            case '\r': put(w, "\\r", 2); break;
+            case '\t': put(w, "\\t", 2); break;
+            default: {
+                char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+                put(w, esc, sizeof(esc));
+            }
+        }
+    }
+    put(w, run, s - run);
+    put_char(w, '"');
+}
+
+static void put_key(JsonWriter *w, const char *key) {
+    if (w->needComma) put_char(w, ',');
+    put_quoted(w, key);
+    put_char(w, ':');
+}
+
+void json_begin(JsonWriter *w, char *buf, size_t size) {
+    w->buf = buf;
+    w->size = size;
+    w->len = 0;
+    w->needComma = false;
+    w->overflow = (size == 0);
+}
+
+void json_open_object(JsonWriter *w, const char *key) {
+    if (key) put_key(w, key);
+    put_char(w, '{');
+    w->needComma = false;
+}
+
+void json_close_object(JsonWriter *w) {
+    put_char(w, '}');
+    w->needComma = true;
+}
+
+void json_add_string(JsonWriter *w, const char *key, const char *value) {
+    put_key(w, key);
+    put_quoted(w, value ? value : "");
+    w->needComma = true;
+}
 
-    cJSON_AddStringToObject(root, "event", event);
-    cJSON_AddStringToObject(root, "state", state);
-    cJSON_AddStringToObject(root, "user", user);
-    cJSON_AddStringToObject(root, "password", password);
+void json_add_number(JsonWriter *w, const char *key, double value, int decimals) {
+    char num[32];
+    int n = snprintf(num, sizeof(num), "%.*f", decimals, value);
+    put_key(w, key);
+    if (n < 0 || n >= (int)sizeof(num)) {
+        w->overflow = true;
+        return;
+    }
+    put(w, num, n);
+    w->needComma = true;
+}
+
+size_t json_finish(JsonWriter *w) {
+    if (w->overflow) {
+        if (w->size) w->buf[0] = '\0';
+        return 0;
+    }
+    w->buf[w->len] = '\0';
+    return w->len;
+}
+
+char* construct_message(const char *event, const char *state, const char *user, const char *password, char *out_buffer, size_t buffer_size) {
+    JsonWriter w;
+    json_begin(&w, out_buffer, buffer_size);
+    json_open_object(&w, NULL);
+    json_add_string(&w, "event", event);
+    json_add_string(&w, "state", state);
+    json_add_string(&w, "user", user);
+    json_add_string(&w, "password", password);
+    json_close_object(&w);
 
-    if (!cJSON_PrintPreallocated(root, out_buffer, buffer_size, 0)) {
+    if (!json_finish(&w)) {
         ESP_LOGE("MessageBuilder", "Failed to print JSON into buffer");
-        cJSON_Delete(root);
         return NULL;
     }
+    return out_buffer;
+}
+
+char* construct_counter_message(const char *event, uint64_t count, uint32_t delta, uint32_t intervalMs,
+                                double rate, double frequency, const char *user, const char *password,
+                                char *out_buffer, size_t buffer_size) {
+    JsonWriter w;
+    json_begin(&w, out_buffer, buffer_size);
+    json_open_object(&w, NULL);
+    json_add_string(&w, "event", event);
+    json_add_string(&w, "state", "COUNT");
+    json_add_number(&w, "count", (double)count, 0);
+    json_add_number(&w, "delta", delta, 0);
+    json_add_number(&w, "intervalMs", intervalMs, 0);
+    json_add_number(&w, "rate", rate, 3);
+    json_add_number(&w, "frequency", frequency, 3);
+    json_add_string(&w, "user", user);
+    json_add_string(&w, "password", password);
+    json_close_object(&w);
 
-    cJSON_Delete(root);
+    if (!json_finish(&w)) {
+        ESP_LOGE("MessageBuilder", "Failed to print JSON into buffer");
+        return NULL;
+    }
     return out_buffer;
-}
\ No newline at end of file
+}
@@ -1,5 +1,32 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 char* construct_message(const char *event, const char *state, const char *user, const char *password, char *out_buffer, size_t buffer_size);
+
+// Counter report of a GPI in counter mode: "state":"COUNT" plus total count, the count since the
+// previous report, the interval it covers and the derived edge rate and signal frequency.
+char* construct_counter_message(const char *event, uint64_t count, uint32_t delta, uint32_t intervalMs,
+                                double rate, double frequency, const char *user, const char *password,
+                                char *out_buffer, size_t buffer_size);
+
+// Writes compact JSON straight into a caller buffer, no heap. Output matches cJSON_PrintUnformatted.
+// Calls after an overflow are no-ops, json_finish reports it.
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    bool needComma;     // a member was written at the current nesting level
+    bool overflow;
+} JsonWriter;
+
+void json_begin(JsonWriter *w, char *buf, size_t size);
+void json_open_object(JsonWriter *w, const char *key);  // key NULL for the root object
+void json_close_object(JsonWriter *w);
+void json_add_string(JsonWriter *w, const char *key, const char *value);
+void json_add_number(JsonWriter *w, const char *key, double value, int decimals);
+
+// Terminates the buffer. Returns the length, or 0 if the output did not fit.
+size_t json_finish(JsonWriter *w);
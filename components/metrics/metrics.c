@@ -0,0 +1,226 @@
+#include "metrics.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef enum {
+    METRIC_TYPE_COUNTER,
+    METRIC_TYPE_GAUGE
+} MetricType;
+
+typedef struct {
+    const char *name;
+    const char *labels;   // Prometheus label set without braces, or NULL
+    const char *help;
+    MetricType type;
+} MetricDef;
+
+// Entries with the same name must stay adjacent so HELP/TYPE is printed once per family
+static const MetricDef metric_defs[METRIC_COUNT] = {
+    [METRIC_GPI_EDGES]            = { "gpiobox_gpi_edges_total", NULL, "GPI edges seen by the ISR", METRIC_TYPE_COUNTER },
+    [METRIC_GPI_QUEUE_OVERFLOWS]  = { "gpiobox_gpi_queue_overflows_total", NULL, "GPI edges dropped because the ISR queue was full", METRIC_TYPE_COUNTER },
+    [METRIC_GPI_DEBOUNCE_DROPS]   = { "gpiobox_gpi_debounce_drops_total", NULL, "Debounce windows that settled without a state change", METRIC_TYPE_COUNTER },
+    [METRIC_GPI_EVENTS]           = { "gpiobox_gpi_events_total", NULL, "Debounced GPI state changes", METRIC_TYPE_COUNTER },
+    [METRIC_GPO_RULE_CHANGES]     = { "gpiobox_gpo_rule_changes_total", NULL, "GPO levels changed by local rules", METRIC_TYPE_COUNTER },
+    [METRIC_GPI_COUNTER_REPORTS]  = { "gpiobox_gpi_counter_reports_total", NULL, "Aggregated reports of GPIs in counter mode", METRIC_TYPE_COUNTER },
+    [METRIC_GPI_EVENTS_SUPPRESSED] = { "gpiobox_gpi_events_suppressed_total", NULL, "GPI events coalesced during event storms", METRIC_TYPE_COUNTER },
+    [METRIC_GPI_QUARANTINES]      = { "gpiobox_gpi_quarantines_total", NULL, "GPIs quarantined after a sustained event storm", METRIC_TYPE_COUNTER },
+    [METRIC_GPI_QUARANTINED]      = { "gpiobox_gpi_quarantined", NULL, "GPIs in quarantine", METRIC_TYPE_GAUGE },
+    [METRIC_EXPANDER_READS]       = { "gpiobox_expander_reads_total", NULL, "I/O expander input reads", METRIC_TYPE_COUNTER },
+    [METRIC_EXPANDER_READ_ERRORS] = { "gpiobox_expander_read_errors_total", NULL, "I/O expander reads that failed on the bus", METRIC_TYPE_COUNTER },
+
+    [METRIC_SINK_COMPANION_SENT]  = { "gpiobox_sink_sent_total", "sink=\"companion\"", "Messages delivered per sink", METRIC_TYPE_COUNTER },
+    [METRIC_SINK_TCP_SENT]        = { "gpiobox_sink_sent_total", "sink=\"tcp\"", NULL, METRIC_TYPE_COUNTER },
+    [METRIC_SINK_HTTP_SENT]       = { "gpiobox_sink_sent_total", "sink=\"http\"", NULL, METRIC_TYPE_COUNTER },
+    [METRIC_SINK_SERIAL_SENT]     = { "gpiobox_sink_sent_total", "sink=\"serial\"", NULL, METRIC_TYPE_COUNTER },
+    [METRIC_SINK_COMPANION_FAILED]= { "gpiobox_sink_failed_total", "sink=\"companion\"", "Messages that could not be delivered per sink", METRIC_TYPE_COUNTER },
+    [METRIC_SINK_TCP_FAILED]      = { "gpiobox_sink_failed_total", "sink=\"tcp\"", NULL, METRIC_TYPE_COUNTER },
+    [METRIC_SINK_HTTP_FAILED]     = { "gpiobox_sink_failed_total", "sink=\"http\"", NULL, METRIC_TYPE_COUNTER },
+    [METRIC_SINK_SERIAL_FAILED]   = { "gpiobox_sink_failed_total", "sink=\"serial\"", NULL, METRIC_TYPE_COUNTER },
+    [METRIC_SINK_HTTP_QUEUED]     = { "gpiobox_sink_queued", "sink=\"http\"", "Messages accepted but not yet delivered per sink", METRIC_TYPE_GAUGE },
+
+    [METRIC_TCP_RECONNECTS]       = { "gpiobox_tcp_reconnects_total", NULL, "TCP client connection attempts after the first one", METRIC_TYPE_COUNTER },
+    [METRIC_HTTP_POST_STACK_MIN_FREE] = { "gpiobox_http_post_stack_min_free_bytes", NULL, "Lowest stack high watermark seen in tcp_post_task", METRIC_TYPE_GAUGE },
+
+    [METRIC_CONFIG_FLASH_COMMITS]   = { "gpiobox_config_flash_commits_total", NULL, "Config records written to flash since boot", METRIC_TYPE_COUNTER },
+    [METRIC_CONFIG_SAVES_COALESCED] = { "gpiobox_config_saves_skipped_total", "reason=\"coalesced\"", "Config saves that did not cause their own flash write", METRIC_TYPE_COUNTER },
+    [METRIC_CONFIG_SAVES_UNCHANGED] = { "gpiobox_config_saves_skipped_total", "reason=\"unchanged\"", NULL, METRIC_TYPE_COUNTER },
+
+    [METRIC_JOURNAL_APPENDED]     = { "gpiobox_journal_appended_total", NULL, "Events journaled for sinks that missed them", METRIC_TYPE_COUNTER },
+    [METRIC_JOURNAL_REPLAYED]     = { "gpiobox_journal_replayed_total", NULL, "Journaled events delivered on catch-up", METRIC_TYPE_COUNTER },
+    [METRIC_JOURNAL_EXPIRED]      = { "gpiobox_journal_expired_total", NULL, "Journaled events dropped by retention", METRIC_TYPE_COUNTER },
+    [METRIC_JOURNAL_OVERWRITTEN]  = { "gpiobox_journal_overwritten_total", NULL, "Undelivered events lost when the journal ring wrapped", METRIC_TYPE_COUNTER },
+    [METRIC_JOURNAL_DROPPED]      = { "gpiobox_journal_dropped_total", NULL, "Events lost because the journal batch was full", METRIC_TYPE_COUNTER },
+    [METRIC_JOURNAL_PAGE_ERASES]  = { "gpiobox_journal_page_erases_total", NULL, "Journal flash sectors erased since boot", METRIC_TYPE_COUNTER },
+    [METRIC_JOURNAL_PENDING_TCP]  = { "gpiobox_journal_pending", "sink=\"tcp\"", "Journaled events waiting for catch-up per sink", METRIC_TYPE_GAUGE },
+    [METRIC_JOURNAL_PENDING_HTTP] = { "gpiobox_journal_pending", "sink=\"http\"", NULL, METRIC_TYPE_GAUGE },
+
+    [METRIC_NET_UP]               = { "gpiobox_net_up", NULL, "1 while the Ethernet link is up and the IP is assigned", METRIC_TYPE_GAUGE },
+    [METRIC_NET_DOWN_EVENTS]      = { "gpiobox_net_link_flaps_total", NULL, "Times the network went down after being up", METRIC_TYPE_COUNTER },
+    [METRIC_NET_DOWNTIME_MS]      = { "gpiobox_net_downtime_ms_total", NULL, "Time spent with the network down since the first link-up", METRIC_TYPE_COUNTER },
+    [METRIC_NET_FAILOVERS]        = { "gpiobox_net_failovers_total", NULL, "Times traffic moved to the other Ethernet port", METRIC_TYPE_COUNTER },
+
+    [METRIC_ETH_RX_FRAMES]        = { "gpiobox_eth_rx_frames_total", NULL, "Ethernet frames received", METRIC_TYPE_COUNTER },
+    [METRIC_ETH_RX_BYTES]         = { "gpiobox_eth_rx_bytes_total", NULL, "Ethernet bytes received", METRIC_TYPE_COUNTER },
+    [METRIC_ETH_RX_POLLS]         = { "gpiobox_eth_rx_polls_total", NULL, "RX checks triggered by adaptive polling", METRIC_TYPE_COUNTER },
+    [METRIC_ETH_RX_POLL_INTERVAL_US] = { "gpiobox_eth_rx_poll_interval_us", NULL, "Current RX poll interval, worst-case frame pickup delay (0 = interrupt driven)", METRIC_TYPE_GAUGE },
+    [METRIC_ETH_SPI_BUSY_US]      = { "gpiobox_eth_spi_rx_busy_us_total", NULL, "Estimated SPI bus time used by RX polls and frames", METRIC_TYPE_COUNTER },
+
+    [METRIC_LOG_DEFERRED]         = { "gpiobox_log_deferred_total", NULL, "Deferred log records written", METRIC_TYPE_COUNTER },
+    [METRIC_LOG_DROPPED]          = { "gpiobox_log_dropped_total", NULL, "Deferred log records overwritten before they were printed", METRIC_TYPE_COUNTER },
+
+    [METRIC_SYSLOG_SENT]          = { "gpiobox_syslog_sent_total", NULL, "Log lines sent to the syslog collector", METRIC_TYPE_COUNTER },
+    [METRIC_SYSLOG_DROPPED_BUFFER] = { "gpiobox_syslog_dropped_total", "reason=\"buffer_full\"", "Log lines that were not streamed to the syslog collector", METRIC_TYPE_COUNTER },
+    [METRIC_SYSLOG_DROPPED_SEND]  = { "gpiobox_syslog_dropped_total", "reason=\"send_failed\"", NULL, METRIC_TYPE_COUNTER },
+};
+
+#define MAX_BUCKETS 13
+
+typedef struct {
+    const char *name;
+    const char *labels;   // Prometheus label set without braces, or NULL
+    const char *help;
+    uint8_t bucketCount;
+    uint32_t bounds[MAX_BUCKETS];  // upper bounds, +Inf is implicit
+} HistogramDef;
+
+typedef struct {
+    uint32_t buckets[MAX_BUCKETS + 1];  // non-cumulative, last one is +Inf
+    uint32_t count;
+    uint64_t sum;
+} HistogramData;
+
+// Edge-to-send includes the pin's debounce, which is per pin and can be 0, so the buckets are
+// 1-2-5 log spaced from 100 us to 1 s rather than clustered around one debounce window
+#define EDGE_TO_SEND_BUCKETS 13, { 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000 }
+
+// Same adjacency rule as metric_defs
+static const HistogramDef histogram_defs[HIST_COUNT] = {
+    [HIST_HTTP_POST_LATENCY_MS] = { "gpiobox_http_post_latency_ms", NULL, "HTTP POST connect + send time", 9,
+                                    { 1, 2, 5, 10, 25, 50, 100, 250, 500 } },
+    [HIST_EDGE_TO_SEND_COMPANION_US] = { "gpiobox_edge_to_send_latency_us", "sink=\"companion\"",
+                                         "Time from the first GPI edge until the message was handed to the sink", EDGE_TO_SEND_BUCKETS },
+    [HIST_EDGE_TO_SEND_TCP_US]       = { "gpiobox_edge_to_send_latency_us", "sink=\"tcp\"", NULL, EDGE_TO_SEND_BUCKETS },
+    [HIST_EDGE_TO_SEND_HTTP_US]      = { "gpiobox_edge_to_send_latency_us", "sink=\"http\"", NULL, EDGE_TO_SEND_BUCKETS },
+    [HIST_EDGE_TO_SEND_SERIAL_US]    = { "gpiobox_edge_to_send_latency_us", "sink=\"serial\"", NULL, EDGE_TO_SEND_BUCKETS },
+    [HIST_EDGE_TO_OUTPUT_US] = { "gpiobox_edge_to_output_latency_us", NULL,
+                                 "Time from the first GPI edge until a local rule set the GPO, includes debounce", 10,
+                                 { 20, 50, 100, 200, 500, 1000, 2000, 5000, 20000, 60000 } },
+};
+
+static HistogramData histograms[HIST_COUNT];
+static portMUX_TYPE histogram_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Stacks reported as gpiobox_task_stack_free_bytes, looked up by name at scrape time
+static const char *const watched_tasks[] = { "gpio_task", "tcp_client_task", "httpd", "tiT", "journal_task", "dlog_task", "syslog_task" };
+
+volatile uint32_t metric_values[METRIC_COUNT];
+
+void metrics_set_min(MetricId id, uint32_t value) {
+    uint32_t cur = __atomic_load_n(&metric_values[id], __ATOMIC_RELAXED);
+    while ((cur == 0 || value < cur) &&
+           !__atomic_compare_exchange_n(&metric_values[id], &cur, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void metrics_observe(HistogramId id, uint32_t value) {
+    const HistogramDef *def = &histogram_defs[id];
+    uint8_t bucket = 0;
+    while (bucket < def->bucketCount && value > def->bounds[bucket]) bucket++;
+
+    portENTER_CRITICAL(&histogram_lock);
+    histograms[id].buckets[bucket]++;
+    histograms[id].count++;
+    histograms[id].sum += value;
+    portEXIT_CRITICAL(&histogram_lock);
+}
+
+static void emit(MetricsWriter writer, void *ctx, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+static void emit(MetricsWriter writer, void *ctx, const char *fmt, ...) {
+    char line[160];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (len <= 0) return;
+    if (len >= (int)sizeof(line)) len = sizeof(line) - 1;
+    writer(line, len, ctx);
+}
+
+static void emit_header(MetricsWriter writer, void *ctx, const char *name, const char *help, const char *type) {
+    if (help) emit(writer, ctx, "# HELP %s %s\n", name, help);
+    emit(writer, ctx, "# TYPE %s %s\n", name, type);
+}
+
+static void render_histogram(MetricsWriter writer, void *ctx, HistogramId id, bool header) {
+    const HistogramDef *def = &histogram_defs[id];
+    HistogramData snap;
+
+    portENTER_CRITICAL(&histogram_lock);
+    snap = histograms[id];
+    portEXIT_CRITICAL(&histogram_lock);
+
+    // "sink=\"tcp\"," in front of le, "{sink=\"tcp\"}" after _sum/_count
+    const char *labels = def->labels ? def->labels : "";
+    const char *sep = def->labels ? "," : "";
+    const char *open = def->labels ? "{" : "";
+    const char *close = def->labels ? "}" : "";
+
+    if (header) emit_header(writer, ctx, def->name, def->help, "histogram");
+    uint32_t cumulative = 0;
+    for (uint8_t i = 0; i < def->bucketCount; i++) {
+        cumulative += snap.buckets[i];
+        emit(writer, ctx, "%s_bucket{%s%sle=\"%lu\"} %lu\n", def->name, labels, sep,
+             (unsigned long)def->bounds[i], (unsigned long)cumulative);
+    }
+    cumulative += snap.buckets[def->bucketCount];
+    emit(writer, ctx, "%s_bucket{%s%sle=\"+Inf\"} %lu\n", def->name, labels, sep, (unsigned long)cumulative);
+    emit(writer, ctx, "%s_sum%s%s%s %llu\n", def->name, open, labels, close, (unsigned long long)snap.sum);
+    emit(writer, ctx, "%s_count%s%s%s %lu\n", def->name, open, labels, close, (unsigned long)snap.count);
+}
+
+void metrics_render(MetricsWriter writer, void *ctx) {
+    const char *prev_name = NULL;
+
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        const MetricDef *def = &metric_defs[i];
+        uint32_t value = metrics_get(i);
+
+        if (!prev_name || strcmp(prev_name, def->name) != 0) {
+            emit_header(writer, ctx, def->name, def->help, def->type == METRIC_TYPE_COUNTER ? "counter" : "gauge");
+            prev_name = def->name;
+        }
+
+        if (def->labels) {
+            emit(writer, ctx, "%s{%s} %lu\n", def->name, def->labels, (unsigned long)value);
+        } else {
+            emit(writer, ctx, "%s %lu\n", def->name, (unsigned long)value);
+        }
+    }
+
+    prev_name = NULL;
+    for (int i = 0; i < HIST_COUNT; i++) {
+        bool header = !prev_name || strcmp(prev_name, histogram_defs[i].name) != 0;
+        render_histogram(writer, ctx, i, header);
+        prev_name = histogram_defs[i].name;
+    }
+
+    // Sampled at scrape time
+    emit_header(writer, ctx, "gpiobox_heap_free_bytes", "Current free heap", "gauge");
+    emit(writer, ctx, "gpiobox_heap_free_bytes %lu\n", (unsigned long)esp_get_free_heap_size());
+    emit_header(writer, ctx, "gpiobox_heap_min_free_bytes", "Lowest free heap since boot", "gauge");
+    emit(writer, ctx, "gpiobox_heap_min_free_bytes %lu\n", (unsigned long)esp_get_minimum_free_heap_size());
+
+    emit_header(writer, ctx, "gpiobox_task_stack_free_bytes", "Stack high watermark per task", "gauge");
+    for (size_t i = 0; i < sizeof(watched_tasks) / sizeof(watched_tasks[0]); i++) {
+        TaskHandle_t task = xTaskGetHandle(watched_tasks[i]);
+        if (!task) continue;  // not running right now
+        emit(writer, ctx, "gpiobox_task_stack_free_bytes{task=\"%s\"} %lu\n", watched_tasks[i],
+             (unsigned long)uxTaskGetStackHighWaterMark(task));
+    }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Central metric table. Counters and gauges are plain 32-bit words updated with
+// relaxed atomics, so metrics_inc() is safe and cheap from ISRs and hot paths.
+// Add new entries here and describe them in metrics.c (metric_defs[]). Entries that share a
+// metric name (label variants) must be adjacent so the family is rendered in one block.
+typedef enum {
+    // GPI pipeline
+    METRIC_GPI_EDGES,               // every ISR edge
+    METRIC_GPI_QUEUE_OVERFLOWS,     // edges lost because the ISR queue was full
+    METRIC_GPI_DEBOUNCE_DROPS,      // debounce windows that settled without a state change
+    METRIC_GPI_EVENTS,              // debounced state changes reported to sinks
+    METRIC_GPO_RULE_CHANGES,        // GPO levels changed by local rules
+    METRIC_GPI_COUNTER_REPORTS,     // aggregated reports of GPIs in counter mode
+    METRIC_GPI_EVENTS_SUPPRESSED,   // GPI events coalesced away during an event storm
+    METRIC_GPI_QUARANTINES,         // pins quarantined after a sustained storm
+    METRIC_GPI_QUARANTINED,         // gauge: pins in quarantine right now
+    METRIC_EXPANDER_READS,          // successful I/O expander input reads
+    METRIC_EXPANDER_READ_ERRORS,    // I/O expander reads that failed on the bus
+
+    // Sinks, one entry per sink label. Keep each family (sent/failed/queued) contiguous.
+    METRIC_SINK_COMPANION_SENT,
+    METRIC_SINK_TCP_SENT,
+    METRIC_SINK_HTTP_SENT,
+    METRIC_SINK_SERIAL_SENT,
+    METRIC_SINK_COMPANION_FAILED,
+    METRIC_SINK_TCP_FAILED,
+    METRIC_SINK_HTTP_FAILED,
+    METRIC_SINK_SERIAL_FAILED,
+    METRIC_SINK_HTTP_QUEUED,        // gauge: posts handed to tcp_post_task, not finished yet
+
+    // Connections
+    METRIC_TCP_RECONNECTS,
+    METRIC_HTTP_POST_STACK_MIN_FREE, // gauge: lowest stack high watermark seen in tcp_post_task
+
+    // Config storage (flash wear, counted since boot)
+    METRIC_CONFIG_FLASH_COMMITS,    // config blobs written to NVS
+    METRIC_CONFIG_SAVES_COALESCED,  // saves merged into an already pending commit
+    METRIC_CONFIG_SAVES_UNCHANGED,  // commits skipped because flash already held the same data
+
+    // Event journal
+    METRIC_JOURNAL_APPENDED,        // events journaled for sinks that missed them
+    METRIC_JOURNAL_REPLAYED,        // journaled events delivered on catch-up
+    METRIC_JOURNAL_EXPIRED,         // journaled events dropped by retention
+    METRIC_JOURNAL_OVERWRITTEN,     // undelivered events lost when the ring wrapped
+    METRIC_JOURNAL_DROPPED,         // events lost because the RAM batch was full
+    METRIC_JOURNAL_PAGE_ERASES,
+    METRIC_JOURNAL_PENDING_TCP,     // gauge: events waiting for catch-up, per sink
+    METRIC_JOURNAL_PENDING_HTTP,
+
+    METRIC_NET_UP,                  // gauge: 1 while link is up and the IP is assigned
+    METRIC_NET_DOWN_EVENTS,         // up -> down transitions (link flaps)
+    METRIC_NET_DOWNTIME_MS,         // total time spent down after the first link-up
+    METRIC_NET_FAILOVERS,           // traffic moved between Ethernet ports while the network stayed up
+
+    METRIC_ETH_RX_FRAMES,           // frames handed from the W5500 driver to lwIP, all ports
+    METRIC_ETH_RX_BYTES,
+    METRIC_ETH_RX_POLLS,            // extra RX checks requested by adaptive polling
+    METRIC_ETH_RX_POLL_INTERVAL_US, // gauge: current RX poll interval, 0 = interrupt driven
+    METRIC_ETH_SPI_BUSY_US,         // estimated SPI bus time spent on RX polls and frames
+
+    METRIC_LOG_DEFERRED,            // deferred log records written, updated by dlog_task
+    METRIC_LOG_DROPPED,             // deferred log records overwritten before they were printed
+
+    METRIC_SYSLOG_SENT,             // syslog datagrams handed to lwIP
+    METRIC_SYSLOG_DROPPED_BUFFER,   // log lines not streamed because the syslog buffer was full
+    METRIC_SYSLOG_DROPPED_SEND,     // syslog datagrams lwIP refused
+
+    METRIC_COUNT
+} MetricId;
+
+typedef enum {
+    HIST_HTTP_POST_LATENCY_MS,      // connect + send duration of one HTTP POST
+    HIST_EDGE_TO_SEND_COMPANION_US, // first GPI edge until the message is handed off, per sink (live sends only)
+    HIST_EDGE_TO_SEND_TCP_US,
+    HIST_EDGE_TO_SEND_HTTP_US,
+    HIST_EDGE_TO_SEND_SERIAL_US,
+    HIST_EDGE_TO_OUTPUT_US,         // first GPI edge until a local rule drove a GPO, the I/O jitter benchmark
+
+    HIST_COUNT
+} HistogramId;
+
+extern volatile uint32_t metric_values[METRIC_COUNT];
+
+static inline void metrics_inc(MetricId id) {
+    __atomic_fetch_add(&metric_values[id], 1, __ATOMIC_RELAXED);
+}
+
+static inline void metrics_add(MetricId id, int32_t delta) {
+    __atomic_fetch_add(&metric_values[id], (uint32_t)delta, __ATOMIC_RELAXED);
+}
+
+static inline void metrics_set(MetricId id, uint32_t value) {
+    __atomic_store_n(&metric_values[id], value, __ATOMIC_RELAXED);
+}
+
+static inline uint32_t metrics_get(MetricId id) {
+    return __atomic_load_n(&metric_values[id], __ATOMIC_RELAXED);
+}
+
+// Lowers a gauge to value if value is smaller (used for watermarks). 0 means "unset".
+void metrics_set_min(MetricId id, uint32_t value);
+
+// Records one observation into a fixed-bucket histogram. Task context only.
+void metrics_observe(HistogramId id, uint32_t value);
+
+// Renders all metrics in Prometheus text exposition format. The writer is called once per line.
+typedef void (*MetricsWriter)(const char *line, size_t len, void *ctx);
+void metrics_render(MetricsWriter writer, void *ctx);
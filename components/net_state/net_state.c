@@ -0,0 +1,187 @@
+#include "net_state.h"
+#include "esp_eth.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include "freertos/event_groups.h"
+#include "metrics.h"
+
+static const char *TAG = "NET_STATE";
+
+// Two bits per port: link up, IP assigned
+#define LINK_UP_BIT(port)  (1 << ((port) * 2))
+#define GOT_IP_BIT(port)   (1 << ((port) * 2 + 1))
+#define PORT_UP_BITS(port) (LINK_UP_BIT(port) | GOT_IP_BIT(port))
+#define NET_UP_BIT         (1 << (NET_STATE_MAX_PORTS * 2))  // set while any port is up, for net_state_wait_up
+
+#define MAX_LISTENERS 6
+
+typedef struct {
+    esp_eth_handle_t eth;
+    esp_netif_t *netif;
+} NetPort;
+
+static EventGroupHandle_t net_events = NULL;
+static NetPort ports[NET_STATE_MAX_PORTS];
+static NetStateListener listeners[MAX_LISTENERS];
+static int listener_count = 0;
+static int published_port = NET_STATE_NO_PORT;  // last state sent to listeners, event loop task only
+static int64_t down_since_us = 0;
+
+esp_err_t net_state_subscribe(NetStateListener listener) {
+    if (listener_count >= MAX_LISTENERS) return ESP_ERR_NO_MEM;
+    listeners[listener_count++] = listener;
+    return ESP_OK;
+}
+
+esp_err_t net_state_add_port(uint8_t port, esp_eth_handle_t eth, esp_netif_t *netif) {
+    if (port >= NET_STATE_MAX_PORTS) return ESP_ERR_INVALID_ARG;
+    ports[port].eth = eth;
+    ports[port].netif = netif;
+    return ESP_OK;
+}
+
+bool net_state_port_up(int port) {
+    if (!net_events || port < 0 || port >= NET_STATE_MAX_PORTS) return false;
+    return (xEventGroupGetBits(net_events) & PORT_UP_BITS(port)) == PORT_UP_BITS(port);
+}
+
+int net_state_active_port(void) {
+    for (int i = 0; i < NET_STATE_MAX_PORTS; i++) {
+        if (net_state_port_up(i)) return i;
+    }
+    return NET_STATE_NO_PORT;
+}
+
+int net_state_up_count(void) {
+    int count = 0;
+    for (int i = 0; i < NET_STATE_MAX_PORTS; i++) {
+        if (net_state_port_up(i)) count++;
+    }
+    return count;
+}
+
+bool net_state_is_up(void) {
+    return net_state_active_port() != NET_STATE_NO_PORT;
+}
+
+int net_state_port_for_ip(uint32_t ip) {
+    for (int i = 0; i < NET_STATE_MAX_PORTS; i++) {
+        esp_netif_ip_info_t info;
+        if (ports[i].netif && esp_netif_get_ip_info(ports[i].netif, &info) == ESP_OK && info.ip.addr == ip) {
+            return i;
+        }
+    }
+    return NET_STATE_NO_PORT;
+}
+
+bool net_state_port_ifname(int port, char *name, size_t size) {
+    if (port < 0 || port >= NET_STATE_MAX_PORTS || !ports[port].netif || size < 6) return false;
+    return esp_netif_get_netif_impl_name(ports[port].netif, name) == ESP_OK;
+}
+
+bool net_state_wait_up(TickType_t timeout) {
+    if (!net_events) return false;
+    xEventGroupWaitBits(net_events, NET_UP_BIT, pdFALSE, pdTRUE, timeout);
+    return net_state_is_up();
+}
+
+// Runs after every bit change, tells listeners only about up/down and active port transitions
+static void publish(void) {
+    int active = net_state_active_port();
+    if (active == published_port) return;
+
+    bool was_up = published_port != NET_STATE_NO_PORT;
+    bool up = active != NET_STATE_NO_PORT;
+    published_port = active;
+
+    metrics_set(METRIC_NET_UP, up);
+    if (up) {
+        xEventGroupSetBits(net_events, NET_UP_BIT);
+    } else {
+        xEventGroupClearBits(net_events, NET_UP_BIT);
+    }
+
+    if (up && was_up) {
+        metrics_inc(METRIC_NET_FAILOVERS);
+        ESP_LOGW(TAG, "Traffic moved to port %d", active);
+    } else if (up) {
+        if (down_since_us) {
+            uint32_t down_ms = (esp_timer_get_time() - down_since_us) / 1000;
+            metrics_add(METRIC_NET_DOWNTIME_MS, down_ms);
+            ESP_LOGI(TAG, "Network up on port %d after %lu ms", active, (unsigned long)down_ms);
+        } else {
+            ESP_LOGI(TAG, "Network up on port %d", active);
+        }
+    } else {
+        down_since_us = esp_timer_get_time();
+        metrics_inc(METRIC_NET_DOWN_EVENTS);
+        ESP_LOGW(TAG, "Network down, sinks paused");
+    }
+
+    for (int i = 0; i < listener_count; i++) {
+        listeners[i](up, active);
+    }
+}
+
+static int port_of_eth(esp_eth_handle_t eth) {
+    for (int i = 0; i < NET_STATE_MAX_PORTS; i++) {
+        if (ports[i].eth && ports[i].eth == eth) return i;
+    }
+    return NET_STATE_NO_PORT;
+}
+
+static int port_of_netif(esp_netif_t *netif) {
+    for (int i = 0; i < NET_STATE_MAX_PORTS; i++) {
+        if (ports[i].netif && ports[i].netif == netif) return i;
+    }
+    return NET_STATE_NO_PORT;
+}
+
+static bool has_static_ip(esp_netif_t *netif) {
+    esp_netif_dhcp_status_t dhcp;
+    esp_netif_ip_info_t info;
+    return esp_netif_dhcpc_get_status(netif, &dhcp) == ESP_OK && dhcp != ESP_NETIF_DHCP_STARTED &&
+           esp_netif_get_ip_info(netif, &info) == ESP_OK && info.ip.addr != 0;
+}
+
+static void on_eth_event(void *arg, esp_event_base_t base, int32_t id, void *data) {
+    int port = port_of_eth(*(esp_eth_handle_t *)data);
+    if (port == NET_STATE_NO_PORT) return;
+
+    if (id == ETHERNET_EVENT_CONNECTED) {
+        // A static IP survives the link loss inside esp_netif, but GOT_IP is not guaranteed to be
+        // posted again on reconnect, so the port is up as soon as it has link
+        EventBits_t bits = LINK_UP_BIT(port);
+        if (has_static_ip(ports[port].netif)) bits |= GOT_IP_BIT(port);
+        xEventGroupSetBits(net_events, bits);
+    } else if (id == ETHERNET_EVENT_DISCONNECTED || id == ETHERNET_EVENT_STOP) {
+        // esp_netif drops the IP on its own, but the LOST_IP event comes later (or never for static IPs)
+        xEventGroupClearBits(net_events, PORT_UP_BITS(port));
+    }
+    publish();
+}
+
+static void on_ip_event(void *arg, esp_event_base_t base, int32_t id, void *data) {
+    int port = port_of_netif(((ip_event_got_ip_t *)data)->esp_netif);
+    if (port == NET_STATE_NO_PORT) return;
+
+    if (id == IP_EVENT_ETH_GOT_IP) {
+        xEventGroupSetBits(net_events, GOT_IP_BIT(port));
+    } else if (id == IP_EVENT_ETH_LOST_IP) {
+        xEventGroupClearBits(net_events, GOT_IP_BIT(port));
+    }
+    publish();
+}
+
+esp_err_t net_state_init(void) {
+    if (net_events) return ESP_OK;
+    net_events = xEventGroupCreate();
+    if (!net_events) return ESP_ERR_NO_MEM;
+
+    esp_err_t err = esp_event_handler_register(ETH_EVENT, ESP_EVENT_ANY_ID, on_eth_event, NULL);
+    if (err == ESP_OK) err = esp_event_handler_register(IP_EVENT, IP_EVENT_ETH_GOT_IP, on_ip_event, NULL);
+    if (err == ESP_OK) err = esp_event_handler_register(IP_EVENT, IP_EVENT_ETH_LOST_IP, on_ip_event, NULL);
+    return err;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_eth_driver.h"
+#include "esp_netif.h"
+#include "freertos/FreeRTOS.h"
+
+// Ethernet link and IP state, published to the sinks so they pause while all cables are out,
+// move to the backup port the moment the port they use goes down, and reconnect as soon as
+// a link is back instead of waiting out their retry timers.
+
+#define NET_STATE_MAX_PORTS 2
+#define NET_STATE_NO_PORT   -1
+
+// Called from the default event loop task whenever the network goes up/down or the preferred
+// port changes. Keep it short: wake a task, shut down a socket, nothing that blocks.
+// activePort is the lowest port that is up (the one lwIP routes through), or NET_STATE_NO_PORT.
+typedef void (*NetStateListener)(bool up, int activePort);
+
+// Registers the ETHERNET_EVENT/IP_EVENT handlers on the default event loop.
+// Call after the loop exists and before esp_eth_start, so the first link-up is not missed.
+esp_err_t net_state_init(void);
+// Port 0 is the primary, port 1 the backup. Call before the port's esp_eth_start.
+esp_err_t net_state_add_port(uint8_t port, esp_eth_handle_t eth, esp_netif_t *netif);
+esp_err_t net_state_subscribe(NetStateListener listener);
+
+// Any port has link and IP
+bool net_state_is_up(void);
+bool net_state_port_up(int port);
+int net_state_active_port(void);
+int net_state_up_count(void);
+
+// Port whose current IP is ip (e.g. from getsockname), or NET_STATE_NO_PORT
+int net_state_port_for_ip(uint32_t ip);
+
+// lwIP interface name of the port for SO_BINDTODEVICE ("en1"...), false if the port doesn't exist
+bool net_state_port_ifname(int port, char *name, size_t size);
+
+// Blocks until net_state_is_up() or timeout. Returns the state at return.
+bool net_state_wait_up(TickType_t timeout);
@@ -0,0 +1,239 @@
+#include "syslog_sink.h"
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+// syslog_task never logs: every line would come back through syslog_vprintf
+
+#define APP_NAME "gpiobox"
+#define MSGID_MAX_LEN 32        // RFC 5424 MSGID limit
+#define SEQUENCE_ID_MAX 2147483647u
+
+// ESP-IDF prints "L (time) TAG: text", with an ANSI colour around it when colours are enabled
+static const char *skip_colour(const char *s) {
+    if (s[0] == '\033' && s[1] == '[') {
+        const char *end = strchr(s, 'm');
+        if (end) return end + 1;
+    }
+    return s;
+}
+
+static int severity_for(char letter) {
+    switch (letter) {
+        case 'E': return 3;  // error
+        case 'W': return 4;  // warning
+        case 'I': return 6;  // informational
+        case 'D':
+        case 'V': return 7;  // debug
+        default:  return -1;
+    }
+}
+
+size_t syslog_format(const char *line, uint32_t sequenceId, uint32_t upTimeCs, const char *hostname,
+                     char *out, size_t size) {
+    const char *text = skip_colour(line);
+    char msgid[MSGID_MAX_LEN + 1] = "-";
+    int severity = severity_for(text[0]);
+
+    // Anything that isn't a whole esp_log header goes out as an untagged notice
+    const char *tagEnd = NULL;
+    if (severity >= 0 && text[1] == ' ' && text[2] == '(') {
+        const char *tag = strstr(text, ") ");
+        if (tag) tagEnd = strstr(tag + 2, ": ");
+        if (tagEnd) {
+            tag += 2;
+            size_t len = 0;
+            for (; tag + len < tagEnd && len < MSGID_MAX_LEN; len++) {
+                char c = tag[len];
+                msgid[len] = (c > ' ' && c < 127) ? c : '_';  // PRINTUSASCII only
+            }
+            msgid[len > 0 ? len : 1] = '\0';
+            text = tagEnd + 2;
+        }
+    }
+    if (!tagEnd) severity = 5;
+
+    // Drop the trailing colour reset and newline
+    size_t textLen = strlen(text);
+    while (textLen > 0 && (text[textLen - 1] == '\n' || text[textLen - 1] == '\r')) textLen--;
+    if (textLen >= 4 && memcmp(text + textLen - 4, "\033[0m", 4) == 0) textLen -= 4;
+    while (textLen > 0 && (text[textLen - 1] == '\n' || text[textLen - 1] == '\r')) textLen--;
+
+    int len = snprintf(out, size, "<%d>1 - %s " APP_NAME " - %s [meta sequenceId=\"%lu\" sysUpTime=\"%lu\"] %.*s",
+                       CONFIG_SYSLOG_FACILITY * 8 + severity, hostname, msgid,
+                       (unsigned long)sequenceId, (unsigned long)upTimeCs, (int)textLen, text);
+    if (len < 0) return 0;
+    return (size_t)len < size ? (size_t)len : size - 1;
+}
+
+#if CONFIG_SYSLOG_SINK_ENABLE
+
+#include "app_config.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/ringbuf.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include "metrics.h"
+#include "net_state.h"
+#include "task_layout.h"
+
+#define LINE_MAX_LEN 192        // longer lines are cut
+#define MESSAGE_MAX_LEN 320     // line plus the RFC 5424 header
+
+// One ring buffer item, sized to the line it holds
+typedef struct {
+    uint32_t upTimeCs;          // when the line was logged, in hundredths of a second
+    char text[];                // terminated
+} SyslogLine;
+
+typedef struct {
+    bool enabled;
+    uint32_t ip;
+    uint16_t port;
+    char hostname[16];
+} SyslogTarget;
+
+static vprintf_like_t previous_vprintf;
+static RingbufHandle_t line_buffer;
+static TaskHandle_t syslog_task_handle;
+static volatile bool streaming;         // lines are only buffered while a collector is set
+static portMUX_TYPE target_lock = portMUX_INITIALIZER_UNLOCKED;
+static SyslogTarget target;
+
+// Runs on every logging task. The line is measured, then formatted straight into its ring buffer
+// item, so no line buffer lands on those tasks' stacks.
+static int syslog_vprintf(const char *format, va_list args) {
+    if (streaming && !xPortInIsrContext()) {
+        va_list copy;
+        va_copy(copy, args);
+        int len = vsnprintf(NULL, 0, format, copy);
+        va_end(copy);
+
+        if (len > 0) {
+            if (len >= LINE_MAX_LEN) len = LINE_MAX_LEN - 1;
+            SyslogLine *line;
+            if (xRingbufferSendAcquire(line_buffer, (void **)&line, offsetof(SyslogLine, text) + len + 1, 0) == pdTRUE) {
+                va_copy(copy, args);
+                vsnprintf(line->text, len + 1, format, copy);
+                va_end(copy);
+                line->upTimeCs = (uint32_t)(esp_timer_get_time() / 10000);
+                xRingbufferSendComplete(line_buffer, line);
+            } else {
+                metrics_inc(METRIC_SYSLOG_DROPPED_BUFFER);
+            }
+        }
+    }
+    return previous_vprintf(format, args);
+}
+
+static int open_socket(const SyslogTarget *t, struct sockaddr_in *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(t->port);
+    addr->sin_addr.s_addr = t->ip;
+    return socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+}
+
+// Sends what the buffer holds, at most as many lines as the token bucket allows. Lines wait in
+// the buffer while the network is down; new ones are dropped once it is full.
+static void syslog_task(void *arg) {
+    static char message[MESSAGE_MAX_LEN];
+    const uint32_t burstMilli = CONFIG_SYSLOG_BURST * 1000;
+    uint32_t tokensMilli = burstMilli;  // one line costs 1000
+    uint32_t sequenceId = 0;
+    int64_t lastRefillUs = esp_timer_get_time();
+    SyslogTarget current = {0};
+    struct sockaddr_in addr;
+    int sock = -1;
+
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_SYSLOG_FLUSH_MS));
+
+        int64_t now = esp_timer_get_time();
+        uint32_t refill = (uint32_t)((now - lastRefillUs) / 1000) * CONFIG_SYSLOG_RATE;
+        lastRefillUs = now;
+        tokensMilli = tokensMilli + refill > burstMilli ? burstMilli : tokensMilli + refill;
+
+        SyslogTarget t;
+        portENTER_CRITICAL(&target_lock);
+        t = target;
+        portEXIT_CRITICAL(&target_lock);
+
+        if (sock >= 0 && (!t.enabled || t.ip != current.ip || t.port != current.port)) {
+            close(sock);
+            sock = -1;
+        }
+        current = t;
+
+        if (!t.enabled) {
+            // Streaming was switched off: forget what is still buffered
+            size_t size;
+            void *item;
+            while ((item = xRingbufferReceive(line_buffer, &size, 0)) != NULL) vRingbufferReturnItem(line_buffer, item);
+            continue;
+        }
+        if (!net_state_is_up()) continue;
+        if (sock < 0 && (sock = open_socket(&t, &addr)) < 0) continue;
+
+        while (tokensMilli >= 1000) {
+            size_t size;
+            SyslogLine *line = xRingbufferReceive(line_buffer, &size, 0);
+            if (!line) break;
+
+            sequenceId = sequenceId >= SEQUENCE_ID_MAX ? 1 : sequenceId + 1;
+            size_t len = syslog_format(line->text, sequenceId, line->upTimeCs, t.hostname, message, sizeof(message));
+            vRingbufferReturnItem(line_buffer, line);
+            if (sendto(sock, message, len, MSG_DONTWAIT, (struct sockaddr *)&addr, sizeof(addr)) == (int)len) {
+                metrics_inc(METRIC_SYSLOG_SENT);
+            } else {
+                metrics_inc(METRIC_SYSLOG_DROPPED_SEND);  // lwIP out of buffers, or no route
+            }
+            tokensMilli -= 1000;
+        }
+    }
+}
+
+// Config reload hook - points the streamer at the new collector, starts it on first use
+static void on_syslog_config_change(uint32_t changed, const AppConfig *cfg) {
+    SyslogTarget t = {
+        .enabled = cfg->syslogEnabled && cfg->syslogIp != 0 && cfg->syslogPort != 0,
+        .ip = cfg->syslogIp,
+        .port = cfg->syslogPort,
+    };
+    // RFC 5424 prefers a static IP to a bare hostname
+    snprintf(t.hostname, sizeof(t.hostname), "%d.%d.%d.%d",
+             (int)(cfg->deviceIp & 0xFF), (int)((cfg->deviceIp >> 8) & 0xFF),
+             (int)((cfg->deviceIp >> 16) & 0xFF), (int)(cfg->deviceIp >> 24));
+
+    if (t.enabled && !syslog_task_handle) {
+        if (!line_buffer) line_buffer = xRingbufferCreate(CONFIG_SYSLOG_BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+        if (!line_buffer || task_layout_create(TASK_SYSLOG, syslog_task, NULL, &syslog_task_handle) != pdPASS) {
+            ESP_LOGE("SYSLOG", "Not enough memory to stream logs");
+            return;  // retried on the next config change
+        }
+    }
+
+    portENTER_CRITICAL(&target_lock);
+    target = t;
+    portEXIT_CRITICAL(&target_lock);
+    streaming = t.enabled;
+}
+
+esp_err_t syslog_sink_init(void) {
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    on_syslog_config_change(CONFIG_CHANGED_SYSLOG, &cfg);
+    previous_vprintf = esp_log_set_vprintf(syslog_vprintf);
+    return register_config_reload_hook(CONFIG_CHANGED_SYSLOG | CONFIG_CHANGED_NETWORK, on_syslog_config_change);
+}
+
+#else
+
+esp_err_t syslog_sink_init(void) {
+    return ESP_OK;
+}
+
+#endif
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+// Streams every log line to a syslog collector (syslogEnabled/syslogIp/syslogPort) as one
+// RFC 5424 message per UDP datagram. The log call only copies the line into a RAM buffer; a
+// priority 1 task sends the buffered lines at a limited rate, so logging never blocks and never
+// starves event delivery. Lines that don't fit in the buffer are dropped and counted.
+//
+// Installs itself as the esp_log vprintf and passes every line on to the previous one, so the
+// UART output doesn't change. The box has no wall clock, so messages carry the NILVALUE
+// timestamp and the uptime in the meta SD-ELEMENT:
+//
+//   <134>1 - 192.168.1.100 gpiobox - GPIO [meta sequenceId="42" sysUpTime="1234"] Trigger GPI01
+
+// Call after load_config(). Follows syslog config changes.
+esp_err_t syslog_sink_init(void);
+
+// Turns one esp_log line ("I (1234) TAG: text", colours allowed) into an RFC 5424 message.
+// Returns the message length, truncated to size - 1.
+size_t syslog_format(const char *line, uint32_t sequenceId, uint32_t upTimeCs, const char *hostname,
+                     char *out, size_t size);
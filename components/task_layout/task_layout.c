@@ -0,0 +1,55 @@
+#include "task_layout.h"
+#include "esp_log.h"
+
+#define TAG "TASK_LAYOUT"
+
+#if CONFIG_TASK_LAYOUT_SPLIT
+#define IO_CORE  TASK_LAYOUT_IO_CORE
+#define NET_CORE TASK_LAYOUT_NET_CORE
+#else
+#define IO_CORE  tskNO_AFFINITY
+#define NET_CORE tskNO_AFFINITY
+#endif
+
+static const TaskLayout layouts[TASK_COUNT] = {
+    [TASK_GPIO]       = { "gpio_task", CONFIG_TASK_LAYOUT_GPIO_STACK_SIZE, CONFIG_TASK_LAYOUT_GPIO_PRIORITY, IO_CORE },
+    [TASK_GPIO_SIM]   = { "gpio_sim", 3072, CONFIG_TASK_LAYOUT_GPIO_PRIORITY + 1, IO_CORE },
+    [TASK_TCP_CLIENT] = { "tcp_client_task", CONFIG_TASK_LAYOUT_TCP_CLIENT_STACK_SIZE,
+                          CONFIG_TASK_LAYOUT_TCP_CLIENT_PRIORITY, NET_CORE },
+    [TASK_HTTP_POST]  = { "tcp_post_task", CONFIG_TASK_LAYOUT_HTTP_POST_STACK_SIZE,
+                          CONFIG_TASK_LAYOUT_HTTP_POST_PRIORITY, NET_CORE },
+    [TASK_JOURNAL]    = { "journal_task", CONFIG_TASK_LAYOUT_JOURNAL_STACK_SIZE, CONFIG_TASK_LAYOUT_JOURNAL_PRIORITY, NET_CORE },
+    [TASK_HTTPD]      = { "httpd", CONFIG_TASK_LAYOUT_HTTPD_STACK_SIZE, CONFIG_TASK_LAYOUT_HTTPD_PRIORITY, NET_CORE },
+    [TASK_BOOT_NET]   = { "boot_net", CONFIG_TASK_LAYOUT_BOOT_NET_STACK_SIZE, 5, NET_CORE },
+    [TASK_LOG]        = { "dlog_task", 3072, 1, NET_CORE },
+    [TASK_SYSLOG]     = { "syslog_task", 3072, 1, NET_CORE },
+    [TASK_CONFIG_COMMIT] = { "config_commit", 3072, 2, NET_CORE },
+    [TASK_HTTPD_RESTART] = { "httpd_restart", 3072, 2, NET_CORE },
+};
+
+const TaskLayout *task_layout_get(TaskId id) {
+    return &layouts[id];
+}
+
+BaseType_t task_layout_create(TaskId id, TaskFunction_t fn, void *arg, TaskHandle_t *handle) {
+    const TaskLayout *t = &layouts[id];
+    return xTaskCreatePinnedToCore(fn, t->name, t->stackSize, arg, t->priority, handle, t->core);
+}
+
+void task_layout_log(void) {
+#if CONFIG_TASK_LAYOUT_SPLIT
+    ESP_LOGI(TAG, "Split layout: input path on core %d, network on core %d", TASK_LAYOUT_IO_CORE, TASK_LAYOUT_NET_CORE);
+#else
+    ESP_LOGI(TAG, "Unpinned layout");
+#endif
+    for (int i = 0; i < TASK_COUNT; i++) {
+        const TaskLayout *t = &layouts[i];
+        if (t->core == tskNO_AFFINITY) {
+            ESP_LOGI(TAG, "%-16s prio %2u  stack %5lu  any core", t->name, (unsigned)t->priority,
+                     (unsigned long)t->stackSize);
+        } else {
+            ESP_LOGI(TAG, "%-16s prio %2u  stack %5lu  core %d", t->name, (unsigned)t->priority,
+                     (unsigned long)t->stackSize, (int)t->core);
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+// Core, priority and stack of every long-lived application task, in one table so the layout can
+// be reviewed and benchmarked as a whole (GPIO Box Task Layout in menuconfig).
+//
+// The input path is the GPIO ISR, the settle timers on the esp_timer task and gpio_task. Both the
+// ISR service (installed from app_main) and esp_timer run on core 0, so the split layout puts
+// gpio_task there too and moves every network task to the other core.
+
+#define TASK_LAYOUT_IO_CORE 0
+#if CONFIG_FREERTOS_UNICORE
+#define TASK_LAYOUT_NET_CORE 0
+#else
+#define TASK_LAYOUT_NET_CORE 1
+#endif
+
+typedef enum {
+    TASK_GPIO,          // debounce, rules, event dispatch
+    TASK_GPIO_SIM,      // sim trace player, bench builds only
+    TASK_TCP_CLIENT,
+    TASK_HTTP_POST,     // one per HTTP event
+    TASK_JOURNAL,       // journal replay
+    TASK_HTTPD,
+    TASK_BOOT_NET,      // Ethernet bring-up, exits once booted
+    TASK_LOG,           // deferred log printer, lowest priority
+    TASK_SYSLOG,        // syslog streamer, lowest priority
+    TASK_CONFIG_COMMIT, // deferred config writes to NVS
+    TASK_HTTPD_RESTART, // re-creates httpd after a settings change, exits
+
+    TASK_COUNT
+} TaskId;
+
+typedef struct {
+    const char *name;
+    uint32_t stackSize;
+    UBaseType_t priority;
+    BaseType_t core;    // tskNO_AFFINITY when unpinned
+} TaskLayout;
+
+const TaskLayout *task_layout_get(TaskId id);
+
+// xTaskCreatePinnedToCore with the name, stack, priority and core of id
+BaseType_t task_layout_create(TaskId id, TaskFunction_t fn, void *arg, TaskHandle_t *handle);
+
+// Logs the table, once at boot
+void task_layout_log(void);
@@ -2,49 +2,94 @@
 #include "app_config.h"
 #include "esp_log.h"
 #include "lwip/sockets.h"
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include "freertos/task.h"
 #include "cJSON.h"
 #include "gpio_handler.h"
+#include "message_builder.h"
+#include "metrics.h"
+#include "event_journal.h"
+#include "net_state.h"
+#include "esp_timer.h"
+#include "task_layout.h"
+#include "deferred_log.h"
 
 #define TAG "TCP_CLIENT"
 
-extern AppConfig globalConfig;
 static int tcp_socket = -1;
 static TaskHandle_t tcp_task = NULL;
 static TcpClientMode client_mode;
 static void process_incoming_command(const char *data);
 
+#define RETRY_DELAY_MS 2000
+
+static volatile int connected_port = NET_STATE_NO_PORT;  // Ethernet port the open connection runs over
+static int64_t port_lost_us = 0;                          // when that port went down, for failover timing
+
+// Port of the connection went down: unblock recv so the task drops the dead connection right away.
+// Network (still) up: cut the retry delay short and (re)connect now, over the backup port if needed.
+static void on_net_state_change(bool up, int activePort) {
+    int sock = tcp_socket;
+    if (sock >= 0 && connected_port != NET_STATE_NO_PORT && !net_state_port_up(connected_port)) {
+        port_lost_us = esp_timer_get_time();
+        shutdown(sock, SHUT_RDWR);
+    }
+    if (up && tcp_task) {
+        xTaskNotifyGive(tcp_task);
+    }
+}
+
+// Waits out the retry delay, returns early when the network comes back
+static void retry_delay(void) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(RETRY_DELAY_MS));
+}
+
 static void tcp_client_task(void *arg) {
     
     // Init config
     struct sockaddr_in dest_addr;
+    SinkConfig cfg;
+    config_snapshot_sinks(&cfg);
     
     // Based on mode (regular/companion) - set the ip/port
     if (client_mode == TCP_MODE_COMPANION) {
-	    dest_addr.sin_addr.s_addr = globalConfig.companionIp;
-	    dest_addr.sin_port = htons(globalConfig.companionPort);
+	    dest_addr.sin_addr.s_addr = cfg.companionIp;
+	    dest_addr.sin_port = htons(cfg.companionPort);
 	} else {
-	    dest_addr.sin_addr.s_addr = globalConfig.tcpIp;
-	    dest_addr.sin_port = htons(globalConfig.tcpPort);
+	    dest_addr.sin_addr.s_addr = cfg.tcpIp;
+	    dest_addr.sin_port = htons(cfg.tcpPort);
 	}
 	
     dest_addr.sin_family = AF_INET;
+    bool first_attempt = true;
 
     while (1) {
         // Close task (tcp_client) if disabled in config
-        if (!globalConfig.tcpEnabled && !globalConfig.companionMode) {
+        config_snapshot_sinks(&cfg);
+        if (!cfg.tcpEnabled && !cfg.companionMode) {
             ESP_LOGW(TAG, "TCP and Companion disabled. Closing socket.");
             break;
         }
 
+        // Paused while the network is down, sends fail fast and get journaled meanwhile
+        if (!net_state_is_up()) {
+            ESP_LOGW(TAG, "Network down, waiting for link");
+            net_state_wait_up(portMAX_DELAY);
+            ulTaskNotifyTake(pdTRUE, 0);  // the link-up wake is consumed by this wait
+            continue;  // re-check config, it may have changed while waiting
+        }
+
+        if (!first_attempt) metrics_inc(METRIC_TCP_RECONNECTS);
+        first_attempt = false;
+
         tcp_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
         
         // Cannot create socket, retry in 2 sec
         if (tcp_socket < 0) {
             ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
-            vTaskDelay(pdMS_TO_TICKS(2000));
+            retry_delay();
             continue;
         }
 
@@ -55,18 +100,30 @@ static void tcp_client_task(void *arg) {
             ESP_LOGE(TAG, "Socket connect failed: errno %d", errno);
             close(tcp_socket);
             tcp_socket = -1;
-            vTaskDelay(pdMS_TO_TICKS(2000));
+            retry_delay();
             continue;
         }
 
-        ESP_LOGI(TAG, "TCP connected.");
+        struct sockaddr_in local_addr;
+        socklen_t local_len = sizeof(local_addr);
+        connected_port = getsockname(tcp_socket, (struct sockaddr *)&local_addr, &local_len) == 0
+                             ? net_state_port_for_ip(local_addr.sin_addr.s_addr) : net_state_active_port();
+        if (port_lost_us) {
+            ESP_LOGW(TAG, "TCP connected over port %d, %lld ms after the previous port went down",
+                     connected_port, (esp_timer_get_time() - port_lost_us) / 1000);
+            port_lost_us = 0;
+        } else {
+            ESP_LOGI(TAG, "TCP connected over port %d.", connected_port);
+        }
+        event_journal_kick();  // catch up on events missed while disconnected
 
         char rx_buffer[128];
         // If we are here - we are connected and listenings in loop
         while (1) {
             
             // If user set tcp and companion to off while we connected - exit
-            if (!globalConfig.tcpEnabled && !globalConfig.companionMode) {
+            config_snapshot_sinks(&cfg);
+            if (!cfg.tcpEnabled && !cfg.companionMode) {
                 ESP_LOGW(TAG, "TCP/Companion disabled. Closing socket.");
                 break;
             }
@@ -79,14 +136,20 @@ static void tcp_client_task(void *arg) {
                 break;
             } else {
                 rx_buffer[len] = 0;
-                ESP_LOGI(TAG, "Received: %s", rx_buffer);
+                DLOGI(TAG, "Received %d bytes", len);
+                ESP_LOGD(TAG, "Received: %s", rx_buffer);  // debug builds only, the payload can't be deferred
                 process_incoming_command(rx_buffer); // Parse and handle GPO commands
             }
         }
 
         close(tcp_socket);
         tcp_socket = -1;
-        vTaskDelay(pdMS_TO_TICKS(2000));
+        connected_port = NET_STATE_NO_PORT;
+        if (port_lost_us && net_state_is_up()) {
+            ulTaskNotifyTake(pdTRUE, 0);
+            continue;  // failover: reconnect over the other port right away
+        }
+        retry_delay();
     }
 
     tcp_task = NULL;
@@ -94,9 +157,14 @@ static void tcp_client_task(void *arg) {
 }
 
 esp_err_t start_tcp_client_service(TcpClientMode mode) {
+    static bool subscribed = false;
+    if (!subscribed) {
+        net_state_subscribe(on_net_state_change);
+        subscribed = true;
+    }
     if (tcp_task) return ESP_OK;
     client_mode = mode;
-    return xTaskCreate(tcp_client_task, "tcp_client_task", 4096, NULL, 5, &tcp_task) == pdPASS ? ESP_OK : ESP_FAIL;
+    return task_layout_create(TASK_TCP_CLIENT, tcp_client_task, NULL, &tcp_task) == pdPASS ? ESP_OK : ESP_FAIL;
 }
 
 esp_err_t stop_tcp_client_service(void) {
@@ -111,49 +179,107 @@ esp_err_t stop_tcp_client_service(void) {
     return ESP_OK;
 }
 
+bool tcp_client_is_running(void) {
+    return tcp_task != NULL;
+}
+
 esp_err_t tcp_client_send(const char *json_data) {
+    bool companion = client_mode == TCP_MODE_COMPANION;
     if (tcp_socket < 0) {
         ESP_LOGW(TAG, "Socket not connected");
+        metrics_inc(companion ? METRIC_SINK_COMPANION_FAILED : METRIC_SINK_TCP_FAILED);
         return ESP_FAIL;
     }
 
     int sent = send(tcp_socket, json_data, strlen(json_data), 0);
     if (sent < 0) {
         ESP_LOGE(TAG, "Send failed: errno %d", errno);
+        metrics_inc(companion ? METRIC_SINK_COMPANION_FAILED : METRIC_SINK_TCP_FAILED);
         return ESP_FAIL;
     }
 
-    ESP_LOGI(TAG, "TCP message sent");
+    DLOGI(TAG, "TCP message sent");
+    metrics_inc(companion ? METRIC_SINK_COMPANION_SENT : METRIC_SINK_TCP_SENT);
     return ESP_OK;
 }
 
 // Uses get_gpo_state and get_gpi_state from gpio module to get the current pin states
 static void generate_sync_response(char *out_json, size_t max_len) {
-    cJSON *root = cJSON_CreateObject();
-    cJSON *gpi = cJSON_CreateObject();
-    cJSON *gpo = cJSON_CreateObject();
+    JsonWriter w;
+    char key[8];
+
+    json_begin(&w, out_json, max_len);
+    json_open_object(&w, NULL);
+    json_add_string(&w, "event", "sync-response");
 
+    json_open_object(&w, "gpi");
     for (int i = 0; i < get_gpi_count(); i++) {
-        char key[8];
         snprintf(key, sizeof(key), "GPI-%d", i + 1);
-        cJSON_AddStringToObject(gpi, key, get_gpi_state(i) ? "HIGH" : "LOW");
+        json_add_string(&w, key, get_gpi_state(i) ? "HIGH" : "LOW");
     }
+    json_close_object(&w);
 
+    json_open_object(&w, "gpo");
     for (int i = 0; i < get_gpo_count(); i++) {
-        char key[8];
         snprintf(key, sizeof(key), "GPO-%d", i + 1);
-        cJSON_AddStringToObject(gpo, key, get_gpo_state(i) ? "HIGH" : "LOW");
+        json_add_string(&w, key, get_gpo_state(i) ? "HIGH" : "LOW");
     }
+    json_close_object(&w);
 
-    cJSON_AddStringToObject(root, "event", "sync-response");
-    cJSON_AddItemToObject(root, "gpi", gpi);
-    cJSON_AddItemToObject(root, "gpo", gpo);
+    // Storm suppression and quarantines, only listed for pins that had any
+    bool suppressed = false, faulted = false;
+    for (int i = 0; i < get_gpi_count(); i++) {
+        suppressed |= get_gpi_suppressed(i) > 0;
+        faulted |= get_gpi_quarantined(i);
+    }
+    if (suppressed) {
+        json_open_object(&w, "suppressed");
+        for (int i = 0; i < get_gpi_count(); i++) {
+            if (get_gpi_suppressed(i) == 0) continue;
+            snprintf(key, sizeof(key), "GPI-%d", i + 1);
+            json_add_number(&w, key, get_gpi_suppressed(i), 0);
+        }
+        json_close_object(&w);
+    }
+    if (faulted) {
+        json_open_object(&w, "fault");
+        for (int i = 0; i < get_gpi_count(); i++) {
+            if (!get_gpi_quarantined(i)) continue;
+            snprintf(key, sizeof(key), "GPI-%d", i + 1);
+            json_add_string(&w, key, "QUARANTINED");
+        }
+        json_close_object(&w);
+    }
+    json_close_object(&w);
 
-    if (!cJSON_PrintPreallocated(root, out_json, max_len, 0)) {
-        strcpy(out_json, "{\"event\":\"sync-response\",\"error\":\"buffer-too-small\"}");
+    if (!json_finish(&w)) {
+        snprintf(out_json, max_len, "{\"event\":\"sync-response\",\"error\":\"buffer-too-small\"}");
     }
+}
 
-    cJSON_Delete(root);
+// Optional non-negative number field of a command, def when missing
+static double command_number(const cJSON *json, const char *key, double def) {
+    const cJSON *item = cJSON_GetObjectItem(json, key);
+    return (cJSON_IsNumber(item) && item->valuedouble >= 0) ? item->valuedouble : def;
+}
+
+// state: HIGH/LOW sets the level, PULSE {"ms"|"us"} and BLINK {"period" ms, "duty" %, "count"}
+// run a timed pattern. Any command replaces a pattern still running on that GPO.
+static void handle_gpo_command(const cJSON *json, int gpo_num, const char *state) {
+    if (strcmp(state, "PULSE") == 0) {
+        double us = command_number(json, "us", command_number(json, "ms", 0) * 1000);
+        if (us > GPO_PATTERN_MAX_US) us = 0;  // out of range, rejected below
+        gpo_start_pattern(gpo_num, (uint32_t)us, 0, 1);
+    } else if (strcmp(state, "BLINK") == 0) {
+        double period = command_number(json, "period", 0) * 1000;
+        double duty = command_number(json, "duty", 50);
+        double count = command_number(json, "count", 0);
+        if (duty > 100 || period > GPO_PATTERN_MAX_US || count > UINT32_MAX) period = 0;
+        uint32_t on = (uint32_t)(period * duty / 100);
+        gpo_start_pattern(gpo_num, on, (uint32_t)period - on, (uint32_t)count);
+    } else {
+        trigger_gpo(gpo_num, strcmp(state, "HIGH") == 0);
+    }
 }
 
 // Function to process incoming GPO commands
@@ -170,18 +296,24 @@ static void process_incoming_command(const char *data) {
     if (event && state && cJSON_IsString(event) && cJSON_IsString(state)) {
         if (strncmp(event->valuestring, "GPO-", 4) == 0) {
             int gpo_num = atoi(event->valuestring + 4); // Get number after "GPO-"
-            if (gpo_num >= 1 && gpo_num <= 5) {
-                bool set_high = strcmp(state->valuestring, "HIGH") == 0;
-                trigger_gpo(gpo_num, set_high);
+            if (gpo_num >= 1 && gpo_num <= get_gpo_count()) {
+                handle_gpo_command(json, gpo_num, state->valuestring);
             } else {
                 ESP_LOGW(TAG, "Invalid GPO number: %d", gpo_num);
             }
         } 
         
         else if (strcmp(event->valuestring, "sync") == 0 && strcmp(state->valuestring, "request") == 0) {
-            char syncJson[512];
-            generate_sync_response(syncJson, sizeof(syncJson));
-            tcp_client_send(syncJson);
+            // Sized per GPI, expanders can add 64 inputs to the response
+            size_t len = 256 + get_gpi_count() * 64;
+            char *syncJson = malloc(len);
+            if (syncJson) {
+                generate_sync_response(syncJson, len);
+                tcp_client_send(syncJson);
+                free(syncJson);
+            } else {
+                ESP_LOGE(TAG, "No memory for sync response");
+            }
         }
     }
     cJSON_Delete(json);
@@ -1,5 +1,6 @@
 #pragma once
 #include "esp_err.h"
+#include <stdbool.h>
 
 typedef enum {
     TCP_MODE_REGULAR,
@@ -8,4 +9,5 @@ typedef enum {
 
 esp_err_t start_tcp_client_service(TcpClientMode mode);
 esp_err_t stop_tcp_client_service(void);
+bool tcp_client_is_running(void);
 esp_err_t tcp_client_send(const char *json_data);
\ No newline at end of file
@@ -0,0 +1,414 @@
+#include "config_parser.h"
+#include "esp_log.h"
+#include "lwip/ip4_addr.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+static const char *TAG = "config_parser";
+
+#define MAX_KEY_LEN 32
+#define MAX_VALUE_LEN 72  // Largest string field (httpUrl) plus escape headroom
+
+typedef enum {
+    FIELD_IP,       // dotted quad string -> uint32_t
+    FIELD_PORT,     // number or numeric string -> uint16_t
+    FIELD_UINT,     // number or numeric string -> unsigned member of any width, up to max
+    FIELD_BOOL,     // true/false -> uint8_t
+    FIELD_STRING,   // string -> char[], must fit including terminator
+    FIELD_SECRET    // like FIELD_STRING, but an empty value keeps the current one
+} FieldType;
+
+typedef struct {
+    const char *key;
+    FieldType type;
+    size_t offset;
+    size_t size;
+    uint32_t max;   // FIELD_UINT only
+} ConfigField;
+
+#define FIELD(key, type, member) { key, type, offsetof(AppConfig, member), sizeof(((AppConfig *)0)->member), 0 }
+#define FIELD_MAX(key, member, max) { key, FIELD_UINT, offsetof(AppConfig, member), sizeof(((AppConfig *)0)->member), max }
+
+// Pin map keys are flat, e.g. "gpi3DebounceUs" for gpi[2].debounceUs
+#define GPI_FIELDS(n) \
+    FIELD_MAX("gpi" #n "Gpio",       gpi[n - 1].gpio, 255), \
+    FIELD_MAX("gpi" #n "DebounceUs", gpi[n - 1].debounceUs, 1000000), \
+    FIELD("gpi" #n "Enabled",        FIELD_BOOL, gpi[n - 1].enabled), \
+    FIELD("gpi" #n "Invert",         FIELD_BOOL, gpi[n - 1].invert), \
+    FIELD_MAX("gpi" #n "Pull",       gpi[n - 1].pull, PIN_PULL_NONE), \
+    FIELD_MAX("gpi" #n "Edges",      gpi[n - 1].edges, PIN_EDGES_FALLING), \
+    FIELD_MAX("gpi" #n "Mode",       gpi[n - 1].mode, GPI_MODE_COUNTER), \
+    FIELD_MAX("gpi" #n "ReportMs",   gpi[n - 1].reportMs, 60000), \
+    FIELD_MAX("gpi" #n "ReportThreshold", gpi[n - 1].reportThreshold, 1000000000), \
+    FIELD_MAX("gpi" #n "EventBurst", gpi[n - 1].eventBurst, 255), \
+    FIELD_MAX("gpi" #n "EventsPerMin", gpi[n - 1].eventsPerMin, 60000)
+
+#define GPO_FIELDS(n) \
+    FIELD_MAX("gpo" #n "Gpio",       gpo[n - 1].gpio, 255), \
+    FIELD("gpo" #n "Enabled",        FIELD_BOOL, gpo[n - 1].enabled), \
+    FIELD("gpo" #n "Invert",         FIELD_BOOL, gpo[n - 1].invert), \
+    FIELD("gpo" #n "Rule",           FIELD_STRING, gpo[n - 1].rule)
+
+#define EXP_FIELDS(n) \
+    FIELD("exp" #n "Enabled",        FIELD_BOOL, expander[n - 1].enabled), \
+    FIELD_MAX("exp" #n "Address",    expander[n - 1].address, 0x7F), \
+    FIELD_MAX("exp" #n "IntGpio",    expander[n - 1].intGpio, 255), \
+    FIELD_MAX("exp" #n "InputMask",  expander[n - 1].inputMask, 0xFFFF), \
+    FIELD_MAX("exp" #n "InvertMask", expander[n - 1].invertMask, 0xFFFF), \
+    FIELD_MAX("exp" #n "PullUpMask", expander[n - 1].pullUpMask, 0xFFFF), \
+    FIELD_MAX("exp" #n "DebounceUs", expander[n - 1].debounceUs, 1000000), \
+    FIELD_MAX("exp" #n "Edges",      expander[n - 1].edges, PIN_EDGES_FALLING), \
+    FIELD_MAX("exp" #n "EventBurst", expander[n - 1].eventBurst, 255), \
+    FIELD_MAX("exp" #n "EventsPerMin", expander[n - 1].eventsPerMin, 60000)
+
+// Keys accepted by /save, as sent by index.js
+static const ConfigField config_fields[] = {
+    FIELD("ip",            FIELD_IP,     deviceIp),
+    FIELD("gateway",       FIELD_IP,     gateway),
+    FIELD("subnetMask",    FIELD_IP,     subnetMask),
+    FIELD("backupIp",      FIELD_IP,     backupIp),
+    FIELD("backupGateway", FIELD_IP,     backupGateway),
+    FIELD("backupSubnetMask", FIELD_IP,  backupSubnetMask),
+    FIELD("companionMode", FIELD_BOOL,   companionMode),
+    FIELD("companionIp",   FIELD_IP,     companionIp),
+    FIELD("companionPort", FIELD_PORT,   companionPort),
+    FIELD("tcpEnabled",    FIELD_BOOL,   tcpEnabled),
+    FIELD("tcpIp",         FIELD_IP,     tcpIp),
+    FIELD("tcpPort",       FIELD_PORT,   tcpPort),
+    FIELD("tcpSecure",     FIELD_BOOL,   tcpSecure),
+    FIELD("tcpUser",       FIELD_STRING, tcpUser),
+    FIELD("tcpPassword",   FIELD_STRING, tcpPassword),
+    FIELD("httpEnabled",   FIELD_BOOL,   httpEnabled),
+    FIELD("httpUrl",       FIELD_STRING, httpUrl),
+    FIELD("httpSecure",    FIELD_BOOL,   httpSecure),
+    FIELD("httpUser",      FIELD_STRING, httpUser),
+    FIELD("httpPassword",  FIELD_STRING, httpPassword),
+    FIELD("serialEnabled", FIELD_BOOL,   serialEnabled),
+    FIELD("syslogEnabled", FIELD_BOOL,   syslogEnabled),
+    FIELD("syslogIp",      FIELD_IP,     syslogIp),
+    FIELD("syslogPort",    FIELD_PORT,   syslogPort),
+    FIELD("adminPassword", FIELD_SECRET, adminPassword),
+    FIELD_MAX("webMaxSockets",       web.maxOpenSockets, 13),
+    FIELD_MAX("webBacklog",          web.backlogConn, 16),
+    FIELD("webLruPurge",             FIELD_BOOL, web.lruPurge),
+    FIELD("webKeepAlive",            FIELD_BOOL, web.keepAlive),
+    FIELD_MAX("webKeepAliveIdleS",   web.keepAliveIdleS, 7200),
+    FIELD_MAX("webKeepAliveIntervalS", web.keepAliveIntervalS, 600),
+    FIELD_MAX("webKeepAliveCount",   web.keepAliveCount, 10),
+    FIELD_MAX("webTaskPriority",     web.taskPriority, 24),
+    FIELD_MAX("webTaskCore",         web.taskCore, WEB_TASK_CORE_ANY),
+    FIELD_MAX("webRecvTimeoutS",     web.recvTimeoutS, 60),
+    FIELD_MAX("webSendTimeoutS",     web.sendTimeoutS, 60),
+    FIELD_MAX("ethRxMode",           ethRxMode, ETH_RX_MODE_ADAPTIVE),
+    GPI_FIELDS(1), GPI_FIELDS(2), GPI_FIELDS(3), GPI_FIELDS(4),
+    GPI_FIELDS(5), GPI_FIELDS(6), GPI_FIELDS(7), GPI_FIELDS(8),
+    GPO_FIELDS(1), GPO_FIELDS(2), GPO_FIELDS(3), GPO_FIELDS(4), GPO_FIELDS(5),
+    EXP_FIELDS(1), EXP_FIELDS(2), EXP_FIELDS(3), EXP_FIELDS(4),
+};
+
+_Static_assert(GPI_PIN_COUNT == 8 && GPO_PIN_COUNT == 5 && GPIO_EXPANDER_COUNT == 4,
+               "pin map keys above list every pin");
+
+typedef enum {
+    TOK_STRING,
+    TOK_NUMBER,
+    TOK_TRUE,
+    TOK_FALSE,
+    TOK_NULL,
+    TOK_COMPOUND  // nested object/array, skipped
+} TokenType;
+
+typedef struct {
+    const char *pos;
+    const char *end;
+} Cursor;
+
+static void skip_ws(Cursor *c) {
+    while (c->pos < c->end && (*c->pos == ' ' || *c->pos == '\t' || *c->pos == '\r' || *c->pos == '\n')) {
+        c->pos++;
+    }
+}
+
+static bool expect(Cursor *c, char ch) {
+    skip_ws(c);
+    if (c->pos < c->end && *c->pos == ch) {
+        c->pos++;
+        return true;
+    }
+    return false;
+}
+
+static int hex_digit(char ch) {
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+// Reads a JSON string (cursor on the opening quote) and unescapes it into out.
+// *overflow is set when the decoded value does not fit; the string is still consumed.
+static bool read_string(Cursor *c, char *out, size_t out_size, size_t *out_len, bool *overflow) {
+    size_t len = 0;
+    *overflow = false;
+    c->pos++;  // opening quote
+
+    while (c->pos < c->end) {
+        char ch = *c->pos++;
+        if (ch == '"') {
+            out[len < out_size ? len : out_size - 1] = '\0';
+            *out_len = len;
+            return true;
+        }
+        if ((unsigned char)ch < 0x20) return false;  // raw control chars are not valid JSON
+
+        uint32_t cp = (unsigned char)ch;
+        if (ch == '\\') {
+            if (c->pos >= c->end) return false;
+            char esc = *c->pos++;
+            switch (esc) {
+                case '"': case '\\': case '/': cp = esc; break;
+                case 'b': cp = '\b'; break;
+                case 'f': cp = '\f'; break;
+                case 'n': cp = '\n'; break;
+                case 'r': cp = '\r'; break;
+                case 't': cp = '\t'; break;
+                case 'u':
+                    if (c->end - c->pos < 4) return false;
+                    cp = 0;
+                    for (int i = 0; i < 4; i++) {
+                        int d = hex_digit(*c->pos++);
+                        if (d < 0) return false;
+                        cp = (cp << 4) | d;
+                    }
+                    break;
+                default:
+                    return false;
+            }
+        }
+
+        // Encode as UTF-8 (surrogate pairs are passed through as two 3-byte sequences)
+        char enc[3];
+        size_t n;
+        if (cp < 0x80) {
+            enc[0] = (char)cp;
+            n = 1;
+        } else if (cp < 0x800) {
+            enc[0] = (char)(0xC0 | (cp >> 6));
+            enc[1] = (char)(0x80 | (cp & 0x3F));
+            n = 2;
+        } else {
+            enc[0] = (char)(0xE0 | (cp >> 12));
+            enc[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+            enc[2] = (char)(0x80 | (cp & 0x3F));
+            n = 3;
+        }
+
+        if (len + n < out_size) {
+            memcpy(out + len, enc, n);
+        } else {
+            *overflow = true;
+        }
+        len += n;
+    }
+    return false;  // unterminated
+}
+
+// Skips a nested object or array, honouring strings so brackets inside them are ignored
+static bool skip_compound(Cursor *c) {
+    int depth = 0;
+    while (c->pos < c->end) {
+        char ch = *c->pos;
+        if (ch == '"') {
+            char scratch[1];
+            size_t len;
+            bool overflow;
+            if (!read_string(c, scratch, sizeof(scratch), &len, &overflow)) return false;
+            continue;
+        }
+        c->pos++;
+        if (ch == '{' || ch == '[') {
+            depth++;
+        } else if (ch == '}' || ch == ']') {
+            if (--depth == 0) return true;
+        }
+    }
+    return false;
+}
+
+static bool match_literal(Cursor *c, const char *lit) {
+    size_t n = strlen(lit);
+    if ((size_t)(c->end - c->pos) < n || memcmp(c->pos, lit, n) != 0) return false;
+    c->pos += n;
+    return true;
+}
+
+// Reads one value. Strings and numbers are copied into buf; compound values are skipped.
+static bool read_value(Cursor *c, TokenType *type, char *buf, size_t buf_size, size_t *len, bool *overflow) {
+    skip_ws(c);
+    if (c->pos >= c->end) return false;
+
+    *len = 0;
+    *overflow = false;
+    buf[0] = '\0';
+
+    char ch = *c->pos;
+    if (ch == '"') {
+        *type = TOK_STRING;
+        return read_string(c, buf, buf_size, len, overflow);
+    }
+    if (ch == '{' || ch == '[') {
+        *type = TOK_COMPOUND;
+        return skip_compound(c);
+    }
+    if (ch == 't') {
+        *type = TOK_TRUE;
+        return match_literal(c, "true");
+    }
+    if (ch == 'f') {
+        *type = TOK_FALSE;
+        return match_literal(c, "false");
+    }
+    if (ch == 'n') {
+        *type = TOK_NULL;
+        return match_literal(c, "null");
+    }
+    if (ch == '-' || (ch >= '0' && ch <= '9')) {
+        *type = TOK_NUMBER;
+        while (c->pos < c->end) {
+            ch = *c->pos;
+            if (!((ch >= '0' && ch <= '9') || ch == '-' || ch == '+' || ch == '.' || ch == 'e' || ch == 'E')) break;
+            if (*len + 1 < buf_size) {
+                buf[*len] = ch;
+            } else {
+                *overflow = true;
+            }
+            (*len)++;
+            c->pos++;
+        }
+        buf[*len < buf_size ? *len : buf_size - 1] = '\0';
+        return true;
+    }
+    return false;
+}
+
+static const ConfigField *find_field(const char *key) {
+    for (size_t i = 0; i < sizeof(config_fields) / sizeof(config_fields[0]); i++) {
+        if (strcmp(config_fields[i].key, key) == 0) return &config_fields[i];
+    }
+    return NULL;
+}
+
+static bool parse_uint(const char *s, uint32_t max, uint32_t *out) {
+    if (*s == '\0') return false;
+    uint32_t v = 0;
+    for (; *s; s++) {
+        if (*s < '0' || *s > '9') return false;
+        v = v * 10 + (*s - '0');
+        if (v > max) return false;
+    }
+    *out = v;
+    return true;
+}
+
+static bool parse_port(const char *s, uint16_t *out) {
+    uint32_t v;
+    if (!parse_uint(s, 65535, &v)) return false;
+    *out = (uint16_t)v;
+    return true;
+}
+
+// Converts a token into the field's storage inside staged
+static bool apply_field(const ConfigField *f, TokenType type, const char *val, size_t len, AppConfig *staged) {
+    uint8_t *dst = (uint8_t *)staged + f->offset;
+
+    switch (f->type) {
+        case FIELD_IP: {
+            ip4_addr_t addr;
+            if (type != TOK_STRING || !ip4addr_aton(val, &addr)) return false;
+            memcpy(dst, &addr.addr, sizeof(uint32_t));
+            return true;
+        }
+        case FIELD_PORT: {
+            uint16_t port;
+            if (type != TOK_STRING && type != TOK_NUMBER) return false;
+            if (!parse_port(val, &port)) return false;
+            memcpy(dst, &port, sizeof(port));
+            return true;
+        }
+        case FIELD_UINT: {
+            uint32_t v;
+            if (type != TOK_STRING && type != TOK_NUMBER) return false;
+            if (!parse_uint(val, f->max, &v)) return false;
+            if (f->size == sizeof(uint8_t)) {
+                *dst = (uint8_t)v;
+            } else if (f->size == sizeof(uint16_t)) {
+                uint16_t v16 = (uint16_t)v;
+                memcpy(dst, &v16, sizeof(v16));
+            } else {
+                memcpy(dst, &v, sizeof(v));
+            }
+            return true;
+        }
+        case FIELD_BOOL:
+            if (type != TOK_TRUE && type != TOK_FALSE) return false;
+            *dst = (type == TOK_TRUE) ? 1 : 0;
+            return true;
+        case FIELD_SECRET:
+            if (type == TOK_STRING && len == 0) return true;  // empty -> keep current
+            // fall through
+        case FIELD_STRING:
+            if (type != TOK_STRING || len >= f->size) return false;
+            memset(dst, 0, f->size);
+            memcpy(dst, val, len);
+            return true;
+    }
+    return false;
+}
+
+esp_err_t parse_config_json(const char *body, size_t len, AppConfig *staged) {
+    Cursor c = { .pos = body, .end = body + len };
+    char key[MAX_KEY_LEN];
+    char value[MAX_VALUE_LEN];
+
+    if (!expect(&c, '{')) goto malformed;
+
+    skip_ws(&c);
+    if (c.pos < c.end && *c.pos == '}') {
+        c.pos++;
+        goto done;
+    }
+
+    while (1) {
+        size_t key_len, value_len;
+        bool key_overflow, value_overflow;
+        TokenType type;
+
+        skip_ws(&c);
+        if (c.pos >= c.end || *c.pos != '"') goto malformed;
+        if (!read_string(&c, key, sizeof(key), &key_len, &key_overflow)) goto malformed;
+        if (!expect(&c, ':')) goto malformed;
+        if (!read_value(&c, &type, value, sizeof(value), &value_len, &value_overflow)) goto malformed;
+
+        const ConfigField *field = key_overflow ? NULL : find_field(key);
+        if (field) {
+            if (value_overflow || !apply_field(field, type, value, value_len, staged)) {
+                ESP_LOGW(TAG, "Rejected value for '%s'", field->key);
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+
+        if (expect(&c, ',')) continue;
+        if (expect(&c, '}')) break;
+        goto malformed;
+    }
+
+done:
+    skip_ws(&c);
+    if (c.pos != c.end) goto malformed;  // trailing garbage
+    return ESP_OK;
+
+malformed:
+    ESP_LOGW(TAG, "Malformed JSON near offset %d", (int)(c.pos - body));
+    return ESP_ERR_INVALID_ARG;
+}
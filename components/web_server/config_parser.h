@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "app_config.h"
+
+// Parses the flat JSON object posted by the config page and writes every recognized
+// field straight into `staged`. Unknown keys are skipped. On any malformed or out of
+// range value the function returns ESP_ERR_INVALID_ARG and `staged` must be discarded.
+esp_err_t parse_config_json(const char *body, size_t len, AppConfig *staged);
@@ -2,51 +2,180 @@
 #include "esp_http_server.h"
 #include "esp_log.h"
 #include "esp_spiffs.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "app_config.h"  
 #include "lwip/ip4_addr.h"
-#include "cJSON.h"
-#include "eth_setup.h"
+#include "config_parser.h"
+#include "metrics.h"
+#include "boot_timeline.h"
+#include "gpio_handler.h"
+#include "task_layout.h"
+#include "event_trace.h"
 
 
 static const char *TAG = "web_server";
 
+#define SAVE_BODY_MAX_LEN 6144  // Upper bound for /save bodies, the config page with the pin map and expanders sends about 3 KB
+#define SIM_BODY_MAX_LEN  (CONFIG_GPIO_HANDLER_SIM_MAX_STEPS * 24)  // "<delay_us> <gpi> <level>\n" per step
+#define BODY_MAX_TIMEOUTS 3     // consecutive recv timeouts before a stalled body is given up
+#define BODY_DEADLINE_US  (10 * 1000000)  // whole body, so a client trickling bytes can't hold the httpd task
+
+static httpd_handle_t server = NULL;
+
 const char* itoa_buf(int value) {
     static char buf[8];
     snprintf(buf, sizeof(buf), "%d", value);
     return buf;
 }
 
-const char* get_placeholder_value(const char* key, char* outBuf, size_t outSize) {
-    if (strcmp(key, "deviceIp") == 0) return ip4addr_ntoa((const ip4_addr_t*)&globalConfig.deviceIp);
-    if (strcmp(key, "gateway") == 0) return ip4addr_ntoa((const ip4_addr_t*)&globalConfig.gateway);
-    if (strcmp(key, "subnetMask") == 0) return ip4addr_ntoa((const ip4_addr_t*)&globalConfig.subnetMask);
-    if (strcmp(key, "companionIp") == 0) return ip4addr_ntoa((const ip4_addr_t*)&globalConfig.companionIp);
+// Pin map placeholders: "gpi<n><Field>" / "gpo<n><Field>", n is 1-based
+static const char* get_pin_placeholder_value(const AppConfig *cfg, const char* key, char* outBuf, size_t outSize) {
+    bool isGpi = strncmp(key, "gpi", 3) == 0;
+    int n = key[3] - '0';
+    const char *field = key + 4;
+    if (n < 1 || n > (isGpi ? GPI_PIN_COUNT : GPO_PIN_COUNT)) return "";
+
+    if (isGpi) {
+        const GpiPinConfig *pin = &cfg->gpi[n - 1];
+        if (strcmp(field, "Gpio") == 0) snprintf(outBuf, outSize, "%u", pin->gpio);
+        else if (strcmp(field, "DebounceUs") == 0) snprintf(outBuf, outSize, "%lu", (unsigned long)pin->debounceUs);
+        else if (strcmp(field, "Pull") == 0) snprintf(outBuf, outSize, "%u", pin->pull);
+        else if (strcmp(field, "Edges") == 0) snprintf(outBuf, outSize, "%u", pin->edges);
+        else if (strcmp(field, "Mode") == 0) snprintf(outBuf, outSize, "%u", pin->mode);
+        else if (strcmp(field, "ReportMs") == 0) snprintf(outBuf, outSize, "%u", pin->reportMs);
+        else if (strcmp(field, "ReportThreshold") == 0) snprintf(outBuf, outSize, "%lu", (unsigned long)pin->reportThreshold);
+        else if (strcmp(field, "EventBurst") == 0) snprintf(outBuf, outSize, "%u", pin->eventBurst);
+        else if (strcmp(field, "EventsPerMin") == 0) snprintf(outBuf, outSize, "%u", pin->eventsPerMin);
+        else if (strcmp(field, "Enabled") == 0) return pin->enabled ? "checked" : "";
+        else if (strcmp(field, "Invert") == 0) return pin->invert ? "checked" : "";
+        else return "";
+        return outBuf;
+    }
+
+    const GpoPinConfig *pin = &cfg->gpo[n - 1];
+    if (strcmp(field, "Gpio") == 0) {
+        snprintf(outBuf, outSize, "%u", pin->gpio);
+        return outBuf;
+    }
+    if (strcmp(field, "Enabled") == 0) return pin->enabled ? "checked" : "";
+    if (strcmp(field, "Invert") == 0) return pin->invert ? "checked" : "";
+    if (strcmp(field, "Rule") == 0) {
+        snprintf(outBuf, outSize, "%.*s", (int)sizeof(pin->rule), pin->rule);
+        return outBuf;
+    }
+    return "";
+}
+
+// Expander placeholders: "exp<n><Field>", n is 1-based. Masks and addresses are shown in hex.
+static const char* get_expander_placeholder_value(const AppConfig *cfg, const char* key, char* outBuf, size_t outSize) {
+    int n = key[3] - '0';
+    const char *field = key + 4;
+    if (n < 1 || n > GPIO_EXPANDER_COUNT) return "";
+
+    const ExpanderConfig *x = &cfg->expander[n - 1];
+    if (strcmp(field, "Enabled") == 0) return x->enabled ? "checked" : "";
+    if (strcmp(field, "Address") == 0) snprintf(outBuf, outSize, "0x%02X", x->address);
+    else if (strcmp(field, "IntGpio") == 0) {
+        if (x->intGpio == GPIO_EXPANDER_NO_INT) return "";  // polled
+        snprintf(outBuf, outSize, "%u", x->intGpio);
+    }
+    else if (strcmp(field, "InputMask") == 0) snprintf(outBuf, outSize, "0x%04X", x->inputMask);
+    else if (strcmp(field, "InvertMask") == 0) snprintf(outBuf, outSize, "0x%04X", x->invertMask);
+    else if (strcmp(field, "PullUpMask") == 0) snprintf(outBuf, outSize, "0x%04X", x->pullUpMask);
+    else if (strcmp(field, "DebounceUs") == 0) snprintf(outBuf, outSize, "%lu", (unsigned long)x->debounceUs);
+    else if (strcmp(field, "Edges") == 0) snprintf(outBuf, outSize, "%u", x->edges);
+    else if (strcmp(field, "EventBurst") == 0) snprintf(outBuf, outSize, "%u", x->eventBurst);
+    else if (strcmp(field, "EventsPerMin") == 0) snprintf(outBuf, outSize, "%u", x->eventsPerMin);
+    else return "";
+    return outBuf;
+}
+
+// HTTP server tuning placeholders: "web<Field>"
+static const char* get_web_placeholder_value(const AppConfig *cfg, const char* key, char* outBuf, size_t outSize) {
+    const WebServerConfig *web = &cfg->web;
+    const char *field = key + 3;
+    if (strcmp(field, "LruPurge") == 0) return web->lruPurge ? "checked" : "";
+    if (strcmp(field, "KeepAlive") == 0) return web->keepAlive ? "checked" : "";
+    if (strcmp(field, "MaxSockets") == 0) snprintf(outBuf, outSize, "%u", web->maxOpenSockets);
+    else if (strcmp(field, "Backlog") == 0) snprintf(outBuf, outSize, "%u", web->backlogConn);
+    else if (strcmp(field, "KeepAliveIdleS") == 0) snprintf(outBuf, outSize, "%u", web->keepAliveIdleS);
+    else if (strcmp(field, "KeepAliveIntervalS") == 0) snprintf(outBuf, outSize, "%u", web->keepAliveIntervalS);
+    else if (strcmp(field, "KeepAliveCount") == 0) snprintf(outBuf, outSize, "%u", web->keepAliveCount);
+    else if (strcmp(field, "TaskPriority") == 0) snprintf(outBuf, outSize, "%u", web->taskPriority);
+    else if (strcmp(field, "TaskCore") == 0) snprintf(outBuf, outSize, "%u", web->taskCore);
+    else if (strcmp(field, "RecvTimeoutS") == 0) snprintf(outBuf, outSize, "%u", web->recvTimeoutS);
+    else if (strcmp(field, "SendTimeoutS") == 0) snprintf(outBuf, outSize, "%u", web->sendTimeoutS);
+    else return "";
+    return outBuf;
+}
+
+const char* get_placeholder_value(const AppConfig *cfg, const char* key, char* outBuf, size_t outSize) {
+    if (strncmp(key, "web", 3) == 0) {
+        return get_web_placeholder_value(cfg, key, outBuf, outSize);
+    }
+    if (strncmp(key, "gpi", 3) == 0 || strncmp(key, "gpo", 3) == 0) {
+        return get_pin_placeholder_value(cfg, key, outBuf, outSize);
+    }
+    if (strncmp(key, "exp", 3) == 0) {
+        return get_expander_placeholder_value(cfg, key, outBuf, outSize);
+    }
+    if (strcmp(key, "deviceIp") == 0) return ip4addr_ntoa((const ip4_addr_t*)&cfg->deviceIp);
+    if (strcmp(key, "gateway") == 0) return ip4addr_ntoa((const ip4_addr_t*)&cfg->gateway);
+    if (strcmp(key, "subnetMask") == 0) return ip4addr_ntoa((const ip4_addr_t*)&cfg->subnetMask);
+    if (strcmp(key, "backupIp") == 0) return ip4addr_ntoa((const ip4_addr_t*)&cfg->backupIp);
+    if (strcmp(key, "backupGateway") == 0) return ip4addr_ntoa((const ip4_addr_t*)&cfg->backupGateway);
+    if (strcmp(key, "backupSubnetMask") == 0) return ip4addr_ntoa((const ip4_addr_t*)&cfg->backupSubnetMask);
+    if (strcmp(key, "companionIp") == 0) return ip4addr_ntoa((const ip4_addr_t*)&cfg->companionIp);
     if (strcmp(key, "companionPort") == 0) {
-        snprintf(outBuf, outSize, "%u", globalConfig.companionPort);
+        snprintf(outBuf, outSize, "%u", cfg->companionPort);
         return outBuf;
     }
-    if (strcmp(key, "companionMode") == 0) return globalConfig.companionMode ? "checked" : "";
-    if (strcmp(key, "tcpEnabled") == 0) return globalConfig.tcpEnabled ? "checked" : "";
-    if (strcmp(key, "tcpIp") == 0) return ip4addr_ntoa((const ip4_addr_t*)&globalConfig.tcpIp);
+    if (strcmp(key, "companionMode") == 0) return cfg->companionMode ? "checked" : "";
+    if (strcmp(key, "tcpEnabled") == 0) return cfg->tcpEnabled ? "checked" : "";
+    if (strcmp(key, "tcpIp") == 0) return ip4addr_ntoa((const ip4_addr_t*)&cfg->tcpIp);
     if (strcmp(key, "tcpPort") == 0) {
-        snprintf(outBuf, outSize, "%u", globalConfig.tcpPort);
+        snprintf(outBuf, outSize, "%u", cfg->tcpPort);
+        return outBuf;
+    }
+    if (strcmp(key, "tcpSecure") == 0) return cfg->tcpSecure ? "checked" : "";
+    if (strcmp(key, "tcpUser") == 0) return cfg->tcpUser;
+    if (strcmp(key, "tcpPassword") == 0) return cfg->tcpPassword;
+    if (strcmp(key, "httpEnabled") == 0) return cfg->httpEnabled ? "checked" : "";
+    if (strcmp(key, "httpUrl") == 0) return cfg->httpUrl;
+    if (strcmp(key, "httpSecure") == 0) return cfg->httpSecure ? "checked" : "";
+    if (strcmp(key, "httpUser") == 0) return cfg->httpUser;
+    if (strcmp(key, "httpPassword") == 0) return cfg->httpPassword;
+    if (strcmp(key, "serialEnabled") == 0) return cfg->serialEnabled ? "checked" : "";
+    if (strcmp(key, "syslogEnabled") == 0) return cfg->syslogEnabled ? "checked" : "";
+    if (strcmp(key, "syslogIp") == 0) return ip4addr_ntoa((const ip4_addr_t*)&cfg->syslogIp);
+    if (strcmp(key, "syslogPort") == 0) {
+        snprintf(outBuf, outSize, "%u", cfg->syslogPort);
+        return outBuf;
+    }
+    if (strcmp(key, "ethRxMode") == 0) {
+        snprintf(outBuf, outSize, "%u", cfg->ethRxMode);
         return outBuf;
     }
-    if (strcmp(key, "tcpSecure") == 0) return globalConfig.tcpSecure ? "checked" : "";
-    if (strcmp(key, "tcpUser") == 0) return globalConfig.tcpUser;
-    if (strcmp(key, "tcpPassword") == 0) return globalConfig.tcpPassword;
-    if (strcmp(key, "httpEnabled") == 0) return globalConfig.httpEnabled ? "checked" : "";
-    if (strcmp(key, "httpUrl") == 0) return globalConfig.httpUrl;
-    if (strcmp(key, "httpSecure") == 0) return globalConfig.httpSecure ? "checked" : "";
-    if (strcmp(key, "httpUser") == 0) return globalConfig.httpUser;
-    if (strcmp(key, "httpPassword") == 0) return globalConfig.httpPassword;
-    if (strcmp(key, "serialEnabled") == 0) return globalConfig.serialEnabled ? "checked" : "";
 
     return "";
 }
 
+// Appends to the chunk buffer, sending it first when data won't fit
+static void append_to_chunk(httpd_req_t *req, char *buf, size_t size, size_t *len, const char *data, size_t n) {
+    if (*len + n > size) {
+        httpd_resp_send_chunk(req, buf, *len);
+        *len = 0;
+    }
+    if (n > size) n = size;  // placeholder values are far shorter than a chunk
+    memcpy(buf + *len, data, n);
+    *len += n;
+}
+
 // Open  given file from spiffs, and send it chunked
 esp_err_t serve_file(httpd_req_t *req, const char *filename) {
     FILE *f;
@@ -62,60 +191,62 @@ esp_err_t serve_file(httpd_req_t *req, const char *filename) {
     char send_buffer[512];
     char ph_buffer[64];  // for collecting placeholder names
     char temp_value[70]; // temp buffer for placeholder output
+    AppConfig cfg;       // one snapshot per page, so a concurrent save can't mix old and new values
+    config_snapshot(&cfg);
 
     size_t send_len = 0;
     size_t ph_len = 0;
     bool in_placeholder = false;
+    char pending = 0;  // first brace of a "{{" or "}}" that may continue in the next read
 
     size_t bytes_read;
     while ((bytes_read = fread(file_buffer, 1, sizeof(file_buffer), f)) > 0) {
         for (size_t i = 0; i < bytes_read; i++) {
             char c = file_buffer[i];
 
-            // Start of placeholder
-            if (!in_placeholder && c == '{' && i + 1 < bytes_read && file_buffer[i + 1] == '{') {
-                in_placeholder = true;
-                ph_len = 0;
-                i++;  // skip next '{'
-                continue;
-            }
-
-            // End of placeholder
-            if (in_placeholder && c == '}' && i + 1 < bytes_read && file_buffer[i + 1] == '}') {
-                ph_buffer[ph_len] = '\0';
-                const char *value = get_placeholder_value(ph_buffer, temp_value, sizeof(temp_value));
-                size_t value_len = strlen(value);
-
-                // flush if value won't fit
-                if (send_len + value_len >= sizeof(send_buffer)) {
-                    httpd_resp_send_chunk(req, send_buffer, send_len);
-                    send_len = 0;
+            if (!in_placeholder) {
+                if (pending == '{') {
+                    pending = 0;
+                    // Start of placeholder
+                    if (c == '{') {
+                        in_placeholder = true;
+                        ph_len = 0;
+                        continue;
+                    }
+                    append_to_chunk(req, send_buffer, sizeof(send_buffer), &send_len, "{", 1);
                 }
-
-                memcpy(send_buffer + send_len, value, value_len);
-                send_len += value_len;
-
-                i++;  // skip next '}'
-                in_placeholder = false;
+                if (c == '{') {
+                    pending = c;
+                    continue;
+                }
+                // Normal char
+                append_to_chunk(req, send_buffer, sizeof(send_buffer), &send_len, &c, 1);
                 continue;
             }
 
-            // Inside placeholder content
-            if (in_placeholder) {
-                if (ph_len < sizeof(ph_buffer) - 1) {
-                    ph_buffer[ph_len++] = c;
-                }
-                // else: overflow — silently truncate
-            } else {
-                // Normal char
-                if (send_len >= sizeof(send_buffer)) {
-                    httpd_resp_send_chunk(req, send_buffer, send_len);
-                    send_len = 0;
+            if (pending == '}') {
+                pending = 0;
+                // End of placeholder
+                if (c == '}') {
+                    ph_buffer[ph_len] = '\0';
+                    const char *value = get_placeholder_value(&cfg, ph_buffer, temp_value, sizeof(temp_value));
+                    append_to_chunk(req, send_buffer, sizeof(send_buffer), &send_len, value, strlen(value));
+                    in_placeholder = false;
+                    continue;
                 }
-                send_buffer[send_len++] = c;
+                if (ph_len < sizeof(ph_buffer) - 1) ph_buffer[ph_len++] = '}';
+            }
+            if (c == '}') {
+                pending = c;
+            } else if (ph_len < sizeof(ph_buffer) - 1) {
+                ph_buffer[ph_len++] = c;
             }
+            // else: overflow — silently truncate
         }
     }
+    if (pending == '{') {
+        append_to_chunk(req, send_buffer, sizeof(send_buffer), &send_len, "{", 1);
+    }
 
     fclose(f);
 
@@ -169,7 +300,9 @@ static esp_err_t handle_login(httpd_req_t *req) {
         strncpy(password, passPos + strlen("password="), sizeof(password) - 1);
 
         // Compare against stored password
-        if (strcmp(password, globalConfig.adminPassword) == 0) {
+        AppConfig cfg;
+        config_snapshot(&cfg);
+        if (strcmp(password, cfg.adminPassword) == 0) {
             httpd_resp_set_hdr(req, "Set-Cookie", "sessionToken=loggedIn; Path=/;");
             httpd_resp_set_status(req, "302 Found");
             httpd_resp_set_hdr(req, "Location", "/");
@@ -180,12 +313,15 @@ static esp_err_t handle_login(httpd_req_t *req) {
     return serve_login_page(req, true);  // Login failed
 }
 
-static esp_err_t HTTP_get_router(httpd_req_t *req) {
+static bool has_session(httpd_req_t *req) {
     char buf[200];
-    if (httpd_req_get_hdr_value_str(req, "Cookie", buf, sizeof(buf)) == ESP_OK) {
-        if (strstr(buf, "sessionToken=loggedIn")) {
-            return serve_config_page(req);
-        }
+    return httpd_req_get_hdr_value_str(req, "Cookie", buf, sizeof(buf)) == ESP_OK &&
+           strstr(buf, "sessionToken=loggedIn") != NULL;
+}
+
+static esp_err_t HTTP_get_router(httpd_req_t *req) {
+    if (has_session(req)) {
+        return serve_config_page(req);
     }
 
     if (req->method == HTTP_POST) {
@@ -204,108 +340,295 @@ static esp_err_t serve_css_handler(httpd_req_t *req) {
     return serve_file(req, "styles.css");
 }
 
-static esp_err_t handle_save_config(httpd_req_t *req) {
-    char buf[1024];
-    int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
-    if (ret <= 0) {
-        ESP_LOGE(TAG, "Failed to receive config data");
-        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid data");
+// Batches metric lines (and trace records) into chunked response writes
+typedef struct {
+    httpd_req_t *req;
+    char buf[512];
+    size_t len;
+} MetricsResponse;
+
+static void metrics_write_line(const char *line, size_t len, void *ctx) {
+    MetricsResponse *resp = ctx;
+    if (resp->len + len > sizeof(resp->buf)) {
+        httpd_resp_send_chunk(resp->req, resp->buf, resp->len);
+        resp->len = 0;
     }
-    buf[ret] = '\0';
-    ESP_LOGI(TAG, "Received config JSON:\n%s", buf);
+    memcpy(resp->buf + resp->len, line, len);
+    resp->len += len;
+}
 
-    cJSON *json = cJSON_Parse(buf);
-    if (!json) {
-        ESP_LOGE(TAG, "JSON parsing failed");
-        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+// Prometheus scrape endpoint, no session needed
+static esp_err_t serve_metrics_handler(httpd_req_t *req) {
+    MetricsResponse *resp = malloc(sizeof(MetricsResponse));
+    if (!resp) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
     }
+    resp->req = req;
+    resp->len = 0;
 
-    const char* val;
-    bool ip_changed = false;
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    metrics_render(metrics_write_line, resp);
+    if (resp->len > 0) {
+        httpd_resp_send_chunk(req, resp->buf, resp->len);
+    }
+    free(resp);
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
 
-    // Here we compare existing network settings with new one
-    if ((val = cJSON_GetStringValue(cJSON_GetObjectItem(json, "ip")))) {
-        ip4_addr_t new_ip = { .addr = ipaddr_addr(val) };
-        if (globalConfig.deviceIp != new_ip.addr) {
-            globalConfig.deviceIp = new_ip.addr;
-            ip_changed = true;
-        }
+// Event trace as Chrome trace JSON, no session needed
+static esp_err_t serve_trace_handler(httpd_req_t *req) {
+    MetricsResponse *resp = malloc(sizeof(MetricsResponse));
+    if (!resp) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+    }
+    resp->req = req;
+    resp->len = 0;
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"gpiobox-trace.json\"");
+    event_trace_render(metrics_write_line, resp);
+    if (resp->len > 0) {
+        httpd_resp_send_chunk(req, resp->buf, resp->len);
     }
+    free(resp);
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
 
-    if ((val = cJSON_GetStringValue(cJSON_GetObjectItem(json, "gateway")))) {
-        ip4_addr_t new_gw = { .addr = ipaddr_addr(val) };
-        if (globalConfig.gateway != new_gw.addr) {
-            globalConfig.gateway = new_gw.addr;
-            ip_changed = true;
-        }
+// Boot timeline as JSON, no session needed
+static esp_err_t serve_boot_handler(httpd_req_t *req) {
+    char json[768];
+    size_t len = boot_timeline_json(json, sizeof(json));
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, len);
+}
+
+// Reads the whole request body into a heap buffer, looping until content_len bytes arrived.
+// Slow clients may deliver the body over several TCP segments, so a single recv is not enough,
+// but one that stalls is answered with 408: httpd serves every client from this one task.
+static esp_err_t read_request_body(httpd_req_t *req, size_t max_len, char **out_body, size_t *out_len) {
+    size_t total = req->content_len;
+    if (total == 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Empty body");
+        return ESP_FAIL;
+    }
+    if (total > max_len) {
+        ESP_LOGW(TAG, "Request body too large: %d bytes", (int)total);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Body too large");
+        return ESP_FAIL;
     }
 
-    if ((val = cJSON_GetStringValue(cJSON_GetObjectItem(json, "subnetMask")))) {
-        ip4_addr_t new_mask = { .addr = ipaddr_addr(val) };
-        if (globalConfig.subnetMask != new_mask.addr) {
-            globalConfig.subnetMask = new_mask.addr;
-            ip_changed = true;
+    char *body = malloc(total + 1);
+    if (!body) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t received = 0;
+    int timeouts = 0;
+    int64_t deadline = esp_timer_get_time() + BODY_DEADLINE_US;
+    while (received < total) {
+        int ret = httpd_req_recv(req, body + received, total - received);
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            timeouts++;  // Segment not there yet, each try waits recv_wait_timeout
+        } else if (ret <= 0) {
+            ESP_LOGE(TAG, "Failed to receive request body");
+            free(body);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid data");
+            return ESP_FAIL;
+        } else {
+            received += ret;
+            timeouts = 0;
         }
+        if (received < total && (timeouts >= BODY_MAX_TIMEOUTS || esp_timer_get_time() > deadline)) {
+            ESP_LOGW(TAG, "Request body stalled at %d of %d bytes", (int)received, (int)total);
+            free(body);
+            httpd_resp_send_err(req, HTTPD_408_REQ_TIMEOUT, "Body timed out");
+            return ESP_FAIL;
+        }
+    }
+    body[total] = '\0';
+
+    *out_body = body;
+    *out_len = total;
+    return ESP_OK;
+}
+
+static esp_err_t handle_save_config(httpd_req_t *req) {
+    char *body = NULL;
+    size_t body_len = 0;
+    if (read_request_body(req, SAVE_BODY_MAX_LEN, &body, &body_len) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Received config JSON (%d bytes)", (int)body_len);
+
+    // Parse into a staging copy, live config is only replaced when the whole body is valid
+    AppConfig staged;
+    config_snapshot(&staged);
+    esp_err_t err = parse_config_json(body, body_len, &staged);
+    free(body);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Config JSON rejected");
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+    }
+
+    char reason[64];
+    if (gpio_check_pin_map(&staged, reason, sizeof(reason)) != ESP_OK) {
+        ESP_LOGE(TAG, "Pin map rejected: %s", reason);
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, reason);
+    }
+    if (web_server_check_settings(&staged.web, reason, sizeof(reason)) != ESP_OK) {
+        ESP_LOGE(TAG, "Web server settings rejected: %s", reason);
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, reason);
     }
 
-    // Companion
-    if (cJSON_HasObjectItem(json, "companionMode"))
-        globalConfig.companionMode = cJSON_IsTrue(cJSON_GetObjectItem(json, "companionMode")) ? 1 : 0;
-    if ((val = cJSON_GetStringValue(cJSON_GetObjectItem(json, "companionIp"))))
-        globalConfig.companionIp = ipaddr_addr(val);
-    if ((val = cJSON_GetStringValue(cJSON_GetObjectItem(json, "companionPort"))))
-        globalConfig.companionPort = atoi(val);
-
-    // TCP
-    if (cJSON_HasObjectItem(json, "tcpEnabled"))
-        globalConfig.tcpEnabled = cJSON_IsTrue(cJSON_GetObjectItem(json, "tcpEnabled")) ? 1 : 0;
-    if ((val = cJSON_GetStringValue(cJSON_GetObjectItem(json, "tcpIp"))))
-        globalConfig.tcpIp = ipaddr_addr(val);
-    if (cJSON_HasObjectItem(json, "tcpPort"))
-        globalConfig.tcpPort = cJSON_GetObjectItem(json, "tcpPort")->valueint;
-    if (cJSON_HasObjectItem(json, "tcpSecure"))
-        globalConfig.tcpSecure = cJSON_IsTrue(cJSON_GetObjectItem(json, "tcpSecure")) ? 1 : 0;
-    if ((val = cJSON_GetStringValue(cJSON_GetObjectItem(json, "tcpUser"))))
-        strncpy(globalConfig.tcpUser, val, sizeof(globalConfig.tcpUser));
-    if ((val = cJSON_GetStringValue(cJSON_GetObjectItem(json, "tcpPassword"))))
-        strncpy(globalConfig.tcpPassword, val, sizeof(globalConfig.tcpPassword));
-
-    // HTTP
-    if (cJSON_HasObjectItem(json, "httpEnabled"))
-        globalConfig.httpEnabled = cJSON_IsTrue(cJSON_GetObjectItem(json, "httpEnabled")) ? 1 : 0;
-    if ((val = cJSON_GetStringValue(cJSON_GetObjectItem(json, "httpUrl"))))
-        strncpy(globalConfig.httpUrl, val, sizeof(globalConfig.httpUrl));
-    if (cJSON_HasObjectItem(json, "httpSecure"))
-        globalConfig.httpSecure = cJSON_IsTrue(cJSON_GetObjectItem(json, "httpSecure")) ? 1 : 0;
-    if ((val = cJSON_GetStringValue(cJSON_GetObjectItem(json, "httpUser"))))
-        strncpy(globalConfig.httpUser, val, sizeof(globalConfig.httpUser));
-    if ((val = cJSON_GetStringValue(cJSON_GetObjectItem(json, "httpPassword"))))
-        strncpy(globalConfig.httpPassword, val, sizeof(globalConfig.httpPassword));
-
-    // Serial
-    if (cJSON_HasObjectItem(json, "serialEnabled"))
-        globalConfig.serialEnabled = cJSON_IsTrue(cJSON_GetObjectItem(json, "serialEnabled")) ? 1 : 0;
-
-    // Admin password (only update if not empty)
-    val = cJSON_GetStringValue(cJSON_GetObjectItem(json, "adminPassword"));
-    if (val && strlen(val) > 0)
-        strncpy(globalConfig.adminPassword, val, sizeof(globalConfig.adminPassword));
-
-    cJSON_Delete(json);
-    save_config();
-    if (ip_changed) {reapply_eth_config();}
+    // Persists and reloads only what changed (network, TCP, ...), no-op saves skip flash
+    apply_config(&staged);
     ESP_LOGI(TAG, "Finished processing save");
     httpd_resp_set_status(req, "302 Found");
     httpd_resp_set_hdr(req, "Location", "/");
     return httpd_resp_send(req, NULL, 0);
 }
 
+#if CONFIG_GPIO_HANDLER_SIM_INPUTS
+// Bench only: replays an edge trace against the simulated GPI inputs
+static esp_err_t handle_sim_gpi(httpd_req_t *req) {
+    if (!has_session(req)) {
+        return httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Login required");
+    }
+
+    char *body = NULL;
+    size_t body_len = 0;
+    if (read_request_body(req, SIM_BODY_MAX_LEN, &body, &body_len) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    esp_err_t err = gpio_sim_play(body, body_len);
+    free(body);
+    if (err == ESP_ERR_INVALID_STATE) {
+        httpd_resp_set_status(req, "409 Conflict");
+        return httpd_resp_sendstr(req, "Trace still playing");
+    }
+    if (err != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid trace");
+    }
+    httpd_resp_set_status(req, "202 Accepted");
+    return httpd_resp_send(req, NULL, 0);
+}
+#endif
+
+//*************** Runtime settings *****************************//
+// A change to AppConfig.web arrives in the reload hook on the httpd task itself, in the middle of
+// the /save request, where httpd_stop would wait for its own task. The restart runs from a
+// short-lived task instead, once the reply had time to go out; saves meanwhile only update the
+// settings it will use.
+
+#define RESTART_DELAY_MS 500
+
+static WebServerConfig pending_web;
+static bool restart_pending = false;
+static portMUX_TYPE restart_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static esp_err_t stop_webserver(void);
+static esp_err_t start_webserver_with_settings(const WebServerConfig *settings);
+
+// Falls back to the factory tuning when httpd refuses the stored settings (e.g. not enough lwIP
+// sockets left), so a bad save can't lock the config page out
+static esp_err_t start_with_fallback(const WebServerConfig *web) {
+    if (start_webserver_with_settings(web) == ESP_OK) return ESP_OK;
+
+    AppConfig *defaults = malloc(sizeof(AppConfig));
+    if (!defaults) return ESP_ERR_NO_MEM;
+    config_factory_defaults(defaults);
+    esp_err_t err = ESP_FAIL;
+    if (memcmp(&defaults->web, web, sizeof(*web)) != 0) {
+        ESP_LOGW(TAG, "Starting HTTP server with the factory settings instead");
+        err = start_webserver_with_settings(&defaults->web);
+    }
+    free(defaults);
+    return err;
+}
+
+static void httpd_restart_task(void *arg) {
+    vTaskDelay(pdMS_TO_TICKS(RESTART_DELAY_MS));
+
+    WebServerConfig web;
+    portENTER_CRITICAL(&restart_lock);
+    web = pending_web;
+    restart_pending = false;
+    portEXIT_CRITICAL(&restart_lock);
+
+    ESP_LOGW(TAG, "Restarting HTTP server with new settings");
+    stop_webserver();
+    start_with_fallback(&web);
+    vTaskDelete(NULL);
+}
+
+static void on_web_config_change(uint32_t changed, const AppConfig *cfg) {
+    portENTER_CRITICAL(&restart_lock);
+    pending_web = cfg->web;
+    bool start = !restart_pending;
+    restart_pending = true;
+    portEXIT_CRITICAL(&restart_lock);
+
+    if (start && task_layout_create(TASK_HTTPD_RESTART, httpd_restart_task, NULL, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "No memory to restart the HTTP server, new settings apply after a reboot");
+        portENTER_CRITICAL(&restart_lock);
+        restart_pending = false;
+        portEXIT_CRITICAL(&restart_lock);
+    }
+}
+
+static esp_err_t stop_webserver(void) {
+    if (!server) return ESP_ERR_INVALID_STATE;
+    esp_err_t err = httpd_stop(server);
+    server = NULL;
+    return err;
+}
+
+esp_err_t web_server_check_settings(const WebServerConfig *web, char *reason, size_t reasonSize) {
+    if (web->maxOpenSockets < 1 || web->backlogConn < 1) {
+        snprintf(reason, reasonSize, "Web server: needs at least one socket and backlog slot");
+    } else if (web->keepAlive && (web->keepAliveIdleS < 1 || web->keepAliveIntervalS < 1 || web->keepAliveCount < 1)) {
+        snprintf(reason, reasonSize, "Web server: keep-alive times and count must be at least 1");
+    } else if (web->recvTimeoutS < 1 || web->sendTimeoutS < 1) {
+        snprintf(reason, reasonSize, "Web server: timeouts must be at least 1 s");
+    } else if (web->taskPriority < 1 || web->taskPriority >= configMAX_PRIORITIES) {
+        snprintf(reason, reasonSize, "Web server: task priority must be 1-%d", configMAX_PRIORITIES - 1);
+    } else if (web->taskCore != WEB_TASK_CORE_ANY && web->taskCore >= portNUM_PROCESSORS) {
+        snprintf(reason, reasonSize, "Web server: no core %u on this chip", web->taskCore);
+    } else {
+        return ESP_OK;
+    }
+    return ESP_ERR_INVALID_ARG;
+}
 
 esp_err_t start_webserver(void) {
-    httpd_handle_t server = NULL;
-    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    register_config_reload_hook(CONFIG_CHANGED_WEB, on_web_config_change);
+    return start_with_fallback(&cfg.web);
+}
 
-    ESP_LOGI(TAG, "Starting HTTP Server");
+static esp_err_t start_webserver_with_settings(const WebServerConfig *settings) {
+    if (server) return ESP_ERR_INVALID_STATE;
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.max_open_sockets    = settings->maxOpenSockets;
+    config.backlog_conn        = settings->backlogConn;
+    config.lru_purge_enable    = settings->lruPurge;
+    config.keep_alive_enable   = settings->keepAlive;
+    config.keep_alive_idle     = settings->keepAliveIdleS;
+    config.keep_alive_interval = settings->keepAliveIntervalS;
+    config.keep_alive_count    = settings->keepAliveCount;
+    config.task_priority       = settings->taskPriority;
+    config.core_id             = settings->taskCore == WEB_TASK_CORE_ANY ? tskNO_AFFINITY : settings->taskCore;
+    config.stack_size          = task_layout_get(TASK_HTTPD)->stackSize;
+    config.recv_wait_timeout   = settings->recvTimeoutS;
+    config.send_wait_timeout   = settings->sendTimeoutS;
+    config.max_uri_handlers    = 10;  // 9 with the sim endpoint
+
+    ESP_LOGI(TAG, "Starting HTTP Server (sockets:%d, lru:%d, prio:%d, core:%d)",
+             settings->maxOpenSockets, settings->lruPurge, settings->taskPriority, settings->taskCore);
 
     if (httpd_start(&server, &config) == ESP_OK) {
         httpd_uri_t root_uri = {
@@ -342,17 +665,52 @@ esp_err_t start_webserver(void) {
             .handler  = handle_save_config,
             .user_ctx = NULL
         };
+
+        httpd_uri_t metrics_uri = {
+            .uri      = "/metrics",
+            .method   = HTTP_GET,
+            .handler  = serve_metrics_handler,
+            .user_ctx = NULL
+        };
+
+        httpd_uri_t boot_uri = {
+            .uri      = "/boot",
+            .method   = HTTP_GET,
+            .handler  = serve_boot_handler,
+            .user_ctx = NULL
+        };
+
+        httpd_uri_t trace_uri = {
+            .uri      = "/trace",
+            .method   = HTTP_GET,
+            .handler  = serve_trace_handler,
+            .user_ctx = NULL
+        };
         
         httpd_register_uri_handler(server, &root_uri);
         httpd_register_uri_handler(server, &post_uri);
         httpd_register_uri_handler(server, &js_uri);
         httpd_register_uri_handler(server, &css_uri);
         httpd_register_uri_handler(server, &save_uri);
+        httpd_register_uri_handler(server, &metrics_uri);
+        httpd_register_uri_handler(server, &boot_uri);
+        httpd_register_uri_handler(server, &trace_uri);
+
+#if CONFIG_GPIO_HANDLER_SIM_INPUTS
+        httpd_uri_t sim_uri = {
+            .uri      = "/sim/gpi",
+            .method   = HTTP_POST,
+            .handler  = handle_sim_gpi,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &sim_uri);
+#endif
        
         ESP_LOGI(TAG, "HTTP Server started successfully");
         return ESP_OK;
     }
 
     ESP_LOGE(TAG, "Failed to start HTTP server");
+    server = NULL;
     return ESP_FAIL;
 }
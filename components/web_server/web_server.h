@@ -1,4 +1,11 @@
 #pragma once
+#include <stddef.h>
 #include "esp_err.h"
+#include "app_config.h"
 
+// Starts the HTTP server with the tuning in the live config (AppConfig.web). A saved change to
+// those settings restarts the server from a short-lived task, after the /save reply went out.
 esp_err_t start_webserver(void);
+
+// Rejects settings the server can't start with, reason is shown to the user
+esp_err_t web_server_check_settings(const WebServerConfig *web, char *reason, size_t reasonSize);
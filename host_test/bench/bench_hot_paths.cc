@@ -0,0 +1,295 @@
+// Microbenchmarks of the per-event and per-request paths: ns and heap allocations per operation.
+// Run before and after a change to these files and compare, e.g.
+//   _gate_build/bench_hot_paths --benchmark_repetitions=5 --benchmark_report_aggregates_only=true
+// The tcp_client cases and the *_cJSON cases (the serializers used before JsonWriter) are built
+// when cJSON is found.
+
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+extern "C" {
+#include "app_config.h"
+#include "config_parser.h"
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "esp_spiffs.h"
+#include "event_journal.h"
+#include "gpio_handler.h"
+#include "message_builder.h"
+#include "nvs.h"
+#if BENCH_CJSON_BASELINE
+#include "cjson_baseline.h"
+#endif
+uint64_t bench_alloc_count(void);
+esp_err_t serve_file(httpd_req_t *req, const char *filename);  // web_server.c
+#if BENCH_TCP_CLIENT
+void bench_generate_sync_response(char *out_json, size_t max_len);
+void bench_process_incoming_command(const char *data);
+int bench_parse_url(const char *url);
+#endif
+}
+
+// The pin states the sync response reports, read back after setup
+static bool gpi_states[GPI_PIN_COUNT];
+static bool gpo_states[GPO_PIN_COUNT];
+
+// A /save body as index.js posts it: every network and sink key plus the whole pin map
+static std::string save_body() {
+    std::string body =
+        "{\"ip\":\"192.168.1.50\",\"gateway\":\"192.168.1.1\",\"subnetMask\":\"255.255.255.0\","
+        "\"backupIp\":\"0.0.0.0\",\"backupGateway\":\"0.0.0.0\",\"backupSubnetMask\":\"255.255.255.0\","
+        "\"companionMode\":false,\"companionIp\":\"0.0.0.0\",\"companionPort\":\"16759\","
+        "\"tcpEnabled\":true,\"tcpIp\":\"10.0.0.2\",\"tcpPort\":\"9000\",\"tcpSecure\":true,"
+        "\"tcpUser\":\"operator\",\"tcpPassword\":\"\",\"httpEnabled\":true,\"httpUrl\":\"http://10.0.0.3/hook\","
+        "\"httpSecure\":false,\"httpUser\":\"\",\"httpPassword\":\"\",\"serialEnabled\":false,"
+        "\"adminPassword\":\"\",\"syslogEnabled\":true,\"syslogIp\":\"10.0.0.9\",\"syslogPort\":\"514\"";
+    char field[160];
+    for (int n = 1; n <= GPI_PIN_COUNT; n++) {
+        snprintf(field, sizeof(field),
+                 ",\"gpi%dGpio\":%d,\"gpi%dDebounceUs\":\"50000\",\"gpi%dEnabled\":true,\"gpi%dInvert\":false,"
+                 "\"gpi%dPull\":0,\"gpi%dEdges\":0,\"gpi%dMode\":0",
+                 n, 24 + n, n, n, n, n, n, n);
+        body += field;
+        snprintf(field, sizeof(field),
+                 ",\"gpi%dReportMs\":\"1000\",\"gpi%dReportThreshold\":\"0\",\"gpi%dEventBurst\":\"20\","
+                 "\"gpi%dEventsPerMin\":\"600\"",
+                 n, n, n, n);
+        body += field;
+    }
+    for (int n = 1; n <= GPO_PIN_COUNT; n++) {
+        snprintf(field, sizeof(field),
+                 ",\"gpo%dGpio\":%d,\"gpo%dEnabled\":true,\"gpo%dInvert\":false,\"gpo%dRule\":\"GPI%d & !GPI%d\"",
+                 n, 15 + n, n, n, n, n, n + 1);
+        body += field;
+    }
+    for (int n = 1; n <= GPIO_EXPANDER_COUNT; n++) {
+        snprintf(field, sizeof(field),
+                 ",\"exp%dEnabled\":false,\"exp%dAddress\":%d,\"exp%dIntGpio\":255,\"exp%dInputMask\":\"65535\","
+                 "\"exp%dInvertMask\":\"0\",\"exp%dPullUpMask\":\"65535\"",
+                 n, n, 0x1F + n, n, n, n, n);
+        body += field;
+        snprintf(field, sizeof(field),
+                 ",\"exp%dDebounceUs\":\"50000\",\"exp%dEdges\":0,\"exp%dEventBurst\":\"20\",\"exp%dEventsPerMin\":\"600\"",
+                 n, n, n, n);
+        body += field;
+    }
+    return body + "}";
+}
+
+static void report_allocs(benchmark::State &state, uint64_t before) {
+    state.counters["allocs/op"] =
+        benchmark::Counter(double(bench_alloc_count() - before), benchmark::Counter::kAvgIterations);
+}
+
+static void BM_ConstructMessage(benchmark::State &state) {
+    char msg[256];
+    uint64_t before = bench_alloc_count();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(construct_message("GPI01", "HIGH", "operator", "secret", msg, sizeof(msg)));
+    }
+    report_allocs(state, before);
+}
+BENCHMARK(BM_ConstructMessage);
+
+// Credentials that need escaping take the slow path of the string writer
+static void BM_ConstructMessageEscaped(benchmark::State &state) {
+    char msg[256];
+    uint64_t before = bench_alloc_count();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(construct_message("GPI01", "HIGH", "op\"er\\ator", "se\tcret\n", msg, sizeof(msg)));
+    }
+    report_allocs(state, before);
+}
+BENCHMARK(BM_ConstructMessageEscaped);
+
+static void BM_ConstructCounterMessage(benchmark::State &state) {
+    char msg[256];
+    uint64_t before = bench_alloc_count();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(construct_counter_message("GPI03", 1234567, 250, 1000, 250.0, 125.0, "operator",
+                                                           "secret", msg, sizeof(msg)));
+    }
+    report_allocs(state, before);
+}
+BENCHMARK(BM_ConstructCounterMessage);
+
+#if BENCH_TCP_CLIENT
+// generate_sync_response for the 8 GPIs and 5 GPOs with nothing suppressed or quarantined, the
+// common case
+static void BM_SyncResponse(benchmark::State &state) {
+    char msg[512];
+    uint64_t before = bench_alloc_count();
+    for (auto _ : state) {
+        bench_generate_sync_response(msg, sizeof(msg));
+        benchmark::DoNotOptimize(msg);
+    }
+    report_allocs(state, before);
+}
+BENCHMARK(BM_SyncResponse);
+
+// A GPO command as the controller sends it, from the cJSON parse to the pin, alternating levels
+static void BM_ProcessGpoCommand(benchmark::State &state) {
+    static const char *const commands[2] = { "{\"event\":\"GPO-2\",\"state\":\"HIGH\"}",
+                                             "{\"event\":\"GPO-2\",\"state\":\"LOW\"}" };
+    int i = 0;
+    uint64_t before = bench_alloc_count();
+    for (auto _ : state) {
+        bench_process_incoming_command(commands[i]);
+        i ^= 1;
+    }
+    report_allocs(state, before);
+}
+BENCHMARK(BM_ProcessGpoCommand);
+
+// A sync request: parse, build the response, send. Nothing is connected, so the send fails at
+// once and the case measures everything before the socket.
+static void BM_ProcessSyncRequest(benchmark::State &state) {
+    uint64_t before = bench_alloc_count();
+    for (auto _ : state) {
+        bench_process_incoming_command("{\"event\":\"sync\",\"state\":\"request\"}");
+    }
+    report_allocs(state, before);
+}
+BENCHMARK(BM_ProcessSyncRequest);
+
+// What on_http_config_change does with httpUrl once per config change
+#define HTTP_URL "http://10.0.0.3:8080/hooks/gpio-box/events"
+static void BM_ParseUrl(benchmark::State &state) {
+    uint64_t before = bench_alloc_count();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bench_parse_url(HTTP_URL));
+    }
+    report_allocs(state, before);
+}
+BENCHMARK(BM_ParseUrl);
+#endif
+
+// Counts the reply bytes serve_file hands to the httpd
+static void count_reply(const char *data, size_t len, void *arg) {
+    (void)data;
+    *(size_t *)arg += len;
+}
+
+// The config page: index.html read from spiffs_data and every {{placeholder}} filled from a config
+// snapshot, sent in 512 byte chunks. The file reads are in the numbers, the sends are not.
+static void BM_ServeConfigPage(benchmark::State &state) {
+    httpd_req_t req = {};
+    size_t bytes = 0;
+    uint64_t before = bench_alloc_count();
+    for (auto _ : state) {
+        host_httpd_req_begin(&req, count_reply, &bytes);
+        if (serve_file(&req, "index.html") != ESP_OK) {
+            state.SkipWithError("index.html not served");
+            break;
+        }
+    }
+    report_allocs(state, before);
+    state.SetBytesProcessed(int64_t(bytes));
+}
+BENCHMARK(BM_ServeConfigPage);
+
+#if BENCH_CJSON_BASELINE
+static void BM_ConstructMessage_cJSON(benchmark::State &state) {
+    char msg[256];
+    uint64_t before = bench_alloc_count();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(construct_message_cjson("GPI01", "HIGH", "operator", "secret", msg, sizeof(msg)));
+    }
+    report_allocs(state, before);
+}
+BENCHMARK(BM_ConstructMessage_cJSON);
+
+static void BM_ConstructMessageEscaped_cJSON(benchmark::State &state) {
+    char msg[256];
+    uint64_t before = bench_alloc_count();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            construct_message_cjson("GPI01", "HIGH", "op\"er\\ator", "se\tcret\n", msg, sizeof(msg)));
+    }
+    report_allocs(state, before);
+}
+BENCHMARK(BM_ConstructMessageEscaped_cJSON);
+
+static void BM_SyncResponse_cJSON(benchmark::State &state) {
+    char msg[512];
+    uint64_t before = bench_alloc_count();
+    for (auto _ : state) {
+        sync_response_cjson(gpi_states, GPI_PIN_COUNT, gpo_states, GPO_PIN_COUNT, msg, sizeof(msg));
+        benchmark::DoNotOptimize(msg);
+    }
+    report_allocs(state, before);
+}
+BENCHMARK(BM_SyncResponse_cJSON);
+
+// The rewrite promised byte-identical output, refuse to compare numbers if it isn't
+static void check_same_output(void) {
+    char a[512], b[512];
+    construct_message("GPI01", "HIGH", "op\"er\\ator", "se\tcret\n\x01", a, sizeof(a));
+    construct_message_cjson("GPI01", "HIGH", "op\"er\\ator", "se\tcret\n\x01", b, sizeof(b));
+    if (strcmp(a, b) != 0) {
+        fprintf(stderr, "construct_message differs from cJSON:\n%s\n%s\n", a, b);
+        exit(1);
+    }
+    bench_generate_sync_response(a, sizeof(a));
+    sync_response_cjson(gpi_states, GPI_PIN_COUNT, gpo_states, GPO_PIN_COUNT, b, sizeof(b));
+    if (strcmp(a, b) != 0) {
+        fprintf(stderr, "sync response differs from cJSON:\n%s\n%s\n", a, b);
+        exit(1);
+    }
+}
+#endif
+
+// The handle_save_config JSON walk over a full form, into a staged copy of the config
+static void BM_ParseConfigJson(benchmark::State &state) {
+    std::string body = save_body();
+    AppConfig staged = {};
+    uint64_t before = bench_alloc_count();
+    for (auto _ : state) {
+        if (parse_config_json(body.data(), body.size(), &staged) != ESP_OK) {
+            state.SkipWithError("body rejected");
+            break;
+        }
+        benchmark::DoNotOptimize(staged);
+    }
+    report_allocs(state, before);
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(body.size()));
+}
+BENCHMARK(BM_ParseConfigJson);
+
+// The factory config with its pins up, two GPOs set
+static void setup(void) {
+    host_nvs_reset();
+    host_spiffs_mount("/spiffs_data", SPIFFS_DATA_DIR);
+    if (init_config() != ESP_OK || load_config() != ESP_OK || event_journal_init() != ESP_OK ||
+        init_gpio_pins() != ESP_OK) {
+        fprintf(stderr, "setup failed\n");
+        exit(1);
+    }
+    trigger_gpo(2, true);
+    trigger_gpo(5, true);
+    for (int i = 0; i < GPI_PIN_COUNT; i++) gpi_states[i] = get_gpi_state(i);
+    for (int i = 0; i < GPO_PIN_COUNT; i++) gpo_states[i] = get_gpo_state(i);
+#if BENCH_TCP_CLIENT
+    if (bench_parse_url(HTTP_URL) != 8080) {
+        fprintf(stderr, "parse_url rejected %s\n", HTTP_URL);
+        exit(1);
+    }
+#endif
+}
+
+int main(int argc, char **argv) {
+    esp_log_level_set("*", ESP_LOG_NONE);
+    setup();
+#if BENCH_CJSON_BASELINE
+    check_same_output();
+#endif
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    host_nvs_reset();
+    return 0;
+}
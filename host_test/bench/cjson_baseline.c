@@ -0,0 +1,54 @@
+// Verbatim apart from the names and the pin state arguments, see cjson_baseline.h
+
+#include "cjson_baseline.h"
+#include "cJSON.h"
+#include <stdio.h>
+#include <string.h>
+
+char *construct_message_cjson(const char *event, const char *state, const char *user, const char *password,
+                              char *out_buffer, size_t buffer_size) {
+    cJSON *root = cJSON_CreateObject();
+    if (!root) return NULL;
+
+    cJSON_AddStringToObject(root, "event", event);
+    cJSON_AddStringToObject(root, "state", state);
+    cJSON_AddStringToObject(root, "user", user);
+    cJSON_AddStringToObject(root, "password", password);
+
+    if (!cJSON_PrintPreallocated(root, out_buffer, buffer_size, 0)) {
+        cJSON_Delete(root);
+        return NULL;
+    }
+
+    cJSON_Delete(root);
+    return out_buffer;
+}
+
+void sync_response_cjson(const bool *gpi_states, int gpiCount, const bool *gpo_states, int gpoCount,
+                         char *out_json, size_t max_len) {
+    cJSON *root = cJSON_CreateObject();
+    cJSON *gpi = cJSON_CreateObject();
+    cJSON *gpo = cJSON_CreateObject();
+
+    for (int i = 0; i < gpiCount; i++) {
+        char key[8];
+        snprintf(key, sizeof(key), "GPI-%d", i + 1);
+        cJSON_AddStringToObject(gpi, key, gpi_states[i] ? "HIGH" : "LOW");
+    }
+
+    for (int i = 0; i < gpoCount; i++) {
+        char key[8];
+        snprintf(key, sizeof(key), "GPO-%d", i + 1);
+        cJSON_AddStringToObject(gpo, key, gpo_states[i] ? "HIGH" : "LOW");
+    }
+
+    cJSON_AddStringToObject(root, "event", "sync-response");
+    cJSON_AddItemToObject(root, "gpi", gpi);
+    cJSON_AddItemToObject(root, "gpo", gpo);
+
+    if (!cJSON_PrintPreallocated(root, out_json, max_len, 0)) {
+        strcpy(out_json, "{\"event\":\"sync-response\",\"error\":\"buffer-too-small\"}");
+    }
+
+    cJSON_Delete(root);
+}
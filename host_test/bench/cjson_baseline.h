@@ -0,0 +1,11 @@
+#pragma once
+
+// The cJSON serializers message_builder and tcp_client used before JsonWriter, kept as the
+// baseline for bench_hot_paths. Only built when a cJSON source or library is found.
+
+#include <stdbool.h>
+#include <stddef.h>
+
+char *construct_message_cjson(const char *event, const char *state, const char *user, const char *password,
+                              char *out_buffer, size_t buffer_size);
+void sync_response_cjson(const bool *gpi, int gpiCount, const bool *gpo, int gpoCount, char *out_json, size_t max_len);
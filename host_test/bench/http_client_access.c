@@ -0,0 +1,10 @@
+// http_client.c built into bench_hot_paths through this file, so the benchmarks can call its
+// static URL parser
+
+#include "../../components/http_client/http_client.c"
+
+// The parsed port, -1 when the URL is rejected
+int bench_parse_url(const char *url) {
+    UrlParts parts;
+    return parse_url(url, &parts) == ESP_OK ? parts.port : -1;
+}
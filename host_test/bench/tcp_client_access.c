@@ -0,0 +1,12 @@
+// tcp_client.c built into bench_hot_paths through this file, so the benchmarks can call its
+// static command and sync response code
+
+#include "../../components/tcp_client/tcp_client.c"
+
+void bench_generate_sync_response(char *out_json, size_t max_len) {
+    generate_sync_response(out_json, max_len);
+}
+
+void bench_process_incoming_command(const char *data) {
+    process_incoming_command(data);
+}
@@ -0,0 +1,79 @@
+// Fake gpi_counter and gpio_expander backends
+
+#include "fakes.h"
+#include "gpi_counter.h"
+#include "gpio_expander.h"
+#include <pthread.h>
+
+volatile uint64_t fake_counter_total;
+
+esp_err_t gpi_counter_start(GpiCounter *counter, const GpiPinConfig *cfg) {
+    counter->total = 0;
+    return ESP_OK;
+}
+
+void gpi_counter_stop(GpiCounter *counter) {
+}
+
+uint64_t gpi_counter_read(GpiCounter *counter) {
+    return fake_counter_total;
+}
+
+static volatile uint16_t expander_levels[GPIO_EXPANDER_COUNT] = { 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF };
+static volatile int expander_starts[GPIO_EXPANDER_COUNT];
+static volatile int expander_stops[GPIO_EXPANDER_COUNT];
+
+void fake_expander_set(int slot, uint16_t levels) {
+    __atomic_store_n(&expander_levels[slot], levels, __ATOMIC_RELEASE);
+}
+
+int fake_expander_starts(int slot) {
+    return __atomic_load_n(&expander_starts[slot], __ATOMIC_ACQUIRE);
+}
+
+int fake_expander_stops(int slot) {
+    return __atomic_load_n(&expander_stops[slot], __ATOMIC_ACQUIRE);
+}
+
+static pthread_mutex_t hold_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t hold_changed = PTHREAD_COND_INITIALIZER;
+static int hold_start;
+static int held;
+
+void fake_expander_hold(int hold) {
+    pthread_mutex_lock(&hold_lock);
+    hold_start = hold;
+    pthread_cond_broadcast(&hold_changed);
+    pthread_mutex_unlock(&hold_lock);
+}
+
+int fake_expander_held(void) {
+    pthread_mutex_lock(&hold_lock);
+    int blocked = held;
+    pthread_mutex_unlock(&hold_lock);
+    return blocked;
+}
+
+esp_err_t gpio_expander_start(GpioExpander *exp, int slot, const ExpanderConfig *cfg) {
+    pthread_mutex_lock(&hold_lock);
+    held = hold_start;
+    while (hold_start) pthread_cond_wait(&hold_changed, &hold_lock);
+    held = 0;
+    pthread_mutex_unlock(&hold_lock);
+
+    exp->slot = slot;
+    exp->dev = (void *)&expander_levels[slot];
+    __atomic_fetch_add(&expander_starts[slot], 1, __ATOMIC_RELEASE);
+    return ESP_OK;
+}
+
+void gpio_expander_stop(GpioExpander *exp) {
+    if (exp->dev) __atomic_fetch_add(&expander_stops[exp->slot], 1, __ATOMIC_RELEASE);
+    exp->dev = NULL;
+}
+
+esp_err_t gpio_expander_read(GpioExpander *exp, uint16_t *levels) {
+    if (!exp->dev) return ESP_ERR_INVALID_STATE;
+    *levels = __atomic_load_n(&expander_levels[exp->slot], __ATOMIC_ACQUIRE);
+    return ESP_OK;
+}
@@ -0,0 +1,60 @@
+// Fake net_state: a single port whose state the test sets, listeners are called from the caller
+
+#include "fakes.h"
+#include "net_state.h"
+#include <stdio.h>
+
+#define MAX_LISTENERS 4
+
+static volatile bool up = true;
+static NetStateListener listeners[MAX_LISTENERS];
+static int listener_count;
+
+void fake_net_state_set_up(bool isUp) {
+    up = isUp;
+    for (int i = 0; i < listener_count; i++) listeners[i](isUp, isUp ? 0 : NET_STATE_NO_PORT);
+}
+
+esp_err_t net_state_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t net_state_add_port(uint8_t port, esp_eth_handle_t eth, esp_netif_t *netif) {
+    return ESP_OK;
+}
+
+esp_err_t net_state_subscribe(NetStateListener listener) {
+    if (listener_count == MAX_LISTENERS) return ESP_ERR_NO_MEM;
+    listeners[listener_count++] = listener;
+    return ESP_OK;
+}
+
+bool net_state_is_up(void) {
+    return up;
+}
+
+bool net_state_port_up(int port) {
+    return up && port == 0;
+}
+
+int net_state_active_port(void) {
+    return up ? 0 : NET_STATE_NO_PORT;
+}
+
+int net_state_up_count(void) {
+    return up ? 1 : 0;
+}
+
+int net_state_port_for_ip(uint32_t ip) {
+    return 0;
+}
+
+bool net_state_port_ifname(int port, char *name, size_t size) {
+    if (port != 0) return false;
+    snprintf(name, size, "lo");
+    return true;
+}
+
+bool net_state_wait_up(TickType_t timeout) {
+    return up;
+}
@@ -0,0 +1,85 @@
+// Fake tcp_client and http_client: messages are recorded instead of sent
+
+#include "fakes.h"
+#include "tcp_client.h"
+#include "http_client.h"
+#include "event_journal.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#define FAKE_SINK_MAX 256
+
+static pthread_mutex_t sink_lock = PTHREAD_MUTEX_INITIALIZER;
+static char messages[2][FAKE_SINK_MAX][256];
+static int message_count[2];
+static esp_err_t fail_with = ESP_OK;
+static bool tcp_running;
+
+static esp_err_t record(int sink, const char *msg) {
+    pthread_mutex_lock(&sink_lock);
+    esp_err_t err = fail_with;
+    if (err == ESP_OK && message_count[sink] < FAKE_SINK_MAX) {
+        snprintf(messages[sink][message_count[sink]++], sizeof(messages[0][0]), "%s", msg);
+    }
+    pthread_mutex_unlock(&sink_lock);
+    return err;
+}
+
+int fake_sink_count(int sink) {
+    pthread_mutex_lock(&sink_lock);
+    int count = message_count[sink];
+    pthread_mutex_unlock(&sink_lock);
+    return count;
+}
+
+const char *fake_sink_message(int sink, int i) {
+    static char copy[256];
+    pthread_mutex_lock(&sink_lock);
+    snprintf(copy, sizeof(copy), "%s", i < message_count[sink] ? messages[sink][i] : "");
+    pthread_mutex_unlock(&sink_lock);
+    return copy;
+}
+
+void fake_sink_fail(esp_err_t err) {
+    pthread_mutex_lock(&sink_lock);
+    fail_with = err;
+    pthread_mutex_unlock(&sink_lock);
+}
+
+esp_err_t start_tcp_client_service(TcpClientMode mode) {
+    tcp_running = true;
+    return ESP_OK;
+}
+
+esp_err_t stop_tcp_client_service(void) {
+    tcp_running = false;
+    return ESP_OK;
+}
+
+bool tcp_client_is_running(void) {
+    return tcp_running;
+}
+
+esp_err_t tcp_client_send(const char *json_data) {
+    return record(FAKE_SINK_TCP, json_data);
+}
+
+esp_err_t init_http_client(void) {
+    return ESP_OK;
+}
+
+esp_err_t send_http_post(const char *json_data) {
+    return record(FAKE_SINK_HTTP, json_data);
+}
+
+esp_err_t send_http_event(const char *json_data, uint8_t gpi, uint8_t level, int64_t edgeUs) {
+    esp_err_t err = record(FAKE_SINK_HTTP, json_data);
+    if (err != ESP_OK) event_journal_append(JOURNAL_SINK_BIT(JOURNAL_SINK_HTTP), gpi, level);
+    return err;
+}
+
+esp_err_t send_http_post_sync(const char *json_data) {
+    return record(FAKE_SINK_HTTP, json_data);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+// Fakes for the components a host test links instead of the real ones: the TCP and HTTP sinks,
+// the PCNT pulse counter, the expander backend and the network state. Test hooks are prefixed fake_.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// tcp_client / http_client: every message sent is kept in order, sends fail with fake_sink_fail()
+#define FAKE_SINK_TCP  0
+#define FAKE_SINK_HTTP 1
+
+int fake_sink_count(int sink);
+const char *fake_sink_message(int sink, int i);     // copied, valid until the next send
+void fake_sink_fail(esp_err_t err);                 // ESP_OK to deliver again
+
+// gpi_counter: every running counter reads fake_counter_total
+extern volatile uint64_t fake_counter_total;
+
+// gpio_expander: 16 input levels per slot, idle high
+void fake_expander_set(int slot, uint16_t levels);
+int fake_expander_starts(int slot);
+int fake_expander_stops(int slot);
+void fake_expander_hold(int hold);      // while set, gpio_expander_start blocks like a hung I2C bus
+int fake_expander_held(void);           // a start is blocked right now
+
+// net_state: one port, up until fake_net_state_set_up(false)
+void fake_net_state_set_up(bool up);
@@ -0,0 +1,417 @@
+// Edge-to-delivery harness: injects timestamped edge patterns into gpio_handler through the GPIO
+// shim and times each GPI message until it arrives at a local stand-in receiver for the TCP,
+// HTTP and serial sinks. Reports p50/p99/p999 latency, throughput and loss per pattern and sink,
+// as a table and as JSON for comparing firmware versions.
+//
+//   edge_harness [--quick] [--out results.json] [--pattern <name>] [--sink tcp|http|serial]
+//
+// Every pin runs with debounceUs 0 and no event rate limit, so the numbers are the firmware's
+// own pipeline (ISR queue, gpio_task, message build, sink hand-off) plus the host loopback.
+// Each pattern x sink runs in its own forked process, like a fresh boot.
+
+#include "app_config.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "event_journal.h"
+#include "event_trace.h"
+#include "gpio_handler.h"
+#include "http_client.h"
+#include "metrics.h"
+#include "nvs.h"
+#include "receivers.h"
+#include "tcp_client.h"
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION "unknown"
+#endif
+
+#define MAX_EDGES   4096    // per run, the khz pattern injects 2000
+// A run ends once every built message arrived and nothing was built for SETTLE_US (the last
+// edges may still be queued for gpio_task), or when nothing happened at all for IDLE_END_US
+#define SETTLE_US   50000
+#define IDLE_END_US 500000
+#define CONNECT_TIMEOUT_US 2000000  // tcp_client connects from its own task
+
+typedef enum {
+    SINK_TCP,
+    SINK_HTTP,
+    SINK_SERIAL,
+    SINK_KIND_COUNT
+} SinkKind;
+
+static const char *const sink_names[SINK_KIND_COUNT] = { "tcp", "http", "serial" };
+
+typedef struct {
+    const char *name;
+    void (*inject)(int scale);  // scale 10 for --quick: a tenth of the edges
+} Pattern;
+
+// One run, passed from the child to the parent over a pipe
+typedef struct {
+    bool ok;                    // the firmware and the receiver came up
+    uint32_t edges;
+    uint32_t delivered;
+    uint32_t lost;              // edges the receiver never heard about: edges - delivered
+    uint32_t undelivered;       // of those, messages built but never received
+    uint32_t spurious;          // messages that matched no built event
+    int64_t p50Us, p99Us, p999Us, maxUs;
+    double throughput;          // delivered messages per second, first edge to last arrival
+    uint32_t queueOverflows;
+    uint32_t debounceDrops;
+    uint32_t suppressed;
+    uint32_t journaled;
+    uint32_t sinkFailed;
+} RunResult;
+
+//*************** Edge book-keeping *****************************//
+// A message carries only pin and level, so which edge it reports comes from the firmware: the
+// harness replaces event_trace and keeps, per pin, the event ID (the ISR time of the edge that
+// opened the debounce window) of every message built. Arrivals pop those in order. Reports on a
+// pin alternate HIGH/LOW starting with HIGH (pins idle low), which pairs them up even when HTTP
+// posts overtake each other.
+
+typedef struct {
+    int64_t edgeUs;
+    uint8_t level;
+} BuiltEvent;
+
+typedef struct {
+    BuiltEvent events[MAX_EDGES];
+    int head, tail;
+} PinFifo;
+
+static pthread_mutex_t match_lock = PTHREAD_MUTEX_INITIALIZER;
+static PinFifo fifos[GPI_PIN_COUNT];
+static int64_t latencies[MAX_EDGES];
+static uint32_t edge_count, built, delivered, spurious;
+static int64_t first_edge_us, last_arrival_us;
+
+static uint8_t gpi_gpio[GPI_PIN_COUNT];
+static uint8_t gpi_level[GPI_PIN_COUNT];
+
+void event_trace_at(TraceStage stage, uint8_t gpi, TraceSink sink, int64_t eventUs, int64_t atUs) {
+    if (stage != TRACE_BUILT || gpi >= GPI_PIN_COUNT) return;
+    pthread_mutex_lock(&match_lock);
+    PinFifo *fifo = &fifos[gpi];
+    if (fifo->tail < MAX_EDGES) {
+        fifo->events[fifo->tail] = (BuiltEvent){ .edgeUs = eventUs, .level = fifo->tail % 2 == 0 };
+        fifo->tail++;
+        built++;
+    }
+    pthread_mutex_unlock(&match_lock);
+}
+
+static void on_arrival(int gpi, int level, int64_t arrivalUs) {
+    pthread_mutex_lock(&match_lock);
+    last_arrival_us = arrivalUs;
+    PinFifo *fifo = gpi < GPI_PIN_COUNT ? &fifos[gpi] : NULL;
+    int i = fifo ? fifo->head : 0;
+    while (fifo && i < fifo->tail && fifo->events[i].level != level) i++;
+    if (fifo && i < fifo->tail) {
+        BuiltEvent ev = fifo->events[i];
+        memmove(&fifo->events[fifo->head + 1], &fifo->events[fifo->head], (i - fifo->head) * sizeof(ev));
+        fifo->head++;
+        latencies[delivered++] = arrivalUs - ev.edgeUs;
+    } else {
+        spurious++;
+    }
+    pthread_mutex_unlock(&match_lock);
+}
+
+// Built messages that have not arrived yet
+static uint32_t in_flight(void) {
+    uint32_t pending = 0;
+    for (int i = 0; i < GPI_PIN_COUNT; i++) pending += fifos[i].tail - fifos[i].head;
+    return pending;
+}
+
+// Sleeps rather than spins until atUs: on a single core a spinning injector starves gpio_task
+static void sleep_until(int64_t atUs) {
+    int64_t wait = atUs - esp_timer_get_time();
+    if (wait <= 0) return;
+    struct timespec ts = { .tv_sec = wait / 1000000, .tv_nsec = (wait % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+// Toggles GPI gpi (0-based) at atUs
+static void inject(int gpi, int64_t atUs) {
+    sleep_until(atUs);
+    gpi_level[gpi] = !gpi_level[gpi];
+    pthread_mutex_lock(&match_lock);
+    if (edge_count++ == 0) first_edge_us = esp_timer_get_time();
+    pthread_mutex_unlock(&match_lock);
+    host_gpio_drive(gpi_gpio[gpi], gpi_level[gpi]);
+}
+
+//*************** Patterns *****************************//
+
+// Isolated edges on GPI1, 5 ms apart
+static void pattern_single(int scale) {
+    int64_t t = esp_timer_get_time();
+    for (int i = 0; i < 200 / scale; i++) inject(0, t += 5000);
+}
+
+// Bursts of 8 edges 100 us apart on GPI1, 20 ms between bursts
+static void pattern_burst(int scale) {
+    int64_t t = esp_timer_get_time();
+    for (int b = 0; b < 50 / scale; b++) {
+        t += 20000;
+        for (int i = 0; i < 8; i++) inject(0, t + i * 100);
+    }
+}
+
+// All 8 GPIs toggled back to back, every 10 ms
+static void pattern_all8(int scale) {
+    int64_t t = esp_timer_get_time();
+    for (int r = 0; r < 100 / scale; r++) {
+        t += 10000;
+        for (int i = 0; i < GPI_PIN_COUNT; i++) inject(i, t);
+    }
+}
+
+// GPI1 toggled every 1 ms (1000 edges/s) for 2 s
+static void pattern_khz(int scale) {
+    int64_t t = esp_timer_get_time();
+    for (int i = 0; i < 2000 / scale; i++) inject(0, t += 1000);
+}
+
+static const Pattern patterns[] = {
+    { "single", pattern_single },
+    { "burst", pattern_burst },
+    { "all8", pattern_all8 },
+    { "khz", pattern_khz },
+};
+#define PATTERN_COUNT (sizeof(patterns) / sizeof(patterns[0]))
+
+//*************** One run *****************************//
+
+// Factory config with every GPI reporting each edge to the one sink under test
+static bool start_firmware(SinkKind sink, int port) {
+    if (init_config() != ESP_OK || load_config() != ESP_OK) return false;
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    for (int i = 0; i < GPI_PIN_COUNT; i++) {
+        cfg.gpi[i].enabled = 1;
+        cfg.gpi[i].invert = 0;
+        cfg.gpi[i].mode = GPI_MODE_LEVEL;
+        cfg.gpi[i].edges = PIN_EDGES_BOTH;
+        cfg.gpi[i].debounceUs = 0;
+        cfg.gpi[i].eventBurst = 0;
+        gpi_gpio[i] = cfg.gpi[i].gpio;
+    }
+    cfg.companionMode = 0;
+    cfg.tcpEnabled = sink == SINK_TCP;
+    cfg.tcpIp = htonl(INADDR_LOOPBACK);
+    cfg.tcpPort = port;
+    cfg.tcpUser[0] = cfg.tcpPassword[0] = '\0';
+    cfg.httpEnabled = sink == SINK_HTTP;
+    snprintf(cfg.httpUrl, sizeof(cfg.httpUrl), "http://127.0.0.1:%d/edge", port);
+    cfg.httpUser[0] = cfg.httpPassword[0] = '\0';
+    cfg.serialEnabled = sink == SINK_SERIAL;
+    if (apply_config(&cfg) != ESP_OK || event_journal_init() != ESP_OK) return false;
+    if (sink == SINK_HTTP && init_http_client() != ESP_OK) return false;
+    if (sink == SINK_TCP) {
+        // apply_config started tcp_client, edges before it connected would only be journaled
+        int64_t until = esp_timer_get_time() + CONNECT_TIMEOUT_US;
+        while (receiver_tcp_connections() == 0 && esp_timer_get_time() < until) {
+            sleep_until(esp_timer_get_time() + 1000);
+        }
+        if (!tcp_client_is_running() || receiver_tcp_connections() == 0) return false;
+    }
+    return init_gpio_pins() == ESP_OK;
+}
+
+static int64_t percentile(const int64_t *sorted, uint32_t n, double q) {
+    if (n == 0) return 0;
+    uint32_t rank = (uint32_t)(q * n + 0.999999);
+    return sorted[rank ? rank - 1 : 0];
+}
+
+static int compare_latency(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static RunResult run(const Pattern *pattern, SinkKind sink, int scale) {
+    RunResult result = { 0 };
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    int port = 0;
+    if (sink == SINK_SERIAL) {
+        // The serial sink is printf: stdout becomes a pipe into the receiver
+        int fds[2];
+        if (pipe(fds) != 0 || dup2(fds[1], STDOUT_FILENO) < 0) return result;
+        close(fds[1]);
+        setvbuf(stdout, NULL, _IONBF, 0);
+        if (receiver_start_serial(fds[0], on_arrival) != 0) return result;
+    } else {
+        port = sink == SINK_TCP ? receiver_start_tcp(on_arrival) : receiver_start_http(on_arrival);
+        if (port < 0) return result;
+    }
+    if (!start_firmware(sink, port)) return result;
+    result.ok = true;
+
+    pattern->inject(scale);
+
+    int64_t idle_since = esp_timer_get_time();
+    uint32_t seen = 0;
+    for (;;) {
+        pthread_mutex_lock(&match_lock);
+        uint32_t pending = in_flight();
+        uint32_t activity = built + delivered + spurious;
+        pthread_mutex_unlock(&match_lock);
+        int64_t now = esp_timer_get_time();
+        if (activity != seen) {
+            seen = activity;
+            idle_since = now;
+        }
+        if ((pending == 0 && now - idle_since >= SETTLE_US) || now - idle_since >= IDLE_END_US) break;
+        sleep_until(now + 1000);
+    }
+
+    pthread_mutex_lock(&match_lock);
+    result.edges = edge_count;
+    result.delivered = delivered;
+    result.lost = edge_count > delivered ? edge_count - delivered : 0;
+    result.undelivered = in_flight();
+    result.spurious = spurious;
+    qsort(latencies, delivered, sizeof(latencies[0]), compare_latency);
+    result.p50Us = percentile(latencies, delivered, 0.50);
+    result.p99Us = percentile(latencies, delivered, 0.99);
+    result.p999Us = percentile(latencies, delivered, 0.999);
+    result.maxUs = delivered ? latencies[delivered - 1] : 0;
+    if (delivered && last_arrival_us > first_edge_us) {
+        result.throughput = delivered * 1e6 / (double)(last_arrival_us - first_edge_us);
+    }
+    pthread_mutex_unlock(&match_lock);
+
+    static const MetricId failed[SINK_KIND_COUNT] = { METRIC_SINK_TCP_FAILED, METRIC_SINK_HTTP_FAILED,
+                                                      METRIC_SINK_SERIAL_FAILED };
+    result.queueOverflows = metrics_get(METRIC_GPI_QUEUE_OVERFLOWS);
+    result.debounceDrops = metrics_get(METRIC_GPI_DEBOUNCE_DROPS);
+    result.suppressed = metrics_get(METRIC_GPI_EVENTS_SUPPRESSED);
+    result.journaled = metrics_get(METRIC_JOURNAL_APPENDED);
+    result.sinkFailed = metrics_get(failed[sink]);
+    return result;
+}
+
+// Forks so every run starts from zeroed module statics and factory NVS, like after a reboot
+static bool run_forked(const Pattern *pattern, SinkKind sink, int scale, RunResult *result) {
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    host_nvs_reset();
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        RunResult r = run(pattern, sink, scale);
+        ssize_t written = write(fds[1], &r, sizeof(r));
+        _exit(written == sizeof(r) ? 0 : 1);   // sink and receiver threads are still running
+    }
+    close(fds[1]);
+    ssize_t got = pid > 0 ? read(fds[0], result, sizeof(*result)) : -1;
+    close(fds[0]);
+    if (pid > 0) waitpid(pid, NULL, 0);
+    return got == sizeof(*result) && result->ok;
+}
+
+//*************** Report *****************************//
+
+static void write_json(FILE *out, int scale, const RunResult *results, const bool *selected) {
+    fprintf(out, "{\"firmware\":\"%s\",\"quick\":%s,\"results\":[", FIRMWARE_VERSION, scale > 1 ? "true" : "false");
+    bool first = true;
+    for (size_t p = 0; p < PATTERN_COUNT; p++) {
+        for (int s = 0; s < SINK_KIND_COUNT; s++) {
+            const RunResult *r = &results[p * SINK_KIND_COUNT + s];
+            if (!selected[p * SINK_KIND_COUNT + s]) continue;
+            fprintf(out, "%s\n  {\"pattern\":\"%s\",\"sink\":\"%s\",\"ok\":%s,\"edges\":%u,\"delivered\":%u,"
+                    "\"lost\":%u,\"undelivered\":%u,\"spurious\":%u,",
+                    first ? "" : ",", patterns[p].name, sink_names[s], r->ok ? "true" : "false",
+                    r->edges, r->delivered, r->lost, r->undelivered, r->spurious);
+            fprintf(out, "\"latency_us\":{\"p50\":%lld,\"p99\":%lld,\"p999\":%lld,\"max\":%lld},"
+                    "\"throughput_per_s\":%.1f,",
+                    (long long)r->p50Us, (long long)r->p99Us, (long long)r->p999Us, (long long)r->maxUs, r->throughput);
+            fprintf(out, "\"loss\":{\"queue_overflows\":%u,\"debounce_drops\":%u,\"suppressed\":%u,"
+                    "\"journaled\":%u,\"sink_failed\":%u}}",
+                    r->queueOverflows, r->debounceDrops, r->suppressed, r->journaled, r->sinkFailed);
+            first = false;
+        }
+    }
+    fprintf(out, "\n]}\n");
+}
+
+static void print_row(const char *pattern, const char *sink, const RunResult *r) {
+    if (!r->ok) {
+        printf("%-7s %-7s setup failed\n", pattern, sink);
+        return;
+    }
+    printf("%-7s %-7s %6u %6u %5u %8lld %8lld %8lld %8lld %9.1f   q%u d%u u%u j%u f%u\n", pattern, sink,
+           r->edges, r->delivered, r->lost, (long long)r->p50Us, (long long)r->p99Us, (long long)r->p999Us,
+           (long long)r->maxUs, r->throughput, r->queueOverflows, r->debounceDrops, r->undelivered, r->journaled, r->sinkFailed);
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--quick] [--out results.json] [--pattern single|burst|all8|khz] "
+            "[--sink tcp|http|serial]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    int scale = 1;
+    const char *out_path = NULL, *only_pattern = NULL, *only_sink = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            scale = 10;
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--pattern") == 0 && i + 1 < argc) {
+            only_pattern = argv[++i];
+        } else if (strcmp(argv[i], "--sink") == 0 && i + 1 < argc) {
+            only_sink = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    RunResult results[PATTERN_COUNT * SINK_KIND_COUNT] = { 0 };
+    bool selected[PATTERN_COUNT * SINK_KIND_COUNT] = { 0 };
+    int failures = 0, runs = 0;
+    printf("firmware %s%s\n", FIRMWARE_VERSION, scale > 1 ? " (quick)" : "");
+    printf("%-7s %-7s %6s %6s %5s %8s %8s %8s %8s %9s   loss: queue/debounce/undelivered/journaled/failed\n",
+           "pattern", "sink", "edges", "recv", "lost", "p50 us", "p99 us", "p999 us", "max us", "msg/s");
+    for (size_t p = 0; p < PATTERN_COUNT; p++) {
+        if (only_pattern && strcmp(only_pattern, patterns[p].name) != 0) continue;
+        for (int s = 0; s < SINK_KIND_COUNT; s++) {
+            if (only_sink && strcmp(only_sink, sink_names[s]) != 0) continue;
+            size_t i = p * SINK_KIND_COUNT + s;
+            selected[i] = true;
+            runs++;
+            if (!run_forked(&patterns[p], s, scale, &results[i])) failures++;
+            print_row(patterns[p].name, sink_names[s], &results[i]);
+        }
+    }
+    if (runs == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (out_path) {
+        FILE *out = fopen(out_path, "w");
+        if (!out) {
+            perror(out_path);
+            return 1;
+        }
+        write_json(out, scale, results, selected);
+        fclose(out);
+    }
+    // Loss is a result, not a failure: only runs that could not start fail the harness
+    return failures ? 1 : 0;
+}
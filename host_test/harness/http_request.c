@@ -0,0 +1,75 @@
+// Client side of the HTTP load generators
+
+#include "http_request.h"
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+int http_connect(uint16_t port) {
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct timeval timeout = { .tv_sec = 10 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int http_read_response(int fd) {
+    char buf[8192];
+    size_t len = 0;
+    char *end = NULL;
+    while (!end) {
+        if (len == sizeof(buf) - 1) return -1;
+        ssize_t n = recv(fd, buf + len, sizeof(buf) - 1 - len, 0);
+        if (n <= 0) return -1;
+        len += n;
+        buf[len] = '\0';
+        end = strstr(buf, "\r\n\r\n");
+    }
+    int status;
+    if (sscanf(buf, "HTTP/1.1 %d", &status) != 1) return -1;
+    size_t have = len - (end + 4 - buf);
+    end[2] = '\0';  // headers only from here
+
+    const char *length = strcasestr(buf, "\r\nContent-Length:");
+    if (length) {
+        size_t want = strtoul(length + 17, NULL, 10);
+        while (have < want) {
+            ssize_t n = recv(fd, buf, want - have < sizeof(buf) ? want - have : sizeof(buf), 0);
+            if (n <= 0) return -1;
+            have += n;
+        }
+        return status;
+    }
+    if (!strcasestr(buf, "\r\nTransfer-Encoding: chunked")) return status;
+
+    // Chunked: the body ends with the empty chunk. Only the last bytes seen are kept.
+    static const char last[] = "\r\n0\r\n\r\n";
+    char tail[sizeof(last)] = "\r\n";
+    size_t tailLen = 2;  // the empty chunk may be the whole body
+    const char *body = end + 4;
+    for (;;) {
+        for (size_t i = 0; i < have; i++) {
+            if (tailLen == sizeof(last) - 1) {
+                memmove(tail, tail + 1, tailLen - 1);
+                tailLen--;
+            }
+            tail[tailLen++] = body[i];
+        }
+        if (tailLen == sizeof(last) - 1 && memcmp(tail, last, tailLen) == 0) return status;
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) return -1;
+        body = buf;
+        have = n;
+    }
+}
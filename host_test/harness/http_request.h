@@ -0,0 +1,13 @@
+#pragma once
+
+// Client side of the HTTP load generators (web_load, io_jitter): blocking loopback connections,
+// one request at a time
+
+#include <stdint.h>
+
+// Connects to 127.0.0.1:port with TCP_NODELAY and a 10 s receive timeout. The socket or -1.
+int http_connect(uint16_t port);
+
+// Reads one whole reply (Content-Length or chunked), returns its status or -1 when the
+// connection ended first
+int http_read_response(int fd);
@@ -0,0 +1,332 @@
+// Input-to-output jitter under network load: how long a GPI edge takes to drive a GPO through a
+// local rule while httpd is busy, for the task layout this binary was built with (io_jitter_split,
+// io_jitter_unpinned). The host counterpart of the /metrics steps under "Task layout" in README.md.
+//
+//   io_jitter_<layout> [--quick] [--clients N] [--seconds S] [--period-us P] [--out results.json]
+//
+// The real gpio_handler and web_server run on the host shims, the network sinks are fakes. GPI-1
+// has debounce 0 and GPO-1 the rule "GPI1". GPI-1 is toggled every P us and each toggle is timed
+// until gpio_set_level on GPO-1, first with the network idle, then with N clients requesting
+// /metrics and the config page over keep-alive connections.
+//
+// Tasks run on the host CPU numbered like their core (host_task_pin_cores), the toggling thread
+// on core 0 like the GPIO ISR, and the load clients on the CPUs after those. With fewer than two
+// host CPUs every thread shares one and the layouts only differ in name. FreeRTOS priorities are
+// not modelled.
+
+#include "app_config.h"
+#include "driver/gpio.h"
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "esp_spiffs.h"
+#include "esp_timer.h"
+#include "event_journal.h"
+#include "freertos/task.h"
+#include "gpio_handler.h"
+#include "http_request.h"
+#include "nvs.h"
+#include "task_layout.h"
+#include "web_server.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION "unknown"
+#endif
+
+#if CONFIG_TASK_LAYOUT_SPLIT
+#define LAYOUT_NAME "split"
+#else
+#define LAYOUT_NAME "unpinned"
+#endif
+
+#define MAX_EDGES   100000
+#define MAX_CLIENTS 64
+#define OUTPUT_TIMEOUT_US 100000    // a toggle GPO-1 didn't follow by then counts as missed
+#define POLL_US 50
+
+static const char metrics_request[] = "GET /metrics HTTP/1.1\r\nHost: gpiobox\r\n\r\n";
+static const char page_request[] = "GET / HTTP/1.1\r\nHost: gpiobox\r\nCookie: sessionToken=loggedIn\r\n\r\n";
+
+typedef struct {
+    const char *name;
+    int clients;
+    uint32_t edges;
+    uint32_t outputs;           // toggles GPO-1 followed within OUTPUT_TIMEOUT_US
+    int64_t p50Us, p99Us, maxUs;
+    uint32_t requests;          // load requests answered with 200
+    uint32_t failed;            // refused, dropped or answered otherwise
+    double requestsPerSecond;
+} PhaseResult;
+
+typedef struct {
+    uint32_t requests;
+    uint32_t failed;
+} LoadClient;
+
+static uint16_t port;
+static int gpi_gpio, gpo_gpio;
+static volatile bool load_running;
+
+//*************** Output timing *****************************//
+// The toggling thread stores the time and level of each toggle in pending_*, the hook on
+// gpio_set_level takes them when GPO-1 reaches that level. Only gpio_task drives GPO-1, so
+// latencies has a single writer; output_count publishes each entry.
+
+static int64_t pending_edge_us;
+static int pending_level;
+static int64_t latencies[MAX_EDGES];
+static uint32_t output_count;
+
+static void on_set_level(gpio_num_t gpio, int level) {
+    if (gpio != gpo_gpio || level != __atomic_load_n(&pending_level, __ATOMIC_ACQUIRE)) return;
+    int64_t now = esp_timer_get_time();
+    int64_t edge = __atomic_exchange_n(&pending_edge_us, 0, __ATOMIC_ACQ_REL);
+    uint32_t n = __atomic_load_n(&output_count, __ATOMIC_RELAXED);
+    if (!edge || n == MAX_EDGES) return;
+    latencies[n] = now - edge;
+    __atomic_store_n(&output_count, n + 1, __ATOMIC_RELEASE);
+}
+
+// Sleeps rather than spins until atUs: on a single CPU a spinning toggler starves gpio_task
+static void sleep_until(int64_t atUs) {
+    int64_t wait = atUs - esp_timer_get_time();
+    if (wait <= 0) return;
+    struct timespec ts = { .tv_sec = wait / 1000000, .tv_nsec = (wait % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+// Toggles GPI-1 and waits for GPO-1 to follow. True when it did.
+static bool toggle(int level) {
+    uint32_t before = __atomic_load_n(&output_count, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&pending_level, level, __ATOMIC_RELEASE);
+    __atomic_store_n(&pending_edge_us, esp_timer_get_time(), __ATOMIC_RELEASE);
+    host_gpio_drive(gpi_gpio, level);
+
+    int64_t deadline = esp_timer_get_time() + OUTPUT_TIMEOUT_US;
+    while (__atomic_load_n(&output_count, __ATOMIC_ACQUIRE) == before && esp_timer_get_time() < deadline) {
+        sleep_until(esp_timer_get_time() + POLL_US);
+    }
+    __atomic_store_n(&pending_edge_us, 0, __ATOMIC_RELEASE);  // a late output is not counted
+    return __atomic_load_n(&output_count, __ATOMIC_ACQUIRE) != before;
+}
+
+//*************** Network load *****************************//
+
+static void *load_thread(void *arg) {
+    LoadClient *c = arg;
+    int fd = -1;
+    for (uint32_t i = 0; __atomic_load_n(&load_running, __ATOMIC_RELAXED); i++) {
+        if (fd < 0 && (fd = http_connect(port)) < 0) {
+            c->failed++;
+            usleep(1000);  // don't spin on a full backlog
+            continue;
+        }
+        const char *request = i % 2 ? page_request : metrics_request;
+        size_t len = strlen(request);
+        if (send(fd, request, len, MSG_NOSIGNAL) != (ssize_t)len || http_read_response(fd) != 200) {
+            c->failed++;
+            close(fd);
+            fd = -1;
+            continue;
+        }
+        c->requests++;
+    }
+    if (fd >= 0) close(fd);
+    return NULL;
+}
+
+// Load clients keep off the CPUs standing in for the two cores when the host has more
+static void start_load(pthread_t *threads, LoadClient *c, int clients) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (cpus > portNUM_PROCESSORS) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (long cpu = portNUM_PROCESSORS; cpu < cpus; cpu++) CPU_SET(cpu, &set);
+        pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+    }
+    __atomic_store_n(&load_running, true, __ATOMIC_RELAXED);
+    for (int i = 0; i < clients; i++) {
+        c[i] = (LoadClient){ 0 };
+        pthread_create(&threads[i], &attr, load_thread, &c[i]);
+    }
+    pthread_attr_destroy(&attr);
+}
+
+//*************** One phase *****************************//
+
+static int compare_latency(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int64_t percentile(const int64_t *sorted, uint32_t n, double q) {
+    if (n == 0) return 0;
+    uint32_t rank = (uint32_t)(q * n + 0.999999);
+    return sorted[rank ? rank - 1 : 0];
+}
+
+static PhaseResult run_phase(const char *name, int clients, double seconds, int64_t periodUs) {
+    static LoadClient c[MAX_CLIENTS];
+    pthread_t threads[MAX_CLIENTS];
+    PhaseResult r = { .name = name, .clients = clients };
+    __atomic_store_n(&output_count, 0, __ATOMIC_RELEASE);
+    if (clients > 0) {
+        start_load(threads, c, clients);
+        sleep_until(esp_timer_get_time() + 200000);  // let the clients connect
+    }
+
+    static int level;
+    int64_t start = esp_timer_get_time();
+    int64_t end = start + (int64_t)(seconds * 1e6);
+    for (int64_t next = start + periodUs; next < end && r.edges < MAX_EDGES; next += periodUs) {
+        sleep_until(next);
+        level = !level;
+        toggle(level);
+        r.edges++;
+        int64_t now = esp_timer_get_time();
+        if (next + periodUs < now) next = now;  // a missed output took longer than the period
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+
+    if (clients > 0) {
+        __atomic_store_n(&load_running, false, __ATOMIC_RELAXED);
+        for (int i = 0; i < clients; i++) {
+            pthread_join(threads[i], NULL);
+            r.requests += c[i].requests;
+            r.failed += c[i].failed;
+        }
+        r.requestsPerSecond = r.requests * 1e6 / (double)elapsed;
+    }
+
+    r.outputs = __atomic_load_n(&output_count, __ATOMIC_ACQUIRE);
+    qsort(latencies, r.outputs, sizeof(int64_t), compare_latency);
+    r.p50Us = percentile(latencies, r.outputs, 0.50);
+    r.p99Us = percentile(latencies, r.outputs, 0.99);
+    r.maxUs = r.outputs ? latencies[r.outputs - 1] : 0;
+    return r;
+}
+
+//*************** Setup *****************************//
+
+// Factory config with GPI-1 unfiltered and GPO-1 following it, every sink off
+static bool start_firmware(void) {
+    host_spiffs_mount("/spiffs_data", SPIFFS_DATA_DIR);
+    host_httpd_listen_on(0);
+    if (init_config() != ESP_OK || load_config() != ESP_OK) return false;
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    cfg.gpi[0].enabled = 1;
+    cfg.gpi[0].invert = 0;
+    cfg.gpi[0].mode = GPI_MODE_LEVEL;
+    cfg.gpi[0].edges = PIN_EDGES_BOTH;
+    cfg.gpi[0].debounceUs = 0;
+    cfg.gpi[0].eventBurst = 0;
+    cfg.gpo[0].enabled = 1;
+    cfg.gpo[0].invert = 0;
+    snprintf(cfg.gpo[0].rule, sizeof(cfg.gpo[0].rule), "GPI1");
+    cfg.companionMode = 0;
+    cfg.tcpEnabled = 0;
+    cfg.httpEnabled = 0;
+    cfg.serialEnabled = 0;
+    gpi_gpio = cfg.gpi[0].gpio;
+    gpo_gpio = cfg.gpo[0].gpio;
+    if (apply_config(&cfg) != ESP_OK || event_journal_init() != ESP_OK || init_gpio_pins() != ESP_OK) return false;
+    if (start_webserver() != ESP_OK) return false;
+    port = host_httpd_port();
+    return port != 0;
+}
+
+//*************** Report *****************************//
+
+static void write_json(FILE *out, int64_t periodUs, const PhaseResult *results, int count) {
+    fprintf(out, "{\"firmware\":\"%s\",\"layout\":\"%s\",\"host_cpus\":%ld,\"period_us\":%lld,\"results\":[",
+            FIRMWARE_VERSION, LAYOUT_NAME, sysconf(_SC_NPROCESSORS_ONLN), (long long)periodUs);
+    for (int i = 0; i < count; i++) {
+        const PhaseResult *r = &results[i];
+        fprintf(out, "%s\n  {\"phase\":\"%s\",\"clients\":%d,\"edges\":%u,\"outputs\":%u,"
+                "\"latency_us\":{\"p50\":%lld,\"p99\":%lld,\"max\":%lld},"
+                "\"load\":{\"requests\":%u,\"failed\":%u,\"per_s\":%.1f}}",
+                i ? "," : "", r->name, r->clients, r->edges, r->outputs, (long long)r->p50Us, (long long)r->p99Us,
+                (long long)r->maxUs, r->requests, r->failed, r->requestsPerSecond);
+    }
+    fprintf(out, "\n]}\n");
+}
+
+static void print_row(const PhaseResult *r) {
+    printf("%-9s %-6s %7d %6u %7u %8lld %8lld %8lld %9.1f %6u\n", LAYOUT_NAME, r->name, r->clients, r->edges,
+           r->outputs, (long long)r->p50Us, (long long)r->p99Us, (long long)r->maxUs, r->requestsPerSecond, r->failed);
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--quick] [--clients N] [--seconds S] [--period-us P] [--out results.json]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    int clients = 8;
+    double seconds = 10;
+    int64_t periodUs = 2000;
+    const char *out_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            clients = 2;
+            seconds = 1;
+        } else if (strcmp(argv[i], "--clients") == 0 && i + 1 < argc) {
+            clients = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--period-us") == 0 && i + 1 < argc) {
+            periodUs = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (clients < 1 || clients > MAX_CLIENTS || seconds <= 0 || periodUs < 100) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    esp_log_level_set("*", ESP_LOG_NONE);
+    host_nvs_reset();
+    host_task_pin_cores(true);
+    host_task_pin_self(TASK_LAYOUT_IO_CORE);  // the toggles run the GPIO ISR
+    if (!start_firmware()) {
+        fprintf(stderr, "firmware did not start\n");
+        return 1;
+    }
+    host_gpio_on_set_level(on_set_level);
+
+    printf("firmware %s, %s layout, %ld host CPUs, GPI-1 toggled every %lld us for %.1f s per phase\n",
+           FIRMWARE_VERSION, LAYOUT_NAME, sysconf(_SC_NPROCESSORS_ONLN), (long long)periodUs, seconds);
+    printf("%-9s %-6s %7s %6s %7s %8s %8s %8s %9s %6s\n", "layout", "phase", "clients", "edges", "outputs",
+           "p50 us", "p99 us", "max us", "req/s", "failed");
+    PhaseResult results[2];
+    results[0] = run_phase("idle", 0, seconds, periodUs);
+    print_row(&results[0]);
+    results[1] = run_phase("load", clients, seconds, periodUs);
+    print_row(&results[1]);
+
+    if (out_path) {
+        FILE *out = fopen(out_path, "w");
+        if (!out) {
+            perror(out_path);
+            return 1;
+        }
+        write_json(out, periodUs, results, 2);
+        fclose(out);
+    }
+    host_nvs_reset();
+    // Slow outputs are a result, not a failure: only a phase where GPO-1 never followed fails
+    return results[0].outputs && results[1].outputs && results[1].requests ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+// Receivers for edge_harness, see receivers.h
+
+#include "receivers.h"
+#include "esp_timer.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+typedef struct {
+    int fd;
+    ReceiverCallback cb;
+} Receiver;
+
+// Reports a complete {"event":"GPI01","state":"HIGH",...} object, anything else is ignored
+static void parse_message(const char *msg, ReceiverCallback cb, int64_t arrivalUs) {
+    const char *event = strstr(msg, "\"event\":\"GPI");
+    const char *state = strstr(msg, "\"state\":\"");
+    if (!event || !state) return;
+    int gpi = atoi(event + strlen("\"event\":\"GPI"));
+    state += strlen("\"state\":\"");
+    if (gpi < 1) return;
+    if (strncmp(state, "HIGH", 4) == 0) {
+        cb(gpi - 1, 1, arrivalUs);
+    } else if (strncmp(state, "LOW", 3) == 0) {
+        cb(gpi - 1, 0, arrivalUs);
+    }
+}
+
+// GPI messages are flat objects, so a stream splits at every closing brace
+static void read_stream(int fd, ReceiverCallback cb) {
+    char buf[4096];
+    char msg[512];
+    size_t len = 0;
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        int64_t now = esp_timer_get_time();
+        for (ssize_t i = 0; i < n; i++) {
+            if (len < sizeof(msg) - 1) msg[len++] = buf[i];
+            if (buf[i] != '}') continue;
+            msg[len] = '\0';
+            parse_message(msg, cb, now);
+            len = 0;
+        }
+    }
+}
+
+static void *stream_thread(void *arg) {
+    Receiver *r = arg;
+    read_stream(r->fd, r->cb);
+    return NULL;
+}
+
+static volatile int tcp_connections;
+
+static void *tcp_thread(void *arg) {
+    Receiver *r = arg;
+    for (;;) {
+        int conn = accept(r->fd, NULL, NULL);
+        if (conn < 0) return NULL;
+        __atomic_add_fetch(&tcp_connections, 1, __ATOMIC_RELAXED);
+        read_stream(conn, r->cb);
+        close(conn);
+    }
+}
+
+// An HTTP request is read until the client closes, then its body is parsed
+static void *http_thread(void *arg) {
+    Receiver *r = arg;
+    char req[1024];
+    for (;;) {
+        int conn = accept(r->fd, NULL, NULL);
+        if (conn < 0) return NULL;
+        size_t len = 0;
+        ssize_t n;
+        while (len < sizeof(req) - 1 && (n = read(conn, req + len, sizeof(req) - 1 - len)) > 0) len += n;
+        int64_t now = esp_timer_get_time();
+        close(conn);
+        req[len] = '\0';
+        const char *body = strstr(req, "\r\n\r\n");
+        if (body) parse_message(body + 4, r->cb, now);
+    }
+}
+
+static int listen_loopback(void) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t size = sizeof(addr);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 128) != 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &size) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int start(int fd, ReceiverCallback cb, void *(*fn)(void *)) {
+    Receiver *r = malloc(sizeof(*r));
+    pthread_t thread;
+    if (!r) return -1;
+    r->fd = fd;
+    r->cb = cb;
+    if (pthread_create(&thread, NULL, fn, r) != 0) {
+        free(r);
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
+
+static int start_listener(ReceiverCallback cb, void *(*fn)(void *)) {
+    int fd = listen_loopback();
+    if (fd < 0) return -1;
+    struct sockaddr_in addr;
+    socklen_t size = sizeof(addr);
+    getsockname(fd, (struct sockaddr *)&addr, &size);
+    if (start(fd, cb, fn) != 0) {
+        close(fd);
+        return -1;
+    }
+    return ntohs(addr.sin_port);
+}
+
+int receiver_start_tcp(ReceiverCallback cb) {
+    return start_listener(cb, tcp_thread);
+}
+
+int receiver_tcp_connections(void) {
+    return __atomic_load_n(&tcp_connections, __ATOMIC_RELAXED);
+}
+
+int receiver_start_http(ReceiverCallback cb) {
+    return start_listener(cb, http_thread);
+}
+
+int receiver_start_serial(int fd, ReceiverCallback cb) {
+    return start(fd, cb, stream_thread);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+// Stand-ins for the controller end of each sink. Every receiver runs on its own thread, splits
+// what arrives into GPI messages and reports each one with its arrival time (esp_timer clock).
+
+#include <stdint.h>
+
+// gpi is 0-based, level 1 for "HIGH"
+typedef void (*ReceiverCallback)(int gpi, int level, int64_t arrivalUs);
+
+// TCP: one long-lived connection from tcp_client, messages back to back on the stream.
+// Listens on 127.0.0.1, returns the port or -1.
+int receiver_start_tcp(ReceiverCallback cb);
+
+// Connections the TCP receiver accepted so far
+int receiver_tcp_connections(void);
+
+// HTTP: one connection per POST, the message is the request body. Returns the port or -1.
+int receiver_start_http(ReceiverCallback cb);
+
+// Serial: reads what the firmware prints to stdout from fd (the read end of a pipe). 0 or -1.
+int receiver_start_serial(int fd, ReceiverCallback cb);
@@ -0,0 +1,275 @@
+// Load generator for the config page server: the real web_server on the esp_http_server shim,
+// hammered over loopback by client threads. Reports requests/s and p50/p99/max latency per
+// scenario, plus the connections the server refused or dropped, as a table and as JSON.
+//
+//   web_load [--quick] [--clients N] [--seconds S] [--keep-alive] [--scenario <name>] [--out results.json]
+//
+// The server runs with the factory AppConfig.web settings (sockets, LRU purge, keep-alive,
+// timeouts), so a change to those or to the handlers shows up here before it reaches a bench unit.
+// Each client sends one request at a time; latency is from connect (or send, with --keep-alive)
+// to the last byte of the reply.
+
+#include "app_config.h"
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "esp_spiffs.h"
+#include "esp_timer.h"
+#include "http_request.h"
+#include "nvs.h"
+#include "web_server.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION "unknown"
+#endif
+
+#define MAX_CLIENTS 64
+#define SESSION "Cookie: sessionToken=loggedIn\r\n"
+
+typedef struct {
+    const char *name;
+    const char *method;
+    const char *paths[2];       // clients alternate between the two, NULL: always the first
+    const char *headers;
+    const char *bodies[2];      // alternated with the paths, so every save changes the config
+    int expect;                 // status of a successful reply
+} Scenario;
+
+static const Scenario scenarios[] = {
+    { "login", "GET", { "/", NULL }, NULL, { NULL, NULL }, 200 },
+    { "assets", "GET", { "/styles.css", "/index.js" }, NULL, { NULL, NULL }, 200 },
+    { "config", "GET", { "/", NULL }, SESSION, { NULL, NULL }, 200 },
+    { "save", "POST", { "/save", NULL }, SESSION, { "{\"syslogPort\":514}", "{\"syslogPort\":515}" }, 302 },
+};
+#define SCENARIO_COUNT (sizeof(scenarios) / sizeof(scenarios[0]))
+
+typedef struct {
+    uint32_t requests;          // answered with the expected status
+    uint32_t refused;           // connect failed: backlog full or server gone
+    uint32_t dropped;           // connection closed or reset before the whole reply arrived
+    uint32_t badStatus;         // a reply, but not the expected status
+    double perSecond;
+    int64_t p50Us, p99Us, maxUs;
+} ScenarioResult;
+
+typedef struct {
+    const Scenario *scenario;
+    int index;
+    int64_t untilUs;
+    bool keepAlive;
+    ScenarioResult counts;
+    int64_t *latencies;
+    size_t latencyCount, latencyCap;
+} Client;
+
+static uint16_t port;
+
+//*************** Client *****************************//
+
+static void record(Client *c, int64_t latencyUs) {
+    if (c->latencyCount == c->latencyCap) {
+        size_t cap = c->latencyCap ? c->latencyCap * 2 : 4096;
+        int64_t *grown = realloc(c->latencies, cap * sizeof(int64_t));
+        if (!grown) return;
+        c->latencies = grown;
+        c->latencyCap = cap;
+    }
+    c->latencies[c->latencyCount++] = latencyUs;
+}
+
+static void *client_thread(void *arg) {
+    Client *c = arg;
+    const Scenario *s = c->scenario;
+    int fd = -1;
+    for (uint32_t i = c->index; esp_timer_get_time() < c->untilUs; i++) {
+        int alt = s->paths[1] && i % 2 ? 1 : 0;
+        int altBody = s->bodies[1] && i % 2 ? 1 : 0;
+        const char *body = s->bodies[altBody];
+        char request[512];
+        int len = snprintf(request, sizeof(request), "%s %s HTTP/1.1\r\nHost: gpiobox\r\n%s%sContent-Length: %d\r\n\r\n%s",
+                           s->method, s->paths[alt], c->keepAlive ? "" : "Connection: close\r\n",
+                           s->headers ? s->headers : "", body ? (int)strlen(body) : 0, body ? body : "");
+
+        int64_t start = esp_timer_get_time();
+        if (fd < 0) fd = http_connect(port);
+        if (fd < 0) {
+            c->counts.refused++;
+            usleep(1000);  // don't spin on a full backlog
+            continue;
+        }
+        int status = send(fd, request, len, MSG_NOSIGNAL) == len ? http_read_response(fd) : -1;
+        int64_t latency = esp_timer_get_time() - start;
+        if (status < 0) {
+            c->counts.dropped++;
+        } else if (status != s->expect) {
+            c->counts.badStatus++;
+        } else {
+            c->counts.requests++;
+            record(c, latency);
+        }
+        if (!c->keepAlive || status < 0 || status >= 400) {  // httpd closes after an error reply
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (fd >= 0) close(fd);
+    return NULL;
+}
+
+//*************** One scenario *****************************//
+
+static int compare_latency(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int64_t percentile(const int64_t *sorted, size_t n, double q) {
+    if (n == 0) return 0;
+    size_t rank = (size_t)(q * n + 0.999999);
+    return sorted[rank ? rank - 1 : 0];
+}
+
+static ScenarioResult run(const Scenario *s, int clients, double seconds, bool keepAlive) {
+    static Client c[MAX_CLIENTS];
+    pthread_t threads[MAX_CLIENTS];
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < clients; i++) {
+        c[i] = (Client){ .scenario = s, .index = i, .untilUs = start + (int64_t)(seconds * 1e6), .keepAlive = keepAlive };
+        pthread_create(&threads[i], NULL, client_thread, &c[i]);
+    }
+
+    ScenarioResult r = { 0 };
+    size_t total = 0;
+    for (int i = 0; i < clients; i++) {
+        pthread_join(threads[i], NULL);
+        total += c[i].latencyCount;
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+    int64_t *all = malloc((total ? total : 1) * sizeof(int64_t));
+    size_t n = 0;
+    for (int i = 0; i < clients; i++) {
+        r.requests += c[i].counts.requests;
+        r.refused += c[i].counts.refused;
+        r.dropped += c[i].counts.dropped;
+        r.badStatus += c[i].counts.badStatus;
+        if (all) memcpy(all + n, c[i].latencies, c[i].latencyCount * sizeof(int64_t));
+        n += c[i].latencyCount;
+        free(c[i].latencies);
+    }
+    if (all) {
+        qsort(all, n, sizeof(int64_t), compare_latency);
+        r.p50Us = percentile(all, n, 0.50);
+        r.p99Us = percentile(all, n, 0.99);
+        r.maxUs = n ? all[n - 1] : 0;
+        free(all);
+    }
+    r.perSecond = r.requests * 1e6 / (double)elapsed;
+    return r;
+}
+
+//*************** Report *****************************//
+
+static void write_json(FILE *out, int clients, double seconds, bool keepAlive, const ScenarioResult *results,
+                       const bool *selected) {
+    fprintf(out, "{\"firmware\":\"%s\",\"clients\":%d,\"seconds\":%.1f,\"keep_alive\":%s,\"results\":[",
+            FIRMWARE_VERSION, clients, seconds, keepAlive ? "true" : "false");
+    bool first = true;
+    for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+        if (!selected[i]) continue;
+        const ScenarioResult *r = &results[i];
+        fprintf(out, "%s\n  {\"scenario\":\"%s\",\"requests\":%u,\"per_s\":%.1f,"
+                "\"latency_us\":{\"p50\":%lld,\"p99\":%lld,\"max\":%lld},"
+                "\"errors\":{\"refused\":%u,\"dropped\":%u,\"bad_status\":%u}}",
+                first ? "" : ",", scenarios[i].name, r->requests, r->perSecond, (long long)r->p50Us,
+                (long long)r->p99Us, (long long)r->maxUs, r->refused, r->dropped, r->badStatus);
+        first = false;
+    }
+    fprintf(out, "\n]}\n");
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--quick] [--clients N] [--seconds S] [--keep-alive] "
+            "[--scenario login|assets|config|save] [--out results.json]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    int clients = 4;
+    double seconds = 5;
+    bool keepAlive = false;
+    const char *out_path = NULL, *only = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            seconds = 0.5;
+        } else if (strcmp(argv[i], "--clients") == 0 && i + 1 < argc) {
+            clients = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--keep-alive") == 0) {
+            keepAlive = true;
+        } else if (strcmp(argv[i], "--scenario") == 0 && i + 1 < argc) {
+            only = argv[++i];
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (clients < 1 || clients > MAX_CLIENTS || seconds <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    esp_log_level_set("*", ESP_LOG_NONE);
+    host_nvs_reset();
+    host_spiffs_mount("/spiffs_data", SPIFFS_DATA_DIR);
+    host_httpd_listen_on(0);
+    if (init_config() != ESP_OK || load_config() != ESP_OK || start_webserver() != ESP_OK) {
+        fprintf(stderr, "web server did not start\n");
+        return 1;
+    }
+    port = host_httpd_port();
+    AppConfig cfg;
+    config_snapshot(&cfg);
+
+    printf("firmware %s, %d clients, %.1f s per scenario, %s, server: %u sockets, lru %s, keep-alive %s\n",
+           FIRMWARE_VERSION, clients, seconds, keepAlive ? "keep-alive" : "one connection per request",
+           cfg.web.maxOpenSockets, cfg.web.lruPurge ? "on" : "off", cfg.web.keepAlive ? "on" : "off");
+    printf("%-8s %8s %9s %8s %8s %8s   errors: refused/dropped/status\n", "scenario", "requests", "req/s",
+           "p50 us", "p99 us", "max us");
+
+    ScenarioResult results[SCENARIO_COUNT] = { 0 };
+    bool selected[SCENARIO_COUNT] = { 0 };
+    int runs = 0, failures = 0;
+    for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+        if (only && strcmp(only, scenarios[i].name) != 0) continue;
+        selected[i] = true;
+        runs++;
+        ScenarioResult *r = &results[i];
+        *r = run(&scenarios[i], clients, seconds, keepAlive);
+        if (r->requests == 0) failures++;
+        printf("%-8s %8u %9.1f %8lld %8lld %8lld   %u/%u/%u\n", scenarios[i].name, r->requests, r->perSecond,
+               (long long)r->p50Us, (long long)r->p99Us, (long long)r->maxUs, r->refused, r->dropped, r->badStatus);
+    }
+    if (runs == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (out_path) {
+        FILE *out = fopen(out_path, "w");
+        if (!out) {
+            perror(out_path);
+            return 1;
+        }
+        write_json(out, clients, seconds, keepAlive, results, selected);
+        fclose(out);
+    }
+    // Errors are a result, like loss in edge_harness: only a scenario nothing got through fails
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,65 @@
+// Host shim: esp_log with the replaceable vprintf hook and per-tag levels
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_TAG_LEVELS 16
+
+typedef struct {
+    char tag[24];
+    esp_log_level_t level;
+} TagLevel;
+
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+static vprintf_like_t log_vprintf = vprintf;
+static esp_log_level_t default_level = ESP_LOG_INFO;
+static TagLevel tag_levels[MAX_TAG_LEVELS];
+static int tag_level_count;
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func) {
+    pthread_mutex_lock(&log_lock);
+    vprintf_like_t previous = log_vprintf;
+    log_vprintf = func;
+    pthread_mutex_unlock(&log_lock);
+    return previous;
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    pthread_mutex_lock(&log_lock);
+    if (strcmp(tag, "*") == 0) {
+        default_level = level;
+        tag_level_count = 0;
+    } else {
+        int i = 0;
+        while (i < tag_level_count && strcmp(tag_levels[i].tag, tag) != 0) i++;
+        if (i < MAX_TAG_LEVELS) {
+            strncpy(tag_levels[i].tag, tag, sizeof(tag_levels[i].tag) - 1);
+            tag_levels[i].level = level;
+            if (i == tag_level_count) tag_level_count++;
+        }
+    }
+    pthread_mutex_unlock(&log_lock);
+}
+
+uint32_t esp_log_timestamp(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    pthread_mutex_lock(&log_lock);
+    esp_log_level_t limit = default_level;
+    for (int i = 0; i < tag_level_count; i++) {
+        if (strcmp(tag_levels[i].tag, tag) == 0) limit = tag_levels[i].level;
+    }
+    vprintf_like_t out = log_vprintf;
+    pthread_mutex_unlock(&log_lock);
+    if (level > limit) return;
+
+    va_list args;
+    va_start(args, format);
+    out(format, args);
+    va_end(args);
+}
@@ -0,0 +1,139 @@
+// Host shim: NOR flash emulator behind the esp_partition API
+
+#include "esp_partition.h"
+#include "freertos/task.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define MAX_PARTITIONS 4
+
+typedef struct {
+    esp_partition_t part;
+    uint8_t *data;
+} HostPartition;
+
+static pthread_mutex_t flash_lock = PTHREAD_MUTEX_INITIALIZER;
+static HostPartition partitions[MAX_PARTITIONS];
+static int partition_count;
+static uint32_t next_address = 0x110000;
+static HostFlashStats stats;
+static const char *owner;
+static bool power_cut_armed;
+static uint32_t power_budget;
+
+static HostPartition *host_of(const esp_partition_t *part) {
+    return (HostPartition *)((uint8_t *)part - offsetof(HostPartition, part));
+}
+
+const esp_partition_t *host_flash_create(const char *label, esp_partition_subtype_t subtype, uint32_t size) {
+    pthread_mutex_lock(&flash_lock);
+    HostPartition *p = NULL;
+    for (int i = 0; i < partition_count && !p; i++) {
+        if (strcmp(partitions[i].part.label, label) == 0) p = &partitions[i];
+    }
+    if (p && p->part.size != size) {
+        munmap(p->data, p->part.size);
+        p->data = NULL;
+    }
+    if (!p) p = &partitions[partition_count++];
+
+    p->part.type = ESP_PARTITION_TYPE_DATA;
+    p->part.subtype = subtype;
+    p->part.size = size;
+    p->part.erase_size = SPI_FLASH_SEC_SIZE;
+    strncpy(p->part.label, label, sizeof(p->part.label) - 1);
+    if (!p->data) {
+        p->part.address = next_address;
+        next_address += size;
+        p->data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    }
+    memset(p->data, 0xFF, size);
+    pthread_mutex_unlock(&flash_lock);
+    return &p->part;
+}
+
+uint8_t *host_flash_data(const esp_partition_t *part) {
+    return host_of(part)->data;
+}
+
+HostFlashStats *host_flash_stats(void) {
+    return &stats;
+}
+
+void host_flash_owner(const char *task) {
+    pthread_mutex_lock(&flash_lock);
+    owner = task;
+    pthread_mutex_unlock(&flash_lock);
+}
+
+// Caller holds flash_lock
+static void check_owner(void) {
+    if (owner && strcmp(pcTaskGetName(NULL), owner) != 0) stats.foreignOps++;
+}
+
+void host_flash_power_cut_after(uint32_t bytes) {
+    pthread_mutex_lock(&flash_lock);
+    power_cut_armed = true;
+    power_budget = bytes;
+    pthread_mutex_unlock(&flash_lock);
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label) {
+    const esp_partition_t *found = NULL;
+    pthread_mutex_lock(&flash_lock);
+    for (int i = 0; i < partition_count && !found; i++) {
+        const esp_partition_t *p = &partitions[i].part;
+        if (p->type == type && p->subtype == subtype && (!label || strcmp(p->label, label) == 0)) found = p;
+    }
+    pthread_mutex_unlock(&flash_lock);
+    return found;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t offset, void *dst, size_t size) {
+    if (offset + size > part->size) return ESP_ERR_INVALID_SIZE;
+    pthread_mutex_lock(&flash_lock);
+    memcpy(dst, host_of(part)->data + offset, size);
+    pthread_mutex_unlock(&flash_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t offset, const void *src, size_t size) {
+    if (offset + size > part->size) return ESP_ERR_INVALID_SIZE;
+    pthread_mutex_lock(&flash_lock);
+    check_owner();
+    uint8_t *dst = host_of(part)->data + offset;
+    const uint8_t *bytes = src;
+    size_t programmed = size;
+    if (power_cut_armed && power_budget < size) programmed = power_budget;
+
+    for (size_t i = 0; i < programmed; i++) {
+        dst[i] &= bytes[i];     // NOR: programming only clears bits
+    }
+    if (programmed < size) _exit(0);
+    if (power_cut_armed) power_budget -= size;
+
+    stats.writes++;
+    stats.bytesWritten += size;
+    pthread_mutex_unlock(&flash_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size) {
+    if (offset % SPI_FLASH_SEC_SIZE || size % SPI_FLASH_SEC_SIZE || offset + size > part->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&flash_lock);
+    check_owner();
+    for (size_t sector = 0; sector < size / SPI_FLASH_SEC_SIZE; sector++) {
+        if (power_cut_armed && power_budget == 0) _exit(0);
+        if (power_cut_armed) power_budget--;
+        memset(host_of(part)->data + offset + sector * SPI_FLASH_SEC_SIZE, 0xFF, SPI_FLASH_SEC_SIZE);
+        stats.erases++;
+    }
+    pthread_mutex_unlock(&flash_lock);
+    return ESP_OK;
+}
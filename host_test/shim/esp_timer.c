@@ -0,0 +1,159 @@
+// Host shim: esp_timer with one dispatcher thread. Callbacks run one at a time, in deadline
+// order, with no shim lock held, so a callback may start, stop or delete timers.
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    int64_t deadline;       // esp_timer_get_time() of the next expiry, 0 when stopped
+    uint64_t period;        // 0 for one-shot timers
+    struct esp_timer *next;
+};
+
+static pthread_mutex_t timers_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timers_changed;
+static pthread_once_t dispatcher_once = PTHREAD_ONCE_INIT;
+static struct esp_timer *timers;
+static struct timespec boot;
+
+__attribute__((constructor)) static void record_boot(void) {
+    clock_gettime(CLOCK_MONOTONIC, &boot);
+}
+
+// Time since "boot", plus one second so a zero timestamp never looks like a real one
+int64_t esp_timer_get_time(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return 1000000 + (int64_t)(now.tv_sec - boot.tv_sec) * 1000000 + (now.tv_nsec - boot.tv_nsec) / 1000;
+}
+
+static struct esp_timer *earliest(void) {
+    struct esp_timer *first = NULL;
+    for (struct esp_timer *t = timers; t; t = t->next) {
+        if (t->deadline && (!first || t->deadline < first->deadline)) first = t;
+    }
+    return first;
+}
+
+static void *dispatcher(void *arg) {
+    host_task_adopt("esp_timer");
+    host_task_pin_self(0);  // the SDK's esp_timer task runs on core 0
+    pthread_mutex_lock(&timers_lock);
+    while (1) {
+        struct esp_timer *t = earliest();
+        int64_t now = esp_timer_get_time();
+        if (!t) {
+            pthread_cond_wait(&timers_changed, &timers_lock);
+            continue;
+        }
+        if (t->deadline > now) {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            int64_t wait_ns = (t->deadline - now) * 1000 + ts.tv_nsec;
+            ts.tv_sec += wait_ns / 1000000000;
+            ts.tv_nsec = wait_ns % 1000000000;
+            pthread_cond_timedwait(&timers_changed, &timers_lock, &ts);
+            continue;
+        }
+
+        t->deadline = t->period ? t->deadline + (int64_t)t->period : 0;
+        esp_timer_cb_t callback = t->callback;
+        void *cb_arg = t->arg;
+        pthread_mutex_unlock(&timers_lock);
+        callback(cb_arg);
+        pthread_mutex_lock(&timers_lock);
+    }
+    return NULL;
+}
+
+static void start_dispatcher(void) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&timers_changed, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, dispatcher, NULL);
+    pthread_detach(thread);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out) {
+    if (!args || !args->callback || !out) return ESP_ERR_INVALID_ARG;
+    pthread_once(&dispatcher_once, start_dispatcher);
+
+    struct esp_timer *t = calloc(1, sizeof(*t));
+    t->callback = args->callback;
+    t->arg = args->arg;
+
+    pthread_mutex_lock(&timers_lock);
+    t->next = timers;
+    timers = t;
+    pthread_mutex_unlock(&timers_lock);
+    *out = t;
+    return ESP_OK;
+}
+
+static esp_err_t arm(esp_timer_handle_t t, uint64_t timeout_us, uint64_t period, bool restart) {
+    pthread_mutex_lock(&timers_lock);
+    if (restart != (t->deadline != 0)) {
+        pthread_mutex_unlock(&timers_lock);
+        return ESP_ERR_INVALID_STATE;   // start on a running timer, restart on a stopped one
+    }
+    t->deadline = esp_timer_get_time() + (int64_t)timeout_us;
+    if (!restart) t->period = period;
+    else if (t->period) t->period = timeout_us;
+    pthread_cond_broadcast(&timers_changed);
+    pthread_mutex_unlock(&timers_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t timeout_us) {
+    return arm(t, timeout_us, 0, false);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t t, uint64_t period_us) {
+    return arm(t, period_us, period_us, false);
+}
+
+esp_err_t esp_timer_restart(esp_timer_handle_t t, uint64_t timeout_us) {
+    return arm(t, timeout_us, 0, true);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t t) {
+    pthread_mutex_lock(&timers_lock);
+    esp_err_t err = t->deadline ? ESP_OK : ESP_ERR_INVALID_STATE;
+    t->deadline = 0;
+    pthread_mutex_unlock(&timers_lock);
+    return err;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t t) {
+    pthread_mutex_lock(&timers_lock);
+    if (t->deadline) {
+        pthread_mutex_unlock(&timers_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (struct esp_timer **p = &timers; *p; p = &(*p)->next) {
+        if (*p == t) {
+            *p = t->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&timers_lock);
+    free(t);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t t) {
+    pthread_mutex_lock(&timers_lock);
+    bool active = t->deadline != 0;
+    pthread_mutex_unlock(&timers_lock);
+    return active;
+}
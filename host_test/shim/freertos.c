@@ -0,0 +1,625 @@
+// Host shim: the FreeRTOS subset the firmware uses, on pthreads. Blocking calls wait on a
+// CLOCK_MONOTONIC condition variable, one tick is one millisecond.
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/ringbuf.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+//*************** Blocking helpers *****************************//
+
+static void init_cond(pthread_cond_t *cond) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static struct timespec deadline_for(TickType_t ticks) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += ticks / 1000;
+    ts.tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+static void unlock_mutex(void *mutex) {
+    pthread_mutex_unlock(mutex);
+}
+
+// Waits once on cond. Returns false when the deadline passed. ticks == 0 never waits. A task
+// deleted while it waits leaves the mutex unlocked.
+static bool wait_on(pthread_cond_t *cond, pthread_mutex_t *mutex, TickType_t ticks, const struct timespec *deadline) {
+    if (ticks == 0) return false;
+    bool woken = true;
+    pthread_cleanup_push(unlock_mutex, mutex);
+    if (ticks == portMAX_DELAY) {
+        pthread_cond_wait(cond, mutex);
+    } else {
+        woken = pthread_cond_timedwait(cond, mutex, deadline) != ETIMEDOUT;
+    }
+    pthread_cleanup_pop(0);
+    return woken;
+}
+
+//*************** Tasks *****************************//
+
+struct HostTask {
+    pthread_t thread;
+    char name[16];
+    TaskFunction_t fn;
+    void *arg;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notifyValue;
+    bool notifyPending;
+    struct HostTask *next;
+};
+
+static pthread_mutex_t tasks_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct HostTask *tasks;
+static int task_count;
+static __thread struct HostTask *current_task;
+static __thread int isr_depth;
+
+static struct HostTask *new_task(const char *name) {
+    struct HostTask *t = calloc(1, sizeof(*t));
+    strncpy(t->name, name, sizeof(t->name) - 1);
+    pthread_mutex_init(&t->lock, NULL);
+    init_cond(&t->cond);
+    return t;
+}
+
+// Threads the shim didn't start (main, the timer dispatcher) become tasks on first use
+static struct HostTask *self(void) {
+    if (!current_task) {
+        current_task = new_task("main");
+        current_task->thread = pthread_self();
+    }
+    return current_task;
+}
+
+void host_task_adopt(const char *name) {
+    strncpy(self()->name, name, sizeof(current_task->name) - 1);
+}
+
+static void *task_entry(void *arg) {
+    current_task = arg;
+    current_task->fn(current_task->arg);
+    return NULL;  // a FreeRTOS task must not return, treat it like vTaskDelete(NULL)
+}
+
+static bool pin_cores;  // host_task_pin_cores
+
+// The host CPU set of a task on core, false when it may run anywhere: unpinned tasks, pinning
+// off, or fewer host CPUs than the target has cores
+static bool core_cpus(BaseType_t core, cpu_set_t *set) {
+    if (!pin_cores || core == tskNO_AFFINITY || sysconf(_SC_NPROCESSORS_ONLN) < portNUM_PROCESSORS) return false;
+    CPU_ZERO(set);
+    CPU_SET(core, set);
+    return true;
+}
+
+void host_task_pin_cores(bool on) {
+    pin_cores = on;
+}
+
+void host_task_pin_self(BaseType_t core) {
+    cpu_set_t set;
+    if (core_cpus(core, &set)) pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stackSize, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core) {
+    struct HostTask *t = new_task(name);
+    t->fn = fn;
+    t->arg = arg;
+
+    pthread_mutex_lock(&tasks_lock);
+    t->next = tasks;
+    tasks = t;
+    task_count++;
+    pthread_mutex_unlock(&tasks_lock);
+
+    if (handle) *handle = t;
+    pthread_attr_t attr;
+    cpu_set_t cpus;
+    pthread_attr_init(&attr);
+    if (core_cpus(core, &cpus)) pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    int err = pthread_create(&t->thread, &attr, task_entry, t);
+    pthread_attr_destroy(&attr);
+    if (err != 0) return pdFAIL;
+    pthread_detach(t->thread);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stackSize, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle) {
+    return xTaskCreatePinnedToCore(fn, name, stackSize, arg, priority, handle, tskNO_AFFINITY);
+}
+
+// Another task is cancelled at its next blocking call (socket, delay or wait), not mid-statement
+void vTaskDelete(TaskHandle_t task) {
+    struct HostTask *t = task ? task : self();
+
+    pthread_mutex_lock(&tasks_lock);
+    for (struct HostTask **p = &tasks; *p; p = &(*p)->next) {
+        if (*p == t) {
+            *p = t->next;
+            task_count--;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&tasks_lock);
+    // The handle stays valid, like a zombie TCB nobody frees
+    if (t == current_task) pthread_exit(NULL);
+    pthread_cancel(t->thread);
+}
+
+int host_task_count(void) {
+    pthread_mutex_lock(&tasks_lock);
+    int count = task_count;
+    pthread_mutex_unlock(&tasks_lock);
+    return count;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    struct timespec ts = { .tv_sec = ticks / 1000, .tv_nsec = (long)(ticks % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+TickType_t xTaskGetTickCount(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (TickType_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return self();
+}
+
+TaskHandle_t xTaskGetHandle(const char *name) {
+    struct HostTask *found = NULL;
+    pthread_mutex_lock(&tasks_lock);
+    for (struct HostTask *t = tasks; t && !found; t = t->next) {
+        if (strcmp(t->name, name) == 0) found = t;
+    }
+    pthread_mutex_unlock(&tasks_lock);
+    return found;
+}
+
+const char *pcTaskGetName(TaskHandle_t task) {
+    return task ? task->name : self()->name;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return 1024;
+}
+
+BaseType_t xPortInIsrContext(void) {
+    return isr_depth > 0;
+}
+
+BaseType_t xPortGetCoreID(void) {
+    return 0;
+}
+
+void host_isr_enter(void) {
+    isr_depth++;
+}
+
+void host_isr_exit(void) {
+    isr_depth--;
+}
+
+//*************** Task notifications *****************************//
+
+static BaseType_t notify(struct HostTask *t, uint32_t value, eNotifyAction action) {
+    BaseType_t ret = pdPASS;
+    pthread_mutex_lock(&t->lock);
+    switch (action) {
+        case eNoAction:
+            break;
+        case eSetBits:
+            t->notifyValue |= value;
+            break;
+        case eIncrement:
+            t->notifyValue++;
+            break;
+        case eSetValueWithOverwrite:
+            t->notifyValue = value;
+            break;
+        case eSetValueWithoutOverwrite:
+            if (t->notifyPending) ret = pdFAIL;
+            else t->notifyValue = value;
+            break;
+    }
+    t->notifyPending = true;
+    pthread_cond_broadcast(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+    return ret;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    struct HostTask *t = self();
+    struct timespec deadline = deadline_for(ticks);
+
+    pthread_mutex_lock(&t->lock);
+    while (t->notifyValue == 0 && wait_on(&t->cond, &t->lock, ticks, &deadline)) {
+    }
+    uint32_t value = t->notifyValue;
+    if (value) t->notifyValue = clearOnExit ? 0 : value - 1;
+    t->notifyPending = false;
+    pthread_mutex_unlock(&t->lock);
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    return notify(task, 0, eIncrement);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) {
+    notify(task, 0, eIncrement);
+    if (woken) *woken = pdTRUE;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    return notify(task, value, action);
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t *woken) {
+    if (woken) *woken = pdTRUE;
+    return notify(task, value, action);
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t *value, TickType_t ticks) {
+    struct HostTask *t = self();
+    struct timespec deadline = deadline_for(ticks);
+
+    pthread_mutex_lock(&t->lock);
+    if (!t->notifyPending) t->notifyValue &= ~clearOnEntry;
+    while (!t->notifyPending && wait_on(&t->cond, &t->lock, ticks, &deadline)) {
+    }
+    BaseType_t got = t->notifyPending ? pdTRUE : pdFALSE;
+    if (value) *value = t->notifyValue;
+    if (got) t->notifyValue &= ~clearOnExit;
+    t->notifyPending = false;
+    pthread_mutex_unlock(&t->lock);
+    return got;
+}
+
+//*************** Queues *****************************//
+
+struct HostQueue {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    UBaseType_t head;
+    UBaseType_t count;
+    uint8_t *items;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    struct HostQueue *q = calloc(1, sizeof(*q));
+    q->items = calloc(length, itemSize);
+    q->length = length;
+    q->itemSize = itemSize;
+    pthread_mutex_init(&q->lock, NULL);
+    init_cond(&q->changed);
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t q) {
+    free(q->items);
+    free(q);
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks) {
+    struct timespec deadline = deadline_for(ticks);
+    pthread_mutex_lock(&q->lock);
+    while (q->count == q->length && wait_on(&q->changed, &q->lock, ticks, &deadline)) {
+    }
+    if (q->count == q->length) {
+        pthread_mutex_unlock(&q->lock);
+        return errQUEUE_FULL;
+    }
+    memcpy(q->items + ((q->head + q->count) % q->length) * q->itemSize, item, q->itemSize);
+    q->count++;
+    pthread_cond_broadcast(&q->changed);
+    pthread_mutex_unlock(&q->lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void *item, BaseType_t *woken) {
+    if (woken) *woken = pdFALSE;
+    return xQueueSend(q, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks) {
+    struct timespec deadline = deadline_for(ticks);
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0 && wait_on(&q->changed, &q->lock, ticks, &deadline)) {
+    }
+    if (q->count == 0) {
+        pthread_mutex_unlock(&q->lock);
+        return errQUEUE_EMPTY;
+    }
+    memcpy(item, q->items + q->head * q->itemSize, q->itemSize);
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+    pthread_cond_broadcast(&q->changed);
+    pthread_mutex_unlock(&q->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+    pthread_mutex_lock(&q->lock);
+    UBaseType_t count = q->count;
+    pthread_mutex_unlock(&q->lock);
+    return count;
+}
+
+//*************** Semaphores *****************************//
+
+struct HostSemaphore {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    UBaseType_t count;
+    UBaseType_t max;
+};
+
+static struct HostSemaphore *new_semaphore(UBaseType_t max, UBaseType_t initial) {
+    struct HostSemaphore *s = calloc(1, sizeof(*s));
+    s->count = initial;
+    s->max = max;
+    pthread_mutex_init(&s->lock, NULL);
+    init_cond(&s->changed);
+    return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return new_semaphore(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return new_semaphore(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial) {
+    return new_semaphore(max, initial);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t s) {
+    free(s);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks) {
+    struct timespec deadline = deadline_for(ticks);
+    pthread_mutex_lock(&s->lock);
+    while (s->count == 0 && wait_on(&s->changed, &s->lock, ticks, &deadline)) {
+    }
+    BaseType_t got = s->count > 0 ? pdTRUE : pdFALSE;
+    if (got) s->count--;
+    pthread_mutex_unlock(&s->lock);
+    return got;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) {
+    pthread_mutex_lock(&s->lock);
+    BaseType_t given = s->count < s->max ? pdTRUE : pdFALSE;
+    if (given) s->count++;
+    pthread_cond_broadcast(&s->changed);
+    pthread_mutex_unlock(&s->lock);
+    return given;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t s, BaseType_t *woken) {
+    if (woken) *woken = pdFALSE;
+    return xSemaphoreGive(s);
+}
+
+//*************** Event groups *****************************//
+
+struct HostEventGroup {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    EventBits_t bits;
+};
+
+EventGroupHandle_t xEventGroupCreate(void) {
+    struct HostEventGroup *g = calloc(1, sizeof(*g));
+    pthread_mutex_init(&g->lock, NULL);
+    init_cond(&g->changed);
+    return g;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t g, EventBits_t bits) {
+    pthread_mutex_lock(&g->lock);
+    g->bits |= bits;
+    EventBits_t now = g->bits;
+    pthread_cond_broadcast(&g->changed);
+    pthread_mutex_unlock(&g->lock);
+    return now;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t g, EventBits_t bits) {
+    pthread_mutex_lock(&g->lock);
+    EventBits_t before = g->bits;
+    g->bits &= ~bits;
+    pthread_mutex_unlock(&g->lock);
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t g) {
+    pthread_mutex_lock(&g->lock);
+    EventBits_t now = g->bits;
+    pthread_mutex_unlock(&g->lock);
+    return now;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t g, EventBits_t bits, BaseType_t clearOnExit,
+                                BaseType_t waitForAll, TickType_t ticks) {
+    struct timespec deadline = deadline_for(ticks);
+    pthread_mutex_lock(&g->lock);
+    while (1) {
+        bool met = waitForAll ? (g->bits & bits) == bits : (g->bits & bits) != 0;
+        if (met) {
+            EventBits_t now = g->bits;
+            if (clearOnExit) g->bits &= ~bits;
+            pthread_mutex_unlock(&g->lock);
+            return now;
+        }
+        if (!wait_on(&g->changed, &g->lock, ticks, &deadline)) break;
+    }
+    EventBits_t now = g->bits;
+    pthread_mutex_unlock(&g->lock);
+    return now;
+}
+
+//*************** Ring buffers *****************************//
+
+#define RINGBUF_ITEM_HEADER 8
+
+typedef struct RingItem {
+    struct RingItem *next;
+    size_t size;
+    bool complete;      // SendAcquire'd items can't be received before SendComplete
+    bool received;      // handed out, waiting for vRingbufferReturnItem
+    uint8_t data[];
+} RingItem;
+
+struct HostRingbuf {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    size_t size;
+    size_t used;
+    RingItem *first;
+    RingItem *last;
+};
+
+static size_t item_cost(size_t size) {
+    return RINGBUF_ITEM_HEADER + ((size + 3) & ~(size_t)3);
+}
+
+static RingItem *item_of(void *data) {
+    return (RingItem *)((uint8_t *)data - offsetof(RingItem, data));
+}
+
+RingbufHandle_t xRingbufferCreate(size_t size, RingbufferType_t type) {
+    assert(type == RINGBUF_TYPE_NOSPLIT);
+    struct HostRingbuf *r = calloc(1, sizeof(*r));
+    r->size = size;
+    pthread_mutex_init(&r->lock, NULL);
+    init_cond(&r->changed);
+    return r;
+}
+
+void vRingbufferDelete(RingbufHandle_t r) {
+    while (r->first) {
+        RingItem *next = r->first->next;
+        free(r->first);
+        r->first = next;
+    }
+    free(r);
+}
+
+static RingItem *reserve(RingbufHandle_t r, size_t size, TickType_t ticks) {
+    struct timespec deadline = deadline_for(ticks);
+    size_t cost = item_cost(size);
+    if (cost > r->size) return NULL;
+
+    pthread_mutex_lock(&r->lock);
+    while (r->used + cost > r->size && wait_on(&r->changed, &r->lock, ticks, &deadline)) {
+    }
+    if (r->used + cost > r->size) {
+        pthread_mutex_unlock(&r->lock);
+        return NULL;
+    }
+    RingItem *item = calloc(1, sizeof(RingItem) + size);
+    item->size = size;
+    r->used += cost;
+    if (r->last) r->last->next = item;
+    else r->first = item;
+    r->last = item;
+    pthread_mutex_unlock(&r->lock);
+    return item;
+}
+
+BaseType_t xRingbufferSend(RingbufHandle_t r, const void *data, size_t size, TickType_t ticks) {
+    RingItem *item = reserve(r, size, ticks);
+    if (!item) return pdFALSE;
+    memcpy(item->data, data, size);
+    return xRingbufferSendComplete(r, item->data);
+}
+
+BaseType_t xRingbufferSendAcquire(RingbufHandle_t r, void **data, size_t size, TickType_t ticks) {
+    RingItem *item = reserve(r, size, ticks);
+    if (!item) return pdFALSE;
+    *data = item->data;
+    return pdTRUE;
+}
+
+BaseType_t xRingbufferSendComplete(RingbufHandle_t r, void *data) {
+    pthread_mutex_lock(&r->lock);
+    item_of(data)->complete = true;
+    pthread_cond_broadcast(&r->changed);
+    pthread_mutex_unlock(&r->lock);
+    return pdTRUE;
+}
+
+void *xRingbufferReceive(RingbufHandle_t r, size_t *size, TickType_t ticks) {
+    struct timespec deadline = deadline_for(ticks);
+    pthread_mutex_lock(&r->lock);
+    while (1) {
+        // FIFO: an item still being written holds back the ones behind it
+        RingItem *item = r->first;
+        while (item && item->received) item = item->next;
+        if (item && item->complete) {
+            item->received = true;
+            *size = item->size;
+            pthread_mutex_unlock(&r->lock);
+            return item->data;
+        }
+        if (!wait_on(&r->changed, &r->lock, ticks, &deadline)) break;
+    }
+    pthread_mutex_unlock(&r->lock);
+    return NULL;
+}
+
+void vRingbufferReturnItem(RingbufHandle_t r, void *data) {
+    RingItem *item = item_of(data);
+    pthread_mutex_lock(&r->lock);
+    RingItem *prev = NULL;
+    for (RingItem *it = r->first; it; prev = it, it = it->next) {
+        if (it != item) continue;
+        if (prev) prev->next = it->next;
+        else r->first = it->next;
+        if (r->last == it) r->last = prev;
+        r->used -= item_cost(it->size);
+        free(it);
+        break;
+    }
+    pthread_cond_broadcast(&r->changed);
+    pthread_mutex_unlock(&r->lock);
+}
+
+size_t xRingbufferGetCurFreeSize(RingbufHandle_t r) {
+    pthread_mutex_lock(&r->lock);
+    size_t free_size = r->size - r->used;
+    pthread_mutex_unlock(&r->lock);
+    return free_size > RINGBUF_ITEM_HEADER ? free_size - RINGBUF_ITEM_HEADER : 0;
+}
@@ -0,0 +1,114 @@
+// Host shim: GPIO pins the tests drive and inspect
+
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+
+static HostGpio pins[GPIO_NUM_MAX];
+static bool isr_service_installed;
+static HostGpioLevelHook level_hook;
+
+HostGpio *host_gpio(gpio_num_t gpio) {
+    return &pins[gpio];
+}
+
+void host_gpio_reset_all(void) {
+    memset(pins, 0, sizeof(pins));
+    isr_service_installed = false;
+    level_hook = NULL;
+}
+
+void host_gpio_on_set_level(HostGpioLevelHook hook) {
+    level_hook = hook;
+}
+
+static bool edge_matches(gpio_int_type_t type, int prev, int level) {
+    switch (type) {
+        case GPIO_INTR_POSEDGE:    return !prev && level;
+        case GPIO_INTR_NEGEDGE:    return prev && !level;
+        case GPIO_INTR_ANYEDGE:    return prev != level;
+        case GPIO_INTR_LOW_LEVEL:  return !level;
+        case GPIO_INTR_HIGH_LEVEL: return level;
+        default:                   return false;
+    }
+}
+
+void host_gpio_drive(gpio_num_t gpio, int level) {
+    HostGpio *pin = &pins[gpio];
+    int prev = __atomic_exchange_n(&pin->level, level ? 1 : 0, __ATOMIC_SEQ_CST);
+    if (pin->handler && pin->intrEnabled && edge_matches(pin->intrType, prev, level ? 1 : 0)) {
+        host_isr_enter();
+        pin->handler(pin->arg);
+        host_isr_exit();
+    }
+}
+
+esp_err_t gpio_config(const gpio_config_t *cfg) {
+    for (int gpio = 0; gpio < GPIO_NUM_MAX; gpio++) {
+        if (!(cfg->pin_bit_mask & (1ULL << gpio))) continue;
+        if (!GPIO_IS_VALID_GPIO(gpio)) return ESP_ERR_INVALID_ARG;
+        if ((cfg->mode & GPIO_MODE_OUTPUT) && !GPIO_IS_VALID_OUTPUT_GPIO(gpio)) return ESP_ERR_INVALID_ARG;
+        pins[gpio].mode = cfg->mode;
+        pins[gpio].pullUp = cfg->pull_up_en == GPIO_PULLUP_ENABLE;
+        pins[gpio].intrType = cfg->intr_type;
+        pins[gpio].intrEnabled = cfg->intr_type != GPIO_INTR_DISABLE;
+    }
+    return ESP_OK;
+}
+
+// Like the SDK: GPIO function, pull-up on, input and output off, interrupt off
+esp_err_t gpio_reset_pin(gpio_num_t gpio) {
+    if (!GPIO_IS_VALID_GPIO(gpio)) return ESP_ERR_INVALID_ARG;
+    pins[gpio].mode = GPIO_MODE_DISABLE;
+    pins[gpio].pullUp = true;
+    pins[gpio].intrType = GPIO_INTR_DISABLE;
+    pins[gpio].intrEnabled = false;
+    __atomic_fetch_add(&pins[gpio].resets, 1, __ATOMIC_RELAXED);
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level) {
+    if (!GPIO_IS_VALID_OUTPUT_GPIO(gpio)) return ESP_ERR_INVALID_ARG;
+    __atomic_store_n(&pins[gpio].level, level ? 1 : 0, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&pins[gpio].levelWrites, 1, __ATOMIC_RELAXED);
+    if (level_hook) level_hook(gpio, level ? 1 : 0);
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio) {
+    if (!GPIO_IS_VALID_GPIO(gpio)) return 0;
+    return __atomic_load_n(&pins[gpio].level, __ATOMIC_SEQ_CST);
+}
+
+esp_err_t gpio_install_isr_service(int flags) {
+    if (isr_service_installed) return ESP_ERR_INVALID_STATE;
+    isr_service_installed = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio, gpio_isr_t handler, void *arg) {
+    if (!GPIO_IS_VALID_GPIO(gpio)) return ESP_ERR_INVALID_ARG;
+    if (!isr_service_installed) return ESP_ERR_INVALID_STATE;
+    pins[gpio].arg = arg;
+    pins[gpio].handler = handler;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio) {
+    if (!GPIO_IS_VALID_GPIO(gpio)) return ESP_ERR_INVALID_ARG;
+    pins[gpio].handler = NULL;
+    pins[gpio].arg = NULL;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t gpio) {
+    if (!GPIO_IS_VALID_GPIO(gpio)) return ESP_ERR_INVALID_ARG;
+    pins[gpio].intrEnabled = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t gpio) {
+    if (!GPIO_IS_VALID_GPIO(gpio)) return ESP_ERR_INVALID_ARG;
+    pins[gpio].intrEnabled = false;
+    return ESP_OK;
+}
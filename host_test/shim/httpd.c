@@ -0,0 +1,532 @@
+// Host shim: esp_http_server on POSIX sockets, one server task multiplexing every client with
+// select() like the SDK's httpd. Requests are parsed into httpd_req_t and handed to the
+// registered handlers on that task; replies go out with Content-Length or chunked.
+
+#include "esp_http_server.h"
+#include "freertos/task.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define HEAD_MAX 2048           // request line and headers, plus whatever pipelined bytes follow
+#define SELECT_POLL_MS 50       // how soon the task notices httpd_stop
+
+typedef struct {
+    int fd;                     // -1: slot free
+    uint64_t lastUse;           // for LRU purge
+    HostHttpdSink sink;         // host_httpd_req_begin: reply bytes go here instead of fd
+    void *sinkArg;
+    char buf[HEAD_MAX + 1];
+    size_t len;
+} Session;
+
+typedef struct {
+    const char *field;
+    const char *value;
+} RespHeader;
+
+// Per request, behind httpd_req_t.aux
+typedef struct {
+    Session *session;
+    size_t headLen;             // bytes of buf taken by the request head
+    size_t bodyOffset;          // next unread body byte in buf
+    size_t remaining;           // body bytes not read by the handler yet
+    const char *status;
+    const char *type;
+    RespHeader headers[16];
+    int headerCount;
+    bool chunked;               // chunked reply under way
+    bool closeAfter;
+} ReqContext;
+
+typedef struct {
+    httpd_config_t config;
+    int listenFd;
+    uint16_t port;
+    httpd_uri_t *handlers;
+    int handlerCount;
+    Session *sessions;
+    uint64_t useCounter;
+    volatile bool stopping;
+    bool stopped;
+    pthread_mutex_t lock;
+    pthread_cond_t stoppedCond;
+} Server;
+
+static int listen_port = -1;    // host_httpd_listen_on, -1: use server_port on every interface
+static Server *running;
+
+void host_httpd_listen_on(uint16_t port) {
+    listen_port = port;
+}
+
+uint16_t host_httpd_port(void) {
+    return running ? running->port : 0;
+}
+
+//*************** Sending *****************************//
+
+static esp_err_t send_all(Session *session, const char *data, size_t len) {
+    if (session->sink) {
+        session->sink(data, len, session->sinkArg);
+        return ESP_OK;
+    }
+    while (len > 0) {
+        ssize_t n = send(session->fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0) return ESP_ERR_HTTPD_RESP_SEND;
+        data += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t send_head(httpd_req_t *r, const char *lengthHeader) {
+    ReqContext *ctx = r->aux;
+    char head[1024];
+    int len = snprintf(head, sizeof(head), "HTTP/1.1 %s\r\nContent-Type: %s\r\n%s",
+                       ctx->status, ctx->type, lengthHeader);
+    for (int i = 0; i < ctx->headerCount && len < (int)sizeof(head); i++) {
+        len += snprintf(head + len, sizeof(head) - len, "%s: %s\r\n", ctx->headers[i].field, ctx->headers[i].value);
+    }
+    if (len + 2 >= (int)sizeof(head)) return ESP_ERR_HTTPD_RESP_HDR;
+    memcpy(head + len, "\r\n", 2);
+    return send_all(ctx->session, head, len + 2);
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status) {
+    ((ReqContext *)r->aux)->status = status;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type) {
+    ((ReqContext *)r->aux)->type = type;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value) {
+    ReqContext *ctx = r->aux;
+    Server *s = r->handle;
+    if (ctx->headerCount >= s->config.max_resp_headers ||
+        ctx->headerCount >= (int)(sizeof(ctx->headers) / sizeof(ctx->headers[0]))) {
+        return ESP_ERR_HTTPD_RESP_HDR;
+    }
+    ctx->headers[ctx->headerCount++] = (RespHeader){ field, value };
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len) {
+    if (buf_len == HTTPD_RESP_USE_STRLEN) buf_len = buf ? strlen(buf) : 0;
+    char length[40];
+    snprintf(length, sizeof(length), "Content-Length: %d\r\n", (int)buf_len);
+    esp_err_t err = send_head(r, length);
+    if (err == ESP_OK && buf_len > 0) err = send_all(((ReqContext *)r->aux)->session, buf, buf_len);
+    return err;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len) {
+    ReqContext *ctx = r->aux;
+    if (buf_len == HTTPD_RESP_USE_STRLEN) buf_len = buf ? strlen(buf) : 0;
+    if (!ctx->chunked) {
+        esp_err_t err = send_head(r, "Transfer-Encoding: chunked\r\n");
+        if (err != ESP_OK) return err;
+        ctx->chunked = true;
+    }
+    char size[16];
+    int len = snprintf(size, sizeof(size), "%x\r\n", (unsigned)buf_len);
+    if (send_all(ctx->session, size, len) != ESP_OK) return ESP_ERR_HTTPD_RESP_SEND;
+    if (buf_len > 0 && send_all(ctx->session, buf, buf_len) != ESP_OK) return ESP_ERR_HTTPD_RESP_SEND;
+    return send_all(ctx->session, "\r\n", 2);
+}
+
+static const char *const err_status[HTTPD_ERR_CODE_MAX] = {
+    [HTTPD_500_INTERNAL_SERVER_ERROR]    = "500 Internal Server Error",
+    [HTTPD_501_METHOD_NOT_IMPLEMENTED]   = "501 Method Not Implemented",
+    [HTTPD_505_VERSION_NOT_SUPPORTED]    = "505 Version Not Supported",
+    [HTTPD_400_BAD_REQUEST]              = "400 Bad Request",
+    [HTTPD_401_UNAUTHORIZED]             = "401 Unauthorized",
+    [HTTPD_403_FORBIDDEN]                = "403 Forbidden",
+    [HTTPD_404_NOT_FOUND]                = "404 Not Found",
+    [HTTPD_405_METHOD_NOT_ALLOWED]       = "405 Method Not Allowed",
+    [HTTPD_408_REQ_TIMEOUT]              = "408 Request Timeout",
+    [HTTPD_411_LENGTH_REQUIRED]          = "411 Length Required",
+    [HTTPD_414_URI_TOO_LONG]             = "414 URI Too Long",
+    [HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE] = "431 Request Header Fields Too Large",
+};
+
+esp_err_t httpd_resp_send_err(httpd_req_t *r, httpd_err_code_t error, const char *msg) {
+    ReqContext *ctx = r->aux;
+    const char *status = error < HTTPD_ERR_CODE_MAX ? err_status[error] : err_status[HTTPD_500_INTERNAL_SERVER_ERROR];
+    ctx->status = status;
+    ctx->type = "text/html";
+    ctx->closeAfter = true;     // like the SDK, the connection goes after an error reply
+    return httpd_resp_send(r, msg ? msg : status + 4, HTTPD_RESP_USE_STRLEN);
+}
+
+//*************** Receiving *****************************//
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len) {
+    ReqContext *ctx = r->aux;
+    Session *session = ctx->session;
+    if (buf_len > ctx->remaining) buf_len = ctx->remaining;
+    if (buf_len == 0) return 0;
+
+    // Body bytes that came in with the head first
+    size_t buffered = session->len - ctx->bodyOffset;
+    if (buffered > 0) {
+        size_t n = buffered < buf_len ? buffered : buf_len;
+        memcpy(buf, session->buf + ctx->bodyOffset, n);
+        ctx->bodyOffset += n;
+        ctx->remaining -= n;
+        return n;
+    }
+
+    ssize_t n = recv(session->fd, buf, buf_len, 0);
+    if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+    ctx->remaining -= n;
+    return n;
+}
+
+// Case-insensitive header lookup in the request head
+static const char *find_header(const ReqContext *ctx, const char *field, size_t *len) {
+    const char *p = strstr(ctx->session->buf, "\r\n");
+    const char *end = ctx->session->buf + ctx->headLen;
+    size_t fieldLen = strlen(field);
+    while (p && p + 2 < end) {
+        p += 2;
+        const char *eol = strstr(p, "\r\n");
+        if (!eol || eol >= end) break;
+        if ((size_t)(eol - p) > fieldLen && strncasecmp(p, field, fieldLen) == 0 && p[fieldLen] == ':') {
+            const char *v = p + fieldLen + 1;
+            while (*v == ' ' || *v == '\t') v++;
+            *len = eol - v;
+            return v;
+        }
+        p = eol;
+    }
+    return NULL;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size) {
+    size_t len;
+    const char *v = find_header(r->aux, field, &len);
+    if (!v) return ESP_ERR_NOT_FOUND;
+    if (val_size == 0) return ESP_ERR_HTTPD_RESULT_TRUNC;
+    size_t n = len < val_size - 1 ? len : val_size - 1;
+    memcpy(val, v, n);
+    val[n] = '\0';
+    return n < len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+//*************** Server task *****************************//
+
+static void close_session(Session *session) {
+    // Read what already arrived first: closing with unread bytes sends a reset, which can
+    // overtake the error reply
+    char discard[1024];
+    for (int i = 0; i < 64 && recv(session->fd, discard, sizeof(discard), MSG_DONTWAIT) > 0; i++) {
+    }
+    close(session->fd);
+    session->fd = -1;
+    session->len = 0;
+}
+
+static const httpd_uri_t *find_handler(Server *s, const char *uri, size_t uriLen, int method, bool *uriKnown) {
+    const httpd_uri_t *match = NULL;
+    pthread_mutex_lock(&s->lock);
+    for (int i = 0; i < s->handlerCount && !match; i++) {
+        const httpd_uri_t *h = &s->handlers[i];
+        if (strlen(h->uri) != uriLen || strncmp(h->uri, uri, uriLen) != 0) continue;
+        *uriKnown = true;
+        if ((int)h->method == method) match = h;
+    }
+    pthread_mutex_unlock(&s->lock);
+    return match;
+}
+
+static int parse_method(const char *m, size_t len) {
+    static const struct { const char *name; int method; } methods[] = {
+        { "GET", HTTP_GET }, { "POST", HTTP_POST }, { "HEAD", HTTP_HEAD }, { "PUT", HTTP_PUT }, { "DELETE", HTTP_DELETE },
+    };
+    for (size_t i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+        if (strlen(methods[i].name) == len && strncmp(methods[i].name, m, len) == 0) return methods[i].method;
+    }
+    return -1;
+}
+
+// Serves the request whose head sits at the start of the session buffer. Returns false when the
+// connection has to be closed.
+static bool serve_request(Server *s, Session *session, size_t headLen) {
+    httpd_req_t req = { .handle = s };
+    ReqContext ctx = { .session = session, .headLen = headLen, .bodyOffset = headLen, .status = "200 OK",
+                       .type = "text/html" };
+    req.aux = &ctx;
+
+    // Request line: METHOD SP URI SP VERSION
+    const char *line = session->buf;
+    const char *sp1 = memchr(line, ' ', headLen);
+    const char *sp2 = sp1 ? memchr(sp1 + 1, ' ', headLen - (sp1 + 1 - line)) : NULL;
+    const char *eol = strstr(line, "\r\n");
+    if (!sp1 || !sp2 || sp2 > eol) {
+        httpd_resp_send_err(&req, HTTPD_400_BAD_REQUEST, NULL);
+        return false;
+    }
+    req.method = parse_method(line, sp1 - line);
+    size_t uriLen = sp2 - sp1 - 1;
+    if (uriLen > HTTPD_MAX_URI_LEN) {
+        httpd_resp_send_err(&req, HTTPD_414_URI_TOO_LONG, NULL);
+        return false;
+    }
+    memcpy((char *)req.uri, sp1 + 1, uriLen);
+    ((char *)req.uri)[uriLen] = '\0';
+    bool http10 = strncmp(sp2 + 1, "HTTP/1.0", 8) == 0;
+
+    char value[32];
+    if (httpd_req_get_hdr_value_str(&req, "Content-Length", value, sizeof(value)) == ESP_OK) {
+        req.content_len = strtoul(value, NULL, 10);
+    }
+    ctx.remaining = req.content_len;
+    bool closeRequested = http10;
+    if (httpd_req_get_hdr_value_str(&req, "Connection", value, sizeof(value)) == ESP_OK) {
+        closeRequested = strcasecmp(value, "close") == 0 || (http10 && strcasecmp(value, "keep-alive") != 0);
+    }
+
+    // Handlers match the path without the query string, like the SDK's default matcher
+    bool uriKnown = false;
+    const httpd_uri_t *handler = find_handler(s, req.uri, strcspn(req.uri, "?"), req.method, &uriKnown);
+    if (!handler) {
+        httpd_resp_send_err(&req, uriKnown ? HTTPD_405_METHOD_NOT_ALLOWED : HTTPD_404_NOT_FOUND, NULL);
+        return false;
+    }
+    req.user_ctx = handler->user_ctx;
+    if (handler->handler(&req) != ESP_OK || ctx.closeAfter) return false;
+
+    // Drop what the handler left of the body, keep pipelined bytes of the next request
+    char discard[256];
+    while (ctx.remaining > 0) {
+        if (httpd_req_recv(&req, discard, sizeof(discard)) <= 0) return false;
+    }
+    memmove(session->buf, session->buf + ctx.bodyOffset, session->len - ctx.bodyOffset);
+    session->len -= ctx.bodyOffset;
+    session->buf[session->len] = '\0';
+    return !closeRequested;
+}
+
+// Reads from a readable session and serves every complete request it holds
+static void serve_session(Server *s, Session *session) {
+    for (;;) {
+        char *end = strstr(session->buf, "\r\n\r\n");
+        if (end) {
+            session->lastUse = ++s->useCounter;
+            if (!serve_request(s, session, end + 4 - session->buf)) {
+                close_session(session);
+                return;
+            }
+            if (session->len > 0) continue;  // pipelined request
+            return;
+        }
+        if (session->len == HEAD_MAX) {
+            static const char tooLarge[] = "HTTP/1.1 431 Request Header Fields Too Large\r\nContent-Length: 0\r\n\r\n";
+            send_all(session, tooLarge, sizeof(tooLarge) - 1);
+            close_session(session);
+            return;
+        }
+        ssize_t n = recv(session->fd, session->buf + session->len, HEAD_MAX - session->len, 0);
+        if (n <= 0) {
+            close_session(session);  // closed by the client, or the head stalled past recv_wait_timeout
+            return;
+        }
+        session->len += n;
+        session->buf[session->len] = '\0';
+        if (!strstr(session->buf, "\r\n\r\n") && session->len < HEAD_MAX) {
+            // Rest of the head not there yet: wait for it on this socket, within the recv timeout
+            continue;
+        }
+    }
+}
+
+static void set_socket_options(Server *s, int fd) {
+    struct timeval rcv = { .tv_sec = s->config.recv_wait_timeout };
+    struct timeval snd = { .tv_sec = s->config.send_wait_timeout };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &rcv, sizeof(rcv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &snd, sizeof(snd));
+    if (s->config.keep_alive_enable) {
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &s->config.keep_alive_idle, sizeof(int));
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &s->config.keep_alive_interval, sizeof(int));
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &s->config.keep_alive_count, sizeof(int));
+    }
+    // Nagle against Linux's 40 ms delayed ACK would time the host stack, not the handlers
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+// A new client takes a free session; when none is left the least recently used one is closed
+// (lru_purge_enable) or the new client is
+static void accept_client(Server *s) {
+    int fd = accept(s->listenFd, NULL, NULL);
+    if (fd < 0) return;
+    Session *free_slot = NULL, *lru = NULL;
+    for (int i = 0; i < s->config.max_open_sockets; i++) {
+        Session *session = &s->sessions[i];
+        if (session->fd < 0) {
+            if (!free_slot) free_slot = session;
+        } else if (!lru || session->lastUse < lru->lastUse) {
+            lru = session;
+        }
+    }
+    if (!free_slot && s->config.lru_purge_enable && lru) {
+        close_session(lru);
+        free_slot = lru;
+    }
+    if (!free_slot) {
+        close(fd);
+        return;
+    }
+    set_socket_options(s, fd);
+    free_slot->fd = fd;
+    free_slot->len = 0;
+    free_slot->buf[0] = '\0';
+    free_slot->lastUse = ++s->useCounter;
+}
+
+static void server_task(void *arg) {
+    Server *s = arg;
+    while (!s->stopping) {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(s->listenFd, &readable);
+        int maxFd = s->listenFd;
+        for (int i = 0; i < s->config.max_open_sockets; i++) {
+            if (s->sessions[i].fd < 0) continue;
+            FD_SET(s->sessions[i].fd, &readable);
+            if (s->sessions[i].fd > maxFd) maxFd = s->sessions[i].fd;
+        }
+        struct timeval poll = { .tv_usec = SELECT_POLL_MS * 1000 };
+        if (select(maxFd + 1, &readable, NULL, NULL, &poll) <= 0) continue;
+
+        for (int i = 0; i < s->config.max_open_sockets && !s->stopping; i++) {
+            if (s->sessions[i].fd >= 0 && FD_ISSET(s->sessions[i].fd, &readable)) serve_session(s, &s->sessions[i]);
+        }
+        if (FD_ISSET(s->listenFd, &readable)) accept_client(s);
+    }
+
+    pthread_mutex_lock(&s->lock);
+    s->stopped = true;
+    pthread_cond_broadcast(&s->stoppedCond);
+    pthread_mutex_unlock(&s->lock);
+    vTaskDelete(NULL);
+}
+
+//*************** Start / stop *****************************//
+
+static void free_server(Server *s) {
+    if (s->listenFd >= 0) close(s->listenFd);
+    for (int i = 0; s->sessions && i < s->config.max_open_sockets; i++) {
+        if (s->sessions[i].fd >= 0) close(s->sessions[i].fd);
+    }
+    free(s->sessions);
+    free(s->handlers);
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->stoppedCond);
+    free(s);
+}
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config) {
+    if (!handle || !config || config->max_open_sockets == 0) return ESP_ERR_INVALID_ARG;
+    Server *s = calloc(1, sizeof(Server));
+    if (!s) return ESP_ERR_NO_MEM;
+    s->config = *config;
+    s->listenFd = -1;
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->stoppedCond, NULL);
+    s->handlers = calloc(config->max_uri_handlers, sizeof(httpd_uri_t));
+    s->sessions = calloc(config->max_open_sockets, sizeof(Session));
+    if (!s->handlers || !s->sessions) {
+        free_server(s);
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < config->max_open_sockets; i++) s->sessions[i].fd = -1;
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(listen_port >= 0 ? listen_port : config->server_port),
+        .sin_addr.s_addr = htonl(listen_port >= 0 ? INADDR_LOOPBACK : INADDR_ANY),
+    };
+    socklen_t addrLen = sizeof(addr);
+    int one = 1;
+    s->listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (s->listenFd < 0 || setsockopt(s->listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+        bind(s->listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(s->listenFd, config->backlog_conn) != 0 ||
+        getsockname(s->listenFd, (struct sockaddr *)&addr, &addrLen) != 0) {
+        free_server(s);
+        return ESP_FAIL;
+    }
+    s->port = ntohs(addr.sin_port);
+    if (listen_port == 0) listen_port = s->port;  // a restarted server comes back on the same port
+
+    running = s;
+    if (xTaskCreatePinnedToCore(server_task, "httpd", config->stack_size, s, config->task_priority, NULL,
+                                config->core_id) != pdPASS) {
+        running = NULL;
+        free_server(s);
+        return ESP_ERR_HTTPD_TASK;
+    }
+    *handle = s;
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle) {
+    Server *s = handle;
+    if (!s) return ESP_ERR_INVALID_ARG;
+    s->stopping = true;
+    pthread_mutex_lock(&s->lock);
+    while (!s->stopped) pthread_cond_wait(&s->stoppedCond, &s->lock);
+    pthread_mutex_unlock(&s->lock);
+    if (running == s) running = NULL;
+    free_server(s);
+    return ESP_OK;
+}
+
+// Backs the requests of host_httpd_req_begin, one at a time
+static struct {
+    Server server;
+    Session session;
+    ReqContext ctx;
+} direct;
+
+void host_httpd_req_begin(httpd_req_t *req, HostHttpdSink sink, void *arg) {
+    memset(&direct, 0, sizeof(direct));
+    direct.server.config.max_resp_headers = 8;
+    direct.session = (Session){ .fd = -1, .sink = sink, .sinkArg = arg };
+    direct.ctx = (ReqContext){ .session = &direct.session, .status = "200 OK", .type = "text/html" };
+    memset(req, 0, sizeof(*req));
+    req->handle = &direct.server;
+    req->method = HTTP_GET;
+    req->aux = &direct.ctx;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler) {
+    Server *s = handle;
+    if (!s || !uri_handler) return ESP_ERR_INVALID_ARG;
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&s->lock);
+    for (int i = 0; i < s->handlerCount; i++) {
+        if (strcmp(s->handlers[i].uri, uri_handler->uri) == 0 && s->handlers[i].method == uri_handler->method) {
+            err = ESP_ERR_HTTPD_HANDLER_EXISTS;
+        }
+    }
+    if (err == ESP_OK && s->handlerCount == s->config.max_uri_handlers) err = ESP_ERR_HTTPD_HANDLERS_FULL;
+    if (err == ESP_OK) s->handlers[s->handlerCount++] = *uri_handler;
+    pthread_mutex_unlock(&s->lock);
+    return err;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+// Host shim: 40 ESP32 GPIOs. Outputs keep their level, inputs are driven by host_gpio_drive(),
+// which runs the registered handler "in ISR context" on the calling thread when the edge matches.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef int gpio_num_t;
+
+#define GPIO_NUM_NC  -1
+#define GPIO_NUM_MAX 40
+
+// ESP32: no GPIO 20, 24 or 28-31, 34-39 are input only
+#define HOST_GPIO_VALID_MASK         (0xFFFFFFFFFFULL & ~((1ULL << 20) | (1ULL << 24) | (0xFULL << 28)))
+#define GPIO_IS_VALID_GPIO(n)        ((n) >= 0 && (n) < GPIO_NUM_MAX && ((HOST_GPIO_VALID_MASK >> (n)) & 1))
+#define GPIO_IS_VALID_OUTPUT_GPIO(n) (GPIO_IS_VALID_GPIO(n) && (n) < 34)
+
+typedef enum {
+    GPIO_MODE_DISABLE = 0,
+    GPIO_MODE_INPUT = 1,
+    GPIO_MODE_OUTPUT = 2,
+    GPIO_MODE_INPUT_OUTPUT = 3,
+} gpio_mode_t;
+
+typedef enum {
+    GPIO_PULLUP_DISABLE,
+    GPIO_PULLUP_ENABLE
+} gpio_pullup_t;
+
+typedef enum {
+    GPIO_PULLDOWN_DISABLE,
+    GPIO_PULLDOWN_ENABLE
+} gpio_pulldown_t;
+
+typedef enum {
+    GPIO_INTR_DISABLE,
+    GPIO_INTR_POSEDGE,
+    GPIO_INTR_NEGEDGE,
+    GPIO_INTR_ANYEDGE,
+    GPIO_INTR_LOW_LEVEL,
+    GPIO_INTR_HIGH_LEVEL
+} gpio_int_type_t;
+
+typedef struct {
+    uint64_t pin_bit_mask;
+    gpio_mode_t mode;
+    gpio_pullup_t pull_up_en;
+    gpio_pulldown_t pull_down_en;
+    gpio_int_type_t intr_type;
+} gpio_config_t;
+
+typedef void (*gpio_isr_t)(void *arg);
+
+esp_err_t gpio_config(const gpio_config_t *cfg);
+esp_err_t gpio_reset_pin(gpio_num_t gpio);
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level);
+int gpio_get_level(gpio_num_t gpio);
+esp_err_t gpio_install_isr_service(int flags);
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio, gpio_isr_t handler, void *arg);
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio);
+esp_err_t gpio_intr_enable(gpio_num_t gpio);
+esp_err_t gpio_intr_disable(gpio_num_t gpio);
+
+// Test hooks
+typedef struct {
+    gpio_mode_t mode;
+    bool pullUp;
+    int level;              // driven by the test for inputs, by the firmware for outputs
+    gpio_int_type_t intrType;
+    bool intrEnabled;
+    gpio_isr_t handler;
+    void *arg;
+    uint32_t resets;        // gpio_reset_pin calls
+    uint32_t levelWrites;   // gpio_set_level calls
+} HostGpio;
+
+void host_gpio_reset_all(void);
+HostGpio *host_gpio(gpio_num_t gpio);
+void host_gpio_drive(gpio_num_t gpio, int level);
+
+// Called by gpio_set_level on the firmware's thread once the level is written, NULL to stop
+typedef void (*HostGpioLevelHook)(gpio_num_t gpio, int level);
+void host_gpio_on_set_level(HostGpioLevelHook hook);
@@ -0,0 +1,6 @@
+#pragma once
+
+// Host shim: handle types only, gpi_counter.c is faked (fakes/fake_gpi_counter.c)
+
+typedef struct pcnt_unit_t *pcnt_unit_handle_t;
+typedef struct pcnt_chan_t *pcnt_channel_handle_t;
@@ -0,0 +1,15 @@
+#pragma once
+
+// Host shim: the Ethernet driver events, posted by tests through host_event_post()
+
+#include "esp_eth_driver.h"
+#include "esp_event.h"
+
+extern const esp_event_base_t ETH_EVENT;
+
+typedef enum {
+    ETHERNET_EVENT_START,
+    ETHERNET_EVENT_STOP,
+    ETHERNET_EVENT_CONNECTED,
+    ETHERNET_EVENT_DISCONNECTED,
+} eth_event_t;
@@ -0,0 +1,14 @@
+#pragma once
+
+// Host shim: the Ethernet driver handle and its RX input path. host_eth_receive() feeds a frame to
+// the path from whichever task stands in for the driver's RX task.
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef void *esp_eth_handle_t;
+typedef esp_err_t (*esp_eth_stack_input_cb_t)(esp_eth_handle_t eth, uint8_t *buffer, uint32_t length, void *priv);
+
+esp_err_t esp_eth_update_input_path(esp_eth_handle_t eth, esp_eth_stack_input_cb_t input, void *priv);
+
+esp_err_t host_eth_receive(esp_eth_handle_t eth, uint32_t length);
@@ -0,0 +1,18 @@
+#pragma once
+
+// Host shim: the default event loop. host_event_post() runs the handlers in the caller's thread,
+// standing in for the event loop task.
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef const char *esp_event_base_t;
+typedef void (*esp_event_handler_t)(void *arg, esp_event_base_t base, int32_t id, void *data);
+
+#define ESP_EVENT_ANY_ID -1
+
+esp_err_t esp_event_loop_create_default(void);
+esp_err_t esp_event_handler_register(esp_event_base_t base, int32_t id, esp_event_handler_t handler, void *arg);
+
+void host_event_post(esp_event_base_t base, int32_t id, void *data);
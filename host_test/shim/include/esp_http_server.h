@@ -0,0 +1,144 @@
+#pragma once
+
+// Host shim: esp_http_server on POSIX sockets. Like the SDK, one task serves every client with
+// select(), handlers run on it one request at a time, and a handler that returns an error closes
+// its connection. Covers what web_server.c uses: exact URI matching, content_len and
+// httpd_req_recv with the recv timeout, Content-Length and chunked replies, keep-alive, and the
+// open socket limit with LRU purge.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#define ESP_ERR_HTTPD_BASE          0xb000
+#define ESP_ERR_HTTPD_HANDLERS_FULL (ESP_ERR_HTTPD_BASE + 1)
+#define ESP_ERR_HTTPD_HANDLER_EXISTS (ESP_ERR_HTTPD_BASE + 2)
+#define ESP_ERR_HTTPD_INVALID_REQ   (ESP_ERR_HTTPD_BASE + 3)
+#define ESP_ERR_HTTPD_RESULT_TRUNC  (ESP_ERR_HTTPD_BASE + 4)
+#define ESP_ERR_HTTPD_RESP_HDR      (ESP_ERR_HTTPD_BASE + 5)
+#define ESP_ERR_HTTPD_RESP_SEND     (ESP_ERR_HTTPD_BASE + 6)
+#define ESP_ERR_HTTPD_TASK          (ESP_ERR_HTTPD_BASE + 8)
+
+#define HTTPD_RESP_USE_STRLEN   -1
+
+// httpd_req_recv results besides the byte count
+#define HTTPD_SOCK_ERR_FAIL     -1
+#define HTTPD_SOCK_ERR_INVALID  -2
+#define HTTPD_SOCK_ERR_TIMEOUT  -3
+
+typedef void *httpd_handle_t;
+
+typedef enum {
+    HTTP_DELETE = 0,
+    HTTP_GET = 1,
+    HTTP_HEAD = 2,
+    HTTP_POST = 3,
+    HTTP_PUT = 4,
+} httpd_method_t;
+
+typedef enum {
+    HTTPD_500_INTERNAL_SERVER_ERROR = 0,
+    HTTPD_501_METHOD_NOT_IMPLEMENTED,
+    HTTPD_505_VERSION_NOT_SUPPORTED,
+    HTTPD_400_BAD_REQUEST,
+    HTTPD_401_UNAUTHORIZED,
+    HTTPD_403_FORBIDDEN,
+    HTTPD_404_NOT_FOUND,
+    HTTPD_405_METHOD_NOT_ALLOWED,
+    HTTPD_408_REQ_TIMEOUT,
+    HTTPD_411_LENGTH_REQUIRED,
+    HTTPD_414_URI_TOO_LONG,
+    HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE,
+    HTTPD_ERR_CODE_MAX
+} httpd_err_code_t;
+
+#define HTTPD_MAX_URI_LEN 512
+
+typedef struct httpd_req {
+    httpd_handle_t handle;
+    int method;                         // httpd_method_t
+    const char uri[HTTPD_MAX_URI_LEN + 1];
+    size_t content_len;
+    void *aux;
+    void *user_ctx;
+} httpd_req_t;
+
+typedef struct httpd_uri {
+    const char *uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *r);
+    void *user_ctx;
+} httpd_uri_t;
+
+typedef struct httpd_config {
+    unsigned task_priority;
+    size_t stack_size;
+    BaseType_t core_id;
+    uint16_t server_port;
+    uint16_t ctrl_port;
+    uint16_t max_open_sockets;
+    uint16_t max_uri_handlers;
+    uint16_t max_resp_headers;
+    uint16_t backlog_conn;
+    bool lru_purge_enable;
+    uint16_t recv_wait_timeout;         // seconds
+    uint16_t send_wait_timeout;         // seconds
+    bool keep_alive_enable;
+    int keep_alive_idle;
+    int keep_alive_interval;
+    int keep_alive_count;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG() {            \
+        .task_priority      = 5,            \
+        .stack_size         = 4096,         \
+        .core_id            = tskNO_AFFINITY, \
+        .server_port        = 80,           \
+        .ctrl_port          = 32768,        \
+        .max_open_sockets   = 7,            \
+        .max_uri_handlers   = 8,            \
+        .max_resp_headers   = 8,            \
+        .backlog_conn       = 5,            \
+        .lru_purge_enable   = false,        \
+        .recv_wait_timeout  = 5,            \
+        .send_wait_timeout  = 5,            \
+        .keep_alive_enable  = false,        \
+        .keep_alive_idle    = 0,            \
+        .keep_alive_interval = 0,           \
+        .keep_alive_count   = 0,            \
+    }
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config);
+esp_err_t httpd_stop(httpd_handle_t handle);
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler);
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len);
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size);
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status);
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type);
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value);
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_err(httpd_req_t *r, httpd_err_code_t error, const char *msg);
+
+static inline esp_err_t httpd_resp_sendstr(httpd_req_t *r, const char *str) {
+    return httpd_resp_send(r, str, str ? HTTPD_RESP_USE_STRLEN : 0);
+}
+
+static inline esp_err_t httpd_resp_send_404(httpd_req_t *r) {
+    return httpd_resp_send_err(r, HTTPD_404_NOT_FOUND, NULL);
+}
+
+// Test hooks: servers started from now on listen on 127.0.0.1:port instead of server_port (0
+// picks a free port), and the port the running server listens on
+void host_httpd_listen_on(uint16_t port);
+uint16_t host_httpd_port(void);
+
+// Benchmark hook: sets up req as a GET on no connection, for calling a handler directly. The
+// reply bytes go to sink. One such request at a time, the next call reuses its state.
+typedef void (*HostHttpdSink)(const char *data, size_t len, void *arg);
+void host_httpd_req_begin(httpd_req_t *req, HostHttpdSink sink, void *arg);
@@ -0,0 +1,52 @@
+#pragma once
+
+// Host shim: netif handles with an interface name and an IPv4 address, created by the test with
+// host_netif_new(). IP events are posted through host_event_post().
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_event.h"
+
+typedef struct esp_netif_obj esp_netif_t;
+
+typedef struct {
+    uint32_t addr;
+} esp_ip4_addr_t;
+
+typedef struct {
+    esp_ip4_addr_t ip;
+    esp_ip4_addr_t netmask;
+    esp_ip4_addr_t gw;
+} esp_netif_ip_info_t;
+
+typedef enum {
+    ESP_NETIF_DHCP_INIT,
+    ESP_NETIF_DHCP_STARTED,
+    ESP_NETIF_DHCP_STOPPED,
+} esp_netif_dhcp_status_t;
+
+extern const esp_event_base_t IP_EVENT;
+
+typedef enum {
+    IP_EVENT_ETH_GOT_IP = 5,
+    IP_EVENT_ETH_LOST_IP,
+} ip_event_t;
+
+typedef struct {
+    esp_netif_t *esp_netif;
+    esp_netif_ip_info_t ip_info;
+    bool ip_changed;
+} ip_event_got_ip_t;
+
+esp_err_t esp_netif_get_ip_info(esp_netif_t *netif, esp_netif_ip_info_t *ip_info);
+esp_err_t esp_netif_set_ip_info(esp_netif_t *netif, const esp_netif_ip_info_t *ip_info);
+esp_err_t esp_netif_get_netif_impl_name(esp_netif_t *netif, char *name);
+esp_err_t esp_netif_receive(esp_netif_t *netif, void *buffer, size_t len, void *eb);
+esp_err_t esp_netif_dhcpc_get_status(esp_netif_t *netif, esp_netif_dhcp_status_t *status);
+
+// New netifs start with DHCP running, like ESP_NETIF_DEFAULT_ETH
+esp_netif_t *host_netif_new(const char *ifname);
+void host_netif_set_dhcp(esp_netif_t *netif, esp_netif_dhcp_status_t status);
+int host_netif_rx_count(esp_netif_t *netif);              // frames handed to esp_netif_receive
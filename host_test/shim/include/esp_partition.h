@@ -0,0 +1,53 @@
+#pragma once
+
+// Host shim: flash emulator with NOR semantics. Erase sets a 4 KB sector to 0xFF, a write can
+// only clear bits (the result is old & new, like programming real NOR flash). The contents live
+// in a shared mapping, so a forked child that "loses power" leaves them for the next boot.
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+typedef enum {
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef int esp_partition_subtype_t;
+
+typedef struct {
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    uint32_t erase_size;
+    char label[17];
+} esp_partition_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t offset, void *dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t offset, const void *src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size);
+
+// Test hooks
+typedef struct {
+    uint32_t writes;        // esp_partition_write calls
+    uint32_t bytesWritten;
+    uint32_t erases;        // sectors erased
+    uint32_t foreignOps;    // writes and erases from a task other than the one host_flash_owner() named
+} HostFlashStats;
+
+// Creates (or recreates, erased) the partition esp_partition_find_first returns for label
+const esp_partition_t *host_flash_create(const char *label, esp_partition_subtype_t subtype, uint32_t size);
+uint8_t *host_flash_data(const esp_partition_t *part);
+HostFlashStats *host_flash_stats(void);
+
+// Names the only task expected to write or erase flash, NULL for any
+void host_flash_owner(const char *task);
+
+// Power cut: after `bytes` more bytes were programmed (erases count as one byte each) the write in
+// progress stops half way and the process exits with status 0, like a board losing power
+void host_flash_power_cut_after(uint32_t bytes);
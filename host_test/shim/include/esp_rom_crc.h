@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+// Same CRC-32 as the ROM (reflected 0xEDB88320, inverted in and out)
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len);
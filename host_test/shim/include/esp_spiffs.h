@@ -0,0 +1,9 @@
+#pragma once
+
+// Host shim: SPIFFS as a host directory. The firmware opens its files with plain fopen, so a
+// target that serves them links with -Wl,--wrap=fopen and paths under base_path resolve in dir.
+
+#include "esp_err.h"
+
+// Test hook: serve base_path (e.g. "/spiffs_data") from dir
+void host_spiffs_mount(const char *base_path, const char *dir);
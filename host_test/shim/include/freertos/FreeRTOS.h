@@ -0,0 +1,60 @@
+#pragma once
+
+// Host shim: FreeRTOS on pthreads. One tick is one millisecond. Tasks are threads, critical
+// sections are recursive mutexes, "ISR context" is a flag the GPIO shim sets around handlers.
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define pdFALSE                 0
+#define pdTRUE                  1
+#define pdFAIL                  0
+#define pdPASS                  1
+#define errQUEUE_FULL           0
+#define errQUEUE_EMPTY          0
+#define portMAX_DELAY           ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS      1
+#define configTICK_RATE_HZ      1000
+#define configMAX_PRIORITIES    25
+#define portNUM_PROCESSORS      2
+#define configASSERT(x)         assert(x)
+#define tskNO_AFFINITY          ((BaseType_t)0x7FFFFFFF)
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(ms))
+
+typedef struct {
+    pthread_mutex_t mutex;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP }
+
+static inline void host_mux_init(portMUX_TYPE *mux) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&mux->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+#define portMUX_INITIALIZE(mux)     host_mux_init(mux)
+#define portENTER_CRITICAL(mux)     pthread_mutex_lock(&(mux)->mutex)
+#define portEXIT_CRITICAL(mux)      pthread_mutex_unlock(&(mux)->mutex)
+#define portENTER_CRITICAL_ISR(mux) pthread_mutex_lock(&(mux)->mutex)
+#define portEXIT_CRITICAL_ISR(mux)  pthread_mutex_unlock(&(mux)->mutex)
+#define taskENTER_CRITICAL(mux)     portENTER_CRITICAL(mux)
+#define taskEXIT_CRITICAL(mux)      portEXIT_CRITICAL(mux)
+#define portYIELD_FROM_ISR(x)       ((void)(x))
+
+BaseType_t xPortInIsrContext(void);
+BaseType_t xPortGetCoreID(void);
+
+// Test hooks: code between these runs as if it were an interrupt handler
+void host_isr_enter(void);
+void host_isr_exit(void);
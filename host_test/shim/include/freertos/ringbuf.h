@@ -0,0 +1,24 @@
+#pragma once
+
+// Host shim: no-split ring buffer. Every item costs an 8-byte header plus its size rounded up to
+// 4 bytes, like the SDK, so "full" happens at about the same fill level.
+
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+
+typedef struct HostRingbuf *RingbufHandle_t;
+
+typedef enum {
+    RINGBUF_TYPE_NOSPLIT,
+    RINGBUF_TYPE_ALLOWSPLIT,
+    RINGBUF_TYPE_BYTEBUF
+} RingbufferType_t;
+
+RingbufHandle_t xRingbufferCreate(size_t size, RingbufferType_t type);
+void vRingbufferDelete(RingbufHandle_t ring);
+BaseType_t xRingbufferSend(RingbufHandle_t ring, const void *data, size_t size, TickType_t ticks);
+BaseType_t xRingbufferSendAcquire(RingbufHandle_t ring, void **item, size_t size, TickType_t ticks);
+BaseType_t xRingbufferSendComplete(RingbufHandle_t ring, void *item);
+void *xRingbufferReceive(RingbufHandle_t ring, size_t *size, TickType_t ticks);
+void vRingbufferReturnItem(RingbufHandle_t ring, void *item);
+size_t xRingbufferGetCurFreeSize(RingbufHandle_t ring);
@@ -0,0 +1,36 @@
+#pragma once
+
+// Host shim: lwIP address helpers over the libc ones, same byte order (network order in a u32)
+
+#include <stdint.h>
+#include <arpa/inet.h>
+
+typedef struct {
+    uint32_t addr;
+} ip4_addr_t;
+
+typedef ip4_addr_t ip_addr_t;
+
+static inline uint32_t ipaddr_addr(const char *cp) {
+    return inet_addr(cp);
+}
+
+// Returns 1 on success like lwIP, and accepts the same short forms ("10.1" and friends)
+static inline int ip4addr_aton(const char *cp, ip4_addr_t *addr) {
+    struct in_addr in;
+    if (!inet_aton(cp, &in)) return 0;
+    if (addr) addr->addr = in.s_addr;
+    return 1;
+}
+
+static inline char *ip4addr_ntoa(const ip4_addr_t *addr) {
+    struct in_addr in = { .s_addr = addr->addr };
+    return inet_ntoa(in);
+}
+
+#define IPSTR "%d.%d.%d.%d"
+#define esp_ip4_addr1_16(ipaddr) ((uint16_t)(((ipaddr)->addr) & 0xFF))
+#define esp_ip4_addr2_16(ipaddr) ((uint16_t)((((ipaddr)->addr) >> 8) & 0xFF))
+#define esp_ip4_addr3_16(ipaddr) ((uint16_t)((((ipaddr)->addr) >> 16) & 0xFF))
+#define esp_ip4_addr4_16(ipaddr) ((uint16_t)((((ipaddr)->addr) >> 24) & 0xFF))
+#define IP2STR(ipaddr) esp_ip4_addr1_16(ipaddr), esp_ip4_addr2_16(ipaddr), esp_ip4_addr3_16(ipaddr), esp_ip4_addr4_16(ipaddr)
@@ -0,0 +1,12 @@
+#pragma once
+
+// Host shim: lwIP's BSD socket API is the real one here
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
@@ -0,0 +1,29 @@
+#pragma once
+
+// Host shim: blob-only NVS backed by <program>.nvs in the working directory. Every write rewrites
+// the file, so a forked child's writes survive into the next "boot" like they would on flash.
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum {
+    NVS_READONLY,
+    NVS_READWRITE
+} nvs_open_mode_t;
+
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *out);
+void nvs_close(nvs_handle_t handle);
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out, size_t *length);
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length);
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key);
+esp_err_t nvs_commit(nvs_handle_t handle);
+
+// Test hooks
+void host_nvs_reset(void);                              // forget every key and delete the file
+void host_nvs_use_file(const char *path);               // back NVS with path instead, loaded now
+int host_nvs_write_count(void);                         // nvs_set_blob calls since the last reset
+void host_nvs_fail_writes(esp_err_t err);               // nvs_set_blob returns err until ESP_OK is set
+const char *host_nvs_last_writer(void);                 // task that made the last nvs_set_blob call, "" if none
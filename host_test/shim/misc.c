@@ -0,0 +1,76 @@
+// Host shim: ROM CRC, error names, shutdown handlers and heap figures
+
+#include "esp_err.h"
+#include "esp_rom_crc.h"
+#include "esp_rom_sys.h"
+#include "esp_system.h"
+#include <time.h>
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len) {
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+void esp_rom_delay_us(uint32_t us) {
+    struct timespec ts = { .tv_sec = us / 1000000, .tv_nsec = (long)(us % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK:                        return "ESP_OK";
+        case ESP_FAIL:                      return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:                return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:           return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:         return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:          return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:             return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED:         return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:               return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_RESPONSE:      return "ESP_ERR_INVALID_RESPONSE";
+        case ESP_ERR_INVALID_CRC:           return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_NOT_FINISHED:          return "ESP_ERR_NOT_FINISHED";
+        case ESP_ERR_NVS_NOT_INITIALIZED:   return "ESP_ERR_NVS_NOT_INITIALIZED";
+        case ESP_ERR_NVS_NOT_FOUND:         return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_INVALID_LENGTH:    return "ESP_ERR_NVS_INVALID_LENGTH";
+        case ESP_ERR_NVS_NO_FREE_PAGES:     return "ESP_ERR_NVS_NO_FREE_PAGES";
+        case ESP_ERR_NVS_NEW_VERSION_FOUND: return "ESP_ERR_NVS_NEW_VERSION_FOUND";
+        default:                            return "UNKNOWN ERROR";
+    }
+}
+
+#define MAX_SHUTDOWN_HANDLERS 5     // same limit as the SDK
+
+static shutdown_handler_t shutdown_handlers[MAX_SHUTDOWN_HANDLERS];
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler) {
+    for (int i = 0; i < MAX_SHUTDOWN_HANDLERS; i++) {
+        if (shutdown_handlers[i] == handler) return ESP_ERR_INVALID_STATE;
+        if (!shutdown_handlers[i]) {
+            shutdown_handlers[i] = handler;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void esp_restart(void) {
+    for (int i = MAX_SHUTDOWN_HANDLERS - 1; i >= 0; i--) {
+        if (shutdown_handlers[i]) shutdown_handlers[i]();
+    }
+    exit(0);
+}
+
+uint32_t esp_get_free_heap_size(void) {
+    return 200 * 1024;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void) {
+    return 180 * 1024;
+}
@@ -0,0 +1,121 @@
+// Host shim: default event loop and netif handles, enough for the link and IP state tracking
+
+#include "esp_eth.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_HANDLERS 8
+#define MAX_INPUT_PATHS 2
+
+const esp_event_base_t ETH_EVENT = "ETH_EVENT";
+const esp_event_base_t IP_EVENT = "IP_EVENT";
+
+typedef struct {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void *arg;
+} Handler;
+
+static Handler handlers[MAX_HANDLERS];
+static int handler_count;
+
+struct esp_netif_obj {
+    char ifname[8];
+    esp_netif_ip_info_t ip_info;
+    esp_netif_dhcp_status_t dhcp;
+    int rx_count;
+};
+
+typedef struct {
+    esp_eth_handle_t eth;
+    esp_eth_stack_input_cb_t input;
+    void *priv;
+} InputPath;
+
+static InputPath input_paths[MAX_INPUT_PATHS];
+
+esp_err_t esp_event_loop_create_default(void) {
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t base, int32_t id, esp_event_handler_t handler, void *arg) {
+    if (handler_count == MAX_HANDLERS) return ESP_ERR_NO_MEM;
+    handlers[handler_count++] = (Handler){ base, id, handler, arg };
+    return ESP_OK;
+}
+
+void host_event_post(esp_event_base_t base, int32_t id, void *data) {
+    for (int i = 0; i < handler_count; i++) {
+        if (handlers[i].base == base && (handlers[i].id == ESP_EVENT_ANY_ID || handlers[i].id == id)) {
+            handlers[i].handler(handlers[i].arg, base, id, data);
+        }
+    }
+}
+
+esp_netif_t *host_netif_new(const char *ifname) {
+    esp_netif_t *netif = calloc(1, sizeof(*netif));
+    if (!netif) return NULL;
+    strncpy(netif->ifname, ifname, sizeof(netif->ifname) - 1);
+    netif->dhcp = ESP_NETIF_DHCP_STARTED;
+    return netif;
+}
+
+void host_netif_set_dhcp(esp_netif_t *netif, esp_netif_dhcp_status_t status) {
+    netif->dhcp = status;
+}
+
+esp_err_t esp_netif_dhcpc_get_status(esp_netif_t *netif, esp_netif_dhcp_status_t *status) {
+    if (!netif) return ESP_ERR_INVALID_ARG;
+    *status = netif->dhcp;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_get_ip_info(esp_netif_t *netif, esp_netif_ip_info_t *ip_info) {
+    if (!netif) return ESP_ERR_INVALID_ARG;
+    *ip_info = netif->ip_info;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_set_ip_info(esp_netif_t *netif, const esp_netif_ip_info_t *ip_info) {
+    if (!netif) return ESP_ERR_INVALID_ARG;
+    netif->ip_info = *ip_info;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_get_netif_impl_name(esp_netif_t *netif, char *name) {
+    if (!netif) return ESP_ERR_INVALID_ARG;
+    strcpy(name, netif->ifname);
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_receive(esp_netif_t *netif, void *buffer, size_t len, void *eb) {
+    __atomic_add_fetch(&netif->rx_count, 1, __ATOMIC_RELAXED);
+    return ESP_OK;
+}
+
+int host_netif_rx_count(esp_netif_t *netif) {
+    return __atomic_load_n(&netif->rx_count, __ATOMIC_RELAXED);
+}
+
+esp_err_t esp_eth_update_input_path(esp_eth_handle_t eth, esp_eth_stack_input_cb_t input, void *priv) {
+    for (int i = 0; i < MAX_INPUT_PATHS; i++) {
+        if (!input_paths[i].eth || input_paths[i].eth == eth) {
+            input_paths[i] = (InputPath){ eth, input, priv };
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t host_eth_receive(esp_eth_handle_t eth, uint32_t length) {
+    uint8_t frame[1514] = { 0 };
+    for (int i = 0; i < MAX_INPUT_PATHS; i++) {
+        if (input_paths[i].eth == eth) {
+            return input_paths[i].input(eth, frame, length < sizeof(frame) ? length : sizeof(frame), input_paths[i].priv);
+        }
+    }
+    return ESP_ERR_INVALID_STATE;
+}
@@ -0,0 +1,240 @@
+// Host shim: blob-only NVS backed by a file. Keys are served from RAM; every write rewrites the
+// file, and a process that didn't load it yet (a forked "boot") reads it first.
+
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_NAMESPACES 8
+#define NVS_KEY_NAME_MAX_SIZE 16
+
+typedef struct NvsEntry {
+    struct NvsEntry *next;
+    uint8_t ns;
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    size_t length;
+    uint8_t data[];
+} NvsEntry;
+
+static pthread_mutex_t nvs_lock = PTHREAD_MUTEX_INITIALIZER;
+static char namespaces[MAX_NAMESPACES][NVS_KEY_NAME_MAX_SIZE];
+static int namespace_count;
+static NvsEntry *entries;
+static char mirror_path[256];      // "" until first use: <program>.nvs in the working directory
+static pid_t loaded_pid;            // process that has the file in RAM
+static int write_count;
+static esp_err_t write_error = ESP_OK;
+static char last_writer[16];
+
+static void ensure_loaded(void);
+static void save_mirror(void);
+
+esp_err_t nvs_flash_init(void) {
+    pthread_mutex_lock(&nvs_lock);
+    ensure_loaded();
+    pthread_mutex_unlock(&nvs_lock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+    host_nvs_reset();
+    return ESP_OK;
+}
+
+static NvsEntry **find(uint8_t ns, const char *key) {
+    NvsEntry **p = &entries;
+    while (*p && ((*p)->ns != ns || strcmp((*p)->key, key) != 0)) p = &(*p)->next;
+    return p;
+}
+
+static void put(uint8_t ns, const char *key, const void *value, size_t length) {
+    NvsEntry **p = find(ns, key);
+    NvsEntry *old = *p;
+    NvsEntry *e = malloc(sizeof(NvsEntry) + length);
+    e->next = old ? old->next : NULL;
+    e->ns = ns;
+    strncpy(e->key, key, sizeof(e->key) - 1);
+    e->key[sizeof(e->key) - 1] = '\0';
+    e->length = length;
+    memcpy(e->data, value, length);
+    *p = e;
+    free(old);
+}
+
+static int namespace_index(const char *name) {
+    for (int i = 0; i < namespace_count; i++) {
+        if (strcmp(namespaces[i], name) == 0) return i;
+    }
+    if (namespace_count == MAX_NAMESPACES) return -1;
+    strncpy(namespaces[namespace_count], name, NVS_KEY_NAME_MAX_SIZE - 1);
+    return namespace_count++;
+}
+
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *out) {
+    if (strlen(ns) >= NVS_KEY_NAME_MAX_SIZE) return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&nvs_lock);
+    ensure_loaded();
+    int index = namespace_index(ns);
+    pthread_mutex_unlock(&nvs_lock);
+    if (index < 0) return ESP_ERR_NO_MEM;
+    *out = (nvs_handle_t)(index + 1);
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out, size_t *length) {
+    pthread_mutex_lock(&nvs_lock);
+    ensure_loaded();
+    NvsEntry *e = *find(handle - 1, key);
+    esp_err_t err = ESP_OK;
+    if (!e) {
+        err = ESP_ERR_NVS_NOT_FOUND;
+    } else if (!out) {
+        *length = e->length;
+    } else if (*length < e->length) {
+        *length = e->length;
+        err = ESP_ERR_NVS_INVALID_LENGTH;
+    } else {
+        memcpy(out, e->data, e->length);
+        *length = e->length;
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return err;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+    if (strlen(key) >= NVS_KEY_NAME_MAX_SIZE) return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&nvs_lock);
+    ensure_loaded();
+    esp_err_t err = write_error;
+    if (err == ESP_OK) {
+        put(handle - 1, key, value, length);
+        save_mirror();
+        write_count++;
+        snprintf(last_writer, sizeof(last_writer), "%s", pcTaskGetName(NULL));
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return err;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+    pthread_mutex_lock(&nvs_lock);
+    ensure_loaded();
+    NvsEntry **p = find(handle - 1, key);
+    NvsEntry *e = *p;
+    if (e) {
+        *p = e->next;
+        free(e);
+        save_mirror();
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return e ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+// File format: per entry the namespace name, key, length and data
+static void save_mirror(void) {
+    FILE *f = fopen(mirror_path, "wb");
+    if (!f) return;
+    for (NvsEntry *e = entries; e; e = e->next) {
+        fwrite(namespaces[e->ns], 1, NVS_KEY_NAME_MAX_SIZE, f);
+        fwrite(e->key, 1, NVS_KEY_NAME_MAX_SIZE, f);
+        fwrite(&e->length, sizeof(e->length), 1, f);
+        fwrite(e->data, 1, e->length, f);
+    }
+    fclose(f);
+}
+
+static void load_mirror(void) {
+    FILE *f = fopen(mirror_path, "rb");
+    if (!f) return;
+    char ns[NVS_KEY_NAME_MAX_SIZE], key[NVS_KEY_NAME_MAX_SIZE];
+    size_t length;
+    while (fread(ns, 1, sizeof(ns), f) == sizeof(ns) && fread(key, 1, sizeof(key), f) == sizeof(key) &&
+           fread(&length, sizeof(length), 1, f) == 1) {
+        uint8_t *data = malloc(length ? length : 1);
+        if (fread(data, 1, length, f) == length) {
+            int index = namespace_index(ns);
+            if (index >= 0) put(index, key, data, length);
+        }
+        free(data);
+    }
+    fclose(f);
+}
+
+static void forget_entries(void) {
+    while (entries) {
+        NvsEntry *next = entries->next;
+        free(entries);
+        entries = next;
+    }
+}
+
+static void set_default_path(void) {
+    if (!mirror_path[0]) snprintf(mirror_path, sizeof(mirror_path), "%s.nvs", program_invocation_short_name);
+}
+
+// Like flash, the file outlives the process: RAM inherited over fork() may be stale
+static void ensure_loaded(void) {
+    if (loaded_pid == getpid()) return;
+    set_default_path();
+    forget_entries();
+    load_mirror();
+    loaded_pid = getpid();
+}
+
+// Writes already went to the file, like nvs_set_blob to flash
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return ESP_OK;
+}
+
+void host_nvs_reset(void) {
+    pthread_mutex_lock(&nvs_lock);
+    set_default_path();
+    forget_entries();
+    remove(mirror_path);
+    loaded_pid = getpid();
+    write_count = 0;
+    write_error = ESP_OK;
+    last_writer[0] = '\0';
+    pthread_mutex_unlock(&nvs_lock);
+}
+
+void host_nvs_use_file(const char *path) {
+    pthread_mutex_lock(&nvs_lock);
+    snprintf(mirror_path, sizeof(mirror_path), "%s", path);
+    forget_entries();
+    load_mirror();
+    loaded_pid = getpid();
+    pthread_mutex_unlock(&nvs_lock);
+}
+
+int host_nvs_write_count(void) {
+    pthread_mutex_lock(&nvs_lock);
+    int count = write_count;
+    pthread_mutex_unlock(&nvs_lock);
+    return count;
+}
+
+void host_nvs_fail_writes(esp_err_t err) {
+    pthread_mutex_lock(&nvs_lock);
+    write_error = err;
+    pthread_mutex_unlock(&nvs_lock);
+}
+
+const char *host_nvs_last_writer(void) {
+    static char name[16];
+    pthread_mutex_lock(&nvs_lock);
+    memcpy(name, last_writer, sizeof(name));
+    pthread_mutex_unlock(&nvs_lock);
+    return name;
+}
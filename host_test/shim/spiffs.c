@@ -0,0 +1,23 @@
+// Host shim: fopen under the SPIFFS base path, see esp_spiffs.h
+
+#include "esp_spiffs.h"
+#include <stdio.h>
+#include <string.h>
+
+static char mount_base[32];
+static char mount_dir[256];
+
+FILE *__real_fopen(const char *path, const char *mode);
+
+void host_spiffs_mount(const char *base_path, const char *dir) {
+    snprintf(mount_base, sizeof(mount_base), "%s", base_path);
+    snprintf(mount_dir, sizeof(mount_dir), "%s", dir);
+}
+
+FILE *__wrap_fopen(const char *path, const char *mode) {
+    size_t len = strlen(mount_base);
+    if (len == 0 || strncmp(path, mount_base, len) != 0 || path[len] != '/') return __real_fopen(path, mode);
+    char hostPath[512];
+    snprintf(hostPath, sizeof(hostPath), "%s%s", mount_dir, path + len);
+    return __real_fopen(hostPath, mode);
+}
@@ -0,0 +1,54 @@
+// Built with a 100 ms commit delay
+#include "app_config.h"
+#include "metrics.h"
+#include "nvs.h"
+#include "test_util.h"
+
+static void start_config(void) {
+    CHECK_INT(init_config(), ESP_OK);
+    CHECK_INT(load_config(), ESP_OK);      // empty NVS: publishes the defaults and schedules a write
+    WAIT_FOR(host_nvs_write_count() == 1, 2000);
+}
+
+// The flash write runs on config_commit, never on the esp_timer task
+static void test_commit_runs_on_commit_task(void) {
+    start_config();
+    CHECK_STR(host_nvs_last_writer(), "config_commit");
+}
+
+// Saves within the commit window become one write
+static void test_burst_is_one_write(void) {
+    start_config();
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    for (int i = 0; i < 5; i++) {
+        snprintf(cfg.adminPassword, sizeof(cfg.adminPassword), "pw%d", i);
+        CHECK_INT(apply_config(&cfg), ESP_OK);
+    }
+    CHECK_INT(host_nvs_write_count(), 1);
+    WAIT_FOR(host_nvs_write_count() == 2, 2000);
+    test_sleep_ms(200);
+    CHECK_INT(host_nvs_write_count(), 2);
+    CHECK_INT(metrics_get(METRIC_CONFIG_SAVES_COALESCED), 4);
+    CHECK_STR(host_nvs_last_writer(), "config_commit");
+}
+
+// config_flush() writes a pending save at once, on the caller's task
+static void test_flush_writes_now(void) {
+    start_config();
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    strcpy(cfg.adminPassword, "flushed");
+    CHECK_INT(apply_config(&cfg), ESP_OK);
+    CHECK_INT(config_flush(), ESP_OK);
+    CHECK_INT(host_nvs_write_count(), 2);
+    CHECK_STR(host_nvs_last_writer(), "main");
+    test_sleep_ms(200);
+    CHECK_INT(host_nvs_write_count(), 2);       // the timer finds nothing pending
+}
+
+RUN_TESTS(
+    TEST(test_commit_runs_on_commit_task),
+    TEST(test_burst_is_one_write),
+    TEST(test_flush_writes_now),
+)
@@ -0,0 +1,121 @@
+#include "config_parser.h"
+#include "lwip/ip4_addr.h"
+#include "test_util.h"
+
+static esp_err_t parse(const char *json, AppConfig *cfg) {
+    return parse_config_json(json, strlen(json), cfg);
+}
+
+static void test_network_and_sinks(void) {
+    AppConfig cfg = {0};
+    CHECK_INT(parse("{\"ip\":\"192.168.1.50\",\"gateway\":\"192.168.1.1\",\"subnetMask\":\"255.255.255.0\","
+                    "\"tcpEnabled\":true,\"tcpIp\":\"10.0.0.2\",\"tcpPort\":\"9000\",\"companionPort\":16759,"
+                    "\"httpUrl\":\"http://10.0.0.3/hook\",\"syslogEnabled\":true,\"syslogPort\":514}", &cfg),
+              ESP_OK);
+    CHECK_INT(cfg.deviceIp, ipaddr_addr("192.168.1.50"));
+    CHECK_INT(cfg.gateway, ipaddr_addr("192.168.1.1"));
+    CHECK_INT(cfg.subnetMask, ipaddr_addr("255.255.255.0"));
+    CHECK_INT(cfg.tcpEnabled, 1);
+    CHECK_INT(cfg.tcpIp, ipaddr_addr("10.0.0.2"));
+    CHECK_INT(cfg.tcpPort, 9000);           // numeric string
+    CHECK_INT(cfg.companionPort, 16759);    // JSON number
+    CHECK_STR(cfg.httpUrl, "http://10.0.0.3/hook");
+    CHECK_INT(cfg.syslogEnabled, 1);
+    CHECK_INT(cfg.syslogPort, 514);
+}
+
+static void test_pin_map_keys(void) {
+    AppConfig cfg = {0};
+    CHECK_INT(parse("{\"gpi3Gpio\":25,\"gpi3DebounceUs\":\"1500\",\"gpi3Mode\":1,\"gpi3ReportThreshold\":100000,"
+                    "\"gpo5Rule\":\"toggle GPI1 & !GPI2\",\"gpo5Invert\":true,"
+                    "\"exp2Enabled\":true,\"exp2Address\":33,\"exp2InputMask\":65535}", &cfg), ESP_OK);
+    CHECK_INT(cfg.gpi[2].gpio, 25);
+    CHECK_INT(cfg.gpi[2].debounceUs, 1500);
+    CHECK_INT(cfg.gpi[2].mode, GPI_MODE_COUNTER);
+    CHECK_INT(cfg.gpi[2].reportThreshold, 100000);
+    CHECK_STR(cfg.gpo[4].rule, "toggle GPI1 & !GPI2");
+    CHECK_INT(cfg.gpo[4].invert, 1);
+    CHECK_INT(cfg.expander[1].enabled, 1);
+    CHECK_INT(cfg.expander[1].address, 33);
+    CHECK_INT(cfg.expander[1].inputMask, 0xFFFF);
+}
+
+static void test_web_server_keys(void) {
+    AppConfig cfg = {0};
+    CHECK_INT(parse("{\"webMaxSockets\":10,\"webBacklog\":\"8\",\"webLruPurge\":true,\"webKeepAlive\":true,"
+                    "\"webKeepAliveIdleS\":7200,\"webKeepAliveIntervalS\":30,\"webKeepAliveCount\":4,"
+                    "\"webTaskPriority\":6,\"webTaskCore\":2,\"webRecvTimeoutS\":10,\"webSendTimeoutS\":15}", &cfg),
+              ESP_OK);
+    CHECK_INT(cfg.web.maxOpenSockets, 10);
+    CHECK_INT(cfg.web.backlogConn, 8);
+    CHECK_INT(cfg.web.lruPurge, 1);
+    CHECK_INT(cfg.web.keepAlive, 1);
+    CHECK_INT(cfg.web.keepAliveIdleS, 7200);
+    CHECK_INT(cfg.web.keepAliveIntervalS, 30);
+    CHECK_INT(cfg.web.keepAliveCount, 4);
+    CHECK_INT(cfg.web.taskPriority, 6);
+    CHECK_INT(cfg.web.taskCore, WEB_TASK_CORE_ANY);
+    CHECK_INT(cfg.web.recvTimeoutS, 10);
+    CHECK_INT(cfg.web.sendTimeoutS, 15);
+
+    CHECK_INT(parse("{\"webMaxSockets\":14}", &cfg), ESP_ERR_INVALID_ARG);   // httpd needs 3 of LWIP's 16
+    CHECK_INT(parse("{\"webTaskCore\":3}", &cfg), ESP_ERR_INVALID_ARG);
+}
+
+static void test_eth_rx_mode_key(void) {
+    AppConfig cfg = {0};
+    CHECK_INT(parse("{\"ethRxMode\":1}", &cfg), ESP_OK);
+    CHECK_INT(cfg.ethRxMode, ETH_RX_MODE_ADAPTIVE);
+    CHECK_INT(parse("{\"ethRxMode\":2}", &cfg), ESP_ERR_INVALID_ARG);
+}
+
+static void test_escapes_and_unknown_keys(void) {
+    AppConfig cfg = {0};
+    CHECK_INT(parse(" {\n \"future\": {\"a\": [1, \"}\"]}, \"tcpUser\": \"a\\\"b\\\\c\\u00e9\", \"x\": null } ", &cfg),
+              ESP_OK);
+    CHECK_STR(cfg.tcpUser, "a\"b\\c\xc3\xa9");
+}
+
+static void test_secret_keeps_current_when_empty(void) {
+    AppConfig cfg = {0};
+    strcpy(cfg.adminPassword, "old");
+    CHECK_INT(parse("{\"adminPassword\":\"\"}", &cfg), ESP_OK);
+    CHECK_STR(cfg.adminPassword, "old");
+    CHECK_INT(parse("{\"adminPassword\":\"new\"}", &cfg), ESP_OK);
+    CHECK_STR(cfg.adminPassword, "new");
+}
+
+static void test_rejects_bad_values(void) {
+    AppConfig cfg = {0};
+    CHECK_INT(parse("{\"ip\":\"300.1.1.1\"}", &cfg), ESP_ERR_INVALID_ARG);
+    CHECK_INT(parse("{\"tcpPort\":65536}", &cfg), ESP_ERR_INVALID_ARG);
+    CHECK_INT(parse("{\"tcpPort\":-1}", &cfg), ESP_ERR_INVALID_ARG);
+    CHECK_INT(parse("{\"tcpEnabled\":1}", &cfg), ESP_ERR_INVALID_ARG);
+    CHECK_INT(parse("{\"gpi1Pull\":3}", &cfg), ESP_ERR_INVALID_ARG);
+    CHECK_INT(parse("{\"gpi1DebounceUs\":1000001}", &cfg), ESP_ERR_INVALID_ARG);
+
+    // 32 characters don't fit a char[32] with its terminator
+    CHECK_INT(parse("{\"tcpUser\":\"0123456789abcdef0123456789abcdef\"}", &cfg), ESP_ERR_INVALID_ARG);
+    CHECK_INT(parse("{\"tcpUser\":\"0123456789abcdef0123456789abcde\"}", &cfg), ESP_OK);
+}
+
+static void test_rejects_malformed_json(void) {
+    AppConfig cfg = {0};
+    CHECK_INT(parse("", &cfg), ESP_ERR_INVALID_ARG);
+    CHECK_INT(parse("{\"ip\":\"1.2.3.4\"", &cfg), ESP_ERR_INVALID_ARG);
+    CHECK_INT(parse("{\"ip\" \"1.2.3.4\"}", &cfg), ESP_ERR_INVALID_ARG);
+    CHECK_INT(parse("{\"tcpUser\":\"a\nb\"}", &cfg), ESP_ERR_INVALID_ARG);
+    CHECK_INT(parse("{} x", &cfg), ESP_ERR_INVALID_ARG);
+    CHECK_INT(parse("{}", &cfg), ESP_OK);
+}
+
+RUN_TESTS(
+    TEST(test_network_and_sinks),
+    TEST(test_pin_map_keys),
+    TEST(test_web_server_keys),
+    TEST(test_eth_rx_mode_key),
+    TEST(test_escapes_and_unknown_keys),
+    TEST(test_secret_keeps_current_when_empty),
+    TEST(test_rejects_bad_values),
+    TEST(test_rejects_malformed_json),
+)
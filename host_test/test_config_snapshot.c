@@ -0,0 +1,97 @@
+// Readers racing a writer on the published config. Built twice: plain, where a torn snapshot
+// fails the field checks, and with -fsanitize=thread (test_config_snapshot_tsan), where any data
+// race between config_snapshot() and a publish fails the run.
+
+#include "app_config.h"
+#include "esp_log.h"
+#include "test_util.h"
+#include <pthread.h>
+#include <sched.h>
+
+#define PUBLISHES 1000
+#define READERS 3
+
+static volatile bool writer_done;
+
+// Every field the readers check carries the generation. None of them is in a group that
+// restarts the TCP client.
+static void generation_config(AppConfig *cfg, uint32_t g) {
+    cfg->deviceIp = g;
+    cfg->gpi[GPI_PIN_COUNT - 1].debounceUs = g;
+    snprintf(cfg->adminPassword, sizeof(cfg->adminPassword), "a%lu", (unsigned long)g);
+    snprintf(cfg->tcpUser, sizeof(cfg->tcpUser), "t%lu", (unsigned long)g);
+    snprintf(cfg->tcpPassword, sizeof(cfg->tcpPassword), "tp%lu", (unsigned long)g);
+    snprintf(cfg->httpUser, sizeof(cfg->httpUser), "h%lu", (unsigned long)g);
+    snprintf(cfg->httpPassword, sizeof(cfg->httpPassword), "hp%lu", (unsigned long)g);
+}
+
+static void *writer(void *arg) {
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    for (uint32_t g = 1; g <= PUBLISHES; g++) {
+        generation_config(&cfg, g);
+        CHECK_INT(apply_config(&cfg), ESP_OK);
+        sched_yield();      // let the readers in between publishes, even on one core
+    }
+    __atomic_store_n(&writer_done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void *reader(void *arg) {
+    uint32_t lastVersion = 0, generations = 0, lastG = 0;
+    AppConfig cfg, expected;
+    SinkConfig sinks;
+    char user[32];
+    while (!__atomic_load_n(&writer_done, __ATOMIC_ACQUIRE)) {
+        uint32_t version = config_snapshot(&cfg);
+        CHECK(version >= lastVersion);
+        lastVersion = version;
+        uint32_t g = cfg.deviceIp;
+        if (g > 0 && g <= PUBLISHES) {     // before the first publish the defaults are live
+            expected = cfg;
+            generation_config(&expected, g);
+            CHECK(memcmp(&cfg, &expected, sizeof(cfg)) == 0);
+            if (g != lastG) generations++;
+            lastG = g;
+        }
+
+        config_snapshot_sinks(&sinks);
+        if (sinks.tcpUser[0] == 't') {
+            unsigned long n = strtoul(sinks.tcpUser + 1, NULL, 10);
+            snprintf(user, sizeof(user), "tp%lu", n);
+            CHECK_STR(sinks.tcpPassword, user);
+            snprintf(user, sizeof(user), "h%lu", n);
+            CHECK_STR(sinks.httpUser, user);
+            snprintf(user, sizeof(user), "hp%lu", n);
+            CHECK_STR(sinks.httpPassword, user);
+        }
+    }
+    return (void *)(uintptr_t)generations;
+}
+
+static void test_readers_never_see_a_torn_config(void) {
+    esp_log_level_set("*", ESP_LOG_WARN);
+    CHECK_INT(init_config(), ESP_OK);
+    CHECK_INT(load_config(), ESP_OK);
+
+    pthread_t readers[READERS], w;
+    for (int i = 0; i < READERS; i++) pthread_create(&readers[i], NULL, reader, NULL);
+    pthread_create(&w, NULL, writer, NULL);
+    pthread_join(w, NULL);
+
+    uint32_t seen = 0;
+    for (int i = 0; i < READERS; i++) {
+        void *generations;
+        pthread_join(readers[i], &generations);
+        seen += (uint32_t)(uintptr_t)generations;
+    }
+    CHECK(seen > READERS);      // the readers really overlapped the publishes
+
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    CHECK_INT(cfg.deviceIp, PUBLISHES);
+}
+
+RUN_TESTS(
+    TEST(test_readers_never_see_a_torn_config),
+)
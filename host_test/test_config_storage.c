@@ -0,0 +1,463 @@
+#include <stddef.h>
+#include "config_storage.h"
+#include "metrics.h"
+#include "nvs.h"
+#include "esp_rom_crc.h"
+#include "lwip/ip4_addr.h"
+#include "test_util.h"
+
+// Slot blob: magic, version, length, sequence, crc, then the TLV records
+#define HEADER_SIZE 16
+
+// A config with every field group set to something other than zero
+static void sample_config(AppConfig *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->deviceIp = ipaddr_addr("192.168.1.50");
+    cfg->gateway = ipaddr_addr("192.168.1.1");
+    cfg->subnetMask = ipaddr_addr("255.255.255.0");
+    cfg->backupIp = ipaddr_addr("192.168.2.50");
+    cfg->companionPort = 16759;
+    cfg->tcpEnabled = 1;
+    cfg->tcpPort = 9000;
+    strcpy(cfg->tcpUser, "user");
+    strcpy(cfg->httpUrl, "http://10.0.0.3/hook");
+    strcpy(cfg->adminPassword, "secret");
+    cfg->configFlag = 0xAA;
+    for (int i = 0; i < GPI_PIN_COUNT; i++) {
+        cfg->gpi[i].gpio = 30 + i;
+        cfg->gpi[i].enabled = 1;
+        cfg->gpi[i].debounceUs = 1000 * (i + 1);
+        cfg->gpi[i].eventsPerMin = 600;
+    }
+    for (int i = 0; i < GPO_PIN_COUNT; i++) {
+        cfg->gpo[i].gpio = 16 + i;
+        snprintf(cfg->gpo[i].rule, sizeof(cfg->gpo[i].rule), "GPI%d & !GPI%d", i + 1, i + 2);
+    }
+    cfg->expander[3].enabled = 1;
+    cfg->expander[3].address = 0x23;
+    cfg->expander[3].inputMask = 0xF00F;
+    cfg->syslogEnabled = 1;
+    cfg->syslogIp = ipaddr_addr("10.0.0.9");
+    cfg->syslogPort = 514;
+    cfg->web.maxOpenSockets = 10;
+    cfg->web.keepAlive = 1;
+    cfg->web.keepAliveIdleS = 300;
+    cfg->web.taskCore = WEB_TASK_CORE_ANY;
+    cfg->ethRxMode = ETH_RX_MODE_ADAPTIVE;
+}
+
+static size_t read_blob(const char *key, uint8_t *out, size_t size) {
+    nvs_handle_t nvs;
+    CHECK_INT(nvs_open("storage", NVS_READWRITE, &nvs), ESP_OK);
+    esp_err_t err = nvs_get_blob(nvs, key, out, &size);
+    nvs_close(nvs);
+    return err == ESP_OK ? size : 0;
+}
+
+static void write_blob(const char *key, const void *data, size_t size) {
+    nvs_handle_t nvs;
+    CHECK_INT(nvs_open("storage", NVS_READWRITE, &nvs), ESP_OK);
+    CHECK_INT(nvs_set_blob(nvs, key, data, size), ESP_OK);
+    CHECK_INT(nvs_commit(nvs), ESP_OK);
+    nvs_close(nvs);
+}
+
+// Points the header at the first size - HEADER_SIZE payload bytes and recomputes the CRC
+static void fix_header(uint8_t *blob, size_t size) {
+    uint16_t length = size - HEADER_SIZE;
+    uint32_t crc = esp_rom_crc32_le(0, blob + HEADER_SIZE, length);
+    memcpy(blob + 6, &length, 2);
+    memcpy(blob + 12, &crc, 4);
+}
+
+// Frozen copy of the v1 layout, the raw struct stored under "app_config" before the TLV slots
+typedef struct {
+    uint32_t deviceIp;
+    uint32_t gateway;
+    uint32_t subnetMask;
+    uint32_t companionIp;
+    uint16_t companionPort;
+    uint8_t  companionMode;
+    uint8_t tcpEnabled;
+    uint32_t tcpIp;
+    uint16_t tcpPort;
+    uint8_t tcpSecure;
+    char tcpUser[32];
+    char tcpPassword[32];
+    uint8_t httpEnabled;
+    char httpUrl[64];
+    uint8_t httpSecure;
+    char httpUser[32];
+    char httpPassword[32];
+    uint8_t serialEnabled;
+    char adminPassword[32];
+    uint8_t configFlag;
+} LegacyAppConfigV1;
+
+_Static_assert(sizeof(LegacyAppConfigV1) == 256, "v1 layout must not change");
+
+// Every v2 payload firmware has written so far: tags were appended, GPI and GPO records grew
+typedef struct {
+    const char *change;
+    uint8_t lastTag;
+    uint8_t gpiSize;
+    uint8_t gpoSize;
+} HistoricalLayout;
+
+static const HistoricalLayout layouts[] = {
+    { "TLV slots",         20, 0, 0 },
+    { "backup port",       23, 0, 0 },
+    { "pin map",           36, offsetof(GpiPinConfig, mode), offsetof(GpoPinConfig, rule) },
+    { "GPO rules",         36, offsetof(GpiPinConfig, mode), sizeof(GpoPinConfig) },
+    { "counter mode",      36, offsetof(GpiPinConfig, eventBurst), sizeof(GpoPinConfig) },
+    { "event suppression", 36, sizeof(GpiPinConfig), sizeof(GpoPinConfig) },
+    { "expanders",         40, sizeof(GpiPinConfig), sizeof(GpoPinConfig) },
+    { "syslog",            43, sizeof(GpiPinConfig), sizeof(GpoPinConfig) },
+    { "web server",        44, sizeof(GpiPinConfig), sizeof(GpoPinConfig) },
+    { "Ethernet RX mode",  45, sizeof(GpiPinConfig), sizeof(GpoPinConfig) },
+};
+
+// Cuts a current payload down to what the firmware that wrote layout stored. Returns the blob size.
+static size_t to_layout(uint8_t *blob, size_t size, const HistoricalLayout *layout) {
+    size_t pos = HEADER_SIZE, kept = HEADER_SIZE;
+    while (pos < size) {
+        uint8_t tag = blob[pos], len = blob[pos + 1];
+        uint8_t keep = len;
+        if (tag >= 24 && tag <= 31) keep = layout->gpiSize;
+        if (tag >= 32 && tag <= 36) keep = layout->gpoSize;
+        if (tag <= layout->lastTag) {
+            memmove(blob + kept, blob + pos, 2 + keep);
+            blob[kept + 1] = keep;
+            kept += 2 + keep;
+        }
+        pos += 2 + len;
+    }
+    fix_header(blob, kept);
+    return kept;
+}
+
+// What loading layout over defaults must give: the fields it stored, defaults for the rest
+static void expected_for(const HistoricalLayout *layout, const AppConfig *saved, AppConfig *out) {
+    out->deviceIp = saved->deviceIp;
+    out->gateway = saved->gateway;
+    out->subnetMask = saved->subnetMask;
+    out->companionIp = saved->companionIp;
+    out->companionPort = saved->companionPort;
+    out->companionMode = saved->companionMode;
+    out->tcpEnabled = saved->tcpEnabled;
+    out->tcpIp = saved->tcpIp;
+    out->tcpPort = saved->tcpPort;
+    out->tcpSecure = saved->tcpSecure;
+    memcpy(out->tcpUser, saved->tcpUser, sizeof(out->tcpUser));
+    memcpy(out->tcpPassword, saved->tcpPassword, sizeof(out->tcpPassword));
+    out->httpEnabled = saved->httpEnabled;
+    memcpy(out->httpUrl, saved->httpUrl, sizeof(out->httpUrl));
+    out->httpSecure = saved->httpSecure;
+    memcpy(out->httpUser, saved->httpUser, sizeof(out->httpUser));
+    memcpy(out->httpPassword, saved->httpPassword, sizeof(out->httpPassword));
+    out->serialEnabled = saved->serialEnabled;
+    memcpy(out->adminPassword, saved->adminPassword, sizeof(out->adminPassword));
+    out->configFlag = saved->configFlag;
+    if (layout->lastTag >= 23) {
+        out->backupIp = saved->backupIp;
+        out->backupGateway = saved->backupGateway;
+        out->backupSubnetMask = saved->backupSubnetMask;
+    }
+    if (layout->lastTag >= 36) {
+        for (int i = 0; i < GPI_PIN_COUNT; i++) memcpy(&out->gpi[i], &saved->gpi[i], layout->gpiSize);
+        for (int i = 0; i < GPO_PIN_COUNT; i++) memcpy(&out->gpo[i], &saved->gpo[i], layout->gpoSize);
+    }
+    if (layout->lastTag >= 40) memcpy(out->expander, saved->expander, sizeof(out->expander));
+    if (layout->lastTag >= 43) {
+        out->syslogEnabled = saved->syslogEnabled;
+        out->syslogIp = saved->syslogIp;
+        out->syslogPort = saved->syslogPort;
+    }
+    if (layout->lastTag >= 44) out->web = saved->web;
+    if (layout->lastTag >= 45) out->ethRxMode = saved->ethRxMode;
+}
+
+// Stands in for the factory defaults, unlike any sample value so a field left alone shows. Padding
+// between fields isn't stored, configs compared byte for byte start from the same pattern.
+static void fill_defaults(AppConfig *cfg, uint8_t pattern) {
+    memset(cfg, pattern, sizeof(*cfg));
+}
+
+// A migrated config is saved in the current format and must come back unchanged
+static void check_saves_unchanged(const AppConfig *migrated) {
+    AppConfig reloaded;
+    CHECK_INT(config_storage_save(migrated), ESP_OK);
+    fill_defaults(&reloaded, 0x5A);
+    CHECK_INT(config_storage_load(&reloaded), ESP_OK);
+    CHECK(memcmp(&reloaded, migrated, sizeof(reloaded)) == 0);
+}
+
+static void test_empty_storage(void) {
+    AppConfig cfg;
+    sample_config(&cfg);
+    CHECK_INT(config_storage_load(&cfg), ESP_ERR_NOT_FOUND);
+}
+
+static void test_round_trip(void) {
+    AppConfig saved, loaded;
+    sample_config(&saved);
+    CHECK_INT(config_storage_save(&saved), ESP_OK);
+
+    memset(&loaded, 0, sizeof(loaded));
+    CHECK_INT(config_storage_load(&loaded), ESP_OK);
+    CHECK(memcmp(&saved, &loaded, sizeof(saved)) == 0);
+}
+
+// Fields without a stored tag keep what the caller pre-filled (the defaults)
+static void test_missing_tags_keep_defaults(void) {
+    AppConfig saved, loaded;
+    sample_config(&saved);
+    CHECK_INT(config_storage_save(&saved), ESP_OK);
+
+    // Drop the syslog tags (41-43) from the stored payload
+    uint8_t blob[1024];
+    size_t size = read_blob("cfg_a", blob, sizeof(blob));
+    CHECK(size > HEADER_SIZE);
+    size_t pos = HEADER_SIZE, kept = HEADER_SIZE;
+    while (pos < size) {
+        uint8_t tag = blob[pos], len = blob[pos + 1];
+        if (tag < 41) {
+            memmove(blob + kept, blob + pos, 2 + len);
+            kept += 2 + len;
+        }
+        pos += 2 + len;
+    }
+    fix_header(blob, kept);
+    write_blob("cfg_a", blob, kept);
+
+    sample_config(&loaded);
+    loaded.syslogEnabled = 0;
+    loaded.syslogPort = 1514;
+    CHECK_INT(config_storage_load(&loaded), ESP_OK);
+    CHECK_INT(loaded.syslogEnabled, 0);
+    CHECK_INT(loaded.syslogPort, 1514);
+    CHECK_INT(loaded.tcpPort, 9000);
+}
+
+// The raw v1 struct goes through the migration table into a slot, then the legacy key is dropped
+static void test_legacy_v1_migrates(void) {
+    LegacyAppConfigV1 legacy;
+    memset(&legacy, 0, sizeof(legacy));
+    legacy.deviceIp = ipaddr_addr("192.168.1.50");
+    legacy.gateway = ipaddr_addr("192.168.1.1");
+    legacy.subnetMask = ipaddr_addr("255.255.255.0");
+    legacy.companionIp = ipaddr_addr("192.168.1.60");
+    legacy.companionPort = 16759;
+    legacy.companionMode = 1;
+    legacy.tcpEnabled = 1;
+    legacy.tcpIp = ipaddr_addr("10.0.0.2");
+    legacy.tcpPort = 9000;
+    strcpy(legacy.tcpUser, "operator");
+    strcpy(legacy.httpUrl, "http://10.0.0.3/hook");
+    legacy.httpSecure = 1;
+    legacy.serialEnabled = 1;
+    memset(legacy.adminPassword, 'p', sizeof(legacy.adminPassword));   // v1 didn't always terminate it
+    legacy.configFlag = 0xAA;
+    write_blob("app_config", &legacy, sizeof(legacy));
+
+    AppConfig loaded, expected;
+    fill_defaults(&loaded, 0x5A);
+    fill_defaults(&expected, 0x5A);
+    CHECK_INT(config_storage_load(&loaded), ESP_OK);
+
+    expected.deviceIp = legacy.deviceIp;
+    expected.gateway = legacy.gateway;
+    expected.subnetMask = legacy.subnetMask;
+    expected.companionIp = legacy.companionIp;
+    expected.companionPort = 16759;
+    expected.companionMode = 1;
+    expected.tcpEnabled = 1;
+    expected.tcpIp = legacy.tcpIp;
+    expected.tcpPort = 9000;
+    expected.tcpSecure = 0;
+    memset(expected.tcpUser, 0, sizeof(expected.tcpUser));
+    strcpy(expected.tcpUser, "operator");
+    memset(expected.tcpPassword, 0, sizeof(expected.tcpPassword));
+    expected.httpEnabled = 0;
+    memset(expected.httpUrl, 0, sizeof(expected.httpUrl));
+    strcpy(expected.httpUrl, "http://10.0.0.3/hook");
+    expected.httpSecure = 1;
+    memset(expected.httpUser, 0, sizeof(expected.httpUser));
+    memset(expected.httpPassword, 0, sizeof(expected.httpPassword));
+    expected.serialEnabled = 1;
+    memset(expected.adminPassword, 'p', sizeof(expected.adminPassword) - 1);
+    expected.adminPassword[sizeof(expected.adminPassword) - 1] = '\0';
+    expected.configFlag = 0xAA;
+    CHECK(memcmp(&loaded, &expected, sizeof(loaded)) == 0);
+
+    uint8_t blob[1024];
+    CHECK_INT(read_blob("app_config", blob, sizeof(blob)), 0);
+    CHECK(read_blob("cfg_a", blob, sizeof(blob)) > HEADER_SIZE);
+    uint16_t version;
+    memcpy(&version, blob + 4, 2);
+    CHECK_INT(version, CONFIG_FORMAT_VERSION);
+
+    AppConfig reloaded;
+    fill_defaults(&reloaded, 0x5A);
+    CHECK_INT(config_storage_load(&reloaded), ESP_OK);
+    CHECK(memcmp(&reloaded, &loaded, sizeof(loaded)) == 0);
+}
+
+// Each historical v2 payload loads over the defaults and survives a save in the current format
+static void test_historical_layouts_load(void) {
+    AppConfig saved;
+    sample_config(&saved);
+    CHECK_INT(config_storage_save(&saved), ESP_OK);
+    uint8_t current[1024];
+    size_t currentSize = read_blob("cfg_a", current, sizeof(current));
+    CHECK(currentSize > HEADER_SIZE);
+
+    for (size_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++) {
+        const HistoricalLayout *layout = &layouts[i];
+        uint8_t blob[1024];
+        memcpy(blob, current, currentSize);
+        size_t size = to_layout(blob, currentSize, layout);
+        host_nvs_reset();
+        write_blob("cfg_a", blob, size);
+
+        AppConfig loaded, expected;
+        fill_defaults(&loaded, 0x5A);
+        fill_defaults(&expected, 0x5A);
+        expected_for(layout, &saved, &expected);
+        CHECK_INT(config_storage_load(&loaded), ESP_OK);
+        if (memcmp(&loaded, &expected, sizeof(loaded)) != 0) {
+            fprintf(stderr, "layout \"%s\" loaded wrong\n", layout->change);
+            CHECK(0);
+        }
+        check_saves_unchanged(&loaded);
+    }
+}
+
+// A slot from newer firmware (after a downgrade) keeps the tags this build knows
+static void test_newer_version_slot(void) {
+    AppConfig saved, loaded;
+    sample_config(&saved);
+    CHECK_INT(config_storage_save(&saved), ESP_OK);
+
+    uint8_t blob[1024];
+    size_t size = read_blob("cfg_a", blob, sizeof(blob));
+    CHECK(size > HEADER_SIZE);
+    uint16_t version = CONFIG_FORMAT_VERSION + 1;
+    memcpy(blob + 4, &version, 2);
+    // A longer GPI01 record with fields appended, then a tag this build doesn't know
+    GpiPinConfig gpi = saved.gpi[0];
+    gpi.gpio = 7;
+    blob[size++] = 24;
+    blob[size++] = sizeof(gpi) + 2;
+    memcpy(blob + size, &gpi, sizeof(gpi));
+    size += sizeof(gpi);
+    blob[size++] = 0xEE;
+    blob[size++] = 0xEE;
+    blob[size++] = 200;
+    blob[size++] = 3;
+    memset(blob + size, 0xEE, 3);
+    size += 3;
+    fix_header(blob, size);
+    write_blob("cfg_a", blob, size);
+    int writes = host_nvs_write_count();
+
+    fill_defaults(&loaded, 0);      // like sample_config, every field is stored
+    CHECK_INT(config_storage_load(&loaded), ESP_OK);
+    saved.gpi[0].gpio = 7;
+    CHECK(memcmp(&loaded, &saved, sizeof(loaded)) == 0);
+    CHECK_INT(host_nvs_write_count(), writes);      // not rewritten in the older format
+}
+
+static void test_slots_alternate_and_newest_wins(void) {
+    AppConfig cfg, loaded;
+    sample_config(&cfg);
+    for (int i = 1; i <= 3; i++) {
+        cfg.tcpPort = 9000 + i;
+        CHECK_INT(config_storage_save(&cfg), ESP_OK);
+    }
+    uint8_t blob[1024];
+    CHECK(read_blob("cfg_a", blob, sizeof(blob)) > 0);     // saves 1 and 3
+    CHECK(read_blob("cfg_b", blob, sizeof(blob)) > 0);     // save 2
+    CHECK_INT(host_nvs_write_count(), 3);
+
+    sample_config(&loaded);
+    CHECK_INT(config_storage_load(&loaded), ESP_OK);
+    CHECK_INT(loaded.tcpPort, 9003);
+}
+
+// A corrupted newest slot falls back to the previous config
+static void test_crc_failure_falls_back(void) {
+    AppConfig cfg, loaded;
+    sample_config(&cfg);
+    cfg.tcpPort = 1111;
+    CHECK_INT(config_storage_save(&cfg), ESP_OK);          // cfg_a
+    cfg.tcpPort = 2222;
+    CHECK_INT(config_storage_save(&cfg), ESP_OK);          // cfg_b
+
+    uint8_t blob[1024];
+    size_t size = read_blob("cfg_b", blob, sizeof(blob));
+    blob[size - 1] ^= 0x01;
+    write_blob("cfg_b", blob, size);
+
+    sample_config(&loaded);
+    CHECK_INT(config_storage_load(&loaded), ESP_OK);
+    CHECK_INT(loaded.tcpPort, 1111);
+}
+
+// A write cut short by power loss leaves a slot shorter than its header says
+static void test_torn_slot_falls_back(void) {
+    AppConfig cfg, loaded;
+    sample_config(&cfg);
+    cfg.tcpPort = 1111;
+    CHECK_INT(config_storage_save(&cfg), ESP_OK);          // cfg_a
+    cfg.tcpPort = 2222;
+    CHECK_INT(config_storage_save(&cfg), ESP_OK);          // cfg_b
+
+    uint8_t blob[1024];
+    size_t size = read_blob("cfg_b", blob, sizeof(blob));
+    write_blob("cfg_b", blob, size / 2);
+
+    sample_config(&loaded);
+    CHECK_INT(config_storage_load(&loaded), ESP_OK);
+    CHECK_INT(loaded.tcpPort, 1111);
+}
+
+static void test_unchanged_save_is_skipped(void) {
+    AppConfig cfg;
+    sample_config(&cfg);
+    CHECK_INT(config_storage_save(&cfg), ESP_OK);
+    CHECK_INT(config_storage_save(&cfg), ESP_OK);
+    CHECK_INT(host_nvs_write_count(), 1);
+    CHECK_INT(metrics_get(METRIC_CONFIG_SAVES_UNCHANGED), 1);
+    CHECK_INT(metrics_get(METRIC_CONFIG_FLASH_COMMITS), 1);
+}
+
+static void test_failed_write_keeps_current_slot(void) {
+    AppConfig cfg, loaded;
+    sample_config(&cfg);
+    cfg.tcpPort = 1111;
+    CHECK_INT(config_storage_save(&cfg), ESP_OK);
+
+    host_nvs_fail_writes(ESP_ERR_NVS_NO_FREE_PAGES);
+    cfg.tcpPort = 2222;
+    CHECK_INT(config_storage_save(&cfg), ESP_ERR_NVS_NO_FREE_PAGES);
+    host_nvs_fail_writes(ESP_OK);
+
+    sample_config(&loaded);
+    CHECK_INT(config_storage_load(&loaded), ESP_OK);
+    CHECK_INT(loaded.tcpPort, 1111);
+}
+
+RUN_TESTS(
+    TEST(test_empty_storage),
+    TEST(test_round_trip),
+    TEST(test_missing_tags_keep_defaults),
+    TEST(test_legacy_v1_migrates),
+    TEST(test_historical_layouts_load),
+    TEST(test_newer_version_slot),
+    TEST(test_slots_alternate_and_newest_wins),
+    TEST(test_crc_failure_falls_back),
+    TEST(test_torn_slot_falls_back),
+    TEST(test_unchanged_save_is_skipped),
+    TEST(test_failed_write_keeps_current_slot),
+)
@@ -0,0 +1,112 @@
+// Built with a 16-record ring. On the host only integer arguments can be replayed: the record
+// keeps 32-bit words, which is the size of a pointer on the target but not here.
+
+#include "deferred_log.h"
+#include "metrics.h"
+#include "test_util.h"
+#include <pthread.h>
+
+static pthread_mutex_t captured_lock = PTHREAD_MUTEX_INITIALIZER;
+static char captured[64][160];
+static int captured_count;
+static int captured_total;
+
+static int capture(const char *format, va_list args) {
+    pthread_mutex_lock(&captured_lock);
+    captured_total++;
+    if (captured_count < 64) vsnprintf(captured[captured_count++], sizeof(captured[0]), format, args);
+    pthread_mutex_unlock(&captured_lock);
+    return 0;
+}
+
+static int lines(void) {
+    pthread_mutex_lock(&captured_lock);
+    int count = captured_count;
+    pthread_mutex_unlock(&captured_lock);
+    return count;
+}
+
+// "I (1234) TAG: text\n" -> "TAG: text"
+static const char *body(int i) {
+    const char *p = strstr(captured[i], ") ");
+    CHECK(p != NULL);
+    static char out[160];
+    snprintf(out, sizeof(out), "%s", p + 2);
+    out[strcspn(out, "\n")] = '\0';
+    return out;
+}
+
+static void test_records_print_in_order(void) {
+    esp_log_set_vprintf(capture);
+    CHECK_INT(dlog_init(), ESP_OK);
+
+    DLOGI("GPIO", "Trigger GPI%02d", 3);
+    DLOGW("GPIO", "Pin %d level %d after %lu us", 7, 1, (unsigned long)1500);
+    DLOGE("NET", "no args");
+    DLOGD("GPIO", "above the compiled level %d", 1);      // CONFIG_DEFERRED_LOG_MAX_LEVEL is info
+
+    WAIT_FOR(lines() == 3, 1000);
+    test_sleep_ms(50);
+    CHECK_INT(lines(), 3);
+    CHECK_STR(body(0), "GPIO: Trigger GPI03");
+    CHECK_STR(body(1), "GPIO: Pin 7 level 1 after 1500 us");
+    CHECK_STR(body(2), "NET: no args");
+    CHECK(captured[0][0] == 'I' && captured[1][0] == 'W' && captured[2][0] == 'E');
+    WAIT_FOR(metrics_get(METRIC_LOG_DEFERRED) == 3, 1000);
+}
+
+static void test_lapped_records_are_counted(void) {
+    esp_log_set_vprintf(capture);
+
+    // Nothing prints before dlog_init, so the writers lap the 16-record ring
+    for (int i = 0; i < 40; i++) DLOGI("T", "n=%d", i);
+    CHECK_INT(dlog_init(), ESP_OK);
+
+    WAIT_FOR(lines() == 16, 1000);
+    test_sleep_ms(50);
+    CHECK_INT(lines(), 16);
+    for (int i = 0; i < 16; i++) {
+        char expected[32];
+        snprintf(expected, sizeof(expected), "T: n=%d", 24 + i);
+        CHECK_STR(body(i), expected);
+    }
+    CHECK_INT(metrics_get(METRIC_LOG_DROPPED), 24);
+}
+
+static void *writer(void *arg) {
+    int id = (int)(intptr_t)arg;
+    for (int i = 0; i < 2000; i++) {
+        DLOGI("W", "%d %d", id, i);
+        if (i % 64 == 0) test_sleep_ms(1);
+    }
+    return NULL;
+}
+
+// Concurrent writers: every record is either printed whole or counted as dropped
+static void test_concurrent_writers(void) {
+    esp_log_set_vprintf(capture);
+    CHECK_INT(dlog_init(), ESP_OK);
+
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++) pthread_create(&threads[i], NULL, writer, (void *)(intptr_t)i);
+    for (int i = 0; i < 4; i++) pthread_join(threads[i], NULL);
+
+    WAIT_FOR(metrics_get(METRIC_LOG_DEFERRED) == 8000, 2000);
+    test_sleep_ms(50);
+    pthread_mutex_lock(&captured_lock);
+    int printed = captured_total;
+    pthread_mutex_unlock(&captured_lock);
+    CHECK(printed > 0);
+    CHECK_INT(printed + metrics_get(METRIC_LOG_DROPPED), 8000);
+    for (int i = 0; i < lines(); i++) {
+        int id, n;
+        CHECK_INT(sscanf(body(i), "W: %d %d", &id, &n), 2);
+        CHECK(id >= 0 && id < 4 && n >= 0 && n < 2000);
+    }
+}
+
+RUN_TESTS(
+    TEST(test_records_print_in_order),
+    TEST(test_lapped_records_are_counted),
+    TEST(test_concurrent_writers),
+)
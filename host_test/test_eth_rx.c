@@ -0,0 +1,111 @@
+// Built with a 1 s RX task learn timeout
+#include "eth_rx.h"
+#include "esp_eth.h"
+#include "fakes/fakes.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "metrics.h"
+#include "sdkconfig.h"
+#include "test_util.h"
+
+// Stands in for the W5500 driver: its RX task counts the notifications adaptive polling sends and
+// delivers the frames a test queues, so rx_tap sees them on this task
+static int eth_driver;
+static esp_netif_t *netif;
+static volatile int frames_to_send;
+static volatile int notifications;
+
+static void w5500_task(void *arg) {
+    for (;;) {
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(5))) notifications++;
+        while (frames_to_send > 0) {
+            host_eth_receive(&eth_driver, 60);
+            frames_to_send--;
+        }
+    }
+}
+
+static void set_mode(EthRxMode mode) {
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    cfg.ethRxMode = mode;
+    CHECK_INT(apply_config(&cfg), ESP_OK);
+}
+
+static void start(EthRxMode mode) {
+    CHECK_INT(init_config(), ESP_OK);
+    CHECK_INT(load_config(), ESP_OK);
+    set_mode(mode);
+    netif = host_netif_new("en1");
+    CHECK_INT(eth_rx_tap_port(0, &eth_driver, netif), ESP_OK);
+    CHECK(xTaskCreate(w5500_task, "w5500_tsk", 4096, NULL, 5, NULL) == pdPASS);
+    CHECK_INT(eth_rx_start(), ESP_OK);
+}
+
+static void receive_frame(void) {
+    frames_to_send = 1;
+    WAIT_FOR(frames_to_send == 0, 1000);
+}
+
+// Polls start once the first frame named the RX task, fast while frames arrive
+static void test_adaptive_polls_learned_task(void) {
+    start(ETH_RX_MODE_ADAPTIVE);
+    test_sleep_ms(50);
+    CHECK_INT(notifications, 0);
+    CHECK_INT(metrics_get(METRIC_ETH_RX_POLLS), 0);
+    CHECK_INT(metrics_get(METRIC_ETH_RX_POLL_INTERVAL_US), CONFIG_ETH_RX_POLL_IDLE_US);
+
+    receive_frame();
+    CHECK_INT(host_netif_rx_count(netif), 1);
+    WAIT_FOR(notifications >= 5, 1000);
+    WAIT_FOR(metrics_get(METRIC_ETH_RX_POLL_INTERVAL_US) == CONFIG_ETH_RX_POLL_FAST_US, 1000);
+    CHECK(metrics_get(METRIC_ETH_RX_POLLS) >= 5);
+}
+
+// The mode follows the config at runtime
+static void test_mode_switch_at_runtime(void) {
+    start(ETH_RX_MODE_DRIVER);
+    receive_frame();
+    test_sleep_ms(50);
+    CHECK_INT(notifications, 0);
+    CHECK_INT(metrics_get(METRIC_ETH_RX_POLL_INTERVAL_US), CONFIG_EXAMPLE_ETH_SPI_POLLING0_MS * 1000);
+
+    set_mode(ETH_RX_MODE_ADAPTIVE);
+    WAIT_FOR(notifications >= 3, 1000);
+
+    set_mode(ETH_RX_MODE_DRIVER);
+    test_sleep_ms(20);
+    int polls = metrics_get(METRIC_ETH_RX_POLLS);
+    test_sleep_ms(50);
+    CHECK_INT(metrics_get(METRIC_ETH_RX_POLLS), polls);
+    CHECK_INT(metrics_get(METRIC_ETH_RX_POLL_INTERVAL_US), CONFIG_EXAMPLE_ETH_SPI_POLLING0_MS * 1000);
+}
+
+// A port that has link but never shows a frame is given up on, and stays with the driver
+static void test_silent_port_gives_up(void) {
+    start(ETH_RX_MODE_ADAPTIVE);
+    test_sleep_ms(1500);
+    CHECK_INT(metrics_get(METRIC_ETH_RX_POLL_INTERVAL_US), CONFIG_EXAMPLE_ETH_SPI_POLLING0_MS * 1000);
+
+    receive_frame();
+    test_sleep_ms(50);
+    CHECK_INT(notifications, 0);
+    CHECK_INT(metrics_get(METRIC_ETH_RX_POLLS), 0);
+}
+
+// Time without link doesn't count against the timeout
+static void test_timeout_only_counts_link_up(void) {
+    fake_net_state_set_up(false);
+    start(ETH_RX_MODE_ADAPTIVE);
+    test_sleep_ms(1500);
+    fake_net_state_set_up(true);
+    receive_frame();
+    WAIT_FOR(notifications >= 3, 1000);
+}
+
+RUN_TESTS(
+    TEST(test_adaptive_polls_learned_task),
+    TEST(test_mode_switch_at_runtime),
+    TEST(test_silent_port_gives_up),
+    TEST(test_timeout_only_counts_link_up),
+)
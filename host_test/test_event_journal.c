@@ -0,0 +1,253 @@
+// Journal paging on the NOR flash emulator: 4 KB pages hold 203 records, so a few hundred events
+// cross page boundaries and a 4-page partition wraps.
+
+#include "event_journal.h"
+#include "esp_partition.h"
+#include "metrics.h"
+#include "sdkconfig.h"
+#include "test_util.h"
+#include <pthread.h>
+
+#define JOURNAL_SUBTYPE 0x40
+#define RECORDS_PER_PAGE 203
+
+static pthread_mutex_t delivered_lock = PTHREAD_MUTEX_INITIALIZER;
+static JournalEvent delivered[4096];
+static int delivered_count;
+
+static esp_err_t deliver(const JournalEvent *ev) {
+    pthread_mutex_lock(&delivered_lock);
+    if (delivered_count < 4096) delivered[delivered_count++] = *ev;
+    pthread_mutex_unlock(&delivered_lock);
+    return ESP_OK;
+}
+
+static int delivered_total(void) {
+    pthread_mutex_lock(&delivered_lock);
+    int count = delivered_count;
+    pthread_mutex_unlock(&delivered_lock);
+    return count;
+}
+
+// Appends faster than any input could, so whenever the journal task is two batches behind the
+// record is dropped and tried again once it caught up
+static void append_events(int count) {
+    for (int i = 0; i < count; i++) {
+        esp_err_t err;
+        while ((err = event_journal_append(JOURNAL_SINK_BIT(JOURNAL_SINK_TCP), i % 72, i & 1)) == ESP_ERR_NO_MEM) {
+            test_sleep_ms(1);
+        }
+        CHECK_INT(err, ESP_OK);
+    }
+}
+
+// Event i carries gpi i % 72 and level i & 1, delivered in order with strictly increasing seq
+static void check_delivered(int first, int count) {
+    CHECK_INT(delivered_total(), count);
+    for (int i = 0; i < count; i++) {
+        CHECK_INT(delivered[i].gpi, (first + i) % 72);
+        CHECK_INT(delivered[i].level, (first + i) & 1);
+        if (i > 0) CHECK(delivered[i].seq > delivered[i - 1].seq);
+    }
+}
+
+static void test_no_partition(void) {
+    CHECK_INT(event_journal_init(), ESP_OK);
+    CHECK_INT(event_journal_append(JOURNAL_SINK_BIT(JOURNAL_SINK_TCP), 1, 1), ESP_ERR_NOT_FOUND);
+    CHECK_INT(event_journal_defer(JOURNAL_SINK_BIT(JOURNAL_SINK_TCP), 1, 1), 0);
+}
+
+static void test_replay_across_pages(void) {
+    host_flash_create("journal", JOURNAL_SUBTYPE, 8 * 4096);
+    CHECK_INT(event_journal_init(), ESP_OK);
+
+    append_events(500);
+    CHECK_INT(metrics_get(METRIC_JOURNAL_PENDING_TCP), 500);
+    CHECK_INT(event_journal_flush(), ESP_OK);
+    CHECK(host_flash_stats()->erases >= 3);                 // page 0 at format, then two more
+
+    event_journal_register_sink(JOURNAL_SINK_TCP, deliver);
+    event_journal_kick();
+    WAIT_FOR(delivered_total() == 500, 10000);
+    check_delivered(0, 500);
+    WAIT_FOR(metrics_get(METRIC_JOURNAL_PENDING_TCP) == 0, 1000);
+    CHECK_INT(metrics_get(METRIC_JOURNAL_REPLAYED), 500);
+}
+
+// Live events wait behind a backlog, so they are journaled instead of overtaking it
+static void test_defer_while_behind(void) {
+    host_flash_create("journal", JOURNAL_SUBTYPE, 4 * 4096);
+    CHECK_INT(event_journal_init(), ESP_OK);
+
+    uint8_t both = JOURNAL_SINK_BIT(JOURNAL_SINK_TCP) | JOURNAL_SINK_BIT(JOURNAL_SINK_HTTP);
+    CHECK_INT(event_journal_defer(both, 0, 0), 0);          // nothing pending: send live
+    CHECK_INT(event_journal_append(JOURNAL_SINK_BIT(JOURNAL_SINK_TCP), 0, 0), ESP_OK);
+    CHECK_INT(event_journal_defer(both, 1, 1), JOURNAL_SINK_BIT(JOURNAL_SINK_TCP));
+
+    event_journal_register_sink(JOURNAL_SINK_TCP, deliver);
+    event_journal_kick();
+    WAIT_FOR(delivered_total() == 2, 5000);
+    check_delivered(0, 2);
+    WAIT_FOR(event_journal_defer(both, 2, 0) == 0, 1000);
+}
+
+// The ring overwrites the oldest page. Every event is either replayed, in order and without
+// duplicates, or counted as overwritten: on a full ring the ack checkpoints written during the
+// catch-up also push out old pages.
+static void test_wrap_overwrites_oldest(void) {
+    host_flash_create("journal", JOURNAL_SUBTYPE, 4 * 4096);
+    CHECK_INT(event_journal_init(), ESP_OK);
+
+    append_events(1000);
+    CHECK_INT(event_journal_flush(), ESP_OK);
+    uint32_t overwritten = metrics_get(METRIC_JOURNAL_OVERWRITTEN);
+    CHECK(overwritten >= RECORDS_PER_PAGE - JOURNAL_SINK_COUNT);
+    CHECK_INT(metrics_get(METRIC_JOURNAL_PENDING_TCP), 1000 - overwritten);
+
+    event_journal_register_sink(JOURNAL_SINK_TCP, deliver);
+    event_journal_kick();
+    WAIT_FOR(metrics_get(METRIC_JOURNAL_PENDING_TCP) == 0, 10000);
+    CHECK_INT(delivered_total() + metrics_get(METRIC_JOURNAL_OVERWRITTEN), 1000);
+    CHECK_INT(delivered[0].seq, overwritten + 1);
+    for (int i = 1; i < delivered_count; i++) {
+        CHECK(delivered[i].seq > delivered[i - 1].seq);
+        CHECK_INT(delivered[i].gpi, (delivered[i].seq - 1) % 72);
+    }
+}
+
+// Flash is only erased and written by journal_task: the flush timer and full batches wake it
+static void test_flash_only_from_journal_task(void) {
+    host_flash_create("journal", JOURNAL_SUBTYPE, 4 * 4096);
+    CHECK_INT(event_journal_init(), ESP_OK);               // formats page 0 from this task
+    host_flash_owner("journal_task");
+    uint32_t writes = host_flash_stats()->writes;
+
+    append_events(3);                                      // flushed by the timer
+    WAIT_FOR(host_flash_stats()->writes > writes, 1000);
+    append_events(400);                                    // full batches, two pages opened
+    event_journal_register_sink(JOURNAL_SINK_TCP, deliver);
+    event_journal_kick();
+    WAIT_FOR(delivered_total() == 403, 10000);
+    WAIT_FOR(metrics_get(METRIC_JOURNAL_PENDING_TCP) == 0, 1000);
+
+    CHECK(host_flash_stats()->erases >= 3);
+    CHECK_INT(host_flash_stats()->foreignOps, 0);
+}
+
+static pthread_mutex_t gate_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gate_changed = PTHREAD_COND_INITIALIZER;
+static bool gate_open;
+static bool gate_reached;
+
+// Blocks the journal task in delivery until the test opens the gate
+static esp_err_t deliver_at_gate(const JournalEvent *ev) {
+    pthread_mutex_lock(&gate_lock);
+    gate_reached = true;
+    while (!gate_open) pthread_cond_wait(&gate_changed, &gate_lock);
+    pthread_mutex_unlock(&gate_lock);
+    return deliver(ev);
+}
+
+// While the journal task is stuck, appends take two batches and then drop, without waiting
+static void test_full_batch_drops_instead_of_blocking(void) {
+    host_flash_create("journal", JOURNAL_SUBTYPE, 4 * 4096);
+    CHECK_INT(event_journal_init(), ESP_OK);
+    CHECK_INT(event_journal_append(JOURNAL_SINK_BIT(JOURNAL_SINK_TCP), 0, 0), ESP_OK);
+    event_journal_register_sink(JOURNAL_SINK_TCP, deliver_at_gate);
+    event_journal_kick();
+    WAIT_FOR(__atomic_load_n(&gate_reached, __ATOMIC_ACQUIRE), 1000);
+
+    int64_t start = test_now_ms();
+    int accepted = 0;
+    for (int i = 1; i <= 40; i++) {
+        esp_err_t err = event_journal_append(JOURNAL_SINK_BIT(JOURNAL_SINK_TCP), i % 72, i & 1);
+        CHECK(err == ESP_OK || err == ESP_ERR_NO_MEM);
+        if (err == ESP_OK) accepted++;
+        test_sleep_ms(1);                                  // let the flush timer fire meanwhile
+    }
+    CHECK(test_now_ms() - start < 500);
+    CHECK_INT(accepted, 2 * CONFIG_EVENT_JOURNAL_BATCH_RECORDS);
+    CHECK_INT(metrics_get(METRIC_JOURNAL_DROPPED), 40 - accepted);
+
+    pthread_mutex_lock(&gate_lock);
+    gate_open = true;
+    pthread_cond_broadcast(&gate_changed);
+    pthread_mutex_unlock(&gate_lock);
+
+    WAIT_FOR(delivered_total() == 1 + accepted, 5000);
+    for (int i = 0; i < delivered_count; i++) CHECK_INT(delivered[i].seq, i + 1);
+    WAIT_FOR(metrics_get(METRIC_JOURNAL_PENDING_TCP) == 0, 1000);
+}
+
+// Power fails 1010 bytes into the records: 50 whole records and a torn one reach flash
+static void boot_cut_power_mid_write(void) {
+    CHECK_INT(event_journal_init(), ESP_OK);
+    host_flash_power_cut_after(1010);
+    append_events(300);
+    event_journal_flush();
+    exit(2);                                               // the cut should have ended this boot
+}
+
+static void boot_replay_before_cut(void) {
+    CHECK_INT(event_journal_init(), ESP_OK);
+    CHECK_INT(metrics_get(METRIC_JOURNAL_PENDING_TCP), 50);
+    event_journal_register_sink(JOURNAL_SINK_TCP, deliver);
+    event_journal_kick();
+    WAIT_FOR(delivered_total() == 50, 10000);
+    check_delivered(0, 50);
+
+    // Appending carries on past the torn slot
+    CHECK_INT(event_journal_append(JOURNAL_SINK_BIT(JOURNAL_SINK_TCP), 7, 1), ESP_OK);
+    event_journal_kick();
+    WAIT_FOR(delivered_total() == 51, 5000);
+    CHECK_INT(delivered[50].gpi, 7);
+    CHECK(delivered[50].seq > delivered[49].seq);
+    CHECK(delivered[50].boot != delivered[0].boot);
+}
+
+static void test_power_cut_mid_write(void) {
+    host_flash_create("journal", JOURNAL_SUBTYPE, 4 * 4096);
+    CHECK_INT(run_boot(boot_cut_power_mid_write), 0);
+    CHECK_INT(run_boot(boot_replay_before_cut), 0);
+}
+
+static void boot_append_300(void) {
+    CHECK_INT(event_journal_init(), ESP_OK);
+    append_events(300);
+    CHECK_INT(event_journal_flush(), ESP_OK);
+}
+
+static void boot_replay_300(void) {
+    CHECK_INT(event_journal_init(), ESP_OK);
+    CHECK_INT(metrics_get(METRIC_JOURNAL_PENDING_TCP), 300);
+    event_journal_register_sink(JOURNAL_SINK_TCP, deliver);
+    event_journal_kick();
+    WAIT_FOR(delivered_total() == 300, 10000);
+    check_delivered(0, 300);
+    for (int i = 0; i < 300; i++) CHECK_INT(delivered[i].boot, delivered[0].boot);
+    CHECK_INT(event_journal_flush(), ESP_OK);               // the acks
+}
+
+static void boot_nothing_pending(void) {
+    CHECK_INT(event_journal_init(), ESP_OK);
+    CHECK_INT(metrics_get(METRIC_JOURNAL_PENDING_TCP), 0);
+}
+
+// Pending events and delivery cursors survive a reboot
+static void test_recovery_after_reboot(void) {
+    host_flash_create("journal", JOURNAL_SUBTYPE, 4 * 4096);
+    CHECK_INT(run_boot(boot_append_300), 0);
+    CHECK_INT(run_boot(boot_replay_300), 0);
+    CHECK_INT(run_boot(boot_nothing_pending), 0);
+}
+
+RUN_TESTS(
+    TEST(test_no_partition),
+    TEST(test_replay_across_pages),
+    TEST(test_defer_while_behind),
+    TEST(test_wrap_overwrites_oldest),
+    TEST(test_recovery_after_reboot),
+    TEST(test_flash_only_from_journal_task),
+    TEST(test_full_batch_drops_instead_of_blocking),
+    TEST(test_power_cut_mid_write),
+)
@@ -0,0 +1,127 @@
+// gpio_handler on the host GPIO shim, built without simulated inputs so the native pin setup and
+// release paths run. Expanders use the fake backend in fakes/fake_gpio.c, sinks are recorded.
+
+#include "gpio_handler.h"
+#include "app_config.h"
+#include "event_journal.h"
+#include "fakes/fakes.h"
+#include "test_util.h"
+
+#define EXPANDER_GPI(pin) (GPI_PIN_COUNT + (pin))   // 0-based index of an input on expander slot 0
+
+// Boots the config with the factory pin map as edited by edit, then starts the pins
+static void start_pins(void (*edit)(AppConfig *cfg)) {
+    CHECK_INT(init_config(), ESP_OK);
+    CHECK_INT(load_config(), ESP_OK);
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    cfg.tcpEnabled = 1;
+    if (edit) edit(&cfg);
+    CHECK_INT(apply_config(&cfg), ESP_OK);
+    CHECK_INT(event_journal_init(), ESP_OK);
+    CHECK_INT(init_gpio_pins(), ESP_OK);
+}
+
+static bool sent(const char *event, const char *state) {
+    for (int i = 0; i < fake_sink_count(FAKE_SINK_TCP); i++) {
+        const char *msg = fake_sink_message(FAKE_SINK_TCP, i);
+        if (strstr(msg, event) && strstr(msg, state)) return true;
+    }
+    return false;
+}
+
+static void polled_expander(AppConfig *cfg) {
+    cfg->expander[0].enabled = 1;
+    cfg->expander[0].debounceUs = 1000;
+    cfg->gpi[1].mode = GPI_MODE_COUNTER;
+}
+
+// Expander inputs carry gpio 0 in their pin config: releasing them must not reset GPIO0, a
+// strapping pin, while native and counter pins are still reset on release
+static void test_release_resets_only_native_pins(void) {
+    start_pins(polled_expander);
+    CHECK_INT(fake_expander_starts(0), 1);
+
+    fake_expander_set(0, 0xFFFE);
+    WAIT_FOR(sent("GPI09", "LOW"), 2000);
+
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    cfg.expander[0].enabled = 0;
+    cfg.gpi[0].enabled = 0;
+    cfg.gpi[1].enabled = 0;
+    CHECK_INT(apply_config(&cfg), ESP_OK);
+    WAIT_FOR(fake_expander_stops(0) == 1, 2000);
+    WAIT_FOR(host_gpio(cfg.gpi[0].gpio)->resets == 1, 2000);
+
+    CHECK_INT(host_gpio(0)->resets, 0);
+    CHECK_INT(host_gpio(cfg.gpi[1].gpio)->resets, 1);
+    CHECK(host_gpio(cfg.gpi[0].gpio)->handler == NULL);
+    CHECK_INT(get_gpi_count(), GPI_PIN_COUNT);
+}
+
+// Native level pins: an edge on the pin reaches the sink once the level held for debounceUs
+static void fast_debounce(AppConfig *cfg) {
+    cfg->gpi[0].debounceUs = 1000;
+}
+
+static void test_native_edge_is_sent(void) {
+    start_pins(fast_debounce);
+    AppConfig cfg;
+    config_snapshot(&cfg);
+
+    host_gpio_drive(cfg.gpi[0].gpio, 1);
+    WAIT_FOR(sent("GPI01", "HIGH"), 2000);
+    CHECK(get_gpi_state(0));
+    CHECK_INT(fake_sink_count(FAKE_SINK_TCP), 1);
+}
+
+// A blink keeps its timing while gpio_task holds gpo_lock across a slow expander start
+static void test_pattern_runs_while_remap_blocks(void) {
+    start_pins(NULL);
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    HostGpio *gpo = host_gpio(cfg.gpo[0].gpio);
+    CHECK_INT(gpo_start_pattern(1, 2000, 2000, 0), ESP_OK);
+    CHECK_INT(gpo->level, 1);
+
+    fake_expander_hold(1);
+    cfg.expander[0].enabled = 1;
+    CHECK_INT(apply_config(&cfg), ESP_OK);
+    WAIT_FOR(fake_expander_held(), 2000);
+
+    uint32_t writes = __atomic_load_n(&gpo->levelWrites, __ATOMIC_RELAXED);
+    test_sleep_ms(100);
+    CHECK(__atomic_load_n(&gpo->levelWrites, __ATOMIC_RELAXED) - writes >= 20);    // about 50
+    CHECK(fake_expander_held());
+
+    fake_expander_hold(0);
+    WAIT_FOR(fake_expander_starts(0) == 1, 2000);
+    trigger_gpo(1, false);
+    writes = __atomic_load_n(&gpo->levelWrites, __ATOMIC_RELAXED);
+    test_sleep_ms(20);
+    CHECK_INT(__atomic_load_n(&gpo->levelWrites, __ATOMIC_RELAXED), writes);  // cancelled
+    CHECK_INT(gpo->level, 0);
+}
+
+// A pulse count of 3 ends low after three on phases
+static void test_pulse_count(void) {
+    start_pins(NULL);
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    HostGpio *gpo = host_gpio(cfg.gpo[1].gpio);
+    uint32_t writes = gpo->levelWrites;
+    CHECK_INT(gpo_start_pattern(2, 1000, 1000, 3), ESP_OK);
+    WAIT_FOR(__atomic_load_n(&gpo->levelWrites, __ATOMIC_RELAXED) - writes == 6, 1000);
+    test_sleep_ms(20);
+    CHECK_INT(gpo->levelWrites - writes, 6);
+    CHECK_INT(gpo->level, 0);
+    CHECK(!get_gpo_state(1));
+}
+
+RUN_TESTS(
+    TEST(test_release_resets_only_native_pins),
+    TEST(test_native_edge_is_sent),
+    TEST(test_pattern_runs_while_remap_blocks),
+    TEST(test_pulse_count),
+)
@@ -0,0 +1,96 @@
+#include "gpio_rules.h"
+#include "test_util.h"
+
+#define GPI(n) (1u << ((n) - 1))
+
+static GpioRule compile(const char *text) {
+    GpioRule rule;
+    char error[64] = "";
+    esp_err_t err = gpio_rule_compile(text, &rule, error, sizeof(error));
+    if (err != ESP_OK) fprintf(stderr, "\"%s\": %s\n", text, error);
+    CHECK_INT(err, ESP_OK);
+    return rule;
+}
+
+// Checks a level rule against a reference expression for all 256 input masks
+static void check_table(const char *text, bool (*expected)(uint8_t inputs)) {
+    GpioRule rule = compile(text);
+    CHECK_INT(rule.kind, GPIO_RULE_LEVEL);
+    for (int inputs = 0; inputs < 256; inputs++) {
+        if (gpio_rule_lut(rule.set, inputs) != expected(inputs)) {
+            fprintf(stderr, "\"%s\" wrong for inputs 0x%02x\n", text, inputs);
+            CHECK(0);
+        }
+    }
+}
+
+static bool and_not(uint8_t in) { return (in & GPI(1)) && !(in & GPI(4)); }
+static bool precedence(uint8_t in) {
+    return (in & GPI(1)) || (((in & GPI(2)) != 0) ^ ((in & GPI(3)) && (in & GPI(8))));
+}
+static bool grouped(uint8_t in) { return !((in & GPI(1)) || (in & GPI(2))) && (in & GPI(5)); }
+static bool always(uint8_t in) { return true; }
+
+static void test_expressions(void) {
+    check_table("GPI1 & !GPI4", and_not);
+    check_table("gpi1 AND NOT gpi4", and_not);
+    check_table("follow GPI1 | GPI2 ^ GPI3 & GPI8", precedence);     // NOT, AND, XOR, OR
+    check_table("!(GPI1 or GPI2) and GPI5", grouped);
+    check_table("1", always);
+}
+
+static void test_empty_rule(void) {
+    GpioRule rule = compile("   ");
+    CHECK_INT(rule.kind, GPIO_RULE_NONE);
+    CHECK_INT(gpio_rule_eval(&rule, 0, 0xFF, true), 1);      // output left alone
+}
+
+static void test_toggle(void) {
+    GpioRule rule = compile("toggle GPI2");
+    CHECK_INT(rule.kind, GPIO_RULE_TOGGLE);
+    bool out = false;
+    out = gpio_rule_eval(&rule, 0, GPI(2), out);
+    CHECK_INT(out, 1);
+    out = gpio_rule_eval(&rule, GPI(2), GPI(2) | GPI(3), out);     // still true: no new edge
+    CHECK_INT(out, 1);
+    out = gpio_rule_eval(&rule, GPI(2), 0, out);
+    CHECK_INT(out, 1);
+    out = gpio_rule_eval(&rule, 0, GPI(2), out);
+    CHECK_INT(out, 0);
+}
+
+static void test_latch(void) {
+    GpioRule rule = compile("latch GPI1 reset GPI2");
+    CHECK_INT(rule.kind, GPIO_RULE_LATCH);
+    bool out = false;
+    out = gpio_rule_eval(&rule, 0, GPI(1), out);
+    CHECK_INT(out, 1);
+    out = gpio_rule_eval(&rule, GPI(1), 0, out);
+    CHECK_INT(out, 1);
+    out = gpio_rule_eval(&rule, 0, GPI(2), out);
+    CHECK_INT(out, 0);
+    out = gpio_rule_eval(&rule, GPI(2), GPI(2) | GPI(1), out);     // set edge wins
+    CHECK_INT(out, 1);
+}
+
+static void test_errors(void) {
+    static const char *const bad[] = {
+        "GPI9", "GPI1 &", "(GPI1", "GPI1 GPI2", "latch GPI1", "toggle", "GPI10",
+        "((((((((((((((((((GPI1))))))))))))))))))",
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        GpioRule rule;
+        char error[64] = "";
+        CHECK_INT(gpio_rule_compile(bad[i], &rule, error, sizeof(error)), ESP_ERR_INVALID_ARG);
+        CHECK_INT(rule.kind, GPIO_RULE_NONE);
+        CHECK(error[0] != '\0');
+    }
+}
+
+RUN_TESTS(
+    TEST(test_expressions),
+    TEST(test_empty_rule),
+    TEST(test_toggle),
+    TEST(test_latch),
+    TEST(test_errors),
+)
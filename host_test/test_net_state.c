@@ -0,0 +1,189 @@
+#include "net_state.h"
+#include "esp_eth.h"
+#include "esp_netif.h"
+#include "lwip/ip4_addr.h"
+#include "metrics.h"
+#include "test_util.h"
+
+// Two mocked W5500 ports: driver handles are just distinct pointers, the netifs come from the shim.
+// They run on DHCP unless a test switches them to the static IPs the firmware uses.
+static int eth_driver[NET_STATE_MAX_PORTS];
+static esp_netif_t *netifs[NET_STATE_MAX_PORTS];
+
+#define MAX_CALLS 8
+
+static struct {
+    bool up;
+    int activePort;
+} calls[MAX_CALLS];
+static int call_count;
+
+static void listener(bool up, int activePort) {
+    CHECK(call_count < MAX_CALLS);
+    calls[call_count].up = up;
+    calls[call_count].activePort = activePort;
+    call_count++;
+}
+
+static void setup_ports(void) {
+    CHECK_INT(net_state_init(), ESP_OK);
+    CHECK_INT(net_state_subscribe(listener), ESP_OK);
+    const char *names[NET_STATE_MAX_PORTS] = { "en1", "en2" };
+    const char *ips[NET_STATE_MAX_PORTS] = { "192.168.1.50", "192.168.2.50" };
+    for (int port = 0; port < NET_STATE_MAX_PORTS; port++) {
+        netifs[port] = host_netif_new(names[port]);
+        esp_netif_ip_info_t info = { .ip.addr = ipaddr_addr(ips[port]) };
+        esp_netif_set_ip_info(netifs[port], &info);
+        CHECK_INT(net_state_add_port(port, &eth_driver[port], netifs[port]), ESP_OK);
+    }
+}
+
+static void set_link(int port, eth_event_t id) {
+    esp_eth_handle_t eth = &eth_driver[port];
+    host_event_post(ETH_EVENT, id, &eth);
+}
+
+static void set_ip(int port, ip_event_t id) {
+    ip_event_got_ip_t event = { .esp_netif = netifs[port] };
+    esp_netif_get_ip_info(netifs[port], &event.ip_info);
+    host_event_post(IP_EVENT, id, &event);
+}
+
+static void bring_up(int port) {
+    set_link(port, ETHERNET_EVENT_CONNECTED);
+    set_ip(port, IP_EVENT_ETH_GOT_IP);
+}
+
+static void check_call(int index, bool up, int activePort) {
+    CHECK(index < call_count);
+    CHECK_INT(calls[index].up, up);
+    CHECK_INT(calls[index].activePort, activePort);
+}
+
+// A port counts once it has both link and IP
+static void test_link_without_ip_is_down(void) {
+    setup_ports();
+    set_link(0, ETHERNET_EVENT_CONNECTED);
+    CHECK(!net_state_is_up());
+    CHECK_INT(call_count, 0);
+
+    set_ip(0, IP_EVENT_ETH_GOT_IP);
+    CHECK(net_state_is_up());
+    CHECK_INT(net_state_active_port(), 0);
+    check_call(0, true, 0);
+    CHECK_INT(metrics_get(METRIC_NET_UP), 1);
+}
+
+static void test_primary_cable_pull_fails_over(void) {
+    setup_ports();
+    bring_up(0);
+    bring_up(1);
+    CHECK_INT(net_state_up_count(), 2);
+    CHECK_INT(call_count, 1);               // the backup coming up doesn't move traffic
+
+    set_link(0, ETHERNET_EVENT_DISCONNECTED);
+    CHECK(net_state_is_up());
+    CHECK_INT(net_state_active_port(), 1);
+    check_call(1, true, 1);
+    CHECK_INT(metrics_get(METRIC_NET_FAILOVERS), 1);
+    CHECK_INT(metrics_get(METRIC_NET_DOWN_EVENTS), 0);
+
+    // Back to the primary once it has link and IP again
+    set_link(0, ETHERNET_EVENT_CONNECTED);
+    CHECK_INT(net_state_active_port(), 1);
+    set_ip(0, IP_EVENT_ETH_GOT_IP);
+    CHECK_INT(net_state_active_port(), 0);
+    check_call(2, true, 0);
+    CHECK_INT(metrics_get(METRIC_NET_FAILOVERS), 2);
+}
+
+static void test_both_ports_down_pauses_sinks(void) {
+    setup_ports();
+    bring_up(0);
+    bring_up(1);
+    set_link(1, ETHERNET_EVENT_DISCONNECTED);   // backup only, traffic stays on the primary
+    CHECK_INT(call_count, 1);
+
+    set_link(0, ETHERNET_EVENT_STOP);
+    CHECK(!net_state_is_up());
+    CHECK_INT(net_state_active_port(), NET_STATE_NO_PORT);
+    check_call(1, false, NET_STATE_NO_PORT);
+    CHECK_INT(metrics_get(METRIC_NET_UP), 0);
+    CHECK_INT(metrics_get(METRIC_NET_DOWN_EVENTS), 1);
+    CHECK(!net_state_wait_up(0));
+
+    bring_up(1);
+    CHECK(net_state_wait_up(0));
+    check_call(2, true, 1);
+    CHECK_INT(metrics_get(METRIC_NET_FAILOVERS), 0);   // a recovery, not a move between live ports
+}
+
+static void test_lost_ip_takes_port_down(void) {
+    setup_ports();
+    bring_up(0);
+    bring_up(1);
+    set_ip(0, IP_EVENT_ETH_LOST_IP);
+    CHECK(!net_state_port_up(0));
+    CHECK_INT(net_state_active_port(), 1);
+    check_call(1, true, 1);
+}
+
+// Sockets are mapped to the port they run over by their local address
+static void test_port_lookup(void) {
+    setup_ports();
+    CHECK_INT(net_state_port_for_ip(ipaddr_addr("192.168.2.50")), 1);
+    CHECK_INT(net_state_port_for_ip(ipaddr_addr("10.0.0.1")), NET_STATE_NO_PORT);
+
+    char name[8];
+    CHECK(net_state_port_ifname(1, name, sizeof(name)));
+    CHECK_STR(name, "en2");
+    CHECK(!net_state_port_ifname(2, name, sizeof(name)));
+}
+
+// eth_setup stops DHCP and sets the IP once; after a cable pull GOT_IP may never come again
+static void test_static_ip_up_on_link(void) {
+    setup_ports();
+    for (int port = 0; port < NET_STATE_MAX_PORTS; port++) host_netif_set_dhcp(netifs[port], ESP_NETIF_DHCP_STOPPED);
+    bring_up(0);
+    set_link(0, ETHERNET_EVENT_DISCONNECTED);
+    CHECK(!net_state_is_up());
+
+    set_link(0, ETHERNET_EVENT_CONNECTED);
+    CHECK(net_state_port_up(0));
+    check_call(2, true, 0);
+}
+
+// A DHCP port still waits for its lease, and a static port without an address stays down
+static void test_link_alone_needs_static_ip(void) {
+    setup_ports();
+    set_link(0, ETHERNET_EVENT_CONNECTED);
+    CHECK(!net_state_port_up(0));
+
+    host_netif_set_dhcp(netifs[1], ESP_NETIF_DHCP_STOPPED);
+    esp_netif_ip_info_t none = { 0 };
+    esp_netif_set_ip_info(netifs[1], &none);
+    set_link(1, ETHERNET_EVENT_CONNECTED);
+    CHECK(!net_state_port_up(1));
+    CHECK_INT(call_count, 0);
+}
+
+// Events of a driver net_state doesn't know, e.g. a module that failed to probe, are ignored
+static void test_unknown_port_ignored(void) {
+    setup_ports();
+    int other = 0;
+    esp_eth_handle_t eth = &other;
+    host_event_post(ETH_EVENT, ETHERNET_EVENT_CONNECTED, &eth);
+    CHECK_INT(net_state_up_count(), 0);
+    CHECK_INT(call_count, 0);
+}
+
+RUN_TESTS(
+    TEST(test_link_without_ip_is_down),
+    TEST(test_primary_cable_pull_fails_over),
+    TEST(test_both_ports_down_pauses_sinks),
+    TEST(test_lost_ip_takes_port_down),
+    TEST(test_port_lookup),
+    TEST(test_static_ip_up_on_link),
+    TEST(test_link_alone_needs_static_ip),
+    TEST(test_unknown_port_ignored),
+)
@@ -0,0 +1,56 @@
+#include "syslog_sink.h"
+#include "test_util.h"
+
+static const char *format(const char *line) {
+    static char out[320];
+    syslog_format(line, 42, 1234, "192.168.1.100", out, sizeof(out));
+    return out;
+}
+
+static void test_esp_log_line(void) {
+    // local0 (16) * 8 + severity
+    CHECK_STR(format("I (1234) GPIO: Trigger GPI01\n"),
+              "<134>1 - 192.168.1.100 gpiobox - GPIO [meta sequenceId=\"42\" sysUpTime=\"1234\"] Trigger GPI01");
+    CHECK_STR(format("E (5) APP_CONFIG: Failed\n"),
+              "<131>1 - 192.168.1.100 gpiobox - APP_CONFIG [meta sequenceId=\"42\" sysUpTime=\"1234\"] Failed");
+    CHECK_STR(format("W (5) T: x\r\n"),
+              "<132>1 - 192.168.1.100 gpiobox - T [meta sequenceId=\"42\" sysUpTime=\"1234\"] x");
+    CHECK_STR(format("D (5) T: x\n"),
+              "<135>1 - 192.168.1.100 gpiobox - T [meta sequenceId=\"42\" sysUpTime=\"1234\"] x");
+}
+
+static void test_colours_are_stripped(void) {
+    CHECK_STR(format("\033[0;32mI (1234) GPIO: Trigger GPI01\033[0m\n"),
+              "<134>1 - 192.168.1.100 gpiobox - GPIO [meta sequenceId=\"42\" sysUpTime=\"1234\"] Trigger GPI01");
+}
+
+static void test_msgid_is_printusascii(void) {
+    CHECK_STR(format("I (1) my tag: text\n"),
+              "<134>1 - 192.168.1.100 gpiobox - my_tag [meta sequenceId=\"42\" sysUpTime=\"1234\"] text");
+    // RFC 5424 MSGID is at most 32 characters
+    CHECK_STR(format("I (1) ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789: text\n"),
+              "<134>1 - 192.168.1.100 gpiobox - ABCDEFGHIJKLMNOPQRSTUVWXYZ012345 [meta sequenceId=\"42\" sysUpTime=\"1234\"] text");
+}
+
+static void test_other_lines_are_notices(void) {
+    CHECK_STR(format("ets Jun  8 2016 00:22:57\n"),
+              "<133>1 - 192.168.1.100 gpiobox - - [meta sequenceId=\"42\" sysUpTime=\"1234\"] ets Jun  8 2016 00:22:57");
+    CHECK_STR(format("I (12) no tag separator\n"),
+              "<133>1 - 192.168.1.100 gpiobox - - [meta sequenceId=\"42\" sysUpTime=\"1234\"] I (12) no tag separator");
+}
+
+static void test_truncation(void) {
+    char out[40];
+    size_t len = syslog_format("I (1) GPIO: a long line that does not fit\n", 1, 2, "10.0.0.1", out, sizeof(out));
+    CHECK_INT(len, sizeof(out) - 1);
+    CHECK_INT(strlen(out), sizeof(out) - 1);
+    CHECK(strncmp(out, "<134>1 - 10.0.0.1 gpiobox - GPIO [meta", 38) == 0);
+}
+
+RUN_TESTS(
+    TEST(test_esp_log_line),
+    TEST(test_colours_are_stripped),
+    TEST(test_msgid_is_printusascii),
+    TEST(test_other_lines_are_notices),
+    TEST(test_truncation),
+)
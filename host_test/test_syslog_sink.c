@@ -0,0 +1,125 @@
+// The streamer end to end: esp_log lines to a UDP collector on the loopback
+#include <sys/time.h>
+#include "syslog_sink.h"
+#include "app_config.h"
+#include "esp_log.h"
+#include "fakes/fakes.h"
+#include "lwip/ip4_addr.h"
+#include "lwip/sockets.h"
+#include "metrics.h"
+#include "sdkconfig.h"
+#include "test_util.h"
+
+static int collector = -1;
+
+// Binds the collector to an ephemeral port and points the device at it
+static void start(bool enabled) {
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = ipaddr_addr("127.0.0.1") };
+    socklen_t addrLen = sizeof(addr);
+    collector = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    CHECK(collector >= 0);
+    CHECK_INT(bind(collector, (struct sockaddr *)&addr, sizeof(addr)), 0);
+    CHECK_INT(getsockname(collector, (struct sockaddr *)&addr, &addrLen), 0);
+    struct timeval timeout = { .tv_sec = 0, .tv_usec = 100000 };
+    CHECK_INT(setsockopt(collector, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)), 0);
+
+    CHECK_INT(init_config(), ESP_OK);
+    CHECK_INT(load_config(), ESP_OK);
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    cfg.syslogEnabled = enabled;
+    cfg.syslogIp = addr.sin_addr.s_addr;
+    cfg.syslogPort = ntohs(addr.sin_port);
+    CHECK_INT(apply_config(&cfg), ESP_OK);
+    CHECK_INT(syslog_sink_init(), ESP_OK);
+}
+
+// The next datagram whose MSGID is tag, NULL if none arrives within timeout_ms
+static const char *receive(const char *tag, int timeout_ms) {
+    static char message[512];
+    char msgid[40];
+    snprintf(msgid, sizeof(msgid), " gpiobox - %s [", tag);
+    int64_t until = test_now_ms() + timeout_ms;
+    while (test_now_ms() < until) {
+        ssize_t len = recv(collector, message, sizeof(message) - 1, 0);
+        if (len <= 0) continue;
+        message[len] = '\0';
+        if (strstr(message, msgid)) return message;
+    }
+    return NULL;
+}
+
+static void test_line_reaches_collector(void) {
+    start(true);
+    ESP_LOGI("GPIO", "Trigger GPI%02d %s", 1, "HIGH");
+    const char *message = receive("GPIO", 2000);
+    CHECK(message != NULL);
+    CHECK(strncmp(message, "<134>1 - 10.168.0.177 gpiobox - GPIO [meta sequenceId=\"", 55) == 0);
+    const char *text = strstr(message, "\"] ");
+    CHECK(text != NULL);
+    CHECK_STR(text + 3, "Trigger GPI01 HIGH");
+    WAIT_FOR(metrics_get(METRIC_SYSLOG_SENT) >= 1, 1000);
+}
+
+// Lines are kept in log order, one datagram each
+static void test_lines_keep_order(void) {
+    start(true);
+    for (int i = 0; i < 20; i++) ESP_LOGW("ORDER", "line %d", i);
+    for (int i = 0; i < 20; i++) {
+        const char *message = receive("ORDER", 2000);
+        CHECK(message != NULL);
+        char expected[16];
+        snprintf(expected, sizeof(expected), "] line %d", i);
+        CHECK(strstr(message, expected) != NULL);
+        CHECK(strncmp(message, "<132>", 5) == 0);
+    }
+}
+
+// The formatted line is cut at 191 characters, the message still ends where the line was cut
+static void test_long_line_is_cut(void) {
+    start(true);
+    char longText[400];
+    memset(longText, 'x', sizeof(longText) - 1);
+    longText[sizeof(longText) - 1] = '\0';
+    ESP_LOGI("LONG", "%s", longText);
+    const char *message = receive("LONG", 2000);
+    CHECK(message != NULL);
+    const char *text = strstr(message, "\"] ");
+    CHECK(text != NULL);
+    text += 3;
+    size_t len = strlen(text);
+    CHECK(len > 150 && len < 191);
+    CHECK(strspn(text, "x") == len);
+}
+
+static void test_disabled_sends_nothing(void) {
+    start(false);
+    ESP_LOGI("QUIET", "not for the collector");
+    CHECK(receive("QUIET", 300) == NULL);
+    CHECK_INT(metrics_get(METRIC_SYSLOG_SENT), 0);
+    CHECK_INT(metrics_get(METRIC_SYSLOG_DROPPED_BUFFER), 0);
+}
+
+// While the network is down lines wait in the buffer, the overflow is counted, the rest go out
+// once it is back
+static void test_full_buffer_drops_and_counts(void) {
+    start(true);
+    fake_net_state_set_up(false);
+    test_sleep_ms(2 * CONFIG_SYSLOG_FLUSH_MS);
+    for (int i = 0; i < 200; i++) ESP_LOGI("FILL", "buffered line %03d", i);
+    uint32_t dropped = metrics_get(METRIC_SYSLOG_DROPPED_BUFFER);
+    CHECK(dropped > 0 && dropped < 200);
+
+    fake_net_state_set_up(true);
+    const char *message = receive("FILL", 2000);
+    CHECK(message != NULL);
+    CHECK(strstr(message, "] buffered line 000") != NULL);
+}
+
+RUN_TESTS(
+    TEST(test_line_reaches_collector),
+    TEST(test_lines_keep_order),
+    TEST(test_long_line_is_cut),
+    TEST(test_disabled_sends_nothing),
+    TEST(test_full_buffer_drops_and_counts),
+)
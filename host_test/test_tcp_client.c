@@ -0,0 +1,149 @@
+// The real tcp_client against a controller on the loopback: commands in, GPI events and sync
+// responses out, reconnects and stop
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "tcp_client.h"
+#include "app_config.h"
+#include "driver/gpio.h"
+#include "event_journal.h"
+#include "fakes/fakes.h"
+#include "gpio_handler.h"
+#include "metrics.h"
+#include "sdkconfig.h"
+#include "test_util.h"
+
+static int listener = -1;
+static int conn = -1;
+static AppConfig cfg;
+
+// Waits for the client to connect, the accepted socket or -1
+static int accept_client(int timeout_ms) {
+    struct timeval timeout = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+    setsockopt(listener, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    int fd = accept(listener, NULL, NULL);
+    if (fd >= 0) {
+        struct timeval recvTimeout = { .tv_sec = 2 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &recvTimeout, sizeof(recvTimeout));
+    }
+    return fd;
+}
+
+// Controller on an ephemeral port, the device's factory pin map with TCP pointed at it
+static void start(void) {
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addrLen = sizeof(addr);
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(listener >= 0);
+    CHECK_INT(bind(listener, (struct sockaddr *)&addr, sizeof(addr)), 0);
+    CHECK_INT(listen(listener, 4), 0);
+    CHECK_INT(getsockname(listener, (struct sockaddr *)&addr, &addrLen), 0);
+
+    CHECK_INT(init_config(), ESP_OK);
+    CHECK_INT(load_config(), ESP_OK);
+    config_snapshot(&cfg);
+    cfg.tcpEnabled = 1;
+    cfg.tcpIp = addr.sin_addr.s_addr;
+    cfg.tcpPort = ntohs(addr.sin_port);
+    CHECK_INT(apply_config(&cfg), ESP_OK);
+    CHECK_INT(event_journal_init(), ESP_OK);
+    CHECK_INT(init_gpio_pins(), ESP_OK);
+    CHECK(tcp_client_is_running());
+    conn = accept_client(2000);
+    CHECK(conn >= 0);
+}
+
+static void command(const char *json) {
+    CHECK_INT(send(conn, json, strlen(json), 0), (int)strlen(json));
+}
+
+// Reads from the connection until a message containing needle arrived, NULL on timeout
+static const char *receive(const char *needle, int timeout_ms) {
+    static char buf[4096];
+    size_t len = 0;
+    int64_t until = test_now_ms() + timeout_ms;
+    while (test_now_ms() < until && len < sizeof(buf) - 1) {
+        ssize_t n = recv(conn, buf + len, sizeof(buf) - 1 - len, 0);
+        if (n <= 0) break;
+        len += n;
+        buf[len] = '\0';
+        const char *found = strstr(buf, needle);
+        if (found) return found;
+    }
+    return NULL;
+}
+
+static void test_gpo_commands(void) {
+    start();
+    command("{\"event\":\"GPO-2\",\"state\":\"HIGH\"}");
+    WAIT_FOR(get_gpo_state(1), 2000);
+    CHECK_INT(host_gpio(cfg.gpo[1].gpio)->level, 1);
+
+    command("{\"event\":\"GPO-2\",\"state\":\"LOW\"}");
+    WAIT_FOR(!get_gpo_state(1), 2000);
+    CHECK_INT(host_gpio(cfg.gpo[1].gpio)->level, 0);
+}
+
+// Unknown pins and malformed JSON are dropped, the connection stays usable
+static void test_bad_commands_ignored(void) {
+    start();
+    command("{\"event\":\"GPO-99\",\"state\":\"HIGH\"}");
+    test_sleep_ms(50);
+    command("{\"event\":");
+    test_sleep_ms(50);
+    for (int i = 0; i < GPO_PIN_COUNT; i++) CHECK(!get_gpo_state(i));
+
+    command("{\"event\":\"GPO-1\",\"state\":\"HIGH\"}");
+    WAIT_FOR(get_gpo_state(0), 2000);
+}
+
+static void test_sync_request(void) {
+    start();
+    command("{\"event\":\"GPO-3\",\"state\":\"HIGH\"}");
+    WAIT_FOR(get_gpo_state(2), 2000);
+    command("{\"event\":\"sync\",\"state\":\"request\"}");
+    const char *response = receive("{\"event\":\"sync-response\"", 2000);
+    CHECK(response != NULL);
+    CHECK(strstr(response, "\"gpi\":{\"GPI-1\":\"LOW\"") != NULL);
+    CHECK(strstr(response, "\"GPO-3\":\"HIGH\"") != NULL);
+    CHECK(strstr(response, "\"GPO-1\":\"LOW\"") != NULL);
+}
+
+static void test_gpi_event_sent(void) {
+    start();
+    uint32_t sent = metrics_get(METRIC_SINK_TCP_SENT);
+    host_gpio_drive(cfg.gpi[0].gpio, 1);
+    CHECK(receive("\"event\":\"GPI01\"", 2000) != NULL);
+    WAIT_FOR(metrics_get(METRIC_SINK_TCP_SENT) > sent, 1000);
+}
+
+// Peer closes: the client reconnects after the retry delay
+static void test_reconnects(void) {
+    start();
+    close(conn);
+    conn = accept_client(4000);
+    CHECK(conn >= 0);
+    WAIT_FOR(metrics_get(METRIC_TCP_RECONNECTS) == 1, 1000);
+    command("{\"event\":\"GPO-1\",\"state\":\"HIGH\"}");
+    WAIT_FOR(get_gpo_state(0), 2000);
+}
+
+// Turning TCP off deletes the client task while it waits in recv and closes the connection
+static void test_disable_stops_client(void) {
+    start();
+    cfg.tcpEnabled = 0;
+    CHECK_INT(apply_config(&cfg), ESP_OK);
+    CHECK(!tcp_client_is_running());
+    char c;
+    CHECK_INT(recv(conn, &c, 1, 0), 0);
+    CHECK_INT(tcp_client_send("{}"), ESP_FAIL);
+}
+
+RUN_TESTS(
+    TEST(test_gpo_commands),
+    TEST(test_bad_commands_ignored),
+    TEST(test_sync_request),
+    TEST(test_gpi_event_sent),
+    TEST(test_reconnects),
+    TEST(test_disable_stops_client),
+)
@@ -0,0 +1,96 @@
+#pragma once
+
+// Minimal test runner for the host tests. Every test runs in its own forked process, so module
+// statics start from zero like after a reboot and a crash fails only that test. NVS is erased
+// before each test, boots within one test share it.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "nvs.h"
+
+typedef struct {
+    const char *name;
+    void (*fn)(void);
+} TestCase;
+
+#define TEST(name) { #name, name }
+
+#define CHECK(cond) do {                                                                    \
+        if (!(cond)) {                                                                      \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);        \
+            exit(1);                                                                        \
+        }                                                                                   \
+    } while (0)
+
+#define CHECK_INT(actual, expected) do {                                                    \
+        long long a_ = (long long)(actual), e_ = (long long)(expected);                     \
+        if (a_ != e_) {                                                                     \
+            fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__,       \
+                    #actual, a_, e_);                                                       \
+            exit(1);                                                                        \
+        }                                                                                   \
+    } while (0)
+
+#define CHECK_STR(actual, expected) do {                                                    \
+        const char *a_ = (actual), *e_ = (expected);                                        \
+        if (strcmp(a_, e_) != 0) {                                                          \
+            fprintf(stderr, "%s:%d: %s is\n  \"%s\"\nexpected\n  \"%s\"\n", __FILE__,       \
+                    __LINE__, #actual, a_, e_);                                             \
+            exit(1);                                                                        \
+        }                                                                                   \
+    } while (0)
+
+static inline int64_t test_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static inline void test_sleep_ms(int ms) {
+    struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (long)(ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+// Polls cond until it holds or timeout_ms passed, for results produced by other tasks
+#define WAIT_FOR(cond, timeout_ms) do {                                                     \
+        int64_t until_ = test_now_ms() + (timeout_ms);                                      \
+        while (!(cond) && test_now_ms() < until_) test_sleep_ms(1);                         \
+        CHECK(cond);                                                                        \
+    } while (0)
+
+// Runs fn in a child process, like one boot of the device. Returns its exit status.
+static inline int run_boot(void (*fn)(void)) {
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid == 0) {
+        fn();
+        fflush(NULL);
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+static inline int run_tests(const TestCase *tests, size_t count) {
+    int failed = 0;
+    for (size_t i = 0; i < count; i++) {
+        host_nvs_reset();
+        int status = run_boot(tests[i].fn);
+        printf("%-6s %s\n", status == 0 ? "ok" : "FAIL", tests[i].name);
+        if (status != 0) failed++;
+    }
+    printf("%d/%d passed\n", (int)(count - failed), (int)count);
+    return failed ? 1 : 0;
+}
+
+#define RUN_TESTS(...) int main(void) {                                                     \
+        static const TestCase tests_[] = { __VA_ARGS__ };                                   \
+        return run_tests(tests_, sizeof(tests_) / sizeof(tests_[0]));                      \
+    }
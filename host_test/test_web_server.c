@@ -0,0 +1,248 @@
+// The real web_server on the esp_http_server shim, driven over loopback HTTP
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "web_server.h"
+#include "app_config.h"
+#include "esp_http_server.h"
+#include "esp_spiffs.h"
+#include "sdkconfig.h"
+#include "test_util.h"
+
+#define SESSION "Cookie: sessionToken=loggedIn\r\n"
+
+typedef struct {
+    int status;
+    char headers[1024];
+    char body[64 * 1024];
+    size_t bodyLen;
+} Response;
+
+static Response resp;
+static uint16_t port;
+
+// Boots the factory config as edited by edit and starts the server on an ephemeral port
+static void start_with(void (*edit)(AppConfig *cfg)) {
+    host_spiffs_mount("/spiffs_data", SPIFFS_DATA_DIR);
+    host_httpd_listen_on(0);
+    CHECK_INT(init_config(), ESP_OK);
+    CHECK_INT(load_config(), ESP_OK);
+    if (edit) {
+        AppConfig cfg;
+        config_snapshot(&cfg);
+        edit(&cfg);
+        CHECK_INT(apply_config(&cfg), ESP_OK);
+    }
+    CHECK_INT(start_webserver(), ESP_OK);
+    port = host_httpd_port();
+    CHECK(port != 0);
+}
+
+static void start(void) {
+    start_with(NULL);
+}
+
+static int connect_server(void) {
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(fd >= 0);
+    CHECK_INT(connect(fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+    return fd;
+}
+
+// Joins the chunks of a chunked body in place
+static void dechunk(void) {
+    size_t in = 0, out = 0;
+    while (in < resp.bodyLen) {
+        char *end;
+        size_t size = strtoul(resp.body + in, &end, 16);
+        if (end == resp.body + in) break;
+        in = end - resp.body + 2;
+        if (size == 0) break;
+        memmove(resp.body + out, resp.body + in, size);
+        out += size;
+        in += size + 2;
+    }
+    resp.bodyLen = out;
+    resp.body[out] = '\0';
+}
+
+// One request on its own connection, the whole reply in resp. Returns the status code.
+static int request(const char *method, const char *path, const char *headers, const char *body) {
+    int fd = connect_server();
+    char head[512];
+    int len = snprintf(head, sizeof(head), "%s %s HTTP/1.1\r\nHost: gpiobox\r\nConnection: close\r\n%sContent-Length: %d\r\n\r\n",
+                       method, path, headers ? headers : "", body ? (int)strlen(body) : 0);
+    CHECK_INT(send(fd, head, len, 0), len);
+    if (body) CHECK_INT(send(fd, body, strlen(body), 0), (int)strlen(body));
+
+    static char raw[sizeof(resp.body) + sizeof(resp.headers)];
+    size_t got = 0;
+    ssize_t n;
+    while (got < sizeof(raw) - 1 && (n = recv(fd, raw + got, sizeof(raw) - 1 - got, 0)) > 0) got += n;
+    close(fd);
+    raw[got] = '\0';
+
+    memset(&resp, 0, sizeof(resp));
+    char *end = strstr(raw, "\r\n\r\n");
+    CHECK(end != NULL);
+    CHECK(sscanf(raw, "HTTP/1.1 %d", &resp.status) == 1);
+    snprintf(resp.headers, sizeof(resp.headers), "%.*s", (int)(end + 2 - raw), raw);
+    resp.bodyLen = got - (end + 4 - raw);
+    memcpy(resp.body, end + 4, resp.bodyLen);
+    if (strstr(resp.headers, "Transfer-Encoding: chunked")) dechunk();
+    return resp.status;
+}
+
+static void read_asset(const char *name, char *out, size_t size) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", SPIFFS_DATA_DIR, name);
+    FILE *f = fopen(path, "r");
+    CHECK(f != NULL);
+    size_t len = fread(out, 1, size - 1, f);
+    out[len] = '\0';
+    fclose(f);
+}
+
+static void test_login_page(void) {
+    start();
+    CHECK_INT(request("GET", "/", NULL, NULL), 200);
+    CHECK(strstr(resp.headers, "Content-Type: text/html") != NULL);
+    CHECK(strstr(resp.body, "<h2>GPIO Box Login</h2>") != NULL);
+    CHECK(strstr(resp.body, "No match") == NULL);
+}
+
+static void test_login(void) {
+    start();
+    CHECK_INT(request("POST", "/", NULL, "user=admin&password=wrong"), 200);
+    CHECK(strstr(resp.body, "No match, try again") != NULL);
+
+    CHECK_INT(request("POST", "/", NULL, "user=admin&password=admin"), 302);
+    CHECK(strstr(resp.headers, "Set-Cookie: sessionToken=loggedIn") != NULL);
+    CHECK(strstr(resp.headers, "Location: /") != NULL);
+}
+
+// The config page goes out chunked with every {{placeholder}} filled from the live config
+static void test_config_page_fills_placeholders(void) {
+    start();
+    CHECK_INT(request("GET", "/", SESSION, NULL), 200);
+    CHECK(strstr(resp.headers, "Transfer-Encoding: chunked") != NULL);
+    CHECK(resp.bodyLen > 20000);
+    CHECK(strstr(resp.body, "{{") == NULL);
+    CHECK(strstr(resp.body, "10.168.0.177") != NULL);
+    CHECK(strstr(resp.body, "</html>") != NULL);
+}
+
+static void test_static_assets(void) {
+    static char file[32 * 1024];
+    start();
+    CHECK_INT(request("GET", "/styles.css", NULL, NULL), 200);
+    CHECK(strstr(resp.headers, "Content-Type: text/css") != NULL);
+    read_asset("styles.css", file, sizeof(file));
+    CHECK_STR(resp.body, file);
+
+    CHECK_INT(request("GET", "/index.js", NULL, NULL), 200);
+    CHECK(strstr(resp.headers, "Content-Type: application/javascript") != NULL);
+    read_asset("index.js", file, sizeof(file));
+    CHECK_INT(resp.bodyLen, strlen(file));
+    CHECK_STR(resp.body, file);
+}
+
+static void test_metrics(void) {
+    start();
+    CHECK_INT(request("GET", "/metrics", NULL, NULL), 200);
+    CHECK(strstr(resp.headers, "Content-Type: text/plain; version=0.0.4") != NULL);
+    CHECK(strstr(resp.body, "# TYPE gpiobox_gpi_edges_total counter") != NULL);
+}
+
+static void test_save_applies_config(void) {
+    start();
+    CHECK_INT(request("POST", "/save", SESSION, "{\"tcpPort\":\"9100\",\"syslogPort\":1514}"), 302);
+    CHECK(strstr(resp.headers, "Location: /") != NULL);
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    CHECK_INT(cfg.tcpPort, 9100);
+    CHECK_INT(cfg.syslogPort, 1514);
+
+    // The page shows the saved values
+    CHECK_INT(request("GET", "/", SESSION, NULL), 200);
+    CHECK(strstr(resp.body, "9100") != NULL);
+}
+
+static void test_save_rejects_bad_bodies(void) {
+    static char big[8 * 1024];
+    start();
+    CHECK_INT(request("POST", "/save", SESSION, "{\"tcpPort\":"), 400);
+    CHECK_STR(resp.body, "Invalid JSON");
+    CHECK_INT(request("POST", "/save", SESSION, NULL), 400);
+    CHECK_STR(resp.body, "Empty body");
+
+    memset(big, ' ', sizeof(big) - 1);
+    big[0] = '{';
+    big[sizeof(big) - 2] = '}';
+    CHECK_INT(request("POST", "/save", SESSION, big), 400);
+    CHECK_STR(resp.body, "Body too large");
+
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    CHECK_INT(cfg.tcpPort, 0);
+}
+
+static void test_unknown_path(void) {
+    start();
+    CHECK_INT(request("GET", "/nope", NULL, NULL), 404);
+    CHECK_INT(request("GET", "/save", NULL, NULL), 405);
+}
+
+static void short_recv_timeout(AppConfig *cfg) {
+    cfg->web.recvTimeoutS = 1;
+}
+
+// A body that stops arriving is answered with 408 after three recv timeouts in a row, and the
+// server goes on serving others
+static void test_stalled_body_times_out(void) {
+    start_with(short_recv_timeout);
+    int fd = connect_server();
+    static const char partial[] = "POST /save HTTP/1.1\r\nContent-Length: 100\r\n\r\n{\"tcpPort\":";
+    CHECK_INT(send(fd, partial, sizeof(partial) - 1, 0), (int)sizeof(partial) - 1);
+
+    // The head and the body may arrive in separate reads, the server closes after the reply
+    char reply[256];
+    int64_t sent = test_now_ms();
+    ssize_t n = recv(fd, reply, sizeof(reply) - 1, 0);
+    int64_t waited = test_now_ms() - sent;
+    CHECK(n > 0);
+    size_t got = n;
+    while (got < sizeof(reply) - 1 && (n = recv(fd, reply + got, sizeof(reply) - 1 - got, 0)) > 0) got += n;
+    close(fd);
+    reply[got] = '\0';
+    CHECK(strncmp(reply, "HTTP/1.1 408 Request Timeout", 28) == 0);
+    CHECK(strstr(reply, "Body timed out") != NULL);
+    CHECK(waited >= 2900 && waited < 5000);
+
+    CHECK_INT(request("GET", "/", NULL, NULL), 200);
+}
+
+// A saved change to the server tuning restarts it from its own task, on the same port
+static void test_settings_change_restarts_server(void) {
+    start();
+    CHECK_INT(request("POST", "/save", SESSION, "{\"webMaxSockets\":3,\"webLruPurge\":true}"), 302);
+    test_sleep_ms(700);
+    CHECK_INT(request("GET", "/", NULL, NULL), 200);
+    CHECK_INT(host_httpd_port(), port);
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    CHECK_INT(cfg.web.maxOpenSockets, 3);
+}
+
+RUN_TESTS(
+    TEST(test_login_page),
+    TEST(test_login),
+    TEST(test_config_page_fills_placeholders),
+    TEST(test_static_assets),
+    TEST(test_metrics),
+    TEST(test_save_applies_config),
+    TEST(test_save_rejects_bad_bodies),
+    TEST(test_unknown_path),
+    TEST(test_stalled_body_times_out),
+    TEST(test_settings_change_restarts_server),
+)
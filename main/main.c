@@ -10,38 +10,64 @@
 #include "gpio_handler.h"
 #include "esp_netif.h"
 #include "esp_netif_types.h"
+#include "event_journal.h"
+#include "boot_timeline.h"
+#include "net_state.h"
+#include "task_layout.h"
+#include "deferred_log.h"
+#include "syslog_sink.h"
 
 // Forward declarations
 void test_debug(void);
-void wait_for_eth_ready(void);
+static void network_boot_task(void *arg);
 
 void app_main(void)
 {
+    boot_timeline_init(); // Stage timestamps and the event group the boot stages wait on
+    task_layout_log();
+    ESP_ERROR_CHECK(dlog_init()); // Prints the event path's deferred log lines at the lowest priority
+
+    boot_stage_begin(BOOT_STAGE_CONFIG);
 	ESP_ERROR_CHECK(init_config()); //On each load - the nvs storage must be initialized
-    ESP_ERROR_CHECK(load_config()); //Once the initialization is done - we can load the config to globalConfig
-    
-    ESP_ERROR_CHECK(init_ethernet_static()); //Initializes W5500 with static IP using values from globalConfig
-    
-	wait_for_eth_ready(); // Waits until IP is assigned and Ethernet is fully up.
-    handle_config_change(); // This determines if tcp_client_task needs to be started (regular or Companion mode)
-	ESP_ERROR_CHECK(init_spiffs()); // Mounts /spiffs_data partition, where HTML/JS/CSS is located.
-    ESP_ERROR_CHECK(init_gpio_pins()); // Initializes all GPI pins with ISR/debounce, and GPO pins as outputs
-    ESP_ERROR_CHECK(start_webserver()); // Starts HTTP server, sets up routes for /, /save, etc.
+    ESP_ERROR_CHECK(load_config()); //Once the initialization is done - we can load and publish the config
+    ESP_ERROR_CHECK(init_http_client()); // Parses httpUrl and follows HTTP config changes
+    ESP_ERROR_CHECK(syslog_sink_init()); // Copies log lines to the syslog collector, if one is configured
+    boot_stage_end(BOOT_STAGE_CONFIG, ESP_OK);
+
+    // Local side first: inputs are sampled (and journaled for offline sinks) before any network exists
+    ESP_ERROR_CHECK(boot_run(BOOT_STAGE_JOURNAL, event_journal_init)); // Mounts the journal partition, recovers undelivered events after a power cut
+    ESP_ERROR_CHECK(boot_run(BOOT_STAGE_GPIO, init_gpio_pins)); // Initializes all GPI pins with ISR/debounce, and GPO pins as outputs
+
+    // W5500 + netif come up in their own task while SPIFFS mounts here
+    task_layout_create(TASK_BOOT_NET, network_boot_task, NULL, NULL);
+
+    ESP_ERROR_CHECK(boot_run(BOOT_STAGE_SPIFFS, init_spiffs)); // Mounts /spiffs_data partition, where HTML/JS/CSS is located.
+    boot_wait(BOOT_BIT(BOOT_STAGE_ETHERNET), portMAX_DELAY); // httpd only needs the netif, not the link
+    ESP_ERROR_CHECK(boot_run(BOOT_STAGE_WEB_SERVER, start_webserver)); // Starts HTTP server, sets up routes for /, /save, etc.
     
     ESP_LOGI("MAIN", "Loaded Config:");
 
     //test_debug(); // manual debug helper
 }
 
-void wait_for_eth_ready() {
-    esp_netif_ip_info_t ip_info;
-    esp_netif_t* netif = esp_netif_get_handle_from_ifkey("ETH_DEF");
+// Brings up Ethernet, then starts the network sinks as soon as the interface has its IP
+static void network_boot_task(void *arg) {
+    ESP_ERROR_CHECK(boot_run(BOOT_STAGE_ETHERNET, init_ethernet_static)); //Initializes W5500 with static IP using values from the loaded config
+
+    boot_stage_begin(BOOT_STAGE_LINK);
+    net_state_wait_up(portMAX_DELAY);  // link up and static IP applied
+    boot_stage_end(BOOT_STAGE_LINK, ESP_OK);
+
+    boot_stage_begin(BOOT_STAGE_SINKS);
+    AppConfig cfg;
+    config_snapshot(&cfg);
+    handle_config_change(CONFIG_CHANGED_TCP | CONFIG_CHANGED_COMPANION, &cfg); // This determines if tcp_client_task needs to be started (regular or Companion mode)
+    event_journal_kick(); // HTTP backlog from before the link came up
+    boot_stage_end(BOOT_STAGE_SINKS, ESP_OK);
 
-    while (esp_netif_get_ip_info(netif, &ip_info) != ESP_OK || ip_info.ip.addr == 0) {
-        ESP_LOGW("NET_WAIT", "Waiting for Ethernet to be ready...");
-        vTaskDelay(pdMS_TO_TICKS(200));
-    }
-    ESP_LOGI("NET_WAIT", "Ethernet is ready with IP: " IPSTR, IP2STR(&ip_info.ip));
+    boot_wait(BOOT_ALL_BITS, portMAX_DELAY);
+    boot_timeline_log();
+    vTaskDelete(NULL);
 }
 
 // Utility debug
@@ -28,6 +28,13 @@ function validateForm(event) {
         alert('Invalid IP Address, Gateway, or Subnet Mask!');
         return false;
     }
+    let backupIp = document.getElementById('backupIp').value;
+    let backupGateway = document.getElementById('backupGateway').value;
+    let backupSubnetMask = document.getElementById('backupSubnetMask').value;
+    if (!isValidIP(backupIp) || !isValidIP(backupGateway) || !isValidIP(backupSubnetMask)) {
+        alert('Invalid backup port IP Address, Gateway, or Subnet Mask!');
+        return false;
+    }
 
     // Tcp IP and Port validation
     if (!isValidIP(tcpIp)) {
@@ -65,6 +72,105 @@ function validateForm(event) {
         }
     }
 
+    // Syslog collector validation
+    if (document.getElementById('syslogEnabled').checked) {
+        if (!isValidIP(document.getElementById('syslogIp').value)) {
+            alert('Invalid syslog collector IP address!');
+            return false;
+        }
+        if (!isValidPort(document.getElementById('syslogPort').value)) {
+            alert('Invalid syslog Port! Must be between 1-65535.');
+            return false;
+        }
+    }
+
+    // Web server tuning, same ranges as the device enforces
+    const webLimits = {
+        webMaxSockets: [1, 13], webBacklog: [1, 16], webKeepAliveIdleS: [1, 7200],
+        webKeepAliveIntervalS: [1, 600], webKeepAliveCount: [1, 10], webTaskPriority: [1, 24],
+        webRecvTimeoutS: [1, 60], webSendTimeoutS: [1, 60]
+    };
+    for (const [id, [min, max]] of Object.entries(webLimits)) {
+        let value = document.getElementById(id).value;
+        if (!/^[0-9]+$/.test(value) || value < min || value > max) {
+            alert('Invalid web server setting ' + id + '! Must be between ' + min + '-' + max + '.');
+            return false;
+        }
+    }
+
+    // Pin map validation, the device rejects duplicates and pins it can't use
+    for (let i = 1; i <= GPI_COUNT; i++) {
+        let debounce = document.getElementById('gpi' + i + 'DebounceUs').value;
+        if (!/^[0-9]+$/.test(debounce) || debounce > 1000000) {
+            alert('Invalid debounce time for GPI' + i + '! Must be between 0-1000000 us.');
+            return false;
+        }
+        let reportMs = document.getElementById('gpi' + i + 'ReportMs').value;
+        let reportThreshold = document.getElementById('gpi' + i + 'ReportThreshold').value;
+        if (!/^[0-9]+$/.test(reportMs) || reportMs > 60000 || !/^[0-9]+$/.test(reportThreshold)) {
+            alert('Invalid counter report settings for GPI' + i + '!');
+            return false;
+        }
+        let burst = document.getElementById('gpi' + i + 'EventBurst').value;
+        let perMin = document.getElementById('gpi' + i + 'EventsPerMin').value;
+        if (!/^[0-9]+$/.test(burst) || burst > 255 || !/^[0-9]+$/.test(perMin) || perMin > 60000 ||
+            (burst > 0 && perMin == 0)) {
+            alert('Invalid event rate limit for GPI' + i + '! Burst 0-255, Events/min 1-60000.');
+            return false;
+        }
+    }
+    let usedPins = {};
+    for (let pin of pinMapIds()) {
+        if (!document.getElementById(pin + 'Enabled').checked) continue;
+        let gpio = document.getElementById(pin + 'Gpio').value;
+        if (!/^[0-9]+$/.test(gpio) || gpio > 39) {
+            alert('Invalid GPIO number for ' + pin.toUpperCase() + '!');
+            return false;
+        }
+        if (usedPins[gpio]) {
+            alert('GPIO ' + gpio + ' is used by both ' + usedPins[gpio].toUpperCase() + ' and ' + pin.toUpperCase() + '!');
+            return false;
+        }
+        usedPins[gpio] = pin;
+    }
+    let addresses = {};
+    for (let i = 1; i <= EXP_COUNT; i++) {
+        let exp = 'exp' + i;
+        if (!document.getElementById(exp + 'Enabled').checked) continue;
+        let address = parseHex(document.getElementById(exp + 'Address').value);
+        if (isNaN(address) || address < 0x20 || address > 0x27 || addresses[address]) {
+            alert('Invalid or duplicate I2C address for expander ' + i + '! Must be 0x20-0x27.');
+            return false;
+        }
+        addresses[address] = true;
+        for (let mask of ['InputMask', 'InvertMask', 'PullUpMask']) {
+            let value = parseHex(document.getElementById(exp + mask).value);
+            if (isNaN(value) || value < 0 || value > 0xFFFF) {
+                alert('Invalid ' + mask + ' for expander ' + i + '! Must be 0x0000-0xFFFF.');
+                return false;
+            }
+        }
+        let debounce = document.getElementById(exp + 'DebounceUs').value;
+        let burst = document.getElementById(exp + 'EventBurst').value;
+        let perMin = document.getElementById(exp + 'EventsPerMin').value;
+        if (!/^[0-9]+$/.test(debounce) || debounce > 1000000 || !/^[0-9]+$/.test(burst) || burst > 255 ||
+            !/^[0-9]+$/.test(perMin) || perMin > 60000 || (burst > 0 && perMin == 0)) {
+            alert('Invalid debounce or event rate limit for expander ' + i + '!');
+            return false;
+        }
+        let intGpio = document.getElementById(exp + 'IntGpio').value;
+        if (intGpio === '') continue;  // polled
+        if (!/^[0-9]+$/.test(intGpio) || intGpio > 39) {
+            alert('Invalid INT GPIO for expander ' + i + '!');
+            return false;
+        }
+        if (usedPins[intGpio]) {
+            alert('GPIO ' + intGpio + ' is used by both ' + usedPins[intGpio].toUpperCase() + ' and expander ' + i + '!');
+            return false;
+        }
+        usedPins[intGpio] = exp;
+    }
+
     // Admin password length validation
     if (adminPassword.length > 32) {
         alert('Admin password too long! (Max 32 characters)');
@@ -75,6 +181,72 @@ function validateForm(event) {
     return false;
 }
 
+const GPI_COUNT = 8;
+const GPO_COUNT = 5;
+const EXP_COUNT = 4;
+const EXP_NO_INT = 255;
+
+// Masks and addresses accept hex ("0x00FF") or decimal
+function parseHex(text) {
+    text = text.trim();
+    if (/^0x[0-9a-f]+$/i.test(text)) return parseInt(text, 16);
+    if (/^[0-9]+$/.test(text)) return parseInt(text, 10);
+    return NaN;
+}
+
+function pinMapIds() {
+    let ids = [];
+    for (let i = 1; i <= GPI_COUNT; i++) ids.push('gpi' + i);
+    for (let i = 1; i <= GPO_COUNT; i++) ids.push('gpo' + i);
+    return ids;
+}
+
+// Pin map is always sent, it applies without a reboot
+function addPinMap(data) {
+    for (let i = 1; i <= GPI_COUNT; i++) {
+        let pin = 'gpi' + i;
+        data[pin + 'Enabled'] = document.getElementById(pin + 'Enabled').checked;
+        data[pin + 'Gpio'] = parseInt(document.getElementById(pin + 'Gpio').value) || 0;
+        data[pin + 'DebounceUs'] = parseInt(document.getElementById(pin + 'DebounceUs').value) || 0;
+        data[pin + 'Invert'] = document.getElementById(pin + 'Invert').checked;
+        data[pin + 'Pull'] = parseInt(document.getElementById(pin + 'Pull').value);
+        data[pin + 'Edges'] = parseInt(document.getElementById(pin + 'Edges').value);
+        data[pin + 'Mode'] = parseInt(document.getElementById(pin + 'Mode').value);
+        data[pin + 'ReportMs'] = parseInt(document.getElementById(pin + 'ReportMs').value) || 0;
+        data[pin + 'ReportThreshold'] = parseInt(document.getElementById(pin + 'ReportThreshold').value) || 0;
+        data[pin + 'EventBurst'] = parseInt(document.getElementById(pin + 'EventBurst').value) || 0;
+        data[pin + 'EventsPerMin'] = parseInt(document.getElementById(pin + 'EventsPerMin').value) || 0;
+    }
+    for (let i = 1; i <= GPO_COUNT; i++) {
+        let pin = 'gpo' + i;
+        data[pin + 'Enabled'] = document.getElementById(pin + 'Enabled').checked;
+        data[pin + 'Gpio'] = parseInt(document.getElementById(pin + 'Gpio').value) || 0;
+        data[pin + 'Invert'] = document.getElementById(pin + 'Invert').checked;
+        data[pin + 'Rule'] = document.getElementById(pin + 'Rule').value.trim();
+    }
+    for (let i = 1; i <= EXP_COUNT; i++) {
+        let exp = 'exp' + i;
+        let intGpio = document.getElementById(exp + 'IntGpio').value.trim();
+        data[exp + 'Enabled'] = document.getElementById(exp + 'Enabled').checked;
+        data[exp + 'Address'] = parseHex(document.getElementById(exp + 'Address').value) || 0x20 + i - 1;
+        data[exp + 'IntGpio'] = intGpio === '' ? EXP_NO_INT : parseInt(intGpio);
+        data[exp + 'InputMask'] = parseHex(document.getElementById(exp + 'InputMask').value) || 0;
+        data[exp + 'InvertMask'] = parseHex(document.getElementById(exp + 'InvertMask').value) || 0;
+        data[exp + 'PullUpMask'] = parseHex(document.getElementById(exp + 'PullUpMask').value) || 0;
+        data[exp + 'DebounceUs'] = parseInt(document.getElementById(exp + 'DebounceUs').value) || 0;
+        data[exp + 'Edges'] = parseInt(document.getElementById(exp + 'Edges').value);
+        data[exp + 'EventBurst'] = parseInt(document.getElementById(exp + 'EventBurst').value) || 0;
+        data[exp + 'EventsPerMin'] = parseInt(document.getElementById(exp + 'EventsPerMin').value) || 0;
+    }
+}
+
+// Selects can't take their value from a placeholder attribute, copy it over once on load
+function loadPinSelects() {
+    for (let select of document.querySelectorAll('#network-block select[data-value], #pins-block select[data-value], #web-block select[data-value]')) {
+        select.value = select.dataset.value;
+    }
+}
+
 // Post func collect only the enabled data and send it (eg if tcp not enabled, the result wont send any tcp related data)
 function sendJson() {
     
@@ -82,6 +254,9 @@ function sendJson() {
         ip: document.getElementById('ip').value,
         gateway: document.getElementById('gateway').value,
         subnetMask: document.getElementById('subnetMask').value,
+        backupIp: document.getElementById('backupIp').value,
+        backupGateway: document.getElementById('backupGateway').value,
+        backupSubnetMask: document.getElementById('backupSubnetMask').value,
         companionMode: document.getElementById('companionEnabled').checked,
         tcpEnabled:document.getElementById('tcpEnabled').checked,
         httpEnabled:document.getElementById('httpEnabled').checked,
@@ -123,6 +298,23 @@ function sendJson() {
         data.serialEnabled = false;
     }
 
+    // Syslog streams in every mode, Companion included
+    data.syslogEnabled = document.getElementById('syslogEnabled').checked;
+    if (data.syslogEnabled) {
+        data.syslogIp = document.getElementById('syslogIp').value;
+        data.syslogPort = parseInt(document.getElementById('syslogPort').value) || 0;
+    }
+
+    data.ethRxMode = parseInt(document.getElementById('ethRxMode').value) || 0;
+    data.webLruPurge = document.getElementById('webLruPurge').checked;
+    data.webKeepAlive = document.getElementById('webKeepAlive').checked;
+    for (const id of ['webMaxSockets', 'webBacklog', 'webKeepAliveIdleS', 'webKeepAliveIntervalS',
+                      'webKeepAliveCount', 'webTaskPriority', 'webTaskCore', 'webRecvTimeoutS', 'webSendTimeoutS']) {
+        data[id] = parseInt(document.getElementById(id).value) || 0;
+    }
+
+    addPinMap(data);
+
     let adminPassword = document.getElementById('adminPassword').value;
     
     // Send password only if user set some data there
@@ -140,7 +332,7 @@ function sendJson() {
                 alert('Configuration Saved Successfully!');
                 location.reload();
             } else {
-                alert('Error saving configuration!');
+                response.text().then(reason => alert('Error saving configuration! ' + reason));
             }
         });
 }
@@ -210,6 +402,7 @@ function toggleCompanionMode() {
 }
 
 window.onload = function () {
+    loadPinSelects();
     toggleTcpSettings();
     toggleHttpSettings();
     toggleCompanionMode();